@@ -0,0 +1,912 @@
+/**********************************************************************/
+/* batch.c - Decodes/encodes one script file, or every script file in */
+/*           a directory on a pool of worker threads.  The text       */
+/*           tables are loaded once and shared read only, each file   */
+/*           gets its own lsb_context, so a batch run writes exactly  */
+/*           the same outputs as running lsb once per file.           */
+/**********************************************************************/
+
+
+/************/
+/* Includes */
+/************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <glob.h>
+#include <sys/stat.h>
+#endif
+#include "batch.h"
+#include "util.h"
+#include "parse_binary.h"
+#include "parse_script.h"
+#include "bpe_train.h"
+#include "snode_list.h"
+#include "write_script.h"
+#include "bpe_compression.h"
+#include "psx_decode.h"
+#include "parse_binary_psx.h"
+#include "parse_binary_reEng.h"
+#include "decode_cache.h"
+#include "script_cfg.h"
+
+
+/***********/
+/* Defines */
+/***********/
+#define MAX_WORKERS    64
+
+/* Files of a batch run, claimed one at a time by the workers */
+typedef struct batchJob{
+    char** pInNames;
+    char** pOutNames;
+    unsigned int numFiles;
+    volatile long next;            /* Index of the next unclaimed file */
+    volatile long numFailed;
+    int decode;
+    int enc;
+    int sss;
+    int prune;
+    int optimal;
+    int report;
+}batchJob;
+
+
+
+/***********************/
+/* Function Prototypes */
+/***********************/
+int loadTables(int ienc, int oenc, int sss);
+void releaseTables(int ienc);
+int decodeFile(lsb_context* ctx, const char* inFileName, const char* outFileName, int ienc, int sss);
+int encodeFile(lsb_context* ctx, const char* inFileName, const char* outFileName, int oenc, int sss, int prune, int optimal, int report);
+int runBatch(int decode, const char* inSpec, const char* outDir, int enc, int sss, int prune, int optimal, int report);
+int runBPETrain(const char* inSpec, const char* tableName);
+static void runJobs(batchJob* pJob);
+static long claimNext(volatile long* pCount);
+static int getNumCores(void);
+static int listInputs(const char* inSpec, int decode, char*** ppNames, unsigned int* pNum);
+static int addName(char*** ppNames, unsigned int* pNum, unsigned int* pMax, const char* dir, const char* name);
+static int isInputName(const char* name, int decode);
+static int endsWithNoCase(const char* str, const char* suffix);
+static int cmpNames(const void* a, const void* b);
+static char* makeOutName(const char* outDir, const char* inName, int decode);
+static void freeNames(char** pNames, unsigned int num);
+#ifdef _WIN32
+static DWORD WINAPI workerMain(LPVOID pArg);
+#else
+static void* workerMain(void* pArg);
+#endif
+
+
+
+
+/*******************************************************************/
+/* loadTables                                                      */
+/* Loads the shared text tables needed by a decode (ienc) or       */
+/* encode (oenc) mode.  Pass -1 for the unused one.                */
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+int loadTables(int ienc, int oenc, int sss){
+
+    int mode = ienc;
+
+    if ((ienc == 5) || (ienc == 6))
+        ienc = 4;
+
+    /***************************************************/
+    /* Load in the Table File for Decoding 2-Byte Text */
+    /***************************************************/
+    if (loadUTF8Table("font_table.txt", sss) < 0){
+        printf("Error loading UTF8 Table for Text Decoding.\n");
+        return -1;
+    }
+
+    /*****************************************************/
+    /* Load in the Table Files for BPE Decoding/Encoding */
+    /*****************************************************/
+    if ((ienc == 1) || (oenc == 1)){
+        if (loadBPETable("bpe.table", "8bit_table.txt") < 0){
+            printf("Error loading BPE Tables for Text Encoding/Decoding.\n");
+            return -1;
+        }
+    }
+
+    /***********************************************/
+    /* Load in PSX Decode String Table if Required */
+    /***********************************************/
+    if (ienc == 4){
+        if (loadPSXStringTable("lsss_txtcmpstr_us.bin") < 0){
+            printf("Error loading Lunar Eng PSX String Decode Table For Decoding.\n");
+            return -1;
+        }
+    }
+
+    /* Decode outputs are cached per table contents if enabled */
+    if (mode >= 0)
+        initDecodeCache(mode);
+
+    return 0;
+}
+
+
+
+
+/*******************************************************************/
+/* releaseTables - Frees tables loaded by loadTables.              */
+/*******************************************************************/
+void releaseTables(int ienc){
+
+    /* Remove PSX String Table (if used) */
+    if ((ienc == 4) || (ienc == 5) || (ienc == 6))
+        releasePSXStringTable();
+
+    /* Remove the font table */
+    releaseUTF8Table();
+
+    return;
+}
+
+
+
+
+/*******************************************************************/
+/* decodeFile                                                      */
+/* Decodes a binary script into a script file plus the TXT and CSV */
+/* dumps named after it.  ctx must be freshly initialized.         */
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+int decodeFile(lsb_context* ctx, const char* inFileName, const char* outFileName, int ienc, int sss){
+
+    FILE *inFile, *outFile, *csvOutFile, *txtOutFile;
+    char csvOutFileName[LSB_PATH_MAX];
+    char txtOutFileName[LSB_PATH_MAX];
+    char cacheKey[CACHE_KEY_SIZE];
+    int rval, cached;
+    int remaster = 0;
+    int mode = ienc;
+
+    /* Check decode parameters */
+    setTextDecodeMethod(ctx, ienc);
+    if (ienc == 6){
+        ienc = 4;
+        remaster = 1;
+    }
+    if (ienc == 5)
+        ienc = 4;
+    if (sss)
+        setSSSEncode(ctx);
+
+    if (strlen(outFileName) + 32 > LSB_PATH_MAX){
+        printf("Error, output filename %s is too long.\n", outFileName);
+        return -1;
+    }
+    strcpy(txtOutFileName, outFileName);
+    strcat(txtOutFileName, "_dump.txt");
+
+    /* Build unique CSV output filename to alleviate */
+    /* Excel frustration with duplicate filenames open simultaneously */
+    strcpy(csvOutFileName, outFileName);
+    if (ienc == 2)
+        strcat(csvOutFileName, "_iosJP");
+    else if (ienc == 3)
+        strcat(csvOutFileName, "_iosENG");
+    else if (remaster == 1)
+        strcat(csvOutFileName, "_reENG");
+    else if (ienc == 4)
+        strcat(csvOutFileName, "_psxENG");
+    else if (sss)
+        strcat(csvOutFileName, "_sss");
+    else
+        strcat(csvOutFileName, "_sssm");
+    strcat(csvOutFileName, "_dump.csv");
+
+    /*******************************/
+    /* Open the input/output files */
+    /*******************************/
+    inFile = fopen(inFileName, "rb");
+    if (inFile == NULL){
+        printf("Error occurred while opening input script %s for reading\n", inFileName);
+        return -1;
+    }
+
+    /* Reuse the outputs of an identical earlier decode */
+    cached = (getCacheKey(inFile, mode, sss, cacheKey) == 0);
+    if (cached && (cacheFetch(cacheKey, outFileName, txtOutFileName, csvOutFileName) == 0)){
+        printf("Decode cache hit, outputs reused.\n");
+        fclose(inFile);
+        return 0;
+    }
+
+    outFile = fopen(outFileName, "wb");
+    if (outFile == NULL){
+        printf("Error occurred while opening output file %s for writing\n", outFileName);
+        fclose(inFile);
+        return -1;
+    }
+
+    /*******************************/
+    /* Parse the Input Binary File */
+    /*******************************/
+    printf("Parsing input file.\n");
+    if (remaster == 1)
+        rval = decodeBinaryScript_RE_Eng(ctx, inFile, outFile);
+    else if (ienc == 4)
+        rval = decodeBinaryScript_PSX(ctx, inFile, outFile);
+    else
+        rval = decodeBinaryScript(ctx, inFile, outFile);
+    fclose(inFile);
+    if (rval != 0){
+        printf("Input File Parsing FAILED. Aborting further operations.\n");
+        fclose(outFile);
+        return -1;
+    }
+    printf("Input File Parsed Successfully.\n");
+
+    printf("DECODE Mode Entered.\n");
+
+    /* Write out the data as a Script file */
+    rval = writeScript(ctx, outFile);
+    fclose(outFile);
+    if (rval == 0){
+        printf("Input Script File Updated Successfully.\n");
+    }
+    else{
+        printf("Input Script File Updating FAILED.\n");
+    }
+
+    /* Text Script Output */
+    txtOutFile = fopen(txtOutFileName, "wb");
+    if (txtOutFile == NULL){
+        printf("Error occurred while opening TXT dump output file %s for writing\n", txtOutFileName);
+        return -1;
+    }
+
+    /* CSV Script Output */
+    csvOutFile = fopen(csvOutFileName, "wb");
+    if (csvOutFile == NULL){
+        printf("Error occurred while opening CSV dump output file %s for writing\n", csvOutFileName);
+        fclose(txtOutFile);
+        return -1;
+    }
+
+    if (dumpScript(ctx, csvOutFile, txtOutFile) == 0){
+        printf("Script File Dumps Created.\n");
+    }
+    else{
+        printf("Script File Dumps FAILED.\n");
+        rval = -1;
+    }
+    fclose(txtOutFile);
+    fclose(csvOutFile);
+
+    if (cached && (rval == 0))
+        cacheStore(cacheKey, outFileName, txtOutFileName, csvOutFileName, ctx->pWarnings, ctx->warnLen);
+
+    return rval;
+}
+
+
+
+
+/*******************************************************************/
+/* encodeFile                                                      */
+/* Encodes a script file into a binary script.  ctx must be        */
+/* freshly initialized.  With prune, commands that can never run   */
+/* are left out and a reachability dump is written alongside.      */
+/* With optimal, BPE text gets its shortest encoding rather than   */
+/* the greedy one.  With report, the bytes each node, pointer ID   */
+/* and subroutine code take are listed alongside, even if the      */
+/* script does not fit.                                            */
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+int encodeFile(lsb_context* ctx, const char* inFileName, const char* outFileName, int oenc, int sss, int prune, int optimal, int report){
+
+    FILE *inFile, *outFile, *cfgOutFile, *sizeOutFile;
+    char cfgOutFileName[LSB_PATH_MAX];
+    char sizeOutFileName[LSB_PATH_MAX];
+    unsigned int numUnreachable;
+    int rval;
+
+    /* Check encode parameters */
+    setTableOutputMode(ctx, oenc);
+    if (sss)
+        setSSSEncode(ctx);
+    ctx->bpeOptimal = optimal;
+
+    /*******************************/
+    /* Open the input/output files */
+    /*******************************/
+    inFile = fopen(inFileName, "rb");
+    if (inFile == NULL){
+        printf("Error occurred while opening input script %s for reading\n", inFileName);
+        return -1;
+    }
+    outFile = fopen(outFileName, "wb");
+    if (outFile == NULL){
+        printf("Error occurred while opening output file %s for writing\n", outFileName);
+        fclose(inFile);
+        return -1;
+    }
+
+    /*******************************/
+    /* Parse the Input Script File */
+    /*******************************/
+    printf("Parsing input file.\n");
+    rval = encodeScript(ctx, inFile, outFile);
+    fclose(inFile);
+    if (rval != 0){
+        printf("Input File Parsing FAILED. Aborting further operations.\n");
+        fclose(outFile);
+        return -1;
+    }
+    printf("Input File Parsed Successfully.\n");
+
+    /* Leave out commands no pointer leads to, listing what was reached */
+    if (prune){
+        if (strlen(outFileName) + 16 > LSB_PATH_MAX){
+            printf("Error, output filename %s is too long.\n", outFileName);
+            fclose(outFile);
+            return -1;
+        }
+        strcpy(cfgOutFileName, outFileName);
+        strcat(cfgOutFileName, "_cfg.csv");
+        if (buildScriptCFG(ctx, &numUnreachable) != 0){
+            printf("Error, script has pointers set by value, unreachable commands cannot be determined.\n");
+            fclose(outFile);
+            return -1;
+        }
+        cfgOutFile = fopen(cfgOutFileName, "wb");
+        if ((cfgOutFile == NULL) || (writeCFGDump(ctx, cfgOutFile) != 0)){
+            printf("Error occurred while writing reachability dump %s\n", cfgOutFileName);
+            if (cfgOutFile != NULL)
+                fclose(cfgOutFile);
+            fclose(outFile);
+            return -1;
+        }
+        fclose(cfgOutFile);
+        printf("%u unreachable commands, %d removed.\n", numUnreachable, pruneUnreachable(ctx));
+    }
+
+    printf("ENCODE Mode Entered.\n");
+
+    /* Write out the data as a binary file */
+    rval = writeBinScript(ctx, outFile);
+    fclose(outFile);
+
+    /* List where the space went, also when the script did not fit */
+    if (report){
+        if (strlen(outFileName) + 16 > LSB_PATH_MAX){
+            printf("Error, output filename %s is too long.\n", outFileName);
+            return -1;
+        }
+        strcpy(sizeOutFileName, outFileName);
+        strcat(sizeOutFileName, "_size.csv");
+        if (!prune && (buildScriptCFG(ctx, &numUnreachable) != 0))
+            printf("Warning, script has pointers set by value, some commands are listed without a pointer ID.\n");
+        sizeOutFile = fopen(sizeOutFileName, "wb");
+        if ((sizeOutFile == NULL) || (writeSizeReport(ctx, sizeOutFile) != 0)){
+            printf("Error occurred while writing size report %s\n", sizeOutFileName);
+            rval = -1;
+        }
+        if (sizeOutFile != NULL)
+            fclose(sizeOutFile);
+    }
+
+    if (rval == 0){
+        printf("Input File Encoded Successfully.\n");
+        if (optimal && (oenc == 1))
+            printf("Optimal BPE parse saved %u bytes over greedy.\n", ctx->bpeBytesSaved);
+    }
+    else{
+        printf("Input File Encoding FAILED.\n");
+    }
+
+    return rval;
+}
+
+
+
+
+/*******************************************************************/
+/* runBatch                                                        */
+/* Decodes (*.DAT) or encodes (*.txt) every script file in the     */
+/* inSpec directory, or every file matching the inSpec wildcard,   */
+/* into outDir.  Outputs are named like the per-file commands,     */
+/* TEXT000.DAT decodes to outDir/TEXT000.txt and its dumps, and    */
+/* TEXT000.txt encodes to outDir/TEXT000.DAT.  The tables must     */
+/* already be loaded.  Files are handed out one at a time to a     */
+/* worker per core, so slow scripts do not hold up the others.     */
+/* Returns 0 if every file succeeded, -1 otherwise.                */
+/*******************************************************************/
+int runBatch(int decode, const char* inSpec, const char* outDir, int enc, int sss, int prune, int optimal, int report){
+
+    batchJob job;
+    unsigned int x, numWorkers;
+#ifdef _WIN32
+    HANDLE workers[MAX_WORKERS];
+#else
+    pthread_t workers[MAX_WORKERS];
+#endif
+
+    memset(&job, 0, sizeof(batchJob));
+    job.decode = decode;
+    job.enc = enc;
+    job.sss = sss;
+    job.prune = prune;
+    job.optimal = optimal;
+    job.report = report;
+
+    /* Find the input files */
+    if (listInputs(inSpec, decode, &job.pInNames, &job.numFiles) != 0)
+        return -1;
+    if (job.numFiles == 0){
+        printf("No input files found for %s\n", inSpec);
+        return -1;
+    }
+
+    /* Create the output directory if needed */
+#ifdef _WIN32
+    _mkdir(outDir);
+#else
+    mkdir(outDir, 0777);
+#endif
+
+    /* Name the outputs */
+    job.pOutNames = (char**)calloc(job.numFiles, sizeof(char*));
+    if (job.pOutNames == NULL){
+        printf("Error allocing memory for output filenames.\n");
+        freeNames(job.pInNames, job.numFiles);
+        return -1;
+    }
+    for (x = 0; x < job.numFiles; x++){
+        job.pOutNames[x] = makeOutName(outDir, job.pInNames[x], decode);
+        if (job.pOutNames[x] == NULL){
+            freeNames(job.pInNames, job.numFiles);
+            freeNames(job.pOutNames, job.numFiles);
+            return -1;
+        }
+    }
+
+    /* One worker per core, the calling thread is one of them */
+    numWorkers = (unsigned int)getNumCores();
+    if (numWorkers > job.numFiles)
+        numWorkers = job.numFiles;
+    if (numWorkers > MAX_WORKERS)
+        numWorkers = MAX_WORKERS;
+    if (numWorkers < 1)
+        numWorkers = 1;
+    printf("%s %u files using %u threads.\n", decode ? "Decoding" : "Encoding", job.numFiles, numWorkers);
+
+    for (x = 1; x < numWorkers; x++){
+#ifdef _WIN32
+        workers[x] = CreateThread(NULL, 0, workerMain, &job, 0, NULL);
+        if (workers[x] == NULL)
+            break;
+#else
+        if (pthread_create(&workers[x], NULL, workerMain, &job) != 0)
+            break;
+#endif
+    }
+    numWorkers = x;
+    runJobs(&job);
+    for (x = 1; x < numWorkers; x++){
+#ifdef _WIN32
+        WaitForSingleObject(workers[x], INFINITE);
+        CloseHandle(workers[x]);
+#else
+        pthread_join(workers[x], NULL);
+#endif
+    }
+
+    if (job.numFailed > 0)
+        printf("%ld of %u files FAILED.\n", (long)job.numFailed, job.numFiles);
+    else
+        printf("All %u files processed successfully.\n", job.numFiles);
+
+    freeNames(job.pInNames, job.numFiles);
+    freeNames(job.pOutNames, job.numFiles);
+
+    return (job.numFailed > 0) ? -1 : 0;
+}
+
+
+
+
+/*******************************************************************/
+/* runBPETrain                                                     */
+/* Builds a BPE table named tableName from every script file       */
+/* (*.txt) in the inSpec directory, or matching the inSpec         */
+/* wildcard.  Uses 8bit_table.txt for the 1-byte codes.            */
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+int runBPETrain(const char* inSpec, const char* tableName){
+
+    char** pNames;
+    unsigned int numFiles;
+    int rval;
+
+    if (listInputs(inSpec, 0, &pNames, &numFiles) != 0)
+        return -1;
+    if (numFiles == 0){
+        printf("No input files found for %s\n", inSpec);
+        return -1;
+    }
+
+    printf("Training BPE table on %u files.\n", numFiles);
+    rval = trainBPETable(pNames, numFiles, tableName, "8bit_table.txt");
+    if (rval == 0)
+        printf("BPE table %s created.\n", tableName);
+    else
+        printf("BPE table training FAILED.\n");
+
+    freeNames(pNames, numFiles);
+
+    return rval;
+}
+
+
+
+
+/*******************************************************************/
+/* runJobs                                                         */
+/* Claims and processes files until none are left.  Each file gets */
+/* a fresh context.                                                */
+/*******************************************************************/
+static void runJobs(batchJob* pJob){
+
+    lsb_context* ctx;
+    long index;
+    int rval;
+
+    ctx = (lsb_context*)malloc(sizeof(lsb_context));
+    if (ctx == NULL){
+        printf("Error creating script context.\n");
+        return;
+    }
+
+    while ((index = claimNext(&pJob->next)) < (long)pJob->numFiles){
+
+        if (initContext(ctx) != 0){
+            printf("Error creating script context.\n");
+            releaseContext(ctx);
+            claimNext(&pJob->numFailed);
+            continue;
+        }
+
+        if (pJob->decode)
+            rval = decodeFile(ctx, pJob->pInNames[index], pJob->pOutNames[index], pJob->enc, pJob->sss);
+        else
+            rval = encodeFile(ctx, pJob->pInNames[index], pJob->pOutNames[index], pJob->enc, pJob->sss, pJob->prune, pJob->optimal, pJob->report);
+        releaseContext(ctx);
+
+        if (rval != 0){
+            printf("FAILED: %s\n", pJob->pInNames[index]);
+            claimNext(&pJob->numFailed);
+        }
+    }
+    free(ctx);
+
+    return;
+}
+
+
+
+
+/*******************************************************************/
+/* workerMain - Thread entry point, runs jobs.                     */
+/*******************************************************************/
+#ifdef _WIN32
+static DWORD WINAPI workerMain(LPVOID pArg){
+    runJobs((batchJob*)pArg);
+    return 0;
+}
+#else
+static void* workerMain(void* pArg){
+    runJobs((batchJob*)pArg);
+    return NULL;
+}
+#endif
+
+
+
+
+/*******************************************************************/
+/* claimNext                                                       */
+/* Atomically increments a counter, returning its previous value.  */
+/*******************************************************************/
+static long claimNext(volatile long* pCount){
+#ifdef _WIN32
+    return InterlockedIncrement(pCount) - 1;
+#else
+    return __sync_fetch_and_add(pCount, 1);
+#endif
+}
+
+
+
+
+/*******************************************************************/
+/* getNumCores - Returns the number of online processors.          */
+/*******************************************************************/
+static int getNumCores(void){
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long num = sysconf(_SC_NPROCESSORS_ONLN);
+    return (num < 1) ? 1 : (int)num;
+#endif
+}
+
+
+
+
+/*******************************************************************/
+/* listInputs                                                      */
+/* Builds a sorted list of input files from a directory (keeping   */
+/* only script files for the mode) or a wildcard pattern.          */
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+static int listInputs(const char* inSpec, int decode, char*** ppNames, unsigned int* pNum){
+
+    unsigned int maxNames = 0;
+    int rval = 0;
+
+    *ppNames = NULL;
+    *pNum = 0;
+
+#ifdef _WIN32
+    {
+        WIN32_FIND_DATAA fd;
+        HANDLE hFind;
+        char pattern[LSB_PATH_MAX];
+        char dir[LSB_PATH_MAX];
+        DWORD attr = GetFileAttributesA(inSpec);
+        int isDir = (attr != INVALID_FILE_ATTRIBUTES) && (attr & FILE_ATTRIBUTE_DIRECTORY);
+        char* pSlash;
+
+        if (strlen(inSpec) + 3 > LSB_PATH_MAX){
+            printf("Error, input path %s is too long.\n", inSpec);
+            return -1;
+        }
+        strcpy(pattern, inSpec);
+        strcpy(dir, inSpec);
+        if (isDir){
+            strcat(pattern, "\\*");
+        }
+        else{
+            /* Matches are relative to the pattern's directory */
+            pSlash = strrchr(dir, '\\');
+            if ((pSlash == NULL) || ((strrchr(dir, '/') != NULL) && (strrchr(dir, '/') > pSlash)))
+                pSlash = strrchr(dir, '/');
+            if (pSlash != NULL)
+                *pSlash = '\0';
+            else
+                strcpy(dir, ".");
+        }
+
+        hFind = FindFirstFileA(pattern, &fd);
+        if (hFind != INVALID_HANDLE_VALUE){
+            do{
+                if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+                    continue;
+                if (isDir && !isInputName(fd.cFileName, decode))
+                    continue;
+                if (addName(ppNames, pNum, &maxNames, dir, fd.cFileName) != 0){
+                    rval = -1;
+                    break;
+                }
+            } while (FindNextFileA(hFind, &fd));
+            FindClose(hFind);
+        }
+    }
+#else
+    {
+        struct stat st;
+
+        if ((stat(inSpec, &st) == 0) && S_ISDIR(st.st_mode)){
+            DIR* pDir = opendir(inSpec);
+            struct dirent* pEnt;
+
+            if (pDir == NULL){
+                printf("Error opening directory %s\n", inSpec);
+                return -1;
+            }
+            while ((pEnt = readdir(pDir)) != NULL){
+                if (!isInputName(pEnt->d_name, decode))
+                    continue;
+                if (addName(ppNames, pNum, &maxNames, inSpec, pEnt->d_name) != 0){
+                    rval = -1;
+                    break;
+                }
+            }
+            closedir(pDir);
+        }
+        else{
+            glob_t g;
+            size_t x;
+
+            if (glob(inSpec, 0, NULL, &g) == 0){
+                for (x = 0; x < g.gl_pathc; x++){
+                    if ((stat(g.gl_pathv[x], &st) != 0) || S_ISDIR(st.st_mode))
+                        continue;
+                    if (addName(ppNames, pNum, &maxNames, NULL, g.gl_pathv[x]) != 0){
+                        rval = -1;
+                        break;
+                    }
+                }
+            }
+            globfree(&g);
+        }
+    }
+#endif
+
+    if (rval != 0){
+        freeNames(*ppNames, *pNum);
+        *ppNames = NULL;
+        *pNum = 0;
+        return -1;
+    }
+
+    /* Same order on every platform */
+    if (*pNum > 1)
+        qsort(*ppNames, *pNum, sizeof(char*), cmpNames);
+
+    return 0;
+}
+
+
+
+
+/*******************************************************************/
+/* addName                                                         */
+/* Appends dir/name (or just name if dir is NULL) to a name list.  */
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+static int addName(char*** ppNames, unsigned int* pNum, unsigned int* pMax, const char* dir, const char* name){
+
+    char* pName;
+    size_t len = strlen(name) + 1;
+
+    if (dir != NULL)
+        len += strlen(dir) + 1;
+
+    if (*pNum >= *pMax){
+        unsigned int newMax = (*pMax == 0) ? 128 : (*pMax * 2);
+        char** pNew = (char**)realloc(*ppNames, newMax * sizeof(char*));
+        if (pNew == NULL){
+            printf("Error allocing memory for input filenames.\n");
+            return -1;
+        }
+        *ppNames = pNew;
+        *pMax = newMax;
+    }
+
+    pName = (char*)malloc(len);
+    if (pName == NULL){
+        printf("Error allocing memory for input filenames.\n");
+        return -1;
+    }
+    if (dir != NULL)
+        sprintf(pName, "%s/%s", dir, name);
+    else
+        strcpy(pName, name);
+    (*ppNames)[(*pNum)++] = pName;
+
+    return 0;
+}
+
+
+
+
+/*******************************************************************/
+/* isInputName                                                     */
+/* Binary scripts (*.DAT) are decoded.  Script files (*.txt) are   */
+/* encoded, skipping the *_dump.txt files a decode creates.        */
+/*******************************************************************/
+static int isInputName(const char* name, int decode){
+
+    if (decode)
+        return endsWithNoCase(name, ".dat");
+    return endsWithNoCase(name, ".txt") && !endsWithNoCase(name, "_dump.txt");
+}
+
+
+
+
+/*******************************************************************/
+/* endsWithNoCase - Case insensitive suffix test.                  */
+/*******************************************************************/
+static int endsWithNoCase(const char* str, const char* suffix){
+
+    size_t len = strlen(str);
+    size_t sLen = strlen(suffix);
+    size_t x;
+
+    if (sLen > len)
+        return 0;
+    str += len - sLen;
+    for (x = 0; x < sLen; x++){
+        if (tolower((unsigned char)str[x]) != tolower((unsigned char)suffix[x]))
+            return 0;
+    }
+
+    return 1;
+}
+
+
+
+
+/*******************************************************************/
+/* cmpNames - qsort comparison for filenames.                      */
+/*******************************************************************/
+static int cmpNames(const void* a, const void* b){
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+
+
+
+/*******************************************************************/
+/* makeOutName                                                     */
+/* Returns outDir/<input name> with its extension replaced by .txt */
+/* (decode) or .DAT (encode), or NULL on failure.                  */
+/*******************************************************************/
+static char* makeOutName(const char* outDir, const char* inName, int decode){
+
+    const char* pBase = inName;
+    const char* p;
+    char* pOut;
+    size_t baseLen;
+
+    for (p = inName; *p != '\0'; p++){
+        if ((*p == '/') || (*p == '\\'))
+            pBase = p + 1;
+    }
+    p = strrchr(pBase, '.');
+    baseLen = (p != NULL) ? (size_t)(p - pBase) : strlen(pBase);
+
+    if (strlen(outDir) + baseLen + 6 > LSB_PATH_MAX){
+        printf("Error, output filename for %s is too long.\n", inName);
+        return NULL;
+    }
+    pOut = (char*)malloc(LSB_PATH_MAX);
+    if (pOut == NULL){
+        printf("Error allocing memory for output filenames.\n");
+        return NULL;
+    }
+    sprintf(pOut, "%s/%.*s%s", outDir, (int)baseLen, pBase, decode ? ".txt" : ".DAT");
+
+    return pOut;
+}
+
+
+
+
+/*******************************************************************/
+/* freeNames - Frees a list of filenames.                          */
+/*******************************************************************/
+static void freeNames(char** pNames, unsigned int num){
+
+    unsigned int x;
+
+    if (pNames == NULL)
+        return;
+    for (x = 0; x < num; x++){
+        if (pNames[x] != NULL)
+            free(pNames[x]);
+    }
+    free(pNames);
+
+    return;
+}
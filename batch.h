@@ -0,0 +1,26 @@
+/**********************************************************************/
+/* batch.h - Single file and whole directory decode/encode jobs.      */
+/**********************************************************************/
+#ifdef _MSC_VER
+#pragma warning(disable:4996)
+#endif
+#ifndef BATCH_H
+#define BATCH_H
+#include "lsb_context.h"
+
+/* Defines */
+#define LSB_PATH_MAX   1024
+
+
+/***********************/
+/* Function Prototypes */
+/***********************/
+int loadTables(int ienc, int oenc, int sss);
+void releaseTables(int ienc);
+int decodeFile(lsb_context* ctx, const char* inFileName, const char* outFileName, int ienc, int sss);
+int encodeFile(lsb_context* ctx, const char* inFileName, const char* outFileName, int oenc, int sss, int prune, int optimal, int report);
+int runBatch(int decode, const char* inSpec, const char* outDir, int enc, int sss, int prune, int optimal, int report);
+int runBPETrain(const char* inSpec, const char* tableName);
+
+
+#endif
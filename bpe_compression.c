@@ -18,6 +18,10 @@
 /***********/
 #define DELIMITER      "`"
 #define NUM_CH_CODES   0xF0  /* 240 (0-239) */
+#define BPE_HASH_SIZE  512   /* Power of 2, at least 2x NUM_CH_CODES */
+#define BPE_NO_CODE    -1
+#define BPE_NO_PAIR    0xFF  /* ch_pairCode value for pairs no code replaces */
+#define MAX_GLYPH_EXP  256   /* Longest code expansion compressBPEOptimal uses */
 
 /* Usage Struct for New/Existing Codes */
 typedef struct chCodeRecord chCodeRecord;
@@ -31,6 +35,28 @@ struct chCodeRecord{
 
 /* Globals */
 static chCodeRecord ch_codes[NUM_CH_CODES];
+static unsigned int ch_expSize[NUM_CH_CODES];  /* Bytes decompressBPE writes per code */
+static unsigned int ch_expOffset[NUM_CH_CODES];/* Start of each code in ch_expData */
+static unsigned char* ch_expData = NULL;       /* Expansions of all codes, back to back */
+
+/* Lookups built by loadBPETable for the 1-byte encoded characters */
+static int ch_decode[256];                     /* Byte value -> ch_codes index */
+static unsigned int ch_hashKey[BPE_HASH_SIZE]; /* Packed UTF-8 character, 0 if unused */
+static unsigned char ch_hashByte[BPE_HASH_SIZE];
+
+/* Lowest code >= 1 replacing each byte pair, (byte1 << 8) | byte2 */
+static unsigned char ch_pairCode[0x10000];
+
+/* Trie of the 1-byte code strings each code stands for */
+typedef struct expTrieNode{
+    int child;               /* First node one code longer, -1 if none */
+    int sibling;             /* Next node with the same parent, -1 if none */
+    int code;                /* Lowest code standing for this string, BPE_NO_CODE if none */
+    unsigned char byteVal;
+}expTrieNode;
+static expTrieNode* ch_trie = NULL;
+static unsigned int ch_trieSize = 0;
+static int ch_trieRoot[256];
 
 
 
@@ -41,14 +67,28 @@ static chCodeRecord ch_codes[NUM_CH_CODES];
 /* Loading Existing BPE Data */
 int loadUtf8MappingForBPETable(char* bpeUtf8MappingTable);
 int loadBPETable(char* bpeTableName, char* bpeUtf8MappingTable);
+int loadBPESymbols(char* bpeUtf8MappingTable);
+static int finishBPETable(void);
 int utf8_to_bpe(char* utf8_in, unsigned char* rval);
-int bpe_to_utf8(unsigned char bpe_in, unsigned char* utf8_out);
+int bpe_to_utf8(unsigned char bpe_in, unsigned char* utf8_out, unsigned int outSize);
 int _8bit_binary_to_utf8Text(unsigned char* bdata, unsigned int binSizeBytes, char** pText);
 
 
 /* Compression/Decompression */
 void decompressBPE(unsigned char* dst, unsigned char* src, unsigned int* nBytes);
-void compressBPE(unsigned char* src, unsigned int* nBytes);
+unsigned int sizeDecompressedBPE(const unsigned char* src);
+int compressBPE(unsigned char* src, unsigned int* nBytes);
+int compressBPEOptimal(unsigned char* src, unsigned int* nBytes);
+static int buildExpansionTrie(void);
+static int glyphExpand(int code, unsigned char* pBuf, int maxLen, int depth);
+static void mergePair(unsigned char* src, int* pNext, int* pPrev, unsigned int* pCount, int pos, int code);
+static void computeExpandedSizes(void);
+static int computeExpansions(void);
+static void expandCode(int code, unsigned char* pState);
+static void getPairHalf(int byteVal, unsigned char* encodedVal);
+static void buildSymbolLookups(void);
+static void buildPairCodes(void);
+static unsigned int expandedSize(int code, unsigned char* pState);
 
 
 
@@ -222,7 +262,72 @@ int loadBPETable(char* bpeTableName, char* bpeUtf8MappingTable){
         return -1;
     }
 
-    return 0;
+    return finishBPETable();
+}
+
+
+
+
+/*******************************************************************/
+/* loadBPESymbols                                                  */
+/* Sets up a table with no pairs, for building a new bpe.table.    */
+/* Every index that has a character in the UTF-8 mapping table     */
+/* becomes a 1-byte code with the index as its value, as in the    */
+/* shipped bpe.table.  All other codes are left unused.            */
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+int loadBPESymbols(char* bpeUtf8MappingTable){
+
+    int x;
+
+    for (x = 0; x < NUM_CH_CODES; x++){
+        ch_codes[x].inuse = 1;
+        ch_codes[x].encoded = 0;
+        memset(ch_codes[x].utf8value, 0, 5);
+        memset(ch_codes[x].encvalue, 0, 5);
+        ch_codes[x].encvalue[0] = 0xFF;
+        ch_codes[x].encvalue[1] = (unsigned char)x;
+    }
+
+    if (loadUtf8MappingForBPETable(bpeUtf8MappingTable) < 0){
+        printf("Error loading UTF-8 Codes for BPE Entries\n");
+        return -1;
+    }
+
+    /* Indices without a character are free for pairs */
+    for (x = 0; x < NUM_CH_CODES; x++){
+        if (ch_codes[x].utf8value[0] == '\0'){
+            ch_codes[x].inuse = 0;
+            memset(ch_codes[x].encvalue, 0, 5);
+        }
+    }
+
+    return finishBPETable();
+}
+
+
+
+
+/*******************************************************************/
+/* finishBPETable                                                  */
+/* Builds the lookups derived from ch_codes once it is filled in.  */
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+static int finishBPETable(void){
+
+    /* Size and text of each code once decompressed */
+    computeExpandedSizes();
+    if (computeExpansions() < 0)
+        return -1;
+
+    /* Direct lookups for utf8_to_bpe and bpe_to_utf8 */
+    buildSymbolLookups();
+
+    /* Pair lookup for compressBPE */
+    buildPairCodes();
+
+    /* Code strings for compressBPEOptimal */
+    return buildExpansionTrie();
 }
 
 
@@ -235,16 +340,20 @@ int loadBPETable(char* bpeTableName, char* bpeUtf8MappingTable){
 /***************************************************************/
 int utf8_to_bpe(char* utf8_in, unsigned char* rval){
 
-    int x;
+    unsigned int packed, slot;
 
-    for(x = 0; x < NUM_CH_CODES; x++){
-        if((ch_codes[x].inuse == 1) && (ch_codes[x].encoded == 0)){
-            /* Check to see if encoding for this value should take place */
-            if(strcmp((char*)ch_codes[x].utf8value, (char*)utf8_in) == 0){
-                *rval = ch_codes[x].encvalue[1];
-                return 0;
-            }
+    packed = packUTF8(utf8_in);
+    if (packed == 0)
+        return -1;
+
+    for (slot = packed; ; slot++){
+        slot &= (BPE_HASH_SIZE - 1);
+        if (ch_hashKey[slot] == packed){
+            *rval = ch_hashByte[slot];
+            return 0;
         }
+        if (ch_hashKey[slot] == 0)
+            break;
     }
 
     /* Not Found */
@@ -256,20 +365,26 @@ int utf8_to_bpe(char* utf8_in, unsigned char* rval){
 
 /***************************************************************/
 /* bpe_to_utf8 - Convert a BPE character to its UTF8           */
-/*               equivalent.  Returns 0 on success, -1 on      */
-/*               error.                                        */
+/*               equivalent, NULL terminated, in the outSize   */
+/*               bytes at utf8_out.  Returns 0 on success, -1  */
+/*               if not found or it does not fit.              */
 /***************************************************************/
-int bpe_to_utf8(unsigned char bpe_in, unsigned char* utf8_out){
+int bpe_to_utf8(unsigned char bpe_in, unsigned char* utf8_out, unsigned int outSize){
 
-    int x;
+    int x = ch_decode[bpe_in];
+    unsigned int len;
 
-    for(x = 0; x < NUM_CH_CODES; x++){
-        if((ch_codes[x].inuse == 1) && (ch_codes[x].encoded == 0)){
-            /* Check to see if encoding for this value should take place */
-            if(ch_codes[x].encvalue[1] == bpe_in){
-                strcpy((char*)utf8_out, (char*)ch_codes[x].utf8value);
-                return 0;
-            }
+    if (outSize == 0)
+        return -1;
+
+    if (x != BPE_NO_CODE){
+        len = 0;
+        while ((len < sizeof(ch_codes[x].utf8value)) && (ch_codes[x].utf8value[len] != 0))
+            len++;
+        if (len < outSize){
+            memcpy(utf8_out, ch_codes[x].utf8value, len);
+            utf8_out[len] = '\0';
+            return 0;
         }
     }
 
@@ -327,10 +442,12 @@ int _8bit_binary_to_utf8Text(unsigned char* bdata, unsigned int binSizeBytes, ch
 	int x;
     unsigned char* ptrOutput;
     unsigned char* pTemp = NULL;
+    unsigned int tempSize;
     *pText = NULL;
 
     /* Allocate worst-case space - 4 bytes for each character plus terminator */
-    pTemp = (unsigned char*)malloc(binSizeBytes*4 +1);
+    tempSize = binSizeBytes*4 + 1;
+    pTemp = (unsigned char*)malloc(tempSize);
     if(pTemp == NULL){
         printf("Error allocating scratch space in _8bit_binary_to_utf8Text\n");
         return -1;
@@ -344,7 +461,7 @@ int _8bit_binary_to_utf8Text(unsigned char* bdata, unsigned int binSizeBytes, ch
         int numBytes;
 
         /* Retrieve utf-8 character */
-        if(bpe_to_utf8(bdata[x], ptrOutput) != 0){
+        if(bpe_to_utf8(bdata[x], ptrOutput, tempSize - (unsigned int)(ptrOutput - pTemp)) != 0){
             printf("Error, failed to look up 8-bit code for UTF8 Code\n");
             free(pTemp);
             return -1;
@@ -381,44 +498,148 @@ int _8bit_binary_to_utf8Text(unsigned char* bdata, unsigned int binSizeBytes, ch
 /* nBytes - Pass in number of bytes in src by reference.  When the  */
 /*          function has concluded execution, this number will be   */
 /*          updated to reflect the comrpessed size in bytes.        */
+/* Returns 0 on success, -1 if memory ran out (src is then left     */
+/* uncompressed).                                                   */
+/*                                                                  */
+/* Pairs are replaced as the original loop did: the leftmost        */
+/* occurrence of the lowest numbered code's pair that is present,   */
+/* then over again from code 1 (code 0 is only tried on the first   */
+/* pass).  Here the bytes are a linked list, so a replacement is a  */
+/* node merge, and the number of occurrences of each code's pair is */
+/* tracked, so the next code to apply is found without searching    */
+/* the text.  This takes about linear time.                         */
 /********************************************************************/
-void compressBPE(unsigned char* src, unsigned int* nBytes){
+int compressBPE(unsigned char* src, unsigned int* nBytes){
 
-    int x,y;
-    unsigned char newCode;
-    unsigned char newSeq[2];
-    unsigned int srch_offset = 0;
+    unsigned int count[NUM_CH_CODES];
+    int *pNext, *pPrev;
+    int numBytes, code, pos, x;
+    unsigned char byte1, byte2;
 
-    for(x = 0; x < NUM_CH_CODES; x++){
+    numBytes = (int)(*nBytes);
+    if (numBytes < 2)
+        return 0;
 
-        /* Check to see if encoding for this value should take place */
-        if((ch_codes[x].inuse == 1) && (ch_codes[x].encoded == 1)){
-            newSeq[0] = ch_codes[x].encvalue[0];
-            newSeq[1] = ch_codes[x].encvalue[1];
-            newCode = x;
+    pNext = (int*)malloc(2 * numBytes * sizeof(int));
+    if (pNext == NULL){
+        printf("Error allocating memory for BPE compression.\n");
+        return -1;
+    }
+    pPrev = pNext + numBytes;
+    for (x = 0; x < numBytes; x++){
+        pNext[x] = x + 1;
+        pPrev[x] = x - 1;
+    }
+    pNext[numBytes - 1] = -1;
+
+    /* Occurrences of each code's pair */
+    memset(count, 0, sizeof(count));
+    for (x = 0; x < numBytes - 1; x++){
+        code = ch_pairCode[(src[x] << 8) | src[x + 1]];
+        if (code != BPE_NO_PAIR)
+            count[code]++;
+    }
+
+    /* Code 0 first if its pair is present */
+    code = -1;
+    if ((ch_codes[0].inuse == 1) && (ch_codes[0].encoded == 1)){
+        for (x = 0; x < numBytes - 1; x++){
+            if ((src[x] == ch_codes[0].encvalue[0]) && (src[x + 1] == ch_codes[0].encvalue[1])){
+                code = 0;
+                break;
+            }
         }
-        else{
-            /* Skip */
-            continue;
+    }
+
+    while (1){
+
+        /* Lowest code with a pair left in the text */
+        if (code < 0){
+            for (x = 1; x < NUM_CH_CODES; x++){
+                if (count[x] > 0)
+                    break;
+            }
+            if (x >= NUM_CH_CODES)
+                break;
+            code = x;
         }
 
-        /* Perform Compression */
-        srch_offset = 0;
-        while (srch_offset < ((*nBytes) - 1)){
-            if (memcmp(newSeq, &src[srch_offset], 2) == 0){
-                src[srch_offset] = newCode;
-                for (y = (int)(srch_offset + 1); y < (int)((*nBytes) - 1); y++){
-                    src[y] = src[y + 1];
-                }
-                (*nBytes)--;
-                src[(*nBytes)] = 0xFF;
-                srch_offset = 0;
-				x = 0;  /* Keep iterating until nothing can be further compressed */
-			}
-            else{
-                srch_offset++;
+        /* Replace its pairs left to right.  The merged node may   */
+        /* pair up with the node before it, so step back after one */
+        byte1 = ch_codes[code].encvalue[0];
+        byte2 = ch_codes[code].encvalue[1];
+        pos = 0;
+        while ((pos >= 0) && (pNext[pos] >= 0)){
+            if ((src[pos] == byte1) && (src[pNext[pos]] == byte2)){
+                mergePair(src, pNext, pPrev, count, pos, code);
+                if (pPrev[pos] >= 0)
+                    pos = pPrev[pos];
             }
+            else
+                pos = pNext[pos];
         }
+        code = -1;
+    }
+
+    /* Compact the list, unused bytes become 0xFF */
+    x = 0;
+    for (pos = 0; pos >= 0; pos = pNext[pos])
+        src[x++] = src[pos];
+    *nBytes = x;
+    for (; x < numBytes; x++)
+        src[x] = 0xFF;
+
+    free(pNext);
+
+    return 0;
+}
+
+
+
+
+/*******************************************************************/
+/* mergePair                                                       */
+/* Replaces the node at pos and the one after it with code, and    */
+/* updates the pair counts for the pairs removed and created.      */
+/*******************************************************************/
+static void mergePair(unsigned char* src, int* pNext, int* pPrev, unsigned int* pCount, int pos, int code){
+
+    int prev, next, pair;
+
+    prev = pPrev[pos];
+    next = pNext[pNext[pos]];
+
+    /* Pairs that go away */
+    if (prev >= 0){
+        pair = ch_pairCode[(src[prev] << 8) | src[pos]];
+        if (pair != BPE_NO_PAIR)
+            pCount[pair]--;
+    }
+    pair = ch_pairCode[(src[pos] << 8) | src[pNext[pos]]];
+    if (pair != BPE_NO_PAIR)
+        pCount[pair]--;
+    if (next >= 0){
+        pair = ch_pairCode[(src[pNext[pos]] << 8) | src[next]];
+        if (pair != BPE_NO_PAIR)
+            pCount[pair]--;
+    }
+
+    /* Merge */
+    src[pos] = (unsigned char)code;
+    pNext[pos] = next;
+    if (next >= 0)
+        pPrev[next] = pos;
+
+    /* Pairs that are new */
+    if (prev >= 0){
+        pair = ch_pairCode[(src[prev] << 8) | src[pos]];
+        if (pair != BPE_NO_PAIR)
+            pCount[pair]++;
+    }
+    if (next >= 0){
+        pair = ch_pairCode[(src[pos] << 8) | src[next]];
+        if (pair != BPE_NO_PAIR)
+            pCount[pair]++;
     }
 
     return;
@@ -427,6 +648,95 @@ void compressBPE(unsigned char* src, unsigned int* nBytes){
 
 
 
+/********************************************************************/
+/* compressBPEOptimal - Re-encodes an 8-bit encoded string with the */
+/*                      fewest codes the loaded table allows.       */
+/* src, nBytes - As for compressBPE.                                */
+/* compressBPE replaces pairs greedily in table order, which can    */
+/* leave a longer result than needed.  Here every code stands for  */
+/* a string of 1-byte codes (its pair tree), and the shortest run  */
+/* of codes whose strings make up src is found by dynamic          */
+/* programming over src, walking the trie of those strings from    */
+/* each position.  The result is kept only if it is shorter than   */
+/* compressBPE's.  Returns the # of bytes saved compared with      */
+/* compressBPE, or -1 if memory ran out (src is then left          */
+/* uncompressed).                                                   */
+/********************************************************************/
+int compressBPEOptimal(unsigned char* src, unsigned int* nBytes){
+
+    unsigned int *pCost, *pFrom;
+    unsigned char *pGreedy, *pUse;
+    unsigned int numBytes, greedySize, size, x, y;
+    int node;
+
+    numBytes = *nBytes;
+    pCost = (unsigned int*)malloc((numBytes + 1) * 2 * sizeof(unsigned int));
+    pGreedy = (unsigned char*)malloc((numBytes + 1) * 2);
+    if ((pCost == NULL) || (pGreedy == NULL) || (ch_trie == NULL)){
+        printf("Error allocating memory for BPE compression.\n");
+        free(pCost);
+        free(pGreedy);
+        return -1;
+    }
+    pFrom = pCost + numBytes + 1;
+    pUse = pGreedy + numBytes + 1;
+
+    /* Greedy result to compare with */
+    memcpy(pGreedy, src, numBytes);
+    greedySize = numBytes;
+    if (compressBPE(pGreedy, &greedySize) != 0){
+        free(pCost);
+        free(pGreedy);
+        return -1;
+    }
+
+    /* pCost[x] = fewest codes making up src[0..x) */
+    pCost[0] = 0;
+    for (x = 1; x <= numBytes; x++)
+        pCost[x] = 0xFFFFFFFF;
+    for (x = 0; x < numBytes; x++){
+        if (pCost[x] == 0xFFFFFFFF)
+            continue;
+        node = ch_trieRoot[src[x]];
+        y = x;
+        while (node >= 0){
+            if ((ch_trie[node].code != BPE_NO_CODE) && (pCost[x] + 1 < pCost[y + 1])){
+                pCost[y + 1] = pCost[x] + 1;
+                pFrom[y + 1] = x;
+                pUse[y + 1] = (unsigned char)ch_trie[node].code;
+            }
+            if (++y >= numBytes)
+                break;
+            for (node = ch_trie[node].child; node >= 0; node = ch_trie[node].sibling){
+                if (ch_trie[node].byteVal == src[y])
+                    break;
+            }
+        }
+    }
+
+    /* Keep whichever is shorter */
+    if (pCost[numBytes] < greedySize){
+        size = pCost[numBytes];
+        for (x = numBytes, y = size; x > 0; x = pFrom[x])
+            pGreedy[--y] = pUse[x];
+    }
+    else
+        size = greedySize;
+
+    memcpy(src, pGreedy, size);
+    for (x = size; x < numBytes; x++)
+        src[x] = 0xFF;
+    *nBytes = size;
+
+    free(pCost);
+    free(pGreedy);
+
+    return (int)(greedySize - size);
+}
+
+
+
+
 /******************************************************************/
 /* decompressBPE - Decompresses a string using byte pair encoding */
 /*                                                                */
@@ -434,74 +744,372 @@ void compressBPE(unsigned char* src, unsigned int* nBytes){
 /* src - ptr to source buffer.  end of src buffer signified by an */
 /*       intput value >= 0xF0                                     */
 /* nbytes - Number of bytes written to dst.  Passed by reference. */
+/* Each code's full expansion is precomputed by loadBPETable.     */
 /******************************************************************/
 void decompressBPE(unsigned char* dst, unsigned char* src, unsigned int* nBytes){
 
-    unsigned int x;
+    unsigned int size;
 
-    /* Base Case */
-    if (*src >= 0xF0)
-        return;
+    while (*src < 0xF0){
+        size = ch_expSize[*src];
+        memcpy(dst, &ch_expData[ch_expOffset[*src]], size);
+        dst += size;
+        *nBytes += size;
+        src++;
+    }
+
+    return;
+}
+
+
+
+
+/******************************************************************/
+/* sizeDecompressedBPE - Number of bytes decompressBPE will write */
+/*                       for src, which ends at a value >= 0xF0.  */
+/******************************************************************/
+unsigned int sizeDecompressedBPE(const unsigned char* src){
+
+    unsigned int nBytes = 0;
 
-    /* Loop */
     while (*src < 0xF0){
-        int byte1, byte2;
-
-        /* Read Next Byte Value from table */
-        byte1 = ch_codes[*src].encvalue[0];
-        byte2 = ch_codes[*src].encvalue[1];
-
-        /* One character case */
-        if (!ch_codes[*src].encoded){
-			unsigned int numutf8bytes = numBytesInUtf8Char(ch_codes[*src].utf8value[0]);
-			for (x = 0; x < numutf8bytes; x++){
-                *dst = ch_codes[*src].utf8value[x];
-                dst++;
-                (*nBytes)++;
+        nBytes += ch_expSize[*src];
+        src++;
+    }
+
+    return nBytes;
+}
+
+
+
+
+/*******************************************************************/
+/* computeExpandedSizes                                            */
+/* Fills in ch_expSize from the loaded table, following the same   */
+/* expansion rules as decompressBPE.                               */
+/*******************************************************************/
+static void computeExpandedSizes(void){
+
+    unsigned char state[NUM_CH_CODES];  /* 0 = unknown, 1 = in progress, 2 = done */
+    int x;
+
+    memset(state, 0, NUM_CH_CODES);
+    for (x = 0; x < NUM_CH_CODES; x++)
+        expandedSize(x, state);
+
+    return;
+}
+
+
+
+
+/*******************************************************************/
+/* buildSymbolLookups                                              */
+/* Fills in ch_decode and the packed UTF-8 hash from the 1-byte    */
+/* encoded entries of the loaded table.  Entries are added lowest  */
+/* index first and later duplicates skipped, so both directions    */
+/* give the same result as scanning ch_codes in order.             */
+/*******************************************************************/
+static void buildSymbolLookups(void){
+
+    unsigned int packed, slot;
+    int x;
+
+    for (x = 0; x < 256; x++)
+        ch_decode[x] = BPE_NO_CODE;
+    memset(ch_hashKey, 0, sizeof(ch_hashKey));
+
+    for (x = 0; x < NUM_CH_CODES; x++){
+        if ((ch_codes[x].inuse != 1) || (ch_codes[x].encoded != 0))
+            continue;
+
+        if (ch_decode[ch_codes[x].encvalue[1]] == BPE_NO_CODE)
+            ch_decode[ch_codes[x].encvalue[1]] = x;
+
+        packed = packUTF8((char*)ch_codes[x].utf8value);
+        if (packed == 0)
+            continue;
+        for (slot = packed; ; slot++){
+            slot &= (BPE_HASH_SIZE - 1);
+            if (ch_hashKey[slot] == packed)
+                break;
+            if (ch_hashKey[slot] == 0){
+                ch_hashKey[slot] = packed;
+                ch_hashByte[slot] = ch_codes[x].encvalue[1];
+                break;
             }
         }
-        else{
-            /* Two Byte Encoded Case */
-            unsigned int nEncBytes1 = 0;
-            unsigned int nEncBytes2 = 0;
-            unsigned char encodedVal1[10];
-            unsigned char encodedVal2[10];
-
-            memset(encodedVal1, 0xFF, 10);
-            memset(encodedVal2, 0xFF, 10);
-
-            if (!ch_codes[byte1].encoded){
-				unsigned int numutf8bytes = numBytesInUtf8Char(ch_codes[byte1].utf8value[0]);
-				for (x = 0; x < numutf8bytes; x++){
-                    encodedVal1[x] = ch_codes[byte1].utf8value[x];
-                }
-            }
-            else{
-                encodedVal1[0] = ch_codes[byte1].encvalue[0];
-                encodedVal1[1] = ch_codes[byte1].encvalue[1];
-            }
+    }
+
+    return;
+}
+
+
+
+
+/*******************************************************************/
+/* buildExpansionTrie                                              */
+/* Builds the trie compressBPEOptimal parses with.  A code is left */
+/* out when the text its pair tree spells differs from what        */
+/* decompressBPE writes for it, as the two only agree when pair    */
+/* halves are plain ASCII codes.  Returns 0 on success.            */
+/*******************************************************************/
+static int buildExpansionTrie(void){
+
+    unsigned char glyphs[MAX_GLYPH_EXP];
+    unsigned char utf8[MAX_GLYPH_EXP * 4];
+    unsigned int total, numUtf8, numBytes;
+    int x, y, len, node, parent;
+
+    free(ch_trie);
+    ch_trieSize = 0;
+    for (x = 0; x < 256; x++)
+        ch_trieRoot[x] = -1;
+
+    total = 0;
+    for (x = 0; x < NUM_CH_CODES; x++)
+        total += (ch_expSize[x] < MAX_GLYPH_EXP) ? ch_expSize[x] : MAX_GLYPH_EXP;
+    ch_trie = (expTrieNode*)malloc((total + 1) * sizeof(expTrieNode));
+    if (ch_trie == NULL){
+        printf("Error allocating BPE expansion trie\n");
+        return -1;
+    }
+
+    for (x = 0; x < NUM_CH_CODES; x++){
+        if (ch_codes[x].inuse != 1)
+            continue;
+        len = glyphExpand(x, glyphs, MAX_GLYPH_EXP, 0);
+        if (len <= 0)
+            continue;
 
-            if (!ch_codes[byte2].encoded){
-				unsigned numutf8bytes = numBytesInUtf8Char(ch_codes[byte2].utf8value[0]);
-				for (x = 0; x < numutf8bytes; x++){
-                    encodedVal2[x] = ch_codes[byte2].utf8value[x];
+        /* Must match decompressBPE */
+        numUtf8 = 0;
+        for (y = 0; y < len; y++){
+            numBytes = numBytesInUtf8Char(ch_codes[glyphs[y]].utf8value[0]);
+            memcpy(&utf8[numUtf8], ch_codes[glyphs[y]].utf8value, numBytes);
+            numUtf8 += numBytes;
+        }
+        if ((numUtf8 != ch_expSize[x]) || (memcmp(utf8, &ch_expData[ch_expOffset[x]], numUtf8) != 0))
+            continue;
+
+        /* Insert, the lowest code keeps a shared string */
+        node = parent = -1;
+        for (y = 0; y < len; y++){
+            node = (parent < 0) ? ch_trieRoot[glyphs[y]] : ch_trie[parent].child;
+            while ((node >= 0) && (ch_trie[node].byteVal != glyphs[y]))
+                node = ch_trie[node].sibling;
+            if (node < 0){
+                node = (int)ch_trieSize++;
+                ch_trie[node].child = -1;
+                ch_trie[node].code = BPE_NO_CODE;
+                ch_trie[node].byteVal = glyphs[y];
+                if (parent < 0){
+                    ch_trie[node].sibling = -1;
+                    ch_trieRoot[glyphs[y]] = node;
+                }
+                else{
+                    ch_trie[node].sibling = ch_trie[parent].child;
+                    ch_trie[parent].child = node;
                 }
             }
-            else{
-                encodedVal2[0] = ch_codes[byte2].encvalue[0];
-                encodedVal2[1] = ch_codes[byte2].encvalue[1];
-            }
+            parent = node;
+        }
+        if (ch_trie[node].code == BPE_NO_CODE)
+            ch_trie[node].code = x;
+    }
+
+    return 0;
+}
+
+
+
+
+/*******************************************************************/
+/* glyphExpand                                                     */
+/* Writes the 1-byte codes a code stands for, following its pair   */
+/* tree.  Returns how many, or -1 if there are more than maxLen or */
+/* the tree loops.                                                 */
+/*******************************************************************/
+static int glyphExpand(int code, unsigned char* pBuf, int maxLen, int depth){
+
+    int len1, len2;
+
+    if ((code >= NUM_CH_CODES) || (depth > NUM_CH_CODES) || (maxLen < 1))
+        return -1;
+    if (!ch_codes[code].encoded){
+        pBuf[0] = (unsigned char)code;
+        return 1;
+    }
+
+    len1 = glyphExpand(ch_codes[code].encvalue[0], pBuf, maxLen, depth + 1);
+    if (len1 < 0)
+        return -1;
+    len2 = glyphExpand(ch_codes[code].encvalue[1], pBuf + len1, maxLen - len1, depth + 1);
+    if (len2 < 0)
+        return -1;
+
+    return len1 + len2;
+}
+
+
+
+
+/*******************************************************************/
+/* buildPairCodes                                                  */
+/* Fills in ch_pairCode.  When codes share a pair the lowest wins, */
+/* as it is the one compressBPE applies first.  Code 0 is          */
+/* left out, compressBPE checks for it separately.                 */
+/*******************************************************************/
+static void buildPairCodes(void){
+
+    int x, pair;
 
-            /* Recurse */
-            decompressBPE(dst, &encodedVal1[0], &nEncBytes1);
-            dst += nEncBytes1;
-            *nBytes += nEncBytes1;
-            decompressBPE(dst, &encodedVal2[0], &nEncBytes2);
-            dst += nEncBytes2;
-            *nBytes += nEncBytes2;
+    memset(ch_pairCode, BPE_NO_PAIR, sizeof(ch_pairCode));
+    for (x = NUM_CH_CODES - 1; x >= 1; x--){
+        if ((ch_codes[x].inuse == 1) && (ch_codes[x].encoded == 1)){
+            pair = (ch_codes[x].encvalue[0] << 8) | ch_codes[x].encvalue[1];
+            ch_pairCode[pair] = (unsigned char)x;
         }
+    }
 
-        src++;
+    return;
+}
+
+
+
+
+/*******************************************************************/
+/* expandedSize                                                    */
+/* Returns the decompressed size of one code, memoized in          */
+/* ch_expSize.  A code that expands to itself counts as 0 bytes.   */
+/*******************************************************************/
+static unsigned int expandedSize(int code, unsigned char* pState){
+
+    unsigned char encodedVal[10];
+    unsigned int nBytes = 0;
+    int x, y;
+
+    if (pState[code] == 2)
+        return ch_expSize[code];
+    if (pState[code] == 1)
+        return 0;
+    pState[code] = 1;
+
+    if (!ch_codes[code].encoded){
+        nBytes = numBytesInUtf8Char(ch_codes[code].utf8value[0]);
+    }
+    else{
+        for (y = 0; y < 2; y++){
+            getPairHalf(ch_codes[code].encvalue[y], encodedVal);
+            for (x = 0; encodedVal[x] < 0xF0; x++)
+                nBytes += expandedSize(encodedVal[x], pState);
+        }
+    }
+
+    ch_expSize[code] = nBytes;
+    pState[code] = 2;
+
+    return nBytes;
+}
+
+
+
+
+/*******************************************************************/
+/* computeExpansions                                               */
+/* Lays out the expansion of every code in ch_expData, using the   */
+/* sizes from computeExpandedSizes.  Codes are visited in the same */
+/* order, so a code that expands to itself again adds nothing.     */
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+static int computeExpansions(void){
+
+    unsigned char state[NUM_CH_CODES];  /* 0 = unknown, 1 = in progress, 2 = done */
+    unsigned int total = 0;
+    int x;
+
+    for (x = 0; x < NUM_CH_CODES; x++){
+        ch_expOffset[x] = total;
+        total += ch_expSize[x];
+    }
+
+    free(ch_expData);
+    ch_expData = (unsigned char*)malloc(total + 1);
+    if (ch_expData == NULL){
+        printf("Error allocating BPE expansion table\n");
+        return -1;
+    }
+
+    memset(state, 0, NUM_CH_CODES);
+    for (x = 0; x < NUM_CH_CODES; x++)
+        expandCode(x, state);
+
+    return 0;
+}
+
+
+
+
+/*******************************************************************/
+/* expandCode                                                      */
+/* Writes the expansion of one code to its place in ch_expData,    */
+/* expanding the codes it is made of first.                        */
+/*******************************************************************/
+static void expandCode(int code, unsigned char* pState){
+
+    unsigned char encodedVal[10];
+    unsigned char* pDst;
+    int x, y, part;
+
+    if (pState[code] != 0)
+        return;
+    pState[code] = 1;
+
+    pDst = &ch_expData[ch_expOffset[code]];
+    if (!ch_codes[code].encoded){
+        memcpy(pDst, ch_codes[code].utf8value, ch_expSize[code]);
+    }
+    else{
+        for (y = 0; y < 2; y++){
+            getPairHalf(ch_codes[code].encvalue[y], encodedVal);
+            for (x = 0; encodedVal[x] < 0xF0; x++){
+                part = encodedVal[x];
+                expandCode(part, pState);
+                if (pState[part] != 2)
+                    continue;
+                memcpy(pDst, &ch_expData[ch_expOffset[part]], ch_expSize[part]);
+                pDst += ch_expSize[part];
+            }
+        }
+    }
+
+    pState[code] = 2;
+
+    return;
+}
+
+
+
+
+/*******************************************************************/
+/* getPairHalf                                                     */
+/* Fills encodedVal (10 bytes) with the codes one half of a pair   */
+/* expands through, ended by 0xFF: the UTF-8 bytes of a 1-byte     */
+/* encoded character, or the pair of an encoded one.               */
+/*******************************************************************/
+static void getPairHalf(int byteVal, unsigned char* encodedVal){
+
+    unsigned int x, numutf8bytes;
+
+    memset(encodedVal, 0xFF, 10);
+    if (!ch_codes[byteVal].encoded){
+        numutf8bytes = numBytesInUtf8Char(ch_codes[byteVal].utf8value[0]);
+        for (x = 0; x < numutf8bytes; x++)
+            encodedVal[x] = ch_codes[byteVal].utf8value[x];
+    }
+    else{
+        encodedVal[0] = ch_codes[byteVal].encvalue[0];
+        encodedVal[1] = ch_codes[byteVal].encvalue[1];
     }
 
     return;
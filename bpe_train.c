@@ -0,0 +1,664 @@
+/**********************************************************************/
+/* bpe_train.c - Builds a bpe.table from a corpus of meta scripts.    */
+/*               The print-line text of every run-commands node is    */
+/*               mapped to 1-byte codes through 8bit_table.txt, then  */
+/*               the most frequent pair of codes is given the lowest  */
+/*               free code until the free codes run out.  Pair counts */
+/*               are kept in a max heap and every pair's occurrences  */
+/*               in a linked list, so a merge only touches the text   */
+/*               it changes.  compressBPE applies the lowest numbered */
+/*               code first, which is the order the pairs were chosen */
+/*               in here.                                             */
+/**********************************************************************/
+
+
+/************/
+/* Includes */
+/************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bpe_train.h"
+#include "bpe_compression.h"
+#include "parse_script.h"
+#include "snode_list.h"
+#include "util.h"
+
+
+/***********/
+/* Defines */
+/***********/
+#define NUM_CH_CODES      0xF0      /* Codes 0xF0 and up end a string */
+#define NUM_PAIRS         0x10000   /* Pair ID = (code1 << 8) | code2 */
+#define TRAIN_MIN_COUNT   2         /* Pairs seen less often are not worth a code */
+#define DEAD_SYMBOL       0xFF      /* Symbol of a position merged into the one before */
+
+/* Corpus and merge state */
+typedef struct bpeTrainer{
+    unsigned char* pSym;          /* Current code at each position */
+    unsigned char* pOrig;         /* Codes before any merge */
+    int* pNext;                   /* Next live position in the line, -1 at its end */
+    int* pPrev;
+    int* pOccNext;                /* Next position starting the same pair */
+    int* pOccPrev;
+    unsigned int numBytes, maxBytes;
+    unsigned int* pLineStart;     /* numLines + 1 entries */
+    unsigned int numLines, maxLines;
+    unsigned int* pFileLine;      /* First line of each file, numFiles + 1 entries */
+    unsigned int numSkipped;      /* Lines left out, a character had no 1-byte code */
+    int occHead[NUM_PAIRS];       /* First position of each pair, -1 if none */
+    unsigned int count[NUM_PAIRS];
+    int heap[NUM_PAIRS];          /* Pair IDs, most frequent first */
+    int heapPos[NUM_PAIRS];       /* Index of each pair in heap, -1 if absent */
+    int heapSize;
+    unsigned char pairable[256];  /* Codes a pair may be made of */
+}bpeTrainer;
+
+
+
+/***********************/
+/* Function Prototypes */
+/***********************/
+int trainBPETable(char** pNames, unsigned int numFiles, const char* tableName, const char* mappingName);
+static int readCorpusFile(bpeTrainer* pT, const char* fname);
+static int addCorpusLine(bpeTrainer* pT, const char* fname, const char* pText);
+static int growCorpus(bpeTrainer* pT, unsigned int numBytes);
+static int allocMergeState(bpeTrainer* pT);
+static void initPairs(bpeTrainer* pT);
+static void addPair(bpeTrainer* pT, int pos);
+static void removePair(bpeTrainer* pT, int pos);
+static void mergeAt(bpeTrainer* pT, int pos, int code);
+static void heapFix(bpeTrainer* pT, int pair);
+static int heapBefore(bpeTrainer* pT, int pairA, int pairB);
+static void heapSwap(bpeTrainer* pT, int x, int y);
+static int cmpPositions(const void* a, const void* b);
+static int writeTrainedTable(const char* tableName, const int* pPairs);
+static void reportSizes(bpeTrainer* pT, char** pNames, unsigned int numFiles);
+static void freeTrainer(bpeTrainer* pT);
+
+
+
+
+/*******************************************************************/
+/* trainBPETable                                                   */
+/* Builds a BPE table from the meta scripts in pNames and writes   */
+/* it to tableName, then reports each file's text size compressed  */
+/* with it.  mappingName is the 8-bit UTF-8 mapping table.  Leaves */
+/* the new table loaded.  Returns 0 on success, -1 on failure.     */
+/*******************************************************************/
+int trainBPETable(char** pNames, unsigned int numFiles, const char* tableName, const char* mappingName){
+
+    bpeTrainer* pT;
+    int pairs[NUM_CH_CODES];
+    int *pPositions = NULL;
+    int code, pair, pos, numPos, x;
+    unsigned char utf8[5];
+    unsigned int y, numCodes = 0;
+
+    /* Codes come from the mapping table alone */
+    if (loadBPESymbols((char*)mappingName) < 0)
+        return -1;
+
+    pT = (bpeTrainer*)calloc(1, sizeof(bpeTrainer));
+    if (pT == NULL){
+        printf("Error allocating BPE trainer.\n");
+        return -1;
+    }
+    pT->pFileLine = (unsigned int*)malloc((numFiles + 1) * sizeof(unsigned int));
+    if (pT->pFileLine == NULL){
+        printf("Error allocating BPE trainer.\n");
+        freeTrainer(pT);
+        return -1;
+    }
+
+    /* Read the corpus */
+    for (y = 0; y < numFiles; y++){
+        pT->pFileLine[y] = pT->numLines;
+        if (readCorpusFile(pT, pNames[y]) != 0){
+            printf("Error reading %s, BPE table not built.\n", pNames[y]);
+            freeTrainer(pT);
+            return -1;
+        }
+    }
+    pT->pFileLine[numFiles] = pT->numLines;
+    if (pT->numSkipped > 0)
+        printf("%u lines with unmapped characters left out of the corpus.\n", pT->numSkipped);
+    if (pT->numLines == 0){
+        printf("Error, no text to train on, BPE table not built.\n");
+        freeTrainer(pT);
+        return -1;
+    }
+    if (allocMergeState(pT) != 0){
+        freeTrainer(pT);
+        return -1;
+    }
+    printf("Corpus: %u files, %u lines, %u bytes.\n", numFiles, pT->numLines, pT->numBytes);
+
+    /* The decompressor expands a 1-byte half of a pair through its */
+    /* UTF-8 bytes, so only ASCII codes whose value is their own    */
+    /* character can be pair halves.  Pairs can always be halves.   */
+    memset(pT->pairable, 0, sizeof(pT->pairable));
+    for (x = 0; x < NUM_CH_CODES; x++){
+        pairs[x] = -1;
+        if ((bpe_to_utf8((unsigned char)x, utf8, sizeof(utf8)) == 0) && (utf8[0] == x) && (utf8[1] == '\0'))
+            pT->pairable[x] = 1;
+    }
+    initPairs(pT);
+
+    /* Most frequent pair into each free code, lowest first.  Code 0 */
+    /* is skipped, compressBPE only tries it before any other code.  */
+    for (code = 1; code < NUM_CH_CODES; code++){
+        if (bpe_to_utf8((unsigned char)code, utf8, sizeof(utf8)) == 0)
+            continue;
+        if ((pT->heapSize == 0) || (pT->count[pT->heap[0]] < TRAIN_MIN_COUNT))
+            break;
+        pair = pT->heap[0];
+        pairs[code] = pair;
+        pT->pairable[code] = 1;
+
+        /* Replace left to right, as compressBPE does */
+        numPos = 0;
+        pPositions = (int*)malloc(pT->count[pair] * sizeof(int));
+        if (pPositions == NULL){
+            printf("Error allocating BPE merge list.\n");
+            freeTrainer(pT);
+            return -1;
+        }
+        for (pos = pT->occHead[pair]; pos >= 0; pos = pT->pOccNext[pos])
+            pPositions[numPos++] = pos;
+        qsort(pPositions, numPos, sizeof(int), cmpPositions);
+        for (x = 0; x < numPos; x++){
+            pos = pPositions[x];
+            if ((pT->pSym[pos] == (pair >> 8)) && (pT->pNext[pos] >= 0) &&
+                (pT->pSym[pT->pNext[pos]] == (pair & 0xFF)))
+                mergeAt(pT, pos, code);
+        }
+        free(pPositions);
+        numCodes++;
+    }
+    printf("%u pair codes assigned.\n", numCodes);
+
+    /* Save, reload and report */
+    if ((writeTrainedTable(tableName, pairs) != 0) ||
+        (loadBPETable((char*)tableName, (char*)mappingName) != 0)){
+        freeTrainer(pT);
+        return -1;
+    }
+    reportSizes(pT, pNames, numFiles);
+    freeTrainer(pT);
+
+    return 0;
+}
+
+
+
+
+/*******************************************************************/
+/* readCorpusFile                                                  */
+/* Adds the print-line text of a meta script's run-commands to the */
+/* corpus, one line per print-line.  Options text is not included, */
+/* the encoder does not compress it.  Lines that cannot be mapped  */
+/* to 1-byte codes are skipped.  Returns 0 on success.             */
+/*******************************************************************/
+static int readCorpusFile(bpeTrainer* pT, const char* fname){
+
+    lsb_context* ctx;
+    scriptNode* pNode;
+    runParamType* rpNode;
+    FILE* inFile;
+    int rval;
+
+    inFile = fopen(fname, "rb");
+    if (inFile == NULL){
+        printf("Error occurred while opening input script %s for reading\n", fname);
+        return -1;
+    }
+    ctx = (lsb_context*)malloc(sizeof(lsb_context));
+    if ((ctx == NULL) || (initContext(ctx) != 0)){
+        printf("Error creating script context.\n");
+        free(ctx);
+        fclose(inFile);
+        return -1;
+    }
+
+    rval = encodeScript(ctx, inFile, NULL);
+    fclose(inFile);
+
+    for (pNode = getHeadPtr(ctx); (rval == 0) && (pNode != NULL); pNode = getNextPtr(ctx, pNode)){
+        if (pNode->nodeType != NODE_RUN_CMDS)
+            continue;
+        for (rpNode = pNode->runParams; (rpNode != NULL) && (rpNode->type != RUN_END); rpNode++){
+            if (rpNode->type != PRINT_LINE)
+                continue;
+            if (addCorpusLine(pT, fname, poolStr(&ctx->strings, rpNode->str)) < 0){
+                rval = -1;
+                break;
+            }
+        }
+    }
+
+    releaseContext(ctx);
+    free(ctx);
+
+    return rval;
+}
+
+
+
+
+/*******************************************************************/
+/* addCorpusLine                                                   */
+/* Appends one line of text from fname as 1-byte codes.  Returns 0 */
+/* on success, 1 if the line was skipped because a character has   */
+/* no 1-byte code, or -1 on failure.                               */
+/*******************************************************************/
+static int addCorpusLine(bpeTrainer* pT, const char* fname, const char* pText){
+
+    unsigned int len, numBytes;
+    unsigned char* pLine;
+
+    len = (unsigned int)strlen(pText);
+    if (growCorpus(pT, len + 1) != 0)
+        return -1;
+
+    /* Converted in place, it only gets shorter */
+    pLine = &pT->pSym[pT->numBytes];
+    strcpy((char*)pLine, pText);
+    if (utf8Text_to_8bit_binary((char*)pLine, &numBytes) != 0){
+        printf("Skipping line in %s: %s\n", fname, pText);
+        pT->numSkipped++;
+        return 1;
+    }
+
+    pT->pLineStart[pT->numLines++] = pT->numBytes;
+    pT->numBytes += numBytes;
+
+    return 0;
+}
+
+
+
+
+/*******************************************************************/
+/* growCorpus                                                      */
+/* Makes room for numBytes more bytes and one more line.  Returns  */
+/* 0 on success, -1 on failure.                                    */
+/*******************************************************************/
+static int growCorpus(bpeTrainer* pT, unsigned int numBytes){
+
+    unsigned int newMax;
+    void* pNew;
+
+    if (pT->numBytes + numBytes + 1 > pT->maxBytes){
+        newMax = (pT->maxBytes == 0) ? 0x10000 : pT->maxBytes;
+        while (pT->numBytes + numBytes + 1 > newMax)
+            newMax *= 2;
+        pNew = realloc(pT->pSym, newMax);
+        if (pNew == NULL){
+            printf("Error allocating BPE corpus.\n");
+            return -1;
+        }
+        pT->pSym = (unsigned char*)pNew;
+        pT->maxBytes = newMax;
+    }
+
+    if (pT->numLines + 2 > pT->maxLines){
+        newMax = (pT->maxLines == 0) ? 1024 : pT->maxLines * 2;
+        pNew = realloc(pT->pLineStart, newMax * sizeof(unsigned int));
+        if (pNew == NULL){
+            printf("Error allocating BPE corpus.\n");
+            return -1;
+        }
+        pT->pLineStart = (unsigned int*)pNew;
+        pT->maxLines = newMax;
+    }
+
+    return 0;
+}
+
+
+
+
+/*******************************************************************/
+/* allocMergeState                                                 */
+/* Called once the corpus is read.  Ends the line list, keeps a    */
+/* copy of the unmerged codes and allocates the position links.    */
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+static int allocMergeState(bpeTrainer* pT){
+
+    unsigned int size;
+
+    if (growCorpus(pT, 0) != 0)
+        return -1;
+    pT->pLineStart[pT->numLines] = pT->numBytes;
+
+    size = pT->numBytes + 1;
+    pT->pOrig = (unsigned char*)malloc(size);
+    pT->pNext = (int*)malloc(size * 4 * sizeof(int));
+    if ((pT->pOrig == NULL) || (pT->pNext == NULL)){
+        printf("Error allocating BPE corpus.\n");
+        return -1;
+    }
+    memcpy(pT->pOrig, pT->pSym, pT->numBytes);
+    pT->pPrev = pT->pNext + size;
+    pT->pOccNext = pT->pPrev + size;
+    pT->pOccPrev = pT->pOccNext + size;
+
+    return 0;
+}
+
+
+
+
+/*******************************************************************/
+/* initPairs                                                       */
+/* Links each line's positions and counts every pair in it.        */
+/*******************************************************************/
+static void initPairs(bpeTrainer* pT){
+
+    unsigned int line, pos, start, end;
+
+    for (pos = 0; pos < NUM_PAIRS; pos++){
+        pT->occHead[pos] = -1;
+        pT->heapPos[pos] = -1;
+        pT->count[pos] = 0;
+    }
+    pT->heapSize = 0;
+
+    for (line = 0; line < pT->numLines; line++){
+        start = pT->pLineStart[line];
+        end = pT->pLineStart[line + 1];
+        for (pos = start; pos < end; pos++){
+            pT->pNext[pos] = (pos + 1 < end) ? (int)(pos + 1) : -1;
+            pT->pPrev[pos] = (pos > start) ? (int)(pos - 1) : -1;
+        }
+        for (pos = start; pos < end; pos++)
+            addPair(pT, pos);
+    }
+
+    return;
+}
+
+
+
+
+/*******************************************************************/
+/* addPair - Counts the pair starting at pos, if pos has a next.   */
+/*******************************************************************/
+static void addPair(bpeTrainer* pT, int pos){
+
+    int pair, next = pT->pNext[pos];
+
+    if ((next < 0) || !pT->pairable[pT->pSym[pos]] || !pT->pairable[pT->pSym[next]])
+        return;
+    pair = (pT->pSym[pos] << 8) | pT->pSym[next];
+
+    pT->pOccPrev[pos] = -1;
+    pT->pOccNext[pos] = pT->occHead[pair];
+    if (pT->occHead[pair] >= 0)
+        pT->pOccPrev[pT->occHead[pair]] = pos;
+    pT->occHead[pair] = pos;
+
+    pT->count[pair]++;
+    heapFix(pT, pair);
+
+    return;
+}
+
+
+
+
+/*******************************************************************/
+/* removePair - Uncounts the pair starting at pos, if any.         */
+/*******************************************************************/
+static void removePair(bpeTrainer* pT, int pos){
+
+    int pair, next = pT->pNext[pos];
+
+    if ((next < 0) || !pT->pairable[pT->pSym[pos]] || !pT->pairable[pT->pSym[next]])
+        return;
+    pair = (pT->pSym[pos] << 8) | pT->pSym[next];
+
+    if (pT->pOccPrev[pos] >= 0)
+        pT->pOccNext[pT->pOccPrev[pos]] = pT->pOccNext[pos];
+    else
+        pT->occHead[pair] = pT->pOccNext[pos];
+    if (pT->pOccNext[pos] >= 0)
+        pT->pOccPrev[pT->pOccNext[pos]] = pT->pOccPrev[pos];
+
+    pT->count[pair]--;
+    heapFix(pT, pair);
+
+    return;
+}
+
+
+
+
+/*******************************************************************/
+/* mergeAt                                                         */
+/* Replaces the code at pos and the one after it with code,        */
+/* updating the pairs on either side.                              */
+/*******************************************************************/
+static void mergeAt(bpeTrainer* pT, int pos, int code){
+
+    int prev = pT->pPrev[pos];
+    int next = pT->pNext[pos];
+
+    if (prev >= 0)
+        removePair(pT, prev);
+    removePair(pT, pos);
+    removePair(pT, next);
+
+    pT->pSym[pos] = (unsigned char)code;
+    pT->pSym[next] = DEAD_SYMBOL;
+    pT->pNext[pos] = pT->pNext[next];
+    if (pT->pNext[pos] >= 0)
+        pT->pPrev[pT->pNext[pos]] = pos;
+
+    if (prev >= 0)
+        addPair(pT, prev);
+    addPair(pT, pos);
+
+    return;
+}
+
+
+
+
+/*******************************************************************/
+/* heapFix                                                         */
+/* Puts a pair whose count changed back in heap order, adding or   */
+/* dropping it as its count becomes non-zero or zero.              */
+/*******************************************************************/
+static void heapFix(bpeTrainer* pT, int pair){
+
+    int x, child, parent;
+
+    x = pT->heapPos[pair];
+    if (x < 0){
+        if (pT->count[pair] == 0)
+            return;
+        x = pT->heapSize++;
+        pT->heap[x] = pair;
+        pT->heapPos[pair] = x;
+    }
+    else if (pT->count[pair] == 0){
+        heapSwap(pT, x, --pT->heapSize);
+        pT->heapPos[pair] = -1;
+        if (x == pT->heapSize)
+            return;
+    }
+
+    /* Up */
+    while (x > 0){
+        parent = (x - 1) / 2;
+        if (!heapBefore(pT, pT->heap[x], pT->heap[parent]))
+            break;
+        heapSwap(pT, x, parent);
+        x = parent;
+    }
+
+    /* Down */
+    while (1){
+        child = 2 * x + 1;
+        if (child >= pT->heapSize)
+            break;
+        if ((child + 1 < pT->heapSize) && heapBefore(pT, pT->heap[child + 1], pT->heap[child]))
+            child++;
+        if (!heapBefore(pT, pT->heap[child], pT->heap[x]))
+            break;
+        heapSwap(pT, x, child);
+        x = child;
+    }
+
+    return;
+}
+
+
+
+
+/*******************************************************************/
+/* heapBefore                                                      */
+/* True if pairA goes above pairB: more frequent, or as frequent   */
+/* with a lower ID, so training is repeatable.                     */
+/*******************************************************************/
+static int heapBefore(bpeTrainer* pT, int pairA, int pairB){
+
+    if (pT->count[pairA] != pT->count[pairB])
+        return (pT->count[pairA] > pT->count[pairB]);
+    return (pairA < pairB);
+}
+
+
+
+
+/*******************************************************************/
+/* heapSwap - Swaps two heap entries.                              */
+/*******************************************************************/
+static void heapSwap(bpeTrainer* pT, int x, int y){
+
+    int tmp = pT->heap[x];
+
+    pT->heap[x] = pT->heap[y];
+    pT->heap[y] = tmp;
+    pT->heapPos[pT->heap[x]] = x;
+    pT->heapPos[pT->heap[y]] = y;
+
+    return;
+}
+
+
+
+
+/*******************************************************************/
+/* cmpPositions - qsort compare, ascending positions.              */
+/*******************************************************************/
+static int cmpPositions(const void* a, const void* b){
+    return *(const int*)a - *(const int*)b;
+}
+
+
+
+
+/*******************************************************************/
+/* writeTrainedTable                                               */
+/* Writes the table in the format loadBPETable reads, 2 bytes per  */
+/* code: 0xFFXX for a 1-byte code, the pair for a pair code and    */
+/* 0xFFFF if unused.  Returns 0 on success, -1 on failure.         */
+/*******************************************************************/
+static int writeTrainedTable(const char* tableName, const int* pPairs){
+
+    FILE* outFile;
+    unsigned char entry[2];
+    unsigned char utf8[5];
+    int x, rval = 0;
+
+    outFile = fopen(tableName, "wb");
+    if (outFile == NULL){
+        printf("Error occurred while opening %s for writing\n", tableName);
+        return -1;
+    }
+
+    for (x = 0; x < NUM_CH_CODES; x++){
+        if (pPairs[x] >= 0){
+            entry[0] = (unsigned char)(pPairs[x] >> 8);
+            entry[1] = (unsigned char)(pPairs[x] & 0xFF);
+        }
+        else if (bpe_to_utf8((unsigned char)x, utf8, sizeof(utf8)) == 0){
+            entry[0] = 0xFF;
+            entry[1] = (unsigned char)x;
+        }
+        else{
+            entry[0] = entry[1] = 0xFF;
+        }
+        if (fwrite(entry, 1, 2, outFile) != 2)
+            rval = -1;
+    }
+    if (fclose(outFile) != 0)
+        rval = -1;
+    if (rval != 0)
+        printf("Error writing %s\n", tableName);
+
+    return rval;
+}
+
+
+
+
+/*******************************************************************/
+/* reportSizes                                                     */
+/* Prints each file's text size before and after compressBPE with  */
+/* the loaded table.                                               */
+/*******************************************************************/
+static void reportSizes(bpeTrainer* pT, char** pNames, unsigned int numFiles){
+
+    unsigned int file, line, rawSize, size, total, totalRaw;
+    unsigned char* pBuf;
+
+    pBuf = (unsigned char*)malloc(pT->numBytes + 1);
+    if (pBuf == NULL)
+        return;
+
+    total = totalRaw = 0;
+    for (file = 0; file < numFiles; file++){
+        rawSize = size = 0;
+        for (line = pT->pFileLine[file]; line < pT->pFileLine[file + 1]; line++){
+            unsigned int lineSize = pT->pLineStart[line + 1] - pT->pLineStart[line];
+            memcpy(pBuf, &pT->pOrig[pT->pLineStart[line]], lineSize);
+            rawSize += lineSize;
+            if (compressBPE(pBuf, &lineSize) != 0){
+                free(pBuf);
+                return;
+            }
+            size += lineSize;
+        }
+        printf("%s: %u text bytes, %u compressed\n", pNames[file], rawSize, size);
+        total += size;
+        totalRaw += rawSize;
+    }
+    printf("Total: %u text bytes, %u compressed\n", totalRaw, total);
+
+    free(pBuf);
+
+    return;
+}
+
+
+
+
+/*******************************************************************/
+/* freeTrainer - Frees the trainer and its corpus.                 */
+/*******************************************************************/
+static void freeTrainer(bpeTrainer* pT){
+
+    free(pT->pSym);
+    free(pT->pOrig);
+    free(pT->pNext);
+    free(pT->pLineStart);
+    free(pT->pFileLine);
+    free(pT);
+
+    return;
+}
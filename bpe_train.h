@@ -0,0 +1,17 @@
+/**********************************************************************/
+/* bpe_train.h - Builds a bpe.table from a corpus of meta scripts.    */
+/**********************************************************************/
+#ifdef _MSC_VER
+#pragma warning(disable:4996)
+#endif
+#ifndef BPE_TRAIN_H
+#define BPE_TRAIN_H
+
+
+/***********************/
+/* Function Prototypes */
+/***********************/
+int trainBPETable(char** pNames, unsigned int numFiles, const char* tableName, const char* mappingName);
+
+
+#endif
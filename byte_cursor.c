@@ -0,0 +1,184 @@
+/**********************************************************************/
+/* byte_cursor.c - Input files are read into memory once and decoded  */
+/*                 through a cursor instead of many small stdio calls.*/
+/**********************************************************************/
+
+
+/************/
+/* Includes */
+/************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "byte_cursor.h"
+
+
+
+/***********************/
+/* Function Prototypes */
+/***********************/
+int curLoadFile(byteCursor* pCur, FILE* inFile);
+void curFree(byteCursor* pCur);
+unsigned int curRead(byteCursor* pCur, void* dst, unsigned int size, unsigned int count);
+int curPeek(byteCursor* pCur, void* dst, unsigned int numBytes);
+int curSeek(byteCursor* pCur, unsigned int offset);
+int curSkip(byteCursor* pCur, unsigned int numBytes);
+int curRewind(byteCursor* pCur, unsigned int numBytes);
+unsigned int curTell(byteCursor* pCur);
+int curEof(byteCursor* pCur);
+
+
+
+/*******************************************************************/
+/* curLoadFile                                                     */
+/* Reads all of inFile into memory and positions the cursor at the */
+/* start of it.  Any previously loaded data is released.           */
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+int curLoadFile(byteCursor* pCur, FILE* inFile){
+
+    long fsize;
+
+    curFree(pCur);
+
+    /* Determine Input File Size */
+    if (fseek(inFile, 0, SEEK_END) != 0){
+        printf("Error seeking in input file.\n");
+        return -1;
+    }
+    fsize = ftell(inFile);
+    if ((fsize < 0) || (fseek(inFile, 0, SEEK_SET) != 0)){
+        printf("Error seeking in input file.\n");
+        return -1;
+    }
+
+    /* One spare byte so an empty file still gets a buffer */
+    pCur->pData = (unsigned char*)malloc((size_t)fsize + 1);
+    if (pCur->pData == NULL){
+        printf("Error allocating space for input file data.\n");
+        return -1;
+    }
+    if (fread(pCur->pData, 1, (size_t)fsize, inFile) != (size_t)fsize){
+        printf("Error reading input file.\n");
+        curFree(pCur);
+        return -1;
+    }
+    pCur->size = (unsigned int)fsize;
+
+    return 0;
+}
+
+
+
+/*******************************************************************/
+/* curFree - Releases the loaded data.                             */
+/*******************************************************************/
+void curFree(byteCursor* pCur){
+
+    if (pCur->pData != NULL)
+        free(pCur->pData);
+    memset(pCur, 0, sizeof(byteCursor));
+
+    return;
+}
+
+
+
+/*******************************************************************/
+/* curRead                                                         */
+/* Copies up to count items of size bytes to dst and advances the  */
+/* cursor.  As with fread, a partial last item is still copied and */
+/* running out of data sets eof.                                   */
+/* Returns the number of complete items read.                      */
+/*******************************************************************/
+unsigned int curRead(byteCursor* pCur, void* dst, unsigned int size, unsigned int count){
+
+    unsigned int numBytes = size * count;
+    unsigned int avail = pCur->size - pCur->pos;
+
+    if (numBytes > avail){
+        numBytes = avail;
+        pCur->eof = 1;
+    }
+    if (numBytes > 0){
+        memcpy(dst, pCur->pData + pCur->pos, numBytes);
+        pCur->pos += numBytes;
+    }
+
+    return (size == 0) ? 0 : (numBytes / size);
+}
+
+
+
+/*******************************************************************/
+/* curPeek                                                         */
+/* Copies the next numBytes to dst without advancing the cursor.   */
+/* Returns 0 on success, -1 if fewer than numBytes remain.         */
+/*******************************************************************/
+int curPeek(byteCursor* pCur, void* dst, unsigned int numBytes){
+
+    if (numBytes > (pCur->size - pCur->pos))
+        return -1;
+    memcpy(dst, pCur->pData + pCur->pos, numBytes);
+
+    return 0;
+}
+
+
+
+/*******************************************************************/
+/* curSeek                                                         */
+/* Moves the cursor to an absolute offset and clears eof.          */
+/* Returns 0 on success, -1 if the offset is past the end.         */
+/*******************************************************************/
+int curSeek(byteCursor* pCur, unsigned int offset){
+
+    if (offset > pCur->size)
+        return -1;
+    pCur->pos = offset;
+    pCur->eof = 0;
+
+    return 0;
+}
+
+
+
+/*******************************************************************/
+/* curSkip - Advances the cursor, see curSeek.                     */
+/*******************************************************************/
+int curSkip(byteCursor* pCur, unsigned int numBytes){
+
+    if (numBytes > (pCur->size - pCur->pos))
+        return -1;
+    return curSeek(pCur, pCur->pos + numBytes);
+}
+
+
+
+/*******************************************************************/
+/* curRewind - Moves the cursor back, see curSeek.                 */
+/*******************************************************************/
+int curRewind(byteCursor* pCur, unsigned int numBytes){
+
+    if (numBytes > pCur->pos)
+        return -1;
+    return curSeek(pCur, pCur->pos - numBytes);
+}
+
+
+
+/*******************************************************************/
+/* curTell - Returns the current offset.                           */
+/*******************************************************************/
+unsigned int curTell(byteCursor* pCur){
+    return pCur->pos;
+}
+
+
+
+/*******************************************************************/
+/* curEof - Returns nonzero once a read has run past the end.      */
+/*******************************************************************/
+int curEof(byteCursor* pCur){
+    return pCur->eof;
+}
@@ -0,0 +1,35 @@
+/**********************************************************************/
+/* byte_cursor.h - Bounds checked reads from a file held in memory.   */
+/**********************************************************************/
+#ifdef _MSC_VER
+#pragma warning(disable:4996)
+#endif
+#ifndef BYTE_CURSOR_H
+#define BYTE_CURSOR_H
+#include <stdio.h>
+
+/* Read position in a memory copy of an input file.  Reads follow  */
+/* fread semantics, a read past the end sets eof like feof would.   */
+typedef struct byteCursor{
+    unsigned char* pData;
+    unsigned int size;             /* Bytes of data */
+    unsigned int pos;              /* Current read offset */
+    int eof;                       /* A read ran past the end */
+}byteCursor;
+
+
+/***********************/
+/* Function Prototypes */
+/***********************/
+int curLoadFile(byteCursor* pCur, FILE* inFile);
+void curFree(byteCursor* pCur);
+unsigned int curRead(byteCursor* pCur, void* dst, unsigned int size, unsigned int count);
+int curPeek(byteCursor* pCur, void* dst, unsigned int numBytes);
+int curSeek(byteCursor* pCur, unsigned int offset);
+int curSkip(byteCursor* pCur, unsigned int numBytes);
+int curRewind(byteCursor* pCur, unsigned int numBytes);
+unsigned int curTell(byteCursor* pCur);
+int curEof(byteCursor* pCur);
+
+
+#endif
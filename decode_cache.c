@@ -0,0 +1,380 @@
+/**********************************************************************/
+/* decode_cache.c - Reuses the outputs of an earlier decode when the  */
+/*                  same input is decoded again.  Only used when      */
+/*                  LSB_CACHE_DIR names the cache directory.  The key */
+/*                  is a 64-bit FNV-1a hash of CACHE_VERSION, the     */
+/*                  input file, the decode mode, the sss flag and the */
+/*                  table files the mode loads, so any change to      */
+/*                  those is a miss.  An entry is the meta script,    */
+/*                  its TXT and CSV dumps and the warnings printed    */
+/*                  while decoding, stored as <key>.txt, <key>.dtx,   */
+/*                  <key>.csv and <key>.log.  Entries are never       */
+/*                  evicted, the directory may be emptied at any time.*/
+/**********************************************************************/
+
+
+/************/
+/* Includes */
+/************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+#include "decode_cache.h"
+
+
+/***********/
+/* Defines */
+/***********/
+#define CACHE_VERSION      4           /* Bump when decode output changes */
+#define CACHE_NUM_PARTS    4
+#define CACHE_PATH_MAX     1024
+#define CACHE_DIR_MAX      960         /* Leaves room for key, ext, tmp id */
+#define CACHE_BUF_SIZE     (64*1024)
+#define FNV64_INIT         0xCBF29CE484222325ULL
+#define FNV64_PRIME        0x100000001B3ULL
+
+/* Set up once by initDecodeCache, read only afterwards */
+static int cacheEnabled = 0;
+static unsigned long long tableHash = 0;
+static char cacheDir[CACHE_DIR_MAX];
+static const char* const cacheExts[CACHE_NUM_PARTS] = { ".txt", ".dtx", ".csv", ".log" };
+
+
+
+/***********************/
+/* Function Prototypes */
+/***********************/
+void initDecodeCache(int ienc);
+int getCacheKey(FILE* inFile, int ienc, int sss, char* key);
+int cacheFetch(const char* key, const char* outFileName, const char* txtOutFileName, const char* csvOutFileName);
+void cacheStore(const char* key, const char* outFileName, const char* txtOutFileName, const char* csvOutFileName,
+                const char* pWarnings, unsigned int warnLen);
+static unsigned long long hashBytes(unsigned long long hash, const void* pData, size_t numBytes);
+static int hashFile(unsigned long long* pHash, FILE* inFile);
+static int hashNamedFile(unsigned long long* pHash, const char* fname);
+static int copyFile(const char* srcName, const char* dstName);
+static int writeFile(const char* fname, const char* pData, unsigned int numBytes);
+
+
+
+
+/*******************************************************************/
+/* initDecodeCache                                                 */
+/* Enables the cache if LSB_CACHE_DIR is set and hashes the table */
+/* files used by decode mode ienc.  Must be called after the       */
+/* tables are loaded and before any decode.                        */
+/*******************************************************************/
+void initDecodeCache(int ienc){
+
+    const char* pDir;
+    unsigned long long hash = FNV64_INIT;
+    int rval = 0;
+    int version = CACHE_VERSION;
+
+    cacheEnabled = 0;
+    pDir = getenv(CACHE_DIR_ENV);
+    if ((pDir == NULL) || (pDir[0] == '\0'))
+        return;
+    if (strlen(pDir) >= CACHE_DIR_MAX){
+        printf("Warning, %s is too long, decode cache disabled.\n", CACHE_DIR_ENV);
+        return;
+    }
+    strcpy(cacheDir, pDir);
+#ifdef _WIN32
+    _mkdir(cacheDir);
+#else
+    mkdir(cacheDir, 0777);
+#endif
+
+    /* Same tables as loadTables */
+    hash = hashBytes(hash, &version, sizeof(version));
+    rval |= hashNamedFile(&hash, "font_table.txt");
+    if (ienc == 1){
+        rval |= hashNamedFile(&hash, "bpe.table");
+        rval |= hashNamedFile(&hash, "8bit_table.txt");
+    }
+    if ((ienc == 4) || (ienc == 5) || (ienc == 6))
+        rval |= hashNamedFile(&hash, "lsss_txtcmpstr_us.bin");
+    if (rval != 0)
+        return;
+
+    tableHash = hash;
+    cacheEnabled = 1;
+
+    return;
+}
+
+
+
+
+/*******************************************************************/
+/* getCacheKey                                                     */
+/* Builds the cache key for decoding inFile, which is rewound.     */
+/* Returns 0 on success, -1 if the cache is not usable.            */
+/*******************************************************************/
+int getCacheKey(FILE* inFile, int ienc, int sss, char* key){
+
+    unsigned long long hash = tableHash;
+    int rval;
+
+    if (!cacheEnabled)
+        return -1;
+
+    hash = hashBytes(hash, &ienc, sizeof(ienc));
+    hash = hashBytes(hash, &sss, sizeof(sss));
+    rval = hashFile(&hash, inFile);
+    rewind(inFile);
+    if (rval != 0)
+        return -1;
+
+    sprintf(key, "%08lX%08lX", (unsigned long)(hash >> 32), (unsigned long)(hash & 0xFFFFFFFF));
+
+    return 0;
+}
+
+
+
+
+/*******************************************************************/
+/* cacheFetch                                                      */
+/* Copies a cached meta script and dumps to the output filenames  */
+/* and prints the warnings of the original decode again.           */
+/* Returns 0 on a hit, -1 on a miss.                               */
+/*******************************************************************/
+int cacheFetch(const char* key, const char* outFileName, const char* txtOutFileName, const char* csvOutFileName){
+
+    const char* outNames[3];
+    char entryName[CACHE_PATH_MAX];
+    char line[512];
+    FILE* pFile;
+    int x;
+
+    outNames[0] = outFileName;
+    outNames[1] = txtOutFileName;
+    outNames[2] = csvOutFileName;
+
+    /* Every part of the entry must be present */
+    for (x = 0; x < CACHE_NUM_PARTS; x++){
+        sprintf(entryName, "%s/%s%s", cacheDir, key, cacheExts[x]);
+        pFile = fopen(entryName, "rb");
+        if (pFile == NULL)
+            return -1;
+        fclose(pFile);
+    }
+
+    for (x = 0; x < 3; x++){
+        sprintf(entryName, "%s/%s%s", cacheDir, key, cacheExts[x]);
+        if (copyFile(entryName, outNames[x]) != 0)
+            return -1;
+    }
+
+    /* Repeat the warnings, a hit should report the same problems */
+    sprintf(entryName, "%s/%s%s", cacheDir, key, cacheExts[3]);
+    pFile = fopen(entryName, "rb");
+    if (pFile != NULL){
+        while (fgets(line, sizeof(line), pFile) != NULL)
+            printf("%s", line);
+        fclose(pFile);
+    }
+
+    return 0;
+}
+
+
+
+
+/*******************************************************************/
+/* cacheStore                                                      */
+/* Saves the outputs of a successful decode and the warnings it    */
+/* printed (warnLen bytes at pWarnings) under key.  Each part      */
+/* is written to a temporary file first and renamed into place, so */
+/* concurrent decodes never see a partial entry.  Failures only    */
+/* mean the entry is not cached.                                   */
+/*******************************************************************/
+void cacheStore(const char* key, const char* outFileName, const char* txtOutFileName, const char* csvOutFileName,
+                const char* pWarnings, unsigned int warnLen){
+
+    const char* outNames[3];
+    char entryName[CACHE_PATH_MAX];
+    char tmpName[CACHE_PATH_MAX];
+    static volatile long tmpCount = 0;
+    long id;
+    int x, rval;
+
+    outNames[0] = outFileName;
+    outNames[1] = txtOutFileName;
+    outNames[2] = csvOutFileName;
+
+    /* Script is stored last, fetches check for all parts */
+    for (x = CACHE_NUM_PARTS - 1; x >= 0; x--){
+#ifdef _WIN32
+        id = (long)_getpid() * 1000 + InterlockedIncrement(&tmpCount);
+#else
+        id = (long)getpid() * 1000 + __sync_add_and_fetch(&tmpCount, 1);
+#endif
+        sprintf(entryName, "%s/%s%s", cacheDir, key, cacheExts[x]);
+        sprintf(tmpName, "%s/%s%s.%lX.tmp", cacheDir, key, cacheExts[x], (unsigned long)id);
+        if (x == 3)
+            rval = writeFile(tmpName, pWarnings, warnLen);
+        else
+            rval = copyFile(outNames[x], tmpName);
+        if (rval != 0){
+            remove(tmpName);
+            return;
+        }
+        remove(entryName);
+        if (rename(tmpName, entryName) != 0){
+            remove(tmpName);
+            return;
+        }
+    }
+
+    return;
+}
+
+
+
+
+/*******************************************************************/
+/* hashBytes - Adds numBytes of data to a 64-bit FNV-1a hash.      */
+/*******************************************************************/
+static unsigned long long hashBytes(unsigned long long hash, const void* pData, size_t numBytes){
+
+    const unsigned char* pByte = (const unsigned char*)pData;
+    size_t x;
+
+    for (x = 0; x < numBytes; x++){
+        hash ^= pByte[x];
+        hash *= FNV64_PRIME;
+    }
+
+    return hash;
+}
+
+
+
+
+/*******************************************************************/
+/* hashFile                                                        */
+/* Adds the rest of a file to a hash.  Returns 0 on success.       */
+/*******************************************************************/
+static int hashFile(unsigned long long* pHash, FILE* inFile){
+
+    unsigned char* pBuf;
+    size_t numRead;
+    unsigned long long hash = *pHash;
+    unsigned long long size = 0;
+
+    pBuf = (unsigned char*)malloc(CACHE_BUF_SIZE);
+    if (pBuf == NULL)
+        return -1;
+
+    while ((numRead = fread(pBuf, 1, CACHE_BUF_SIZE, inFile)) > 0){
+        hash = hashBytes(hash, pBuf, numRead);
+        size += numRead;
+    }
+    free(pBuf);
+    if (ferror(inFile))
+        return -1;
+
+    /* Length too, so files that are prefixes of each other differ */
+    *pHash = hashBytes(hash, &size, sizeof(size));
+
+    return 0;
+}
+
+
+
+
+/*******************************************************************/
+/* hashNamedFile - hashFile by filename.  Returns 0 on success.    */
+/*******************************************************************/
+static int hashNamedFile(unsigned long long* pHash, const char* fname){
+
+    FILE* inFile;
+    int rval;
+
+    inFile = fopen(fname, "rb");
+    if (inFile == NULL)
+        return -1;
+    rval = hashFile(pHash, inFile);
+    fclose(inFile);
+
+    return rval;
+}
+
+
+
+
+/*******************************************************************/
+/* copyFile - Copies a file.  Returns 0 on success, -1 on failure. */
+/*******************************************************************/
+static int copyFile(const char* srcName, const char* dstName){
+
+    FILE *inFile, *outFile;
+    unsigned char* pBuf;
+    size_t numRead;
+    int rval = 0;
+
+    inFile = fopen(srcName, "rb");
+    if (inFile == NULL)
+        return -1;
+    outFile = fopen(dstName, "wb");
+    if (outFile == NULL){
+        fclose(inFile);
+        return -1;
+    }
+    pBuf = (unsigned char*)malloc(CACHE_BUF_SIZE);
+    if (pBuf == NULL){
+        fclose(inFile);
+        fclose(outFile);
+        return -1;
+    }
+
+    while ((numRead = fread(pBuf, 1, CACHE_BUF_SIZE, inFile)) > 0){
+        if (fwrite(pBuf, 1, numRead, outFile) != numRead){
+            rval = -1;
+            break;
+        }
+    }
+    if (ferror(inFile))
+        rval = -1;
+
+    free(pBuf);
+    fclose(inFile);
+    if (fclose(outFile) != 0)
+        rval = -1;
+
+    return rval;
+}
+
+
+
+
+/*******************************************************************/
+/* writeFile - Writes numBytes of data to a new file.              */
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+static int writeFile(const char* fname, const char* pData, unsigned int numBytes){
+
+    FILE* outFile;
+    int rval = 0;
+
+    outFile = fopen(fname, "wb");
+    if (outFile == NULL)
+        return -1;
+    if ((numBytes > 0) && (fwrite(pData, 1, numBytes, outFile) != numBytes))
+        rval = -1;
+    if (fclose(outFile) != 0)
+        rval = -1;
+
+    return rval;
+}
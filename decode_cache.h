@@ -0,0 +1,28 @@
+/**********************************************************************/
+/* decode_cache.h - Optional on disk cache of decode outputs, keyed   */
+/*                  by a hash of the input file, decode mode and      */
+/*                  table files.                                      */
+/**********************************************************************/
+#ifdef _MSC_VER
+#pragma warning(disable:4996)
+#endif
+#ifndef DECODE_CACHE_H
+#define DECODE_CACHE_H
+#include <stdio.h>
+
+/* Defines */
+#define CACHE_DIR_ENV      "LSB_CACHE_DIR"  /* Cache is off unless set    */
+#define CACHE_KEY_SIZE     17            /* 16 hex digits + NUL          */
+
+
+/***********************/
+/* Function Prototypes */
+/***********************/
+void initDecodeCache(int ienc);
+int getCacheKey(FILE* inFile, int ienc, int sss, char* key);
+int cacheFetch(const char* key, const char* outFileName, const char* txtOutFileName, const char* csvOutFileName);
+void cacheStore(const char* key, const char* outFileName, const char* txtOutFileName, const char* csvOutFileName,
+                const char* pWarnings, unsigned int warnLen);
+
+
+#endif
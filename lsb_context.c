@@ -0,0 +1,160 @@
+/**********************************************************************/
+/* lsb_context.c - Setup and teardown of the per-run script context.  */
+/**********************************************************************/
+
+
+/************/
+/* Includes */
+/************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "lsb_context.h"
+#include "snode_list.h"
+#include "util.h"
+
+
+
+/***********************/
+/* Function Prototypes */
+/***********************/
+int initContext(lsb_context* ctx);
+void releaseContext(lsb_context* ctx);
+unsigned char* reserveTextBuf(lsb_context* ctx, unsigned int numBytes);
+void logWarning(lsb_context* ctx, const char* format, ...);
+
+
+
+
+/*******************************************************************/
+/* initContext                                                     */
+/* Puts a context into its default state with an empty node list.  */
+/*******************************************************************/
+int initContext(lsb_context* ctx){
+
+    memset(ctx, 0, sizeof(lsb_context));
+    arenaInit(&ctx->nodeArena, ARENA_BLOCK_SIZE);
+    poolInit(&ctx->strings);
+    ctx->head = ctx->tail = NODE_NONE;
+
+    ctx->textDecodeMode = TEXT_DECODE_TWO_BYTES_PER_CHAR;
+    ctx->outputMode = LUNAR_BIG_ENDIAN;
+    ctx->inputMode = RADIX_HEX;
+    ctx->tableMode = TWO_BYTE_ENC;
+    ctx->maxBinFsize = 0;
+    ctx->ptrTableEntries = DEFAULT_PTR_ENTRIES;
+    ctx->ptrEntrySize = DEFAULT_PTR_ENTRY_SIZE;
+
+    return initNodeList(ctx);
+}
+
+
+
+
+/*******************************************************************/
+/* releaseContext                                                  */
+/* Frees everything owned by the context.                          */
+/*******************************************************************/
+void releaseContext(lsb_context* ctx){
+
+    releaseNodeList(ctx);
+    poolFree(&ctx->strings);
+    curFree(&ctx->input);
+
+    if (ctx->pdata != NULL)
+        free(ctx->pdata);
+    if (ctx->pdata2 != NULL)
+        free(ctx->pdata2);
+    if (ctx->obuf != NULL)
+        free(ctx->obuf);
+    if (ctx->pTextBuf != NULL)
+        free(ctx->pTextBuf);
+    ctx->pTextBuf = NULL;
+    ctx->textBufSize = 0;
+    if (ctx->pScriptBuf != NULL)
+        free(ctx->pScriptBuf);
+    ctx->pScriptBuf = ctx->pInput = NULL;
+    if (ctx->pNodeText != NULL)
+        free(ctx->pNodeText);
+    ctx->pNodeText = NULL;
+    ctx->nodeTextSize = ctx->nodeTextLen = ctx->nodeTextPos = 0;
+    if (ctx->pWarnings != NULL)
+        free(ctx->pWarnings);
+    ctx->pWarnings = NULL;
+    ctx->warnSize = ctx->warnLen = 0;
+    if (ctx->pRunBuf != NULL)
+        free(ctx->pRunBuf);
+    ctx->pRunBuf = NULL;
+    ctx->runCount = ctx->runMax = 0;
+    ctx->pdata = ctx->pdata2 = NULL;
+    ctx->obuf = ctx->pOutput = NULL;
+    ctx->obufSize = 0;
+
+    return;
+}
+
+
+
+
+/*******************************************************************/
+/* reserveTextBuf                                                  */
+/* Makes the context's scratch text buffer at least numBytes long. */
+/* The buffer only grows, so it is reused by every text conversion */
+/* in a run.  Contents are kept.  Returns NULL on failure.         */
+/*******************************************************************/
+unsigned char* reserveTextBuf(lsb_context* ctx, unsigned int numBytes){
+
+    unsigned char* pNew;
+    unsigned int newSize;
+
+    if (numBytes <= ctx->textBufSize)
+        return ctx->pTextBuf;
+
+    newSize = (ctx->textBufSize * 2 > numBytes) ? (ctx->textBufSize * 2) : numBytes;
+    pNew = (unsigned char*)realloc(ctx->pTextBuf, newSize);
+    if (pNew == NULL){
+        printf("Error allocing memory for text conversion.\n");
+        return NULL;
+    }
+    ctx->pTextBuf = pNew;
+    ctx->textBufSize = newSize;
+
+    return ctx->pTextBuf;
+}
+
+
+
+
+/*******************************************************************/
+/* logWarning                                                      */
+/* Prints a warning about the script being decoded and keeps a     */
+/* copy in ctx->pWarnings, so a cached decode can repeat it.       */
+/*******************************************************************/
+void logWarning(lsb_context* ctx, const char* format, ...){
+
+    char line[512];
+    char* pNew;
+    unsigned int len, newSize;
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    printf("%s", line);
+
+    /* Warnings are only informational, drop the copy if out of memory */
+    len = (unsigned int)strlen(line);
+    if (ctx->warnLen + len + 1 > ctx->warnSize){
+        newSize = (ctx->warnSize * 2 > ctx->warnLen + len + 1) ? (ctx->warnSize * 2) : (ctx->warnLen + len + 1024);
+        pNew = (char*)realloc(ctx->pWarnings, newSize);
+        if (pNew == NULL)
+            return;
+        ctx->pWarnings = pNew;
+        ctx->warnSize = newSize;
+    }
+    memcpy(ctx->pWarnings + ctx->warnLen, line, len + 1);
+    ctx->warnLen += len;
+
+    return;
+}
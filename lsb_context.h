@@ -0,0 +1,126 @@
+/**********************************************************************/
+/* lsb_context.h - Per-run state for decoding/encoding/updating a     */
+/*                 single script.  Every function that touches the    */
+/*                 node list, the decoders, the writers, or the I/O   */
+/*                 mode settings takes a context.  Independent        */
+/*                 contexts may be used at the same time on different */
+/*                 threads.  The UTF8, BPE and PSX string tables are  */
+/*                 loaded once and shared (read only) by all of them. */
+/**********************************************************************/
+#ifdef _MSC_VER
+#pragma warning(disable:4996)
+#endif
+#ifndef LSB_CONTEXT_H
+#define LSB_CONTEXT_H
+#include "script_node_types.h"
+#include "mem_arena.h"
+#include "str_pool.h"
+#include "byte_cursor.h"
+
+/* Defines */
+#define psxBufferSize (10*1024) //Should be Overkill
+#define FORMAT_BUF_SIZE   64
+#define CTRL_TXT_BUF_SIZE 300
+#define NODE_UNIT         8      /* Node store granularity in bytes */
+#define NODE_CHUNK_SHIFT  15     /* Handle bits for the unit in a chunk */
+#define NODE_CHUNK_SIZE   ((1 << NODE_CHUNK_SHIFT) * NODE_UNIT)
+
+/* Struct Forward Declarations */
+typedef struct offsetInterval offsetInterval;
+
+/* Sorted [start,end) byte range of a decoded command */
+struct offsetInterval{
+    unsigned int start;
+    unsigned int end;
+    unsigned int node;             /* Handle */
+};
+
+/* Chunked storage for script nodes.  A node's handle is its chunk  */
+/* number shifted by NODE_CHUNK_SHIFT plus its unit in the chunk.    */
+typedef struct nodeStore{
+    unsigned char** pChunks;
+    unsigned int numChunks;
+    unsigned int maxChunks;
+    unsigned int used;             /* Bytes used in the last chunk */
+}nodeStore;
+
+typedef struct lsb_context{
+
+    /* Node List (snode_list.c) */
+    nodeStore nodes;               /* Owns nodes and inline params */
+    unsigned int head;             /* Handle of the first node */
+    unsigned int tail;             /* Handle of the last node */
+    memArena nodeArena;            /* Owns other params and run params */
+    strPool strings;               /* Run param text, kept across scripts */
+    unsigned int* pIdIndex;        /* ID -> first Node with that ID, open */
+                                   /* addressing.  Duplicate IDs are only */
+                                   /* counted, lookups then walk the list.*/
+    unsigned int idIndexSize;
+    unsigned int idIndexCount;
+    unsigned int idIndexDups;
+    unsigned int* pOffsetIndex;    /* fileOffset -> Node, decode only */
+    unsigned int offsetIndexSize;
+    offsetInterval* pIntervals;    /* Sorted command byte ranges */
+    unsigned int numIntervals;
+
+    /* Binary Decoders (parse_binary*.c, psx_decode.c) */
+    byteCursor input;              /* Input file, loaded once per decode */
+    unsigned int nextID;           /* Next node ID, starts at 1 per script */
+    char* pdata;                   /* Command argument / text buffers */
+    char* pdata2;
+    unsigned char psxBuf[psxBufferSize];  /* PSX text decompression */
+    char* pWarnings;               /* Copy of printed decode warnings, */
+    unsigned int warnSize;         /* kept with cached decode outputs  */
+    unsigned int warnLen;
+
+    /* Meta Script Tokenizer (parse_script.c, update_script.c) */
+    unsigned char* pScriptBuf;     /* Script text, tokens point into it */
+    unsigned char* pInput;         /* Current token */
+    char* pTokNext;                /* Resume point for nextToken */
+
+    /* Binary Output (write_script.c) */
+    unsigned char* pOutput;
+    unsigned int offset;
+    unsigned char* obuf;
+    unsigned int obufSize;         /* Grows as the output is written */
+    unsigned int output_endian_type;
+    unsigned int table_mode;
+    char fmtBuf[FORMAT_BUF_SIZE];
+    char ctrlTxt[CTRL_TXT_BUF_SIZE];
+    unsigned char* pTextBuf;       /* Scratch text, see reserveTextBuf */
+    unsigned int textBufSize;
+    unsigned char* pNodeText;      /* Encoded text of the node being */
+    unsigned int nodeTextSize;     /* written, see cacheText          */
+    unsigned int nodeTextLen;
+    unsigned int nodeTextPos;      /* Next cached line to write */
+    int bpeOptimal;                /* Shortest BPE parse instead of greedy */
+    unsigned int bpeBytesSaved;    /* Bytes the optimal parse saved */
+
+    /* Run-commands / options sequence being built (snode_list.c) */
+    runParamType* pRunBuf;
+    unsigned int runCount;
+    unsigned int runMax;
+
+    /* I/O Modes (util.c) */
+    int textDecodeMode;            /* Binary Input File Encoding for Text */
+    int outputMode;                /* Script Text File Value Encoding */
+    int inputMode;                 /* Script Text File Value Representation */
+    int tableMode;                 /* Table File Encoding Method */
+    unsigned int maxBinFsize;      /* MAX allowed size of a binary script file */
+    unsigned int ptrTableEntries;  /* # of pointer table entries */
+    unsigned int ptrEntrySize;     /* Bytes per pointer table entry, 2 or 4 */
+    int sssEncode;                 /* SSS (not SSSC) table in use */
+    int iosEng;                    /* IOS ENG Input */
+    int sssItemHack;               /* PSX SSSC->SSS item renumbering */
+}lsb_context;
+
+
+/***********************/
+/* Function Prototypes */
+/***********************/
+int initContext(lsb_context* ctx);
+void releaseContext(lsb_context* ctx);
+unsigned char* reserveTextBuf(lsb_context* ctx, unsigned int numBytes);
+void logWarning(lsb_context* ctx, const char* format, ...);
+
+#endif
@@ -6,8 +6,11 @@
 /* lunarScriptBuilder (lsb.exe) Usage                                  */
 /* ==================================                                  */
 /* lsb.exe decode InputFname OutputFname ienc [sss]                    */
-/* lsb.exe encode InputFname OutputFname [sss]                         */
+/* lsb.exe encode InputFname OutputFname oenc [sss] [prune] [optimal] [report] */
 /* lsb.exe update InputFname OutputFname UpdateFname                   */
+/* lsb.exe decode-all InputDir OutputDir ienc [sss]                    */
+/* lsb.exe encode-all InputDir OutputDir oenc [sss] [prune] [optimal] [report] */
+/* lsb.exe bpe-train InputDir OutputTable                              */
 /*                                                                     */
 /* Note: Expects table file to be within same directory as exe.        */
 /*       Table file should be named font_table.exe                     */
@@ -28,6 +31,7 @@
 #include "psx_decode.h"
 #include "parse_binary_psx.h"
 #include "parse_binary_reEng.h"
+#include "batch.h"
 
 
 #define VER_MAJ    1
@@ -47,15 +51,28 @@ void printUsage(){
 	printf("    ienc = 4 for PSX Eng decoding of text\n");
 	printf("    ienc = 5 for PSX Eng decoding of text with SSS item hacks\n");
 	printf("    ienc = 6 for Lunar Remastered (Eng vers)\n");
-    printf("lsb.exe encode InputFname OutputFname oenc [sss]\n");
+    printf("lsb.exe encode InputFname OutputFname oenc [sss] [prune] [optimal] [report]\n");
     printf("    oenc = 0 for 2-Byte output encoded text\n");
     printf("    oenc = 1 for BPE output encoded text\n");
     printf("lsb.exe update InputFname OutputFname UpdateFname\n");
+    printf("lsb.exe decode-all InputDir OutputDir ienc [sss]\n");
+    printf("lsb.exe encode-all InputDir OutputDir oenc [sss] [prune] [optimal] [report]\n");
+    printf("lsb.exe bpe-train InputDir OutputTable\n");
     printf("Use Decode to take a binary TEXTxxx.DAT file and convert to metadata format.\n");
     printf("Use Encode to take a script in metadata format and convert to binary.\n");
     printf("Use Update to create modified version of a script in metadata format.\n");
+    printf("Use Decode-all/Encode-all to process every TEXTxxx.DAT/.txt file in a\n");
+    printf("    directory (or matching a wildcard) in parallel, loading tables once.\n");
+    printf("Use BPE-train to build a BPE table from the .txt scripts in a directory.\n");
     printf("Additional Notes:\n");
     printf("    sss flag will interpret SSS-MPEG JP table as the SSS JP table.\n");
+    printf("    prune flag leaves out commands no pointer can reach, and lists\n");
+    printf("        reachability in OutputFname_cfg.csv.\n");
+    printf("    optimal flag encodes BPE text (oenc = 1) with the fewest bytes the\n");
+    printf("        table allows instead of greedily, and reports the bytes saved.\n");
+    printf("    report flag lists the bytes each command, pointer ID and code takes,\n");
+    printf("        and the bytes left under max_size_bytes, in OutputFname_size.csv.\n");
+    printf("    Set LSB_CACHE_DIR to a directory to cache decode outputs there.\n");
     printf("    2-Byte Table file must be for SSS-MPEG, named \"font_table.txt\".\n");
     printf("    BPE Decoding & Encoding require a binary file named \"bpe.table\"\n");
     printf("        and a table file named \"8bit_table.txt\".\n");
@@ -69,14 +86,12 @@ void printUsage(){
 /******************************************************************************/
 int main(int argc, char** argv){
 
-    FILE *inFile, *upFile, *outFile, *csvOutFile, *txtOutFile;
-    static char inFileName[300];
-    static char upFileName[300];
-    static char outFileName[300];
-    static char csvOutFileName[300];
-    static char txtOutFileName[300];
-    int rval, ienc, oenc;
-	int remaster = 0;
+    FILE *inFile, *upFile, *outFile;
+    static char inFileName[LSB_PATH_MAX];
+    static char upFileName[LSB_PATH_MAX];
+    static char outFileName[LSB_PATH_MAX];
+    int rval, ienc, oenc, sss, prune, optimal, report, x;
+    lsb_context* ctx = NULL;
     rval = ienc = oenc = -1;
 
     printf("Lunar Script Builder v%d.%02d\n", VER_MAJ, VER_MIN);
@@ -85,67 +100,50 @@ int main(int argc, char** argv){
     /* Check input parameters */
     /**************************/
 
+    /* Build a BPE table, needs only the 8-bit table */
+    if ((argc == 4) && (strcmp(argv[1], "bpe-train") == 0)){
+        if ((strlen(argv[2]) >= LSB_PATH_MAX) || (strlen(argv[3]) >= LSB_PATH_MAX)){
+            printf("Error, filename too long.\n");
+            return -1;
+        }
+        return runBPETrain(argv[2], argv[3]);
+    }
+
     /* Check for valid # of args */
-    if (argc < 5){
+    if ((argc < 5) || (argc > 9)){
         printUsage();
         return -1;
     }
-
-    //Handle Generic Input Parameters
-    memset(inFileName, 0, 300);
-    memset(outFileName, 0, 300);
-    strcpy(inFileName, argv[2]);
-    strcpy(outFileName, argv[3]);
-    strcpy(csvOutFileName, argv[3]); /* Only used for decode */
-    strcpy(txtOutFileName, argv[3]); /* Only used for decode */
-    strcat(txtOutFileName, "_dump.txt");
+    if ((strlen(argv[2]) >= LSB_PATH_MAX) || (strlen(argv[3]) >= LSB_PATH_MAX) ||
+        (strlen(argv[4]) >= LSB_PATH_MAX)){
+        printf("Error, filename too long.\n");
+        return -1;
+    }
+    sss = prune = optimal = report = 0;
+    for (x = 5; x < argc; x++){
+        if (strcmp(argv[x], "sss") == 0)
+            sss = 1;
+        else if (strcmp(argv[x], "prune") == 0)
+            prune = 1;
+        else if (strcmp(argv[x], "optimal") == 0)
+            optimal = 1;
+        else if (strcmp(argv[x], "report") == 0)
+            report = 1;
+        else{
+            printf("Error, unknown option %s.\n", argv[x]);
+            printUsage();
+            return -1;
+        }
+    }
 
     /***********************************/
     /* Check & Decode Input Parameters */
     /***********************************/
-    if ((strcmp(argv[1], "decode") == 0)){
-        /* Check decode parameters */
+    if ((strcmp(argv[1], "decode") == 0) || (strcmp(argv[1], "decode-all") == 0)){
         ienc = atoi(argv[4]);
-        setTextDecodeMethod(ienc);
-		if(ienc == 6){
-			ienc = 4;
-			remaster = 1;
-		}
-		if(ienc == 5)
-			ienc = 4;
-        if((argc == 6) && (strcmp(argv[5], "sss") == 0))
-            setSSSEncode();
-        if (argc > 6){
-            printUsage();
-            return -1;
-        }
-
-        /* Build unique CSV output filename to alleviate */
-        /* Excel frustration with duplicate filenames open simultaneously */
-        if (ienc == 2)
-            strcat(csvOutFileName, "_iosJP");
-        else if (ienc == 3)
-            strcat(csvOutFileName, "_iosENG");
-		else if (remaster == 1)
-			strcat(csvOutFileName, "_reENG");
-		else if (ienc == 4)
-			strcat(csvOutFileName, "_psxENG");
-        else if ((argc == 6) && (strcmp(argv[5], "sss") == 0))
-            strcat(csvOutFileName, "_sss");
-        else
-            strcat(csvOutFileName, "_sssm");
-        strcat(csvOutFileName, "_dump.csv");
     }
-    else if ((strcmp(argv[1], "encode") == 0)){
-        /* Check encode parameters */
+    else if ((strcmp(argv[1], "encode") == 0) || (strcmp(argv[1], "encode-all") == 0)){
         oenc = atoi(argv[4]);
-        setTableOutputMode(oenc);
-        if ((argc == 6) && (strcmp(argv[5], "sss") == 0))
-            setSSSEncode();
-        if (argc > 6){
-            printUsage();
-            return -1;
-        }
     }
     else if ((strcmp(argv[1], "update") == 0)){
         /* Check update parameters */
@@ -153,7 +151,7 @@ int main(int argc, char** argv){
             printUsage();
             return -1;
         }
-        memset(upFileName, 0, 300);
+        memset(upFileName, 0, LSB_PATH_MAX);
         strcpy(upFileName, argv[4]);
     }
     else{
@@ -162,110 +160,84 @@ int main(int argc, char** argv){
         return -1;
     }
 
-    
-    /***************************************************/
-    /* Load in the Table File for Decoding 2-Byte Text */
-    /***************************************************/
-    if (loadUTF8Table("font_table.txt") < 0){
-        printf("Error loading UTF8 Table for Text Decoding.\n");
+
+    /****************************************************/
+    /* Load in the Table Files, shared by every context */
+    /****************************************************/
+    if (loadTables(ienc, oenc, sss) < 0)
         return -1;
-    }
 
 
-    /*****************************************************/
-    /* Load in the Table Files for BPE Decoding/Encoding */
-    /*****************************************************/
-    if((ienc == 1) || (oenc == 1)){
-        if (loadBPETable("bpe.table","8bit_table.txt") < 0){
-            printf("Error loading BPE Tables for Text Encoding/Decoding.\n");
-            return -1;
-        }
+    /**************************************************/
+    /* Whole directory, every file uses loaded tables */
+    /**************************************************/
+    if ((strcmp(argv[1], "decode-all") == 0) || (strcmp(argv[1], "encode-all") == 0)){
+        if (ienc >= 0)
+            rval = runBatch(1, argv[2], argv[3], ienc, sss, 0, 0, 0);
+        else
+            rval = runBatch(0, argv[2], argv[3], oenc, sss, prune, optimal, report);
+        releaseTables(ienc);
+        return rval;
     }
 
-	/***********************************************/
-	/* Load in PSX Decode String Table if Required */
-	/***********************************************/
-	if (ienc == 4){
-		if (loadPSXStringTable("lsss_txtcmpstr_us.bin") < 0){
-			printf("Error loading Lunar Eng PSX String Decode Table For Decoding.\n");
-			return -1;
-		}
-	}
-
-    /*******************************/
-    /* Open the input/output files */
-    /*******************************/
-    inFile = outFile = NULL;
-    inFile = fopen(inFileName, "rb");
-    if (inFile == NULL){
-        printf("Error occurred while opening input script %s for reading\n", inFileName);
-        return -1;
-    }
-    outFile = fopen(outFileName, "wb");
-    if (outFile == NULL){
-        printf("Error occurred while opening output file %s for writing\n", outFileName);
-        fclose(inFile);
+    /* Create the context holding all state for this script */
+    ctx = (lsb_context*)malloc(sizeof(lsb_context));
+    if ((ctx == NULL) || (initContext(ctx) != 0)){
+        printf("Error creating script context.\n");
         return -1;
     }
 
+    //Handle Generic Input Parameters
+    memset(inFileName, 0, LSB_PATH_MAX);
+    memset(outFileName, 0, LSB_PATH_MAX);
+    strcpy(inFileName, argv[2]);
+    strcpy(outFileName, argv[3]);
 
-    /**************************************************************************/
-    /* Parse the Input Script File (Req'd for Encoding to Binary or Updating) */
-    /**************************************************************************/
-    printf("Parsing input file.\n");
-    
-    /* Init Linked List for storing node data */
-    initNodeList();
 
-    if ((strcmp(argv[1], "encode") == 0) ||
-        (strcmp(argv[1], "update") == 0))
-    {
-        rval = encodeScript(inFile, outFile);
-    }
-    else if (strcmp(argv[1], "decode") == 0){
-		if(remaster == 1)
-			rval = decodeBinaryScript_RE_Eng(inFile, outFile);
-		else if (ienc == 4)
-			rval = decodeBinaryScript_PSX(inFile, outFile);
-		else
-	        rval = decodeBinaryScript(inFile, outFile);
-    } else {
-        printf("Unknown mode: %s\n", argv[1]);
-        fclose(inFile);
-        fclose(outFile);
-        return -1;
+    /*****************************************/
+    /* Single File Decode, Encode, or Update */
+    /*****************************************/
+    if (strcmp(argv[1], "decode") == 0){
+        rval = decodeFile(ctx, inFileName, outFileName, ienc, sss);
     }
-    fclose(inFile);
-    if (rval == 0){
-        printf("Input File Parsed Successfully.\n");
+    else if (strcmp(argv[1], "encode") == 0){
+        rval = encodeFile(ctx, inFileName, outFileName, oenc, sss, prune, optimal, report);
     }
     else{
-        printf("Input File Parsing FAILED. Aborting further operations.\n");
-        fclose(outFile);
-        destroyNodeList();
-        return -1;
-    }
-    
-
-    /**********************************************/
-    /* Parameter Decoding - Encode or Update Mode */
-    /**********************************************/
-    if( (strcmp(argv[1],"encode") == 0) ){
 
-        printf("ENCODE Mode Entered.\n");
+        /*******************************/
+        /* Open the input/output files */
+        /*******************************/
+        inFile = outFile = NULL;
+        inFile = fopen(inFileName, "rb");
+        if (inFile == NULL){
+            printf("Error occurred while opening input script %s for reading\n", inFileName);
+            return -1;
+        }
+        outFile = fopen(outFileName, "wb");
+        if (outFile == NULL){
+            printf("Error occurred while opening output file %s for writing\n", outFileName);
+            fclose(inFile);
+            return -1;
+        }
 
-        /* Write out the data as a binary file */
-        rval = writeBinScript(outFile);
+        /**************************************************/
+        /* Parse the Input Script File (Req'd for Update) */
+        /**************************************************/
+        printf("Parsing input file.\n");
+        rval = encodeScript(ctx, inFile, outFile);
+        fclose(inFile);
         if (rval == 0){
-            printf("Input File Encoded Successfully.\n");
+            printf("Input File Parsed Successfully.\n");
         }
         else{
-            printf("Input File Encoding FAILED.\n");
+            printf("Input File Parsing FAILED. Aborting further operations.\n");
+            fclose(outFile);
+            releaseContext(ctx);
+            free(ctx);
+            return -1;
         }
 
-    }
-    else if ((strcmp(argv[1], "update") == 0)){
-
         printf("UPDATE Mode Entered.\n");
 
         /* Open the update file */
@@ -274,78 +246,31 @@ int main(int argc, char** argv){
         if (upFile == NULL){
             printf("Error occurred while opening update file %s for reading\n", upFileName);
             fclose(outFile);
-            destroyNodeList();
+            releaseContext(ctx);
+            free(ctx);
             return -1;
         }
 
         /* Parse the Update File for Updating */
-        rval = updateScript(upFile);
+        rval = updateScript(ctx, upFile);
         fclose(upFile);
 
         /* Write out the data as a Script file */
-        rval = writeScript(outFile);
-        if (rval == 0){
-            printf("Input Script File Updated Successfully.\n");
-        }
-        else{
-            printf("Input Script File Updating FAILED.\n");
-        }
-    }
-    else if ((strcmp(argv[1], "decode") == 0)){
-        
-        printf("DECODE Mode Entered.\n");
-
-        /* Write out the data as a Script file */
-        rval = writeScript(outFile);
+        rval = writeScript(ctx, outFile);
         if (rval == 0){
             printf("Input Script File Updated Successfully.\n");
         }
         else{
             printf("Input Script File Updating FAILED.\n");
         }
-
-        /* Text Script Output */
-        txtOutFile = fopen(txtOutFileName, "wb");
-        if (txtOutFile == NULL){
-            printf("Error occurred while opening TXT dump output file %s for writing\n", txtOutFileName);
-            return -1;
-        }
-
-        /* CSV Script Output */
-        csvOutFile = fopen(csvOutFileName, "wb");
-        if (csvOutFile == NULL){
-            printf("Error occurred while opening CSV dump output file %s for writing\n", csvOutFileName);
-            return -1;
-        }
-        else{
-            rval = dumpScript(csvOutFile, txtOutFile);
-            if (rval == 0){
-                printf("Script File Dumps Created.\n");
-            }
-            else{
-                printf("Script File Dumps FAILED.\n");
-            }
-            fclose(txtOutFile);
-            fclose(csvOutFile);
-        }
-    }
-    else{
-        printUsage();
         fclose(outFile);
-        destroyNodeList();
-        return -1;
+        rval = 0;
     }
 
-    /* Close files */
-    fclose(outFile);
-
     /* Release Resources */
-    destroyNodeList();
-
-	/* Remove PSX String Table (if used) */
-	if (ienc == 4){
-		releasePSXStringTable();
-	}
+    releaseContext(ctx);
+    free(ctx);
+    releaseTables(ienc);
 
-    return 0;
+    return rval;
 }
@@ -0,0 +1,161 @@
+/**********************************************************************/
+/* mem_arena.c - Bump allocator for per-script data.                  */
+/*               Everything allocated from an arena is released at    */
+/*               once by arenaReset or arenaFree.                     */
+/**********************************************************************/
+
+
+/************/
+/* Includes */
+/************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mem_arena.h"
+
+
+
+/***********************/
+/* Function Prototypes */
+/***********************/
+void arenaInit(memArena* pArena, unsigned int blockSize);
+void* arenaAlloc(memArena* pArena, unsigned int numBytes);
+void arenaReset(memArena* pArena);
+void arenaFree(memArena* pArena);
+static memBlock* newBlock(unsigned int size);
+
+
+/* Size of a block header, rounded up to keep the data aligned */
+#define BLOCK_HDR_SIZE ((sizeof(memBlock) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+
+
+/*******************************************************************/
+/* arenaInit                                                       */
+/* Sets up an empty arena.  Memory is not allocated until needed.  */
+/*******************************************************************/
+void arenaInit(memArena* pArena, unsigned int blockSize){
+
+    pArena->pHead = NULL;
+    pArena->blockSize = (blockSize == 0) ? ARENA_BLOCK_SIZE : blockSize;
+
+    return;
+}
+
+
+
+/*******************************************************************/
+/* arenaAlloc                                                      */
+/* Returns numBytes of aligned memory from the arena.              */
+/* Requests larger than a block get a block of their own.          */
+/* NULL is returned on failure.                                    */
+/*******************************************************************/
+void* arenaAlloc(memArena* pArena, unsigned int numBytes){
+
+    memBlock* pBlock;
+    unsigned int size;
+    void* pData;
+
+    numBytes = (numBytes + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    if (numBytes == 0)
+        numBytes = ARENA_ALIGN;
+
+    /* Use the current block if there is room */
+    pBlock = pArena->pHead;
+    if ((pBlock == NULL) || ((pBlock->size - pBlock->used) < numBytes)){
+
+        size = (numBytes > pArena->blockSize) ? numBytes : pArena->blockSize;
+        pBlock = newBlock(size);
+        if (pBlock == NULL){
+            printf("Error allocing memory for arena block.\n");
+            return NULL;
+        }
+
+        /* An oversized block goes behind the current one so the rest */
+        /* of the current block keeps being used.                     */
+        if ((size > pArena->blockSize) && (pArena->pHead != NULL)){
+            pBlock->pNext = pArena->pHead->pNext;
+            pArena->pHead->pNext = pBlock;
+        }
+        else{
+            pBlock->pNext = pArena->pHead;
+            pArena->pHead = pBlock;
+        }
+    }
+
+    pData = (unsigned char*)pBlock + BLOCK_HDR_SIZE + pBlock->used;
+    pBlock->used += numBytes;
+
+    return pData;
+}
+
+
+
+/*******************************************************************/
+/* arenaReset                                                      */
+/* Releases everything allocated from the arena.  One standard     */
+/* block is kept for reuse by the next script.                     */
+/*******************************************************************/
+void arenaReset(memArena* pArena){
+
+    memBlock* pBlock, *pNext, *pKeep;
+
+    pKeep = NULL;
+    pBlock = pArena->pHead;
+    while (pBlock != NULL){
+        pNext = pBlock->pNext;
+        if ((pKeep == NULL) && (pBlock->size == pArena->blockSize))
+            pKeep = pBlock;
+        else
+            free(pBlock);
+        pBlock = pNext;
+    }
+
+    if (pKeep != NULL){
+        pKeep->pNext = NULL;
+        pKeep->used = 0;
+    }
+    pArena->pHead = pKeep;
+
+    return;
+}
+
+
+
+/*******************************************************************/
+/* arenaFree                                                       */
+/* Releases the arena and all of its blocks.                       */
+/*******************************************************************/
+void arenaFree(memArena* pArena){
+
+    memBlock* pBlock, *pNext;
+
+    pBlock = pArena->pHead;
+    while (pBlock != NULL){
+        pNext = pBlock->pNext;
+        free(pBlock);
+        pBlock = pNext;
+    }
+    pArena->pHead = NULL;
+
+    return;
+}
+
+
+
+/*******************************************************************/
+/* newBlock - Allocates a block with room for size bytes of data.  */
+/*******************************************************************/
+static memBlock* newBlock(unsigned int size){
+
+    memBlock* pBlock;
+
+    pBlock = (memBlock*)malloc(BLOCK_HDR_SIZE + size);
+    if (pBlock == NULL)
+        return NULL;
+    pBlock->pNext = NULL;
+    pBlock->size = size;
+    pBlock->used = 0;
+
+    return pBlock;
+}
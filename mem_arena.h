@@ -0,0 +1,38 @@
+/**********************************************************************/
+/* mem_arena.h - Bump allocator for per-script data.                  */
+/**********************************************************************/
+#ifdef _MSC_VER
+#pragma warning(disable:4996)
+#endif
+#ifndef MEM_ARENA_H
+#define MEM_ARENA_H
+
+/* Defines */
+#define ARENA_BLOCK_SIZE (256*1024)   /* Default size of an arena block */
+#define ARENA_ALIGN      8            /* Alignment of every allocation  */
+
+/* Block of arena memory, data follows the header */
+typedef struct memBlock memBlock;
+struct memBlock{
+    memBlock* pNext;
+    unsigned int size;     /* Bytes of data in the block */
+    unsigned int used;     /* Bytes handed out so far    */
+};
+
+/* Arena, a chain of blocks with the current block at the head */
+typedef struct memArena{
+    memBlock* pHead;
+    unsigned int blockSize;
+}memArena;
+
+
+/***********************/
+/* Function Prototypes */
+/***********************/
+void arenaInit(memArena* pArena, unsigned int blockSize);
+void* arenaAlloc(memArena* pArena, unsigned int numBytes);
+void arenaReset(memArena* pArena);
+void arenaFree(memArena* pArena);
+
+
+#endif
@@ -0,0 +1,301 @@
+/**********************************************************************/
+/* opcode_table.c - Per-platform descriptors for the script commands  */
+/*                  with a fixed argument count or a simple           */
+/*                  terminator.  The Saturn, PSX and Remaster         */
+/*                  decoders look a command up here before falling    */
+/*                  back to their own switch, so these layouts are    */
+/*                  described and decoded in one place.               */
+/**********************************************************************/
+
+
+/************/
+/* Includes */
+/************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "opcode_table.h"
+#include "snode_list.h"
+#include "util.h"
+
+
+
+/***********************/
+/* Function Prototypes */
+/***********************/
+const opcodeDesc* getOpcodeDesc(int profile, unsigned short cmd);
+int decodeTableOp(lsb_context* ctx, byteCursor* pCur, const opcodeDesc* pDesc, unsigned short cmd, int offset);
+static void convertSSSItem(unsigned char* pItem);
+
+
+
+/****************************/
+/* Descriptor Table Entries */
+/****************************/
+#define ALL                  OP_SWAP_ALL
+#define CUSTOM               {OP_CUSTOM, 0, 0, 0}
+#define NOARGS               {OP_SHORTS, 0, 0, 0}
+#define SHORTS(n, swap)      {OP_SHORTS, n, 0, swap}
+#define JUMP(n, swap)        {OP_SHORTS, n, OPF_JUMP, swap}
+#define ITEM(swap)           {OP_SHORTS, 1, OPF_SSS_ITEM, swap}
+#define TO_ZERO(swap)        {OP_SHORTS_TO_ZERO, 0, 0, swap}
+#define JUMP_TO_ZERO(swap)   {OP_SHORTS_TO_ZERO, 0, OPF_JUMP | OPF_FIRST_ANY, swap}
+#define BYTES                {OP_BYTES_TO_NUL, 0, 0, OP_SWAP_ALL}
+
+/* Saturn data is big endian, so every argument is swapped.  PSX   */
+/* and Remaster data is little endian, arguments that are really   */
+/* byte pairs are swapped so they read the same as on the Saturn.  */
+#define OPCODE_LIST \
+    /* cmd        Saturn               PSX                  Remaster */          \
+                                                                                 \
+    /* No arguments */                                                           \
+    OP(0x0039,    NOARGS,              NOARGS,              NOARGS)              \
+    OP(0x003B,    NOARGS,              NOARGS,              NOARGS)              \
+    OP(0x002F,    NOARGS,              NOARGS,              NOARGS)              \
+    OP(0x0032,    NOARGS,              NOARGS,              NOARGS)              \
+    OP(0x003A,    NOARGS,              NOARGS,              NOARGS)              \
+    OP(0x003C,    NOARGS,              NOARGS,              NOARGS)              \
+    OP(0x003F,    NOARGS,              NOARGS,              NOARGS)              \
+    OP(0x0040,    NOARGS,              NOARGS,              NOARGS)              \
+    OP(0x004C,    NOARGS,              NOARGS,              NOARGS)              \
+    OP(0x004D,    NOARGS,              NOARGS,              NOARGS)              \
+    OP(0x0051,    NOARGS,              NOARGS,              NOARGS)              \
+    OP(0x0053,    CUSTOM,              NOARGS,              NOARGS)              \
+    OP(0x0054,    CUSTOM,              NOARGS,              NOARGS)              \
+    OP(0x0058,    NOARGS,              NOARGS,              NOARGS)              \
+    OP(0x005B,    NOARGS,              NOARGS,              NOARGS)              \
+    OP(0x005E,    NOARGS,              NOARGS,              NOARGS)              \
+    OP(0x0064,    CUSTOM,              CUSTOM,              NOARGS)              \
+                                                                                 \
+    /* One short argument */                                                     \
+    OP(0x0003,    JUMP(1, ALL),        JUMP(1, 0),          JUMP(1, 0))          \
+    OP(0x0004,    JUMP(1, ALL),        JUMP(1, 0),          JUMP(1, 0))          \
+    OP(0x001F,    SHORTS(1, ALL),      ITEM(0x1),           ITEM(0x1))           \
+    OP(0x0020,    SHORTS(1, ALL),      ITEM(0x1),           ITEM(0x1))           \
+    OP(0x0023,    SHORTS(1, ALL),      SHORTS(1, 0x1),      SHORTS(1, 0x1))      \
+    OP(0x0028,    SHORTS(1, ALL),      SHORTS(1, 0x1),      SHORTS(1, 0x1))      \
+    OP(0x0029,    SHORTS(1, ALL),      SHORTS(1, 0x1),      SHORTS(1, 0x1))      \
+    OP(0x002A,    SHORTS(1, ALL),      SHORTS(1, 0x1),      SHORTS(1, 0x1))      \
+    OP(0x002E,    SHORTS(1, ALL),      SHORTS(1, 0x1),      SHORTS(1, 0x1))      \
+    OP(0x0030,    SHORTS(1, ALL),      SHORTS(1, 0x1),      SHORTS(1, 0x1))      \
+    OP(0x0031,    SHORTS(1, ALL),      SHORTS(1, 0),        SHORTS(1, 0))        \
+    OP(0x0033,    SHORTS(1, ALL),      SHORTS(1, 0),        SHORTS(1, 0))        \
+    OP(0x0043,    SHORTS(1, ALL),      SHORTS(1, 0x1),      SHORTS(1, 0x1))      \
+    OP(0x0044,    SHORTS(1, ALL),      SHORTS(1, 0x1),      SHORTS(1, 0x1))      \
+    OP(0x0045,    SHORTS(1, ALL),      SHORTS(1, 0x1),      SHORTS(1, 0x1))      \
+    OP(0x0047,    SHORTS(1, ALL),      SHORTS(1, 0x1),      SHORTS(1, 0x1))      \
+    OP(0x0048,    SHORTS(1, ALL),      SHORTS(1, 0x1),      SHORTS(1, 0x1))      \
+    OP(0x0049,    SHORTS(1, ALL),      SHORTS(1, 0x1),      SHORTS(1, 0x1))      \
+    OP(0x0052,    SHORTS(1, ALL),      SHORTS(1, 0x1),      SHORTS(1, 0x1))      \
+    OP(0x0056,    SHORTS(1, ALL),      SHORTS(1, 0x1),      SHORTS(1, 0x1))      \
+    OP(0x0057,    SHORTS(1, ALL),      SHORTS(1, 0x1),      SHORTS(1, 0x1))      \
+    OP(0x0059,    SHORTS(1, ALL),      SHORTS(1, 0x1),      SHORTS(1, 0x1))      \
+    OP(0x005A,    SHORTS(1, ALL),      SHORTS(1, 0x1),      SHORTS(1, 0x1))      \
+    OP(0x005F,    SHORTS(1, ALL),      SHORTS(1, 0x1),      SHORTS(1, 0x1))      \
+    OP(0x0060,    SHORTS(1, ALL),      SHORTS(1, 0x1),      SHORTS(1, 0x1))      \
+    OP(0x0061,    CUSTOM,              CUSTOM,              SHORTS(1, 0))        \
+    OP(0x0065,    CUSTOM,              CUSTOM,              SHORTS(1, 0))        \
+                                                                                 \
+    /* Two short arguments */                                                    \
+    OP(0x0021,    SHORTS(2, ALL),      SHORTS(2, 0x2),      SHORTS(2, 0x2))      \
+    OP(0x0022,    SHORTS(2, ALL),      SHORTS(2, 0x3),      SHORTS(2, 0x3))      \
+    OP(0x0024,    SHORTS(2, ALL),      SHORTS(2, 0x3),      SHORTS(2, 0x3))      \
+    OP(0x002C,    SHORTS(2, ALL),      SHORTS(2, 0x2),      SHORTS(2, 0x2))      \
+    OP(0x002D,    SHORTS(2, ALL),      SHORTS(2, 0x3),      SHORTS(2, 0x3))      \
+    OP(0x0042,    JUMP(2, ALL),        JUMP(2, 0x2),        JUMP(2, 0x2))        \
+    OP(0x0046,    SHORTS(2, ALL),      SHORTS(2, 0x3),      SHORTS(2, 0x3))      \
+    OP(0x0050,    SHORTS(2, ALL),      SHORTS(2, 0x3),      SHORTS(2, 0x3))      \
+                                                                                 \
+    /* Three or more short arguments */                                          \
+    OP(0x002B,    SHORTS(3, ALL),      SHORTS(3, 0x6),      SHORTS(3, 0x6))      \
+    OP(0x005C,    SHORTS(8, ALL),      SHORTS(8, 0xF4),     SHORTS(8, 0xF4))     \
+    OP(0x005D,    SHORTS(8, ALL),      SHORTS(8, 0),        SHORTS(8, 0))        \
+    OP(0x0062,    CUSTOM,              CUSTOM,              SHORTS(9, 0))        \
+                                                                                 \
+    /* Shorts terminated by 0x0000 */                                            \
+    OP(0x0008,    TO_ZERO(ALL),        TO_ZERO(0),          TO_ZERO(0))          \
+    OP(0x0009,    TO_ZERO(ALL),        TO_ZERO(0),          TO_ZERO(0))          \
+    OP(0x000A,    TO_ZERO(ALL),        TO_ZERO(0),          TO_ZERO(0))          \
+    OP(0x000D,    JUMP_TO_ZERO(ALL),   JUMP_TO_ZERO(0),     JUMP_TO_ZERO(0))     \
+                                                                                 \
+    /* Bytes terminated by 0x00 */                                               \
+    OP(0x000E,    BYTES,               BYTES,               BYTES)               \
+    OP(0x000F,    BYTES,               BYTES,               BYTES)               \
+    OP(0x0013,    BYTES,               BYTES,               BYTES)               \
+    OP(0x0014,    BYTES,               BYTES,               BYTES)               \
+    OP(0x0018,    BYTES,               BYTES,               BYTES)               \
+    OP(0x0019,    BYTES,               BYTES,               BYTES)               \
+    OP(0x001A,    BYTES,               BYTES,               BYTES)               \
+    OP(0x0025,    BYTES,               BYTES,               BYTES)               \
+    OP(0x0035,    BYTES,               BYTES,               BYTES)               \
+    OP(0x0036,    BYTES,               BYTES,               BYTES)               \
+    OP(0x003E,    BYTES,               BYTES,               BYTES)               \
+    OP(0x0041,    BYTES,               BYTES,               BYTES)               \
+    OP(0x004E,    BYTES,               BYTES,               BYTES)               \
+    OP(0x004F,    BYTES,               BYTES,               BYTES)               \
+    OP(0x0055,    BYTES,               BYTES,               BYTES)
+
+/* Build one 256 entry table per platform, unlisted commands are custom */
+#define OP(cmd, sat, psx, re)  [cmd] = sat,
+static const opcodeDesc saturnOps[0x100] = { OPCODE_LIST };
+#undef OP
+#define OP(cmd, sat, psx, re)  [cmd] = psx,
+static const opcodeDesc psxOps[0x100] = { OPCODE_LIST };
+#undef OP
+#define OP(cmd, sat, psx, re)  [cmd] = re,
+static const opcodeDesc remasterOps[0x100] = { OPCODE_LIST };
+#undef OP
+
+static const opcodeDesc* const opTables[OP_NUM_PROFILES] = { saturnOps, psxOps, remasterOps };
+static const opcodeDesc customOp = CUSTOM;
+static const opcodeDesc noArgsOp = NOARGS;
+
+
+
+
+/*******************************************************************/
+/* getOpcodeDesc                                                   */
+/* Returns the descriptor of a command for a platform.  Commands   */
+/* the table does not handle have a kind of OP_CUSTOM.             */
+/*******************************************************************/
+const opcodeDesc* getOpcodeDesc(int profile, unsigned short cmd){
+
+    /* Hack for iOS Eng, on every platform */
+    if ((cmd == 0xFF00) || (cmd == 0xFF03) || (cmd == 0xFFFF))
+        return &noArgsOp;
+
+    if ((profile < 0) || (profile >= OP_NUM_PROFILES) || (cmd > 0xFF))
+        return &customOp;
+
+    return &opTables[profile][cmd];
+}
+
+
+
+
+/*******************************************************************/
+/* decodeTableOp                                                   */
+/* Reads the arguments of a table driven command at the cursor and */
+/* appends its EXE node.  offset is the file offset of the command.*/
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+int decodeTableOp(lsb_context* ctx, byteCursor* pCur, const opcodeDesc* pDesc, unsigned short cmd, int offset){
+
+    unsigned char* pdata = (unsigned char*)ctx->pdata;
+    unsigned short* pShort = (unsigned short*)ctx->pdata;
+    scriptNode* sNode;
+    paramType* params;
+    unsigned int numArgs = 0;
+    unsigned int z, bit;
+
+    /* Read in the arguments */
+    switch (pDesc->kind){
+
+        case OP_SHORTS:
+            numArgs = pDesc->numArgs;
+            if (numArgs > 0)
+                curRead(pCur, &pdata[0], 2, numArgs);
+            break;
+
+        case OP_SHORTS_TO_ZERO:
+            curRead(pCur, &pShort[0], 2, 1);
+            numArgs = 1;
+            if ((pDesc->flags & OPF_FIRST_ANY) || (pShort[0] != 0x0000)){
+                do{
+                    curRead(pCur, &pShort[numArgs], 2, 1);
+                    numArgs++;
+                } while ((pShort[numArgs - 1] != 0x0000) && !curEof(pCur));
+            }
+            break;
+
+        case OP_BYTES_TO_NUL:
+            while (!curEof(pCur)){
+                curRead(pCur, &pdata[numArgs], 1, 1);
+                numArgs++;
+
+                if (pdata[numArgs - 1] == 0x00){
+                    //If not aligned, read again
+                    if ((curTell(pCur) % 2) != 0){
+                        curRead(pCur, &pdata[numArgs], 1, 1);
+                        numArgs++;
+                    }
+                    break;
+                }
+            }
+            numArgs /= 2;
+            break;
+
+        default:
+            printf("Error, command 0x%X is not table driven.\n", (unsigned int)cmd);
+            return -1;
+    }
+
+    /* Item Fix for SSS Importing from SSSC */
+    if ((pDesc->flags & OPF_SSS_ITEM) && checkSSSItemHack(ctx))
+        convertSSSItem(&pdata[0]);
+
+    /* Create a new script node at the end of the list */
+    sNode = appendScriptNode(ctx, ctx->nextID++, NODE_EXE_SUB, offset);
+    if (sNode == NULL){
+        printf("Error creating a script node.\n");
+        return -1;
+    }
+
+    /* Fill in Parameters */
+    sNode->subroutine_code = cmd;
+    sNode->num_parameters = numArgs;
+    sNode->alignfillVal = 0x00;
+    if (numArgs == 0)
+        return 0;
+
+    /* Allocate memory for EXE parameters */
+    params = allocNodeParams(ctx, sNode, sNode->num_parameters);
+    if (params == NULL){
+        printf("Error allocing memory for parameters\n");
+        return -1;
+    }
+
+    /* Fill in EXE Parameters */
+    for (z = 0; z < numArgs; z++){
+        params[z].type = SHORT_PARAM;
+        params[z].value = pShort[z];
+        bit = (z < 16) ? z : 15;
+        if (pDesc->swapMask & (1 << bit))
+            swap16(&params[z].value);
+    }
+
+    sNode->subParams = params;
+
+    if (pDesc->flags & OPF_JUMP)
+        sNode->nextPointerID = (unsigned int)params[0].value;
+
+    return 0;
+}
+
+
+
+
+/*******************************************************************/
+/* convertSSSItem                                                  */
+/* Renumbers a PSX SSSC item to its PSX SSS equivalent.            */
+/*******************************************************************/
+static void convertSSSItem(unsigned char* pItem){
+
+    switch (pItem[0]){
+        case 0x90: pItem[0] = 0x91; break;
+        case 0x91: pItem[0] = 0x92; break;
+        case 0x96: pItem[0] = 0x95; break;
+        case 0x97: pItem[0] = 0x96; break;
+        case 0x98: pItem[0] = 0x97; break;
+        case 0x99: pItem[0] = 0x98; break;
+        case 0x9A: pItem[0] = 0x98; break;
+        case 0x9B: pItem[0] = 0x99; break;
+        case 0xA5: pItem[0] = 0x9A; break;
+        case 0xA7: pItem[0] = 0x9B; break;
+        case 0xB5: pItem[0] = 0xA0; break;
+        default:
+            break;
+    }
+
+    return;
+}
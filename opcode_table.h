@@ -0,0 +1,50 @@
+/**********************************************************************/
+/* opcode_table.h - Argument layouts of the script commands that are  */
+/*                  decoded the same way by every binary decoder.     */
+/**********************************************************************/
+#ifdef _MSC_VER
+#pragma warning(disable:4996)
+#endif
+#ifndef OPCODE_TABLE_H
+#define OPCODE_TABLE_H
+#include "lsb_context.h"
+
+/* Platform Profiles */
+#define OP_PROFILE_SATURN    0      /* Saturn SSS/SSSC and iOS */
+#define OP_PROFILE_PSX       1      /* PSX SSS */
+#define OP_PROFILE_REMASTER  2      /* Remaster */
+#define OP_NUM_PROFILES      3
+
+/* Argument Layouts */
+#define OP_CUSTOM            0      /* Decoded by the platform's switch */
+#define OP_SHORTS            1      /* numArgs short arguments */
+#define OP_SHORTS_TO_ZERO    2      /* Shorts up to and including 0x0000 */
+#define OP_BYTES_TO_NUL      3      /* Bytes up to and including 0x00, */
+                                    /* padded to a short boundary      */
+
+/* Flags */
+#define OPF_JUMP             0x01   /* First argument is the next pointer ID */
+#define OPF_FIRST_ANY        0x02   /* First argument never ends the list */
+#define OPF_SSS_ITEM         0x04   /* First byte is an item, renumbered   */
+                                    /* when the SSSC->SSS hack is enabled  */
+
+#define OP_SWAP_ALL          0xFFFF
+
+/* Bit z of swapMask byte swaps argument z, arguments past */
+/* the 16th follow bit 15.                                  */
+typedef struct opcodeDesc{
+    unsigned char kind;
+    unsigned char numArgs;         /* OP_SHORTS only */
+    unsigned char flags;
+    unsigned short swapMask;
+}opcodeDesc;
+
+
+/***********************/
+/* Function Prototypes */
+/***********************/
+const opcodeDesc* getOpcodeDesc(int profile, unsigned short cmd);
+int decodeTableOp(lsb_context* ctx, byteCursor* pCur, const opcodeDesc* pDesc, unsigned short cmd, int offset);
+
+
+#endif
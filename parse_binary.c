@@ -10,135 +10,134 @@
 #include "snode_list.h"
 #include "util.h"
 #include "bpe_compression.h"
+#include "opcode_table.h"
+#include "script_cfg.h"
 
 /* Defines */
-#define DBUF_SIZE      (128*1024)     /* 128kB */
-#define PTR_ARRAY_SIZE (2*1024)       /* 0x800 bytes, or 1024 16-bit LWs */
-
-#define UGLY_ENG_IOS_HACKS
-
-/* Globals */
-static char* pdata = NULL;
-static char* pdata2 = NULL;
-char* pName = NULL;  //Basic Filename
-
-static int G_ID = 1;
-
+#define DBUF_SIZE      (128*1024)     /* 128kB beyond the input size */
 
 /* Function Prototypes */
-int decodeBinaryScript(FILE* inFile, FILE* outFile);
-int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag);
-int encodeScript(FILE* inFile, FILE* outFile);
-runParamType* getRunParam(int textMode, char* pdata);
-
-extern int G_IOS_ENG;
+int decodeBinaryScript(lsb_context* ctx, FILE* inFile, FILE* outFile);
+int parseCmdSeq(lsb_context* ctx, int offset, byteCursor* pCur, int singleRunFlag);
+unsigned int* readPtrTable(lsb_context* ctx, int bigEndian);
+int encodeScript(lsb_context* ctx, FILE* inFile, FILE* outFile);
+runParamType* getRunParam(lsb_context* ctx, int textMode, char* pdata);
+static int addPrintLine(lsb_context* ctx, const char* pText, unsigned int len);
+static int addCtrlCode(lsb_context* ctx, unsigned short code);
 
 
 /*****************************************************************************/
 /* Function: decodeBinaryScript                                              */
-/* Purpose: Parses the script starting at offset 0x0800.                     */
+/* Purpose: Parses the script starting after the pointer table.             */
 /*          Then considers the top level pointers.                           */
 /* Inputs:  Pointers to input/output files.                                  */
 /* Outputs: 0 on Pass, -1 on Fail.                                           */
 /*****************************************************************************/
-int decodeBinaryScript(FILE* inFile, FILE* outFile){
+int decodeBinaryScript(lsb_context* ctx, FILE* inFile, FILE* outFile){
 
-    unsigned short ptrVal;
-//	unsigned int ptrID;
-    unsigned int iFileSizeBytes;
+    unsigned int iFileSizeBytes, numUnreachable, numPtrs, ptrSize;
     int x;
-    unsigned short* pIndexPtrs = NULL;
-//	scriptNode* pScriptNode = NULL;
+    int rval = 0;
+    unsigned int* pPtrOffsets = NULL;
 
-    /* Allocate two 128kB buffers, much bigger than the input file */
-    if (pdata != NULL){
-        free(pdata);
-        pdata = NULL;
+    /* Load the input file, decoding reads it from memory */
+    if (curLoadFile(&ctx->input, inFile) != 0)
+        return -1;
+    iFileSizeBytes = ctx->input.size;
+    numPtrs = getPtrTableEntries(ctx);
+    ptrSize = getPtrEntrySize(ctx);
+
+    /* Scripts past the Saturn limit re-encode at their own size */
+    if (iFileSizeBytes > DEFAULT_MAX_BIN_SIZE)
+        setBinMaxSize(ctx, iFileSizeBytes);
+
+    /* Allocate two buffers, larger than anything read from the input */
+    if (ctx->pdata != NULL){
+        free(ctx->pdata);
+        ctx->pdata = NULL;
     }
-    pdata = (char*)malloc(DBUF_SIZE);
-    if (pdata == NULL){
+    ctx->pdata = (char*)malloc(iFileSizeBytes + DBUF_SIZE);
+    if (ctx->pdata == NULL){
         printf("Error allocating space for file data buffer.\n");
         return -1;
     }
 
-    if (pdata2 != NULL){
-        free(pdata2);
-        pdata2 = NULL;
+    if (ctx->pdata2 != NULL){
+        free(ctx->pdata2);
+        ctx->pdata2 = NULL;
     }
-    pdata2 = (char*)malloc(DBUF_SIZE);
-    if (pdata2 == NULL){
+    ctx->pdata2 = (char*)malloc(iFileSizeBytes + DBUF_SIZE);
+    if (ctx->pdata2 == NULL){
         printf("Error allocating space for file data buffer 2.\n");
         return -1;
     }
 
-    /* Determine Input File Size */
-    if (fseek(inFile, 0, SEEK_END) != 0){
-        printf("Error seeking in input file.\n");
+    /* Index nodes by file offset as they are decoded */
+    if (initOffsetIndex(ctx, iFileSizeBytes) != 0)
         return -1;
-    }
-    iFileSizeBytes = ftell(inFile);
-    if (fseek(inFile, 0, SEEK_SET) != 0){
-        printf("Error seeking in input file.\n");
-        return -1;
-    }
 
 
     /*********************************************/
     /* Step 1: Read the script from start to end */
     /*********************************************/
-    if (parseCmdSeq(0x0800, &inFile, 0) != 0){
+    if (parseCmdSeq(ctx, numPtrs * ptrSize, &ctx->input, 0) != 0){
         printf("Error Detected while reading from input file.\n");
         return -1;
     }
 
-    /* Allocate memory for the array */
-    pIndexPtrs = (unsigned short*)malloc(PTR_ARRAY_SIZE);
-    if (pIndexPtrs == NULL){
-        printf("Error allocing memory for Index Ptr Array\n");
+    /* Record the byte range covered by each decoded command */
+    if (buildOffsetIntervals(ctx, iFileSizeBytes) != 0)
         return -1;
-    }
 
 
     /**********************************************************/
     /* Step 2: Verify each script pointer has a valid target. */
     /**********************************************************/
-    fseek(inFile, 0, SEEK_SET);
+    pPtrOffsets = readPtrTable(ctx, 1);
+    if (pPtrOffsets == NULL)
+        rval = -1;
 
-    for (x = 0; x < 1024; x++){
-        unsigned int byteOffset;
-        unsigned int currentLocation;
-        scriptNode* pNode, *sNode;
-
-        //Read in the pointer value
-        if (fread(&ptrVal, 2, 1, inFile) != 1){
-            printf("Error Reading Pointer Value\n");
-            return -1;
-        }
-        swap16(&ptrVal);
+    for (x = 0; (rval == 0) && (x < (int)numPtrs); x++){
+        unsigned int byteOffset, ovStart, ovEnd;
+        scriptNode* pNode, *pOwner, *sNode;
 
         //Verify validity
-        byteOffset = (unsigned int)ptrVal * 2;
+        byteOffset = pPtrOffsets[x];
         if ((byteOffset == 0x0000) || (byteOffset >= iFileSizeBytes))
             continue;
 
         //Verify mapping to an existing script node
-        pNode = getListItemByOffset(byteOffset);
+        pNode = getListItemByOffset(ctx, byteOffset);
         if (pNode == NULL){
-            printf("SCRIPT ERROR, POSSIBLE OVERLAP DETECTED.\n");
-            currentLocation = ftell(inFile);
+            /* Target lies inside a command that was already decoded */
+            pOwner = getListItemContainingOffset(ctx, byteOffset, &ovStart, &ovEnd);
+
             /* Add it anyway - one file should have this issue and this works */
-            if (parseCmdSeq(byteOffset, &inFile, 1) != 0){
+            if (parseCmdSeq(ctx, byteOffset, &ctx->input, 1) != 0){
                 printf("Error Detected while reading from input file.\n");
-                return -1;
+                rval = -1;
+                break;
             }
-            pNode = getListItemByOffset(byteOffset);
-            fseek(inFile, currentLocation, SEEK_SET);
+            pNode = getListItemByOffset(ctx, byteOffset);
+
+            /* Keep it next to the command it overlaps */
+            if ((pNode != NULL) && (pOwner != NULL)){
+                logWarning(ctx, "SCRIPT ERROR, POSSIBLE OVERLAP DETECTED. Offset 0x%X is inside node %u (0x%X-0x%X), decoded as node %u.\n",
+                    byteOffset, pOwner->id, ovStart, ovEnd, pNode->id);
+                if (placeOverlapNode(ctx, pOwner, pNode, ovEnd, ctx->nextID++) != 0){
+                    rval = -1;
+                    break;
+                }
+            }
+            else
+                logWarning(ctx, "SCRIPT ERROR, POSSIBLE OVERLAP DETECTED. Offset 0x%X.\n", byteOffset);
         }
 
         // Sanity
         if (pNode == NULL){
             printf("Program bug, could not locate item in list corresponding to offset should not get here.\n");
-            return -1;
+            rval = -1;
+            break;
         }
 
         //Associate Script Node with the Short offset of the Pointer that points to it
@@ -146,90 +145,95 @@ int decodeBinaryScript(FILE* inFile, FILE* outFile){
         pNode->pointerID = x;
 
         //Add pointer as a node
-        /* Create a new script node */
-        if (createScriptNode(&sNode) < 0){
+        /* Create a new script node at the end of the list */
+        sNode = appendScriptNode(ctx, ctx->nextID++, NODE_POINTER, byteOffset);
+        if (sNode == NULL){
             printf("Error creating a script node.\n");
-            return -1;
+            rval = -1;
+            break;
         }
 
         /* Fill in Parameters */
-        sNode->id = G_ID++;
-        sNode->nodeType = NODE_POINTER;
-        sNode->ptrSize = 2;
+        sNode->ptrSize = ptrSize;
         sNode->ptrValueFlag = 0;
         sNode->ptrID = pNode->id;
-        sNode->byteOffset = x * 2;
-        sNode->fileOffset = byteOffset;
-
-        /* Add the node */
-        if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-            printf("Error occurred adding the script node.\n");
-            return -1;
-        }
-        free(sNode);
+        sNode->byteOffset = x * ptrSize;
     }
 
-#if 0
-    /************************************************************************/
-    /* Step 3: For linear runs of the script, assign the same Node ID.      */
-    /*         Used for CSV Script dump.  Provides some indication of flow. */
-    /************************************************************************/
-    pScriptNode = getHeadPtr();
-    while (pScriptNode != NULL){
-        scriptNode* pNext = pScriptNode->pNext;
-
-        /* Update ptrID */
-        ptrID = pScriptNode->pointerID;
-
-        /* Check to see if ptrID should be reset due to end of script sequence reached */
-        switch (pScriptNode->nodeType){
-            case 0x0003:  /* Unconditional JMP */
-            case 0x0004:  /* Unconditional JMP */
-            case 0x0005:  /* Return */
-            case 0x0026:  /* Return & Jump into new scene */
-            case 0x0042:  /* Unconditional JMP */
-                ptrID = INVALID_PTR_ID;
-                break;
+    /*********************************************************************/
+    /* Step 3: Follow the runs of the script from the pointer targets.   */
+    /*         Each node reached gets the pointer ID of its run, for the */
+    /*         CSV Script dump.  Provides some indication of flow.       */
+    /*********************************************************************/
+    if (rval == 0)
+        buildScriptCFG(ctx, &numUnreachable);
+
+    /* Free memory, failures in Step 2 end up here too */
+    releaseOffsetIndex(ctx);
+    free(pPtrOffsets);
+    if (ctx->pdata != NULL)
+        free(ctx->pdata);
+    if (ctx->pdata2 != NULL)
+        free(ctx->pdata2);
+    ctx->pdata = ctx->pdata2 = NULL;
+    curFree(&ctx->input);
+
+
+    return rval;
+}
+
 
-            default:
-                break; /* Nothing to be done */
-        }
 
-        /* If the next node has an invalid PTR ID, and the current            */
-        /* Node is not a "Return" node, and the current Node has a valid PTR  */
-        /* associated with it, also associate that pointer with the next item */
-        /* in the script node list. */
-        if (pNext != NULL){
-            if ((pNext->ptrID == INVALID_PTR_ID) &&
-                (ptrID != INVALID_PTR_ID) ){
-                pNext->ptrID = ptrID;
-            }
-        }
 
-        pScriptNode = pScriptNode->pNext;
+/*****************************************************************************/
+/* Function: readPtrTable                                                    */
+/* Purpose: Reads the pointer table at the start of the input file, laid out */
+/*          as set by setPtrTableLayout.  Each entry holds its target's byte */
+/*          offset divided by the entry size.                                */
+/* Inputs:  bigEndian - Entries are big endian (Saturn).                     */
+/* Outputs: Array of target byte offsets to free, NULL on Fail.              */
+/*****************************************************************************/
+unsigned int* readPtrTable(lsb_context* ctx, int bigEndian){
+
+    unsigned int numPtrs = getPtrTableEntries(ctx);
+    unsigned int ptrSize = getPtrEntrySize(ctx);
+    unsigned char* pTable;
+    unsigned int* pOffsets;
+    unsigned int x, y, value;
+
+    /* Allocate memory for the arrays */
+    pTable = (unsigned char*)malloc(numPtrs * ptrSize);
+    pOffsets = (unsigned int*)malloc(numPtrs * sizeof(unsigned int));
+    if ((pTable == NULL) || (pOffsets == NULL)){
+        printf("Error allocing memory for Index Ptr Array\n");
+        free(pTable);
+        free(pOffsets);
+        return NULL;
     }
-#endif
-#if 0
-case 0x0003: /* 0x0003 - Unconditional Jump, 1 short Arg */
-case 0x0004: /* 0x0004 - Unconditional Jump, 1 short Arg */
-case 0x0007: /* SELECT */
-case 0x0010: /* JUMP (?) */
-case 0x0011: /* JUMP (?) */
-case 0x0016: /* Conditional JUMP (?) */
-case 0x000B: /* Conditional TRUE (AND?) */
-case 0x000C: /* Conditional FALSE (NOT?) */
-case 0x000D: /* (OR?) - JUMP OR JUST "OR"?*/
-case 0x0042: /* Unconditional JUMP (?) */
-#endif
 
-    /* Free memory */
-    if (pdata != NULL)
-        free(pdata);
-    if (pdata2 != NULL)
-        free(pdata2);
+    curSeek(&ctx->input, 0);
+    if (curRead(&ctx->input, pTable, ptrSize, numPtrs) != numPtrs){
+        printf("Error Reading Pointer Value\n");
+        free(pTable);
+        free(pOffsets);
+        return NULL;
+    }
 
+    for (x = 0; x < numPtrs; x++){
+        value = 0;
+        for (y = 0; y < ptrSize; y++){
+            if (bigEndian)
+                value = (value << 8) | pTable[x * ptrSize + y];
+            else
+                value |= (unsigned int)pTable[x * ptrSize + y] << (8 * y);
+        }
 
-    return 0;
+        /* Offsets past 4GB are invalid, like 0 */
+        pOffsets[x] = (value > 0xFFFFFFFF / ptrSize) ? 0 : value * ptrSize;
+    }
+    free(pTable);
+
+    return pOffsets;
 }
 
 
@@ -242,55 +246,45 @@ case 0x0042: /* Unconditional JUMP (?) */
 /*          Byte offset into file to read from.                              */
 /* Outputs: None.                                                            */
 /*****************************************************************************/
-int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
+int parseCmdSeq(lsb_context* ctx, int offset, byteCursor* pCur, int singleRunFlag){
 
+    char* pdata = ctx->pdata;      /* Scratch buffers owned by the context */
+    char* pdata2 = ctx->pdata2;
     scriptNode* sNode;
     paramType* params;
     int rval, z;
     int offsetAddress/*, offsetAddress2*/;     /* File Offset in Bytes */
     unsigned short cmd, wdOffset;
-    FILE* inFile;
     unsigned short* pShort = (unsigned short*)pdata;
-
-    /* Update File Pointers */
-    inFile = *ptr_inFile;
+    const opcodeDesc* pDesc;
 
     /* Go to requested offset */
-    if (fseek(inFile, offset, SEEK_SET) != 0){
+    if (curSeek(pCur, offset) != 0){
         printf("Error seeking in input file.\n");
         return -1;
     }
 
     /* Insert a GOTO Node */
-    /* Create a new script node */
-    if (createScriptNode(&sNode) < 0){
+    /* Create a new script node at the end of the list */
+    sNode = appendScriptNode(ctx, ctx->nextID++, NODE_GOTO, 0xFFFFFFFF);
+    if (sNode == NULL){
         printf("Error creating a script node.\n");
         return -1;
     }
 
     /* Fill in Parameters */
-    sNode->id = G_ID++;
-    sNode->nodeType = NODE_GOTO;
     sNode->byteOffset = offset;
-    sNode->fileOffset = 0xFFFFFFFF; // N/A
-
-    /* Add the node */
-    if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-        printf("Error occurred adding the script node.\n");
-        return -1;
-    }
-    free(sNode);
 
     /******************************/
     /* Continue reading until EOF */
     /******************************/
     while (1){
 
-        offset = ftell(inFile);
+        offset = curTell(pCur);
 
         /* Read in the Script Command */
-        if (fread(&cmd, 2, 1, inFile) != 1){
-            if (feof(inFile))
+        if (curRead(pCur, &cmd, 2, 1) != 1){
+            if (curEof(pCur))
                 break;
             printf("Error reading command from input file.\n");
             return -1;
@@ -299,6 +293,16 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
 #if 0
         printf("CMD = 0x%X  Offset= 0x%X (0x%X short)\n", (unsigned int)cmd, offset, offset / 2);
 #endif
+        /* Commands with a fixed argument layout (opcode_table.c) */
+        pDesc = getOpcodeDesc(OP_PROFILE_SATURN, cmd);
+        if (pDesc->kind != OP_CUSTOM){
+            if (decodeTableOp(ctx, pCur, pDesc, cmd, offset) != 0)
+                return -1;
+            if (singleRunFlag)
+                break;
+            continue;
+        }
+
         /****************************************************/
         /* Determine what to do based on the Script Command */
         /****************************************************/
@@ -310,53 +314,6 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
             /*==============================*/
 
 
-            /******************************/
-            /* No arguments with 1 child. */
-            /******************************/
-            case 0x0039: /*confirmed*/
-            case 0x003B: /*confirmed*/
-            case 0x002F: /* Restore Life */
-            case 0x0032: /* confirmed */
-            case 0x003A: /* confirmed */
-            case 0x003C:
-            case 0x003F: /* confirmed */
-            case 0x0040: /* confirmed */
-            case 0x004C:
-            case 0x004D: /* confirmed */
-            case 0x0051: /* confirmed, sometimes crashes during my tests? */
-            case 0x0058: /* confirmed */
-            case 0x005B: /* confirmed */
-    #ifdef UGLY_ENG_IOS_HACKS
-            case 0x005E: /* hack for iOS Eng */
-            case 0xFF00: /* hack for iOS Eng */
-            case 0xFF03: /* hack for iOS Eng */
-            case 0xFFFF: /* hack for iOS Eng */
-    #endif
-            {
-                /* Create a new script node */
-                if (createScriptNode(&sNode) < 0){
-                    printf("Error creating a script node.\n");
-                    return -1;
-                }
-
-                /* Fill in Parameters */
-                sNode->id = G_ID++;
-                sNode->nodeType = NODE_EXE_SUB;
-                sNode->subroutine_code = cmd;
-                sNode->num_parameters = 0;
-                sNode->fileOffset = offset;
-
-                /* Add the node */
-                if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-                    printf("Error occurred adding the script node.\n");
-                    return -1;
-                }
-                free(sNode);
-
-                break;
-            }
-
-
 			/***************************************************************/
 			/* Normally no arguments with 1 child.                         */
 			/* Could have subtitles if part of the new audio subtitle hack */
@@ -366,14 +323,17 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
 			{
 				unsigned short subTest = 0;
 
-				/* Create a new script node */
-				if (createScriptNode(&sNode) < 0){
+				/* Create a new script node at the end of the list */
+				sNode = appendScriptNode(ctx, ctx->nextID++, NODE_EXE_SUB, offset);
+				if (sNode == NULL){
 					printf("Error creating a script node.\n");
 					return -1;
 				}
+				sNode->subroutine_code = cmd;
 				
 				/* Look ahead for "ST" 0x5354 */
-				fread(&subTest, 2, 1, inFile);
+				subTest = 0;
+				curPeek(pCur, &subTest, 2);
 				swap16(&subTest);
 
 
@@ -403,25 +363,22 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
 					/* If not aligned an additional byte, 0xFF is appended             */
 					/*******************************************************************/
 
-					/* Read in Number of Delays */
-					fread(&subTest, 2, 1, inFile);
+					/* Step past "ST", read in Number of Delays */
+					curSkip(pCur, 2);
+					curRead(pCur, &subTest, 2, 1);
 					swap16(&subTest);
 
 					/* Allocate memory for EXE parameters */
 					sNode->num_parameters = subTest + 3; /* "ST" + #delays + delays + Subtitle_Text (Aligns end) */
-					params = (paramType*)malloc(sNode->num_parameters * sizeof(paramType));
+					params = allocNodeParams(ctx, sNode, sNode->num_parameters);
 					if (params == NULL){
 						printf("Error allocing memory for parameters\n");
 						return -1;
 					}
 
 					/* Fill in Node Parameters */
-					sNode->id = G_ID++;
-					sNode->nodeType = NODE_EXE_SUB;
-					sNode->subroutine_code = cmd;
 					sNode->alignfillVal = 0xFF;
 					sNode->subParams = params;
-					sNode->fileOffset = offset;
 					
 					/* First Parameter is "ST" */
 					z = 0;
@@ -435,7 +392,7 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
 					/* Fill in EXE Parameters */
 					for (y=0; y < (int)subTest; y++,z++){
 						params[z].type = SHORT_PARAM;
-						fread(&tval, 2, 1, inFile);
+						curRead(pCur, &tval, 2, 1);
 						swap16(&tval);
 						params[z].value = tval;
 					}
@@ -443,7 +400,7 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
 					/* Read BPE Compressed Text until 0xFFFF is reached */
 					prev = cur = 0;
 					while (1){
-						rval = fread(&pdata[index++], 1, 1, inFile);
+						rval = curRead(pCur, &pdata[index++], 1, 1);
 						if (rval != 1){
 							printf("Error encountered while reading TEXT portion of subtitles, no termination.\n");
 							break;
@@ -458,13 +415,13 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
 					}
 
 					/* Advance File Pointer to a 16-bit boundary if required */
-					if ((ftell(inFile) % 2) != 0){
-						fread(&pdata[index], 1, 1, inFile);
+					if ((curTell(pCur) % 2) != 0){
+						curRead(pCur, &pdata[index], 1, 1);
 					}
 
 					/* Store string as a run command */
 					rpHead = NULL;
-					rpHead = getRunParam(TEXT_DECODE_ONE_BYTE_PER_CHAR, pdata);
+					rpHead = getRunParam(ctx, TEXT_DECODE_ONE_BYTE_PER_CHAR, pdata);
 					sNode->runParams = rpHead;
 
 					/* Create a Subtitle Script Node */
@@ -481,267 +438,14 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
 					/* Regular Audio Node */
 					/**********************/
 
-					/* Rewind File Pointer */
-					fseek(inFile, -2, SEEK_CUR);
-
 					/* Fill in Parameters */
-					sNode->id = G_ID++;
-					sNode->nodeType = NODE_EXE_SUB;
-					sNode->subroutine_code = cmd;
 					sNode->num_parameters = 0;
-					sNode->fileOffset = offset;
-				}
-
-				/* Add the node */
-				if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-					printf("Error occurred adding the script node.\n");
-					return -1;
 				}
-				free(sNode);
 
 				break;
 			}
 
 
-            /************************************/
-            /* One short argument with 1 child. */
-            /************************************/
-
-            case 0x0003: /* 0x0003 - Unconditional Jump, 1 short Arg */
-            case 0x0004: /* 0x0004 - Unconditional Jump, 1 short Arg */
-            case 0x0020: /* Two byte args to specify an item was obtained.  Text prints using subrtn 0x060B7D30 */
-            case 0x0044: /* Really 2 byte args, but basically the same thing */
-            case 0x0043: /* Assumption file#1 0x7144  0043 0100 */
-            case 0x0028:  /* ASSUMPTION 0028 0800     0028 0900 - mostly traced */
-            case 0x0059:  /* Assumption file #1 0x5128 0059 0105*/
-            case 0x001F:  /* Display obtained item */
-            case 0x0023:  /* partially validated... */
-            case 0x0029:  /* two byte arguments */
-            case 0x002A:  /* confirmed */
-            case 0x002E:  /* Display Shop Menu (Argument is shop type) */
-            case 0x0030:
-            case 0x0031:
-            case 0x0033: /* confirmed */
-            case 0x0045: /* Called when Entering/Exiting houses */
-            case 0x0047: /* Called when Entering/Exiting houses */
-            case 0x0048: /* ASSUMPTION , 1 or no children? */
-            case 0x0049: /* confirmed */
-            case 0x0052:
-            case 0x005A: /* Music Select? */
-            case 0x0056:
-            case 0x0057: /* two byte arguments */
-    #ifdef UGLY_ENG_IOS_HACKS
-            case 0x005F: /* hack for iOS Eng */
-            case 0x0060: /* hack for iOS Eng */
-    #endif
-            {
-                /* 1 Argument to read */
-                fread(&pdata[0], 2, 1, inFile);
-
-                /* Create a new script node */
-                if (createScriptNode(&sNode) < 0){
-                    printf("Error creating a script node.\n");
-                    return -1;
-                }
-
-                /* Fill in Parameters */
-                sNode->id = G_ID++;
-                sNode->nodeType = NODE_EXE_SUB;
-                sNode->subroutine_code = cmd;
-                sNode->num_parameters = 1;
-                sNode->alignfillVal = 0x00;
-
-                /* Allocate memory for EXE parameters */
-                params = (paramType*)malloc(sNode->num_parameters * sizeof(paramType));
-                if (params == NULL){
-                    printf("Error allocing memory for parameters\n");
-                    return -1;
-                }
-
-                /* Fill in EXE Parameters */
-                for (z = 0; z < (int)sNode->num_parameters; z++){
-                    params[z].type = SHORT_PARAM;
-                    params[z].value = pShort[z];
-					swap16(&params[z].value);
-                }
-
-                sNode->subParams = params;
-                sNode->fileOffset = offset;
-
-                if ((cmd == 0x0003) || (cmd == 0x0004)){
-                    sNode->nextPointerID = (unsigned int)params[0].value;
-                }
-
-                /* Add the node */
-                if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-                    printf("Error occurred adding the script node.\n");
-                    return -1;
-                }
-                free(sNode);
-
-                break;
-            }
-
-
-            /************************************/
-            /* Two short arguments with 1 child */
-            /************************************/
-            case 0x0022: /* confirmed, 3 byte args, 1 spare */
-            case 0x0021: /* confirmed */
-            case 0x002C: /* confirmed */
-            case 0x002D: /* confirmed, first byte Arg is video to play */
-            case 0x0024: /* confirmed */
-            case 0x0046: /*  0046 0106 0100 <-- args are all bytes  */
-            case 0x0050: /* actually 3 byte args and 1 spare byte */
-            case 0x0042:  /* 0x0042 - Unconditional Jump or End Script Read, 2 short Arg */
-            {
-                /* 2 Arguments to read */
-                fread(&pdata[0], 2, 2, inFile);
-
-                /* Create a new script node */
-                if (createScriptNode(&sNode) < 0){
-                    printf("Error creating a script node.\n");
-                    return -1;
-                }
-
-                /* Fill in Parameters */
-                sNode->id = G_ID++;
-                sNode->nodeType = NODE_EXE_SUB;
-                sNode->subroutine_code = cmd;
-                sNode->num_parameters = 2;
-                sNode->alignfillVal = 0x00;
-
-                /* Allocate memory for EXE parameters */
-                params = (paramType*)malloc(sNode->num_parameters * sizeof(paramType));
-                if (params == NULL){
-                    printf("Error allocing memory for parameters\n");
-                    return -1;
-                }
-
-                /* Fill in EXE Parameters */
-                for (z = 0; z < (int)sNode->num_parameters; z++){
-                    params[z].type = SHORT_PARAM;
-                    params[z].value = pShort[z];
-                    swap16(&params[z].value);
-                }
-
-                sNode->subParams = params;
-                sNode->fileOffset = offset;
-
-                if (cmd == 0x0042){
-                    sNode->nextPointerID = (unsigned int)params[0].value;
-                }
-
-                /* Add the node */
-                if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-                    printf("Error occurred adding the script node.\n");
-                    return -1;
-                }
-                free(sNode);
-
-                break;
-            }
-
-
-            /**********************************/
-            /* 3 short arguments with 1 child */
-            /**********************************/
-            case 0x002B: /* (Confirmed, args are: short, byte, byte, byte, byte) */
-            {
-                /* 3 Arguments to read */
-                fread(&pdata[0], 2, 3, inFile);
-
-                /* Create a new script node */
-                if (createScriptNode(&sNode) < 0){
-                    printf("Error creating a script node.\n");
-                    return -1;
-                }
-
-                /* Fill in Parameters */
-                sNode->id = G_ID++;
-                sNode->nodeType = NODE_EXE_SUB;
-                sNode->subroutine_code = cmd;
-                sNode->num_parameters = 3;
-                sNode->alignfillVal = 0x00;
-
-                /* Allocate memory for EXE parameters */
-                params = (paramType*)malloc(sNode->num_parameters * sizeof(paramType));
-                if (params == NULL){
-                    printf("Error allocing memory for parameters\n");
-                    return -1;
-                }
-
-                /* Fill in EXE Parameters */
-                for (z = 0; z < (int)sNode->num_parameters; z++){
-                    params[z].type = SHORT_PARAM;
-                    params[z].value = pShort[z];
-                    swap16(&params[z].value);
-                }
-
-                sNode->subParams = params;
-                sNode->fileOffset = offset;
-
-                /* Add the node */
-                if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-                    printf("Error occurred adding the script node.\n");
-                    return -1;
-                }
-                free(sNode);
-
-                break;
-            }
-
-
-            /**********************************/
-            /* 8 short arguments with 1 child */
-            /**********************************/
-            case 0x005D:  /* only in SSSC, not confirmed */
-            case 0x005C: /* (Confirmed, args are: short, then rest bytes) */
-            {
-                /* 8 Arguments to read */
-                fread(&pdata[0], 2, 8, inFile);
-
-                /* Create a new script node */
-                if (createScriptNode(&sNode) < 0){
-                    printf("Error creating a script node.\n");
-                    return -1;
-                }
-
-                /* Fill in Parameters */
-                sNode->id = G_ID++;
-                sNode->nodeType = NODE_EXE_SUB;
-                sNode->subroutine_code = cmd;
-                sNode->num_parameters = 8;
-                sNode->alignfillVal = 0x00;
-
-                /* Allocate memory for EXE parameters */
-                params = (paramType*)malloc(sNode->num_parameters * sizeof(paramType));
-                if (params == NULL){
-                    printf("Error allocing memory for parameters\n");
-                    return -1;
-                }
-
-                /* Fill in EXE Parameters */
-                for (z = 0; z < (int)sNode->num_parameters; z++){
-                    params[z].type = SHORT_PARAM;
-                    params[z].value = pShort[z];
-                    swap16(&params[z].value);
-                }
-
-                sNode->subParams = params;
-                sNode->fileOffset = offset;
-
-                /* Add the node */
-                if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-                    printf("Error occurred adding the script node.\n");
-                    return -1;
-                }
-                free(sNode);
-
-                break;
-            }
-
-
             /*******************************************************************/
             /* 2 to 3 short words with 1 child                                 */
             /* (Last arg is really a long, which results in padding sometimes) */
@@ -752,7 +456,7 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 unsigned int bytesToRead;
 //		        int numArg = 0;
 
-                offsetAddress = ftell(inFile); //get current offset
+                offsetAddress = curTell(pCur); //get current offset
                 tmpAddr = (unsigned int)offsetAddress & 0xFFFFFFFC;
                 if (offsetAddress == tmpAddr)
                     tmpAddr += 4; /* Add 4 for LW arg.  Ends up being 2 shorts */
@@ -761,23 +465,22 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 bytesToRead = tmpAddr - offsetAddress;
 //		        numArg = bytesToRead / 2;
 
-                fread(&pdata[0], 1, bytesToRead, inFile);
+                curRead(pCur, &pdata[0], 1, bytesToRead);
 
-                /* Create a new script node */
-                if (createScriptNode(&sNode) < 0){
+                /* Create a new script node at the end of the list */
+                sNode = appendScriptNode(ctx, ctx->nextID++, NODE_EXE_SUB, offset);
+                if (sNode == NULL){
                     printf("Error creating a script node.\n");
                     return -1;
                 }
 
                 /* Fill in Parameters */
-                sNode->id = G_ID++;
-                sNode->nodeType = NODE_EXE_SUB;
                 sNode->subroutine_code = cmd;
                 sNode->num_parameters = 2;
                 sNode->alignfillVal = 0x00;
 
                 /* Allocate memory for EXE parameters */
-                params = (paramType*)malloc(sNode->num_parameters * sizeof(paramType));
+                params = allocNodeParams(ctx, sNode, sNode->num_parameters);
                 if (params == NULL){
                     printf("Error allocing memory for parameters\n");
                     return -1;
@@ -799,14 +502,6 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 }
 
                 sNode->subParams = params;
-                sNode->fileOffset = offset;
-
-                /* Add the node */
-                if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-                    printf("Error occurred adding the script node.\n");
-                    return -1;
-                }
-                free(sNode);
 
                 break;
             }
@@ -823,29 +518,28 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 unsigned int tmpAddr;
                 unsigned int bytesToRead;
 
-                offsetAddress = ftell(inFile); //get current offset
+                offsetAddress = curTell(pCur); //get current offset
                 tmpAddr = (unsigned int)(offsetAddress)& 0xFFFFFFFC;
                 tmpAddr += 8;
                 bytesToRead = tmpAddr - offsetAddress;
 
-                fread(&pdata[0], 1, bytesToRead, inFile);
+                curRead(pCur, &pdata[0], 1, bytesToRead);
 
 
-                /* Create a new script node */
-                if (createScriptNode(&sNode) < 0){
+                /* Create a new script node at the end of the list */
+                sNode = appendScriptNode(ctx, ctx->nextID++, NODE_EXE_SUB, offset);
+                if (sNode == NULL){
                     printf("Error creating a script node.\n");
                     return -1;
                 }
 
                 /* Fill in Parameters */
-                sNode->id = G_ID++;
-                sNode->nodeType = NODE_EXE_SUB;
                 sNode->subroutine_code = cmd;
                 sNode->num_parameters = 3;
                 sNode->alignfillVal = 0x00;
 
                 /* Allocate memory for EXE parameters */
-                params = (paramType*)malloc(sNode->num_parameters * sizeof(paramType));
+                params = allocNodeParams(ctx, sNode, sNode->num_parameters);
                 if (params == NULL){
                     printf("Error allocing memory for parameters\n");
                     return -1;
@@ -869,14 +563,6 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 }
 
                 sNode->subParams = params;
-                sNode->fileOffset = offset;
-
-                /* Add the node */
-                if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-                    printf("Error occurred adding the script node.\n");
-                    return -1;
-                }
-                free(sNode);
 
                 break;
             }
@@ -901,7 +587,7 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 int totalNumArg = 0;
 
                 /* Determine # of Arguments to read */
-                fread(&pdata[numArg * 2], 2, 1, inFile);
+                curRead(pCur, &pdata[numArg * 2], 2, 1);
                 memcpy(&val, &pdata[numArg * 2], sizeof(short));
                 swap16(&val);
                 if ((val & (short)0xFF00) == (short)0x0000)
@@ -912,26 +598,25 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
 
                 /* Read in additional arguments if required */
                 for (x = numArg; x < totalNumArg; x++){
-                    fread(&pdata[numArg * 2], 2, 1, inFile);
+                    curRead(pCur, &pdata[numArg * 2], 2, 1);
                     numArg++;
                 }
 
 
-                /* Create a new script node */
-                if (createScriptNode(&sNode) < 0){
+                /* Create a new script node at the end of the list */
+                sNode = appendScriptNode(ctx, ctx->nextID++, NODE_EXE_SUB, offset);
+                if (sNode == NULL){
                     printf("Error creating a script node.\n");
                     return -1;
                 }
 
                  /* Fill in Parameters */
-                sNode->id = G_ID++;
-                sNode->nodeType = NODE_EXE_SUB;
                 sNode->subroutine_code = cmd;
                 sNode->num_parameters = totalNumArg;
                 sNode->alignfillVal = 0x00;
 
                 /* Allocate memory for EXE parameters */
-                params = (paramType*)malloc(sNode->num_parameters * sizeof(paramType));
+                params = allocNodeParams(ctx, sNode, sNode->num_parameters);
                 if (params == NULL){
                     printf("Error allocing memory for parameters\n");
                     return -1;
@@ -945,14 +630,6 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 }
 
                 sNode->subParams = params;
-                 sNode->fileOffset = offset;
-
-                /* Add the node */
-                if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-                    printf("Error occurred adding the script node.\n");
-                    return -1;
-                }
-                free(sNode);
 
                 break;
             }
@@ -969,269 +646,29 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 int numargs = 1;
 
                 /* At least 1 Short Argument to read */
-                fread(&pdata[0], 2, 1, inFile);
+                curRead(pCur, &pdata[0], 2, 1);
 
                 /* See if 6 additional to read */
-                if (pdata[0] >= 0x0B){
-                    fread(&pdata[2], 2, 6, inFile);
-                    numargs += 6;
-                }
-
-
-                /* Create a new script node */
-                if (createScriptNode(&sNode) < 0){
-                    printf("Error creating a script node.\n");
-                    return -1;
-                }
-
-                /* Fill in Parameters */
-                sNode->id = G_ID++;
-                sNode->nodeType = NODE_EXE_SUB;
-                sNode->subroutine_code = cmd;
-                sNode->num_parameters = numargs;
-                sNode->alignfillVal = 0x00;
-
-                /* Allocate memory for EXE parameters */
-                params = (paramType*)malloc(sNode->num_parameters * sizeof(paramType));
-                if (params == NULL){
-                    printf("Error allocing memory for parameters\n");
-                    return -1;
-                }
-
-                /* Fill in EXE Parameters */
-                for (z = 0; z < (int)sNode->num_parameters; z++){
-                    params[z].type = SHORT_PARAM;
-                    params[z].value = pShort[z];
-                    swap16(&params[z].value);
-                }
-
-                sNode->subParams = params;
-                sNode->fileOffset = offset;
-
-                /* Add the node */
-                if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-                    printf("Error occurred adding the script node.\n");
-                    return -1;
-                }
-                free(sNode);
-
-                break;
-            }
-
-
-            /*========================================================*/
-            /*= VARIABLE NUMBERS OF ARGUMENTS, BASED ON A TERMINATOR =*/
-            /*========================================================*/
-
-
-            /*********************************************************/
-            /* 0x0038 - 1 Child                                      */
-            /* Byte Terminator of 0xF9 (maintains short wd boundary) */
-            /* Has several internal control codes that also dictate  */
-            /* Length of argument list                               */
-            /*********************************************************/
-            /* First byte argument is special, rest are:             **************/
-            /*   0xF0 - Incr 2 bytes                                              */
-            /*   0xF1 - Incr 2 bytes                                              */
-            /*   0xF2 - Incr 2 bytes                                              */
-            /*   0xF3 - Incr 5 bytes                                              */
-            /*   0xF4 - Incr 5 bytes                                              */
-            /*   0xF5 - Incr 2 bytes                                              */
-            /*   0xF6 - Incr 2 bytes                                              */
-            /*   0xF7 - Incr 5 bytes                                              */
-            /*   0xF8 - Incr 4 bytes                                              */
-            /*   0xF9 - End of args(incr to next short word offset(1 or 2 bytes)) */
-            /**********************************************************************/
-            case 0x0038:  /* Byte Terminator of 0xF9 (maintains short wd boundary) */
-            {
-                int numArg = 0;
-                unsigned char argval;
-
-                //First byte argument
-                fread(&pdata[numArg], 1, 1, inFile);
-                numArg++;
-
-                /* Determine # of Arguments to read */
-                while (!feof(inFile)){
-                    fread(&pdata[numArg], 1, 1, inFile);
-                    memcpy(&argval, &pdata[numArg], 1);
-                    numArg++;
-
-                    if ((argval == 0xF0) || (argval == 0xF1) || (argval == 0xF2) || (argval == 0xF5) || (argval == 0xF6)){
-                        fread(&pdata[numArg], 1, 1, inFile);
-                        numArg++;
-                    }
-                    else if ((argval == 0xF3) || (argval == 0xF4) || (argval == 0xF7)){
-                        fread(&pdata[numArg], 1, 4, inFile);
-                        numArg += 4;
-                    }
-                    else if (argval == 0xF8){
-                        fread(&pdata[numArg], 1, 3, inFile);
-                        numArg += 3;
-                    }
-                    else if (argval == 0xF9){
-                        //If not aligned, read again
-                        if ((ftell(inFile) % 2) != 0){
-                            fread(&pdata[numArg], 1, 1, inFile);
-                            numArg++;
-                        }
-                        break;
-                    }
-                    else{
-                        printf("Error parse error in 0x0038, should not get here.\n");
-                    }
-                }
-
-                /* Create a new script node */
-                if (createScriptNode(&sNode) < 0){
-                    printf("Error creating a script node.\n");
-                    return -1;
-                }
-
-                /* Convert to shorts */
-                numArg /= 2;
-
-                /* Fill in Parameters */
-                sNode->id = G_ID++;
-                sNode->nodeType = NODE_EXE_SUB;
-                sNode->subroutine_code = cmd;
-                sNode->num_parameters = numArg;
-                sNode->alignfillVal = 0x00;
-
-                /* Allocate memory for EXE parameters */
-                params = (paramType*)malloc(sNode->num_parameters * sizeof(paramType));
-                if (params == NULL){
-                    printf("Error allocing memory for parameters\n");
-                    return -1;
-                }
-
-                /* Fill in EXE Parameters */
-                for (z = 0; z < (int)sNode->num_parameters; z++){
-                    params[z].type = SHORT_PARAM;
-                    params[z].value = pShort[z];
-                    swap16(&params[z].value);
-                }
-
-                sNode->subParams = params;
-                sNode->fileOffset = offset;
-
-                /* Add the node */
-                if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-                    printf("Error occurred adding the script node.\n");
-                    return -1;
-                }
-                free(sNode);
-
-                break;
-            }
-
-
-            /**************************************************************/
-            /* Variable short arguments that end with a short terminator  */
-            /* of 0x0000 and have only 1 child.                           */
-            /**************************************************************/
-
-            /*****************************************************************************/
-            /* Minimum of 2 short arguments.                                             */
-            /* Terminated with 0x0000, 1 child.                                          */
-            /*****************************************************************************/
-            case 0x000D:
-            {
-                int index = 0;
-                short* val;
-
-                /* N Arguments to read */
-                fread(&pdata[index], 2, 1, inFile);  /* Read 1st arg */
-                do
-                {
-                    index += 2;
-                    fread(&pdata[index], 2, 1, inFile); /* Read args 2 to N */
-                    val = (short*)(&pdata[index]);
-                } while (*val != (short)0x0000);
-                index += 2;
-                index /= 2;
-
-
-                /* Create a new script node */
-                if (createScriptNode(&sNode) < 0){
-                    printf("Error creating a script node.\n");
-                    return -1;
-                }
-
-                /* Fill in Parameters */
-                sNode->id = G_ID++;
-                sNode->nodeType = NODE_EXE_SUB;
-                sNode->subroutine_code = cmd;
-                sNode->num_parameters = index;
-                sNode->alignfillVal = 0x00;
-
-                /* Allocate memory for EXE parameters */
-                params = (paramType*)malloc(sNode->num_parameters * sizeof(paramType));
-                if (params == NULL){
-                    printf("Error allocing memory for parameters\n");
-                    return -1;
-                }
-
-                /* Fill in EXE Parameters */
-                for (z = 0; z < (int)sNode->num_parameters; z++){
-                    params[z].type = SHORT_PARAM;
-                    params[z].value = pShort[z];
-                    swap16(&params[z].value);
-                }
-
-                sNode->subParams = params;
-                sNode->fileOffset = offset;
-
-                sNode->nextPointerID = (unsigned int)params[0].value;
-
-
-                /* Add the node */
-                if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-                    printf("Error occurred adding the script node.\n");
-                    return -1;
-                }
-                free(sNode);
-
-                break;
-            }
-
-
-            /**********************************************************************/
-            /* Terminated with 0x0000, 1 child.  Terminate if First arg is 0x0000 */
-            /**********************************************************************/
-            case 0x000A:  /* Clears a bit in the 0x21F8xx region (opposite of 0x0009) */
-            case 0x0009:  /* Sets a bit in the 0x21F8xx region (opposite of 0x000A) updated */
-            case 0x0008:  /* updated */
-            {
-                int index = 0;
-                short* val;
-
-                /* N Arguments to read */
-                fread(&pdata[index], 2, 1, inFile);
-                val = (short*)(&pdata[index]);
-                while (*val != (short)0x0000){
-                    index += 2;
-                    fread(&pdata[index], 2, 1, inFile);
-                    val = (short*)(&pdata[index]);
+                if (pdata[0] >= 0x0B){
+                    curRead(pCur, &pdata[2], 2, 6);
+                    numargs += 6;
                 }
-                index += 2;
-                index /= 2;
 
-                /* Create a new script node */
-                if (createScriptNode(&sNode) < 0){
+
+                /* Create a new script node at the end of the list */
+                sNode = appendScriptNode(ctx, ctx->nextID++, NODE_EXE_SUB, offset);
+                if (sNode == NULL){
                     printf("Error creating a script node.\n");
                     return -1;
                 }
 
                 /* Fill in Parameters */
-                sNode->id = G_ID++;
-                sNode->nodeType = NODE_EXE_SUB;
                 sNode->subroutine_code = cmd;
-                sNode->num_parameters = index;
+                sNode->num_parameters = numargs;
                 sNode->alignfillVal = 0x00;
 
                 /* Allocate memory for EXE parameters */
-                params = (paramType*)malloc(sNode->num_parameters * sizeof(paramType));
+                params = allocNodeParams(ctx, sNode, sNode->num_parameters);
                 if (params == NULL){
                     printf("Error allocing memory for parameters\n");
                     return -1;
@@ -1245,74 +682,91 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 }
 
                 sNode->subParams = params;
-                sNode->fileOffset = offset;
-
-                /* Add the node */
-                if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-                    printf("Error occurred adding the script node.\n");
-                    return -1;
-                }
-                free(sNode);
 
                 break;
             }
 
 
-            /*************************************************************************/
-            /* xxx byte parameters terminated by first of occurence of 0x00, 1 child */
-            /*************************************************************************/
-            case 0x0036:  /* confirmed */
-            case 0x0013:  /* confirmed, was 0000 , changed to 00 */
-            case 0x001A:  /* confirmed */
-            case 0x000F:  /* confirmed */
-            case 0x0014:  /* confirmed */
-            case 0x0018:  /* confirmed */  /* calling 0x60bb1f4 is a dead giveaway for this type */
-            case 0x0019:  /* confirmed */
-            case 0x0025:  /* confirmed */
-            case 0x0035:  /* confirmed */
-            case 0x0041:  /* confirmed */
-            case 0x004E:  /* confirmed */
-            case 0x000E:  /* confirmed */
-            case 0x003E:  /* confirmed */
-            case 0x0055:  /* confirmed */
-            case 0x004F:  /* confirmed 99% sure */
+            /*========================================================*/
+            /*= VARIABLE NUMBERS OF ARGUMENTS, BASED ON A TERMINATOR =*/
+            /*========================================================*/
+
+
+            /*********************************************************/
+            /* 0x0038 - 1 Child                                      */
+            /* Byte Terminator of 0xF9 (maintains short wd boundary) */
+            /* Has several internal control codes that also dictate  */
+            /* Length of argument list                               */
+            /*********************************************************/
+            /* First byte argument is special, rest are:             **************/
+            /*   0xF0 - Incr 2 bytes                                              */
+            /*   0xF1 - Incr 2 bytes                                              */
+            /*   0xF2 - Incr 2 bytes                                              */
+            /*   0xF3 - Incr 5 bytes                                              */
+            /*   0xF4 - Incr 5 bytes                                              */
+            /*   0xF5 - Incr 2 bytes                                              */
+            /*   0xF6 - Incr 2 bytes                                              */
+            /*   0xF7 - Incr 5 bytes                                              */
+            /*   0xF8 - Incr 4 bytes                                              */
+            /*   0xF9 - End of args(incr to next short word offset(1 or 2 bytes)) */
+            /**********************************************************************/
+            case 0x0038:  /* Byte Terminator of 0xF9 (maintains short wd boundary) */
             {
                 int numArg = 0;
                 unsigned char argval;
 
+                //First byte argument
+                curRead(pCur, &pdata[numArg], 1, 1);
+                numArg++;
+
                 /* Determine # of Arguments to read */
-                while (!feof(inFile)){
-                    fread(&pdata[numArg], 1, 1, inFile);
+                while (!curEof(pCur)){
+                    curRead(pCur, &pdata[numArg], 1, 1);
                     memcpy(&argval, &pdata[numArg], 1);
                     numArg++;
 
-                    if (argval == 0x00){
+                    if ((argval == 0xF0) || (argval == 0xF1) || (argval == 0xF2) || (argval == 0xF5) || (argval == 0xF6)){
+                        curRead(pCur, &pdata[numArg], 1, 1);
+                        numArg++;
+                    }
+                    else if ((argval == 0xF3) || (argval == 0xF4) || (argval == 0xF7)){
+                        curRead(pCur, &pdata[numArg], 1, 4);
+                        numArg += 4;
+                    }
+                    else if (argval == 0xF8){
+                        curRead(pCur, &pdata[numArg], 1, 3);
+                        numArg += 3;
+                    }
+                    else if (argval == 0xF9){
                         //If not aligned, read again
-                        if ((ftell(inFile) % 2) != 0){
-                            fread(&pdata[numArg], 1, 1, inFile);
+                        if ((curTell(pCur) % 2) != 0){
+                            curRead(pCur, &pdata[numArg], 1, 1);
                             numArg++;
                         }
                         break;
                     }
+                    else{
+                        printf("Error parse error in 0x0038, should not get here.\n");
+                    }
                 }
 
-                numArg /= 2;
-
-                /* Create a new script node */
-                if (createScriptNode(&sNode) < 0){
+                /* Create a new script node at the end of the list */
+                sNode = appendScriptNode(ctx, ctx->nextID++, NODE_EXE_SUB, offset);
+                if (sNode == NULL){
                     printf("Error creating a script node.\n");
                     return -1;
                 }
 
+                /* Convert to shorts */
+                numArg /= 2;
+
                 /* Fill in Parameters */
-                sNode->id = G_ID++;
-                sNode->nodeType = NODE_EXE_SUB;
                 sNode->subroutine_code = cmd;
                 sNode->num_parameters = numArg;
                 sNode->alignfillVal = 0x00;
 
                 /* Allocate memory for EXE parameters */
-                params = (paramType*)malloc(sNode->num_parameters * sizeof(paramType));
+                params = allocNodeParams(ctx, sNode, sNode->num_parameters);
                 if (params == NULL){
                     printf("Error allocing memory for parameters\n");
                     return -1;
@@ -1326,14 +780,6 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 }
 
                 sNode->subParams = params;
-                sNode->fileOffset = offset;
-
-                /* Add the node */
-                if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-                    printf("Error occurred adding the script node.\n");
-                    return -1;
-                }
-                free(sNode);
 
                 break;
             }
@@ -1353,11 +799,11 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 runParamType* rpHead;
                 char prev, cur;
                 int index = 0;
-                int textMode = getTextDecodeMethod();
+                int textMode = getTextDecodeMethod(ctx);
                 prev = cur = 0;
 
                 while (1){
-                    rval = fread(&pdata[index++], 1, 1, inFile);
+                    rval = curRead(pCur, &pdata[index++], 1, 1);
                     if (rval != 1){
                         printf("Error encountered while reading TEXT portion of script, no termination.\n");
                         break;
@@ -1370,7 +816,7 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                         int nbytes = numBytesInUtf8Char(cur);
                         if (nbytes > 1){
                             for (x = 0; x < nbytes - 1; x++){
-                                rval = fread(&pdata[index++], 1, 1, inFile);
+                                rval = curRead(pCur, &pdata[index++], 1, 1);
                                 if (rval != 1){
                                     printf("Error encountered while reading TEXT portion of script, no termination.\n");
                                     break;
@@ -1380,7 +826,7 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                             prev = cur = 0;
                             continue;
                         }
-                        else if ((nbytes == 1) && (G_IOS_ENG == 1) && (pdata[index-1] == 0x0A)){
+                        else if ((nbytes == 1) && (ctx->iosEng == 1) && (pdata[index-1] == 0x0A)){
                             //Hack in space for iOS Eng
                             pdata[index - 1] = 0xFF;
                             pdata[index++] = 0x02;
@@ -1392,7 +838,7 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                     else if (textMode == TEXT_DECODE_UTF8){  // >= 0xF0
                         //Read again
                         prev = cur;
-                        fread(&pdata[index], 1, 1, inFile);
+                        curRead(pCur, &pdata[index], 1, 1);
                         cur = pdata[index];
                         index++;
                     }
@@ -1405,7 +851,7 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                             break;
                     }
                     else{
-                        if (((ftell(inFile) % 2) == 0) && (cur == (char)0xFF) && (prev == (char)0xFF))
+                        if (((curTell(pCur) % 2) == 0) && (cur == (char)0xFF) && (prev == (char)0xFF))
                             break;
                     }
                     prev = cur;
@@ -1413,8 +859,8 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
 
                 /* Advance File Pointer to a 16-bit boundary */
                 /* Should already be on one unless running a 1-byte text hack */
-                if ((ftell(inFile) % 2) != 0){
-                    fread(&pdata[index], 1, 1, inFile);
+                if ((curTell(pCur) % 2) != 0){
+                    curRead(pCur, &pdata[index], 1, 1);
                     //No need to increment index based on my storage format
                 }
 
@@ -1422,31 +868,22 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 /* Pass in data (pdata) and size of data (index) */
                 /* For a Text Node, the data count is in bytes, not shorts */
 
-                /* Create a new script node */
-                if (createScriptNode(&sNode) < 0){
+                /* Create a new script node at the end of the list */
+                sNode = appendScriptNode(ctx, ctx->nextID++, NODE_RUN_CMDS, offset);
+                if (sNode == NULL){
                     printf("Error creating a script node.\n");
                     return -1;
                 }
 
                 rpHead = NULL;
-                rpHead = getRunParam(textMode, pdata);
+                rpHead = getRunParam(ctx, textMode, pdata);
 
                 /* Fill in Remaining Parameters */
-                sNode->id = G_ID++;
-                sNode->nodeType = NODE_RUN_CMDS;
                 sNode->subroutine_code = cmd;
                 sNode->num_parameters = 0;    /* N/A */
                 sNode->alignfillVal = 0xFF;
                 sNode->subParams = NULL;
                 sNode->runParams = rpHead;
-                sNode->fileOffset = offset;
-
-                /* Add the node */
-                if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-                    printf("Error occurred adding the script node.\n");
-                    return -1;
-                }
-                free(sNode);
 
                 break;
             }
@@ -1479,19 +916,19 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
 //              int textSize1 = 0;
 //              int textSize2 = 0;
 				rpHead1 = rpHead2 = NULL;
-                int textMode = getTextDecodeMethod();
+                int textMode = getTextDecodeMethod(ctx);
 
 				//Hack because i got lazy and didnt want to compress
 				if (textMode == TEXT_DECODE_ONE_BYTE_PER_CHAR)
 					textMode = TEXT_DECODE_TWO_BYTES_ASCII;
 
                 /* Offset to Opt2 Jump Point */
-                fread(&opt2Offset, 2, 1, inFile);
+                curRead(pCur, &opt2Offset, 2, 1);
                 swap16(&opt2Offset);
 //              offsetAddress2 = 2 * opt2Offset;
 
                 /* NULL - well, not really NULL in all cases */
-                fread(&parameter2, 2, 1, inFile);
+                curRead(pCur, &parameter2, 2, 1);
                 swap16(&parameter2);
                 index = 0;
 
@@ -1503,7 +940,7 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 prev = cur = 0;
 
                 while (1){
-                    fread(&pdata[index], 1, 1, inFile);
+                    curRead(pCur, &pdata[index], 1, 1);
                     cur = pdata[index];
                     index++;
 
@@ -1513,7 +950,7 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                         int nbytes = numBytesInUtf8Char(cur);
                         if (nbytes > 1){
                             for (x = 0; x < nbytes - 1; x++){
-                                rval = fread(&pdata[index++], 1, 1, inFile);
+                                rval = curRead(pCur, &pdata[index++], 1, 1);
                                 if (rval != 1){
                                     printf("Error encountered while reading OPT portion of script, no termination.\n");
                                     break;
@@ -1523,7 +960,7 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                             prev = cur = 0;
                             continue;
                         }
-                        else if ((nbytes == 1) && (G_IOS_ENG == 1) && (pdata[index - 1] == 0x0A)){
+                        else if ((nbytes == 1) && (ctx->iosEng == 1) && (pdata[index - 1] == 0x0A)){
                             //Hack in space for iOS Eng
                             pdata[index - 1] = 0xFF;
                             pdata[index++] = 0x02;
@@ -1535,7 +972,7 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                     else if (textMode == TEXT_DECODE_UTF8){  // >= 0xF0
                         //Read again
                         prev = cur;
-                        fread(&pdata[index], 1, 1, inFile);
+                        curRead(pCur, &pdata[index], 1, 1);
                         cur = pdata[index];
                         index++;
                     }
@@ -1547,7 +984,7 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                             break;
                     }
                     else{
-                        if (((ftell(inFile) % 2) == 0) && (cur == (char)0xFF) && (prev == (char)0xFF))
+                        if (((curTell(pCur) % 2) == 0) && (cur == (char)0xFF) && (prev == (char)0xFF))
                             break;
                     }
 
@@ -1556,8 +993,8 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
 
                 /* Advance File Pointer to a 16-bit boundary */
                 /* Should already be on one unless running a 1-byte text hack */
-                if ((ftell(inFile) % 2) != 0){
-                    fread(&pdata[index], 1, 1, inFile);
+                if ((curTell(pCur) % 2) != 0){
+                    curRead(pCur, &pdata[index], 1, 1);
                     //No need to increment index based on my storage format
                 }
 //              textSize1 = index;
@@ -1571,7 +1008,7 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 prev = cur = 0;
 
                 while (1){
-                    fread(&pdata2[index2], 1, 1, inFile);
+                    curRead(pCur, &pdata2[index2], 1, 1);
                     cur = pdata2[index2];
                     index2++;
 
@@ -1581,7 +1018,7 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                         int nbytes = numBytesInUtf8Char(cur);
                         if (nbytes > 1){
                             for (x = 0; x < nbytes - 1; x++){
-                                rval = fread(&pdata2[index2++], 1, 1, inFile);
+                                rval = curRead(pCur, &pdata2[index2++], 1, 1);
                                 if (rval != 1){
                                     printf("Error encountered while reading OPT portion of script, no termination.\n");
                                     break;
@@ -1595,7 +1032,7 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                     else if (textMode == TEXT_DECODE_UTF8){  // >= 0xF0
                         //Read again
                         prev = cur;
-                        fread(&pdata2[index2], 1, 1, inFile);
+                        curRead(pCur, &pdata2[index2], 1, 1);
                         cur = pdata2[index2];
                         index2++;
                     }
@@ -1607,7 +1044,7 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                             break;
                     }
                     else{
-                        if (((ftell(inFile) % 2) == 0) && (cur == (char)0xFF) && (prev == (char)0xFF))
+                        if (((curTell(pCur) % 2) == 0) && (cur == (char)0xFF) && (prev == (char)0xFF))
                             break;
                     }
 
@@ -1616,11 +1053,11 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
 
                 /* Advance File Pointer to a 16-bit boundary */
                 /* Should already be on one unless running a 1-byte text hack */
-                if ((ftell(inFile) % 2) != 0){
-                    fread(&pdata2[index2], 1, 1, inFile);
+                if ((curTell(pCur) % 2) != 0){
+                    curRead(pCur, &pdata2[index2], 1, 1);
                     //No need to increment index2 based on my storage format
                 }
-                offsetAddress = ftell(inFile);
+                offsetAddress = curTell(pCur);
 //              textSize2 = index2;
 
 
@@ -1628,15 +1065,16 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 /* Create a New Two Option Script Node */
                 /***************************************/
 
-                /* Create a new script node */
-                if (createScriptNode(&sNode) < 0){
+                /* Create a new script node at the end of the list */
+                sNode = appendScriptNode(ctx, ctx->nextID++, NODE_OPTIONS, offset);
+                if (sNode == NULL){
                     printf("Error creating a script node.\n");
                     return -1;
                 }
 
                 /* Allocate memory for EXE parameters */
                 sNode->num_parameters = 2;
-                params = (paramType*)malloc(sNode->num_parameters * sizeof(paramType));
+                params = allocNodeParams(ctx, sNode, sNode->num_parameters);
                 if (params == NULL){
                     printf("Error allocing memory for parameters\n");
                     return -1;
@@ -1651,27 +1089,17 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
 
                 /* Convert Text to Run Parameters */
                 rpHead1 = rpHead2 = NULL;
-				rpHead1 = getRunParam(textMode, pdata);
-				rpHead2 = getRunParam(textMode, pdata2);
+				rpHead1 = getRunParam(ctx, textMode, pdata);
+				rpHead2 = getRunParam(ctx, textMode, pdata2);
 
                 /* Fill in Remaining Parameters */
-                sNode->id = G_ID++;
-                sNode->nodeType = NODE_OPTIONS;
                 sNode->subroutine_code = cmd;
                 sNode->alignfillVal = 0xFF;
                 sNode->runParams = rpHead1;
                 sNode->runParams2 = rpHead2;
-                sNode->fileOffset = offset;
 
                 sNode->nextPointerID = (unsigned int)params[0].value;
 
-                /* Add the node */
-                if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-                    printf("Error occurred adding the script node.\n");
-                    return -1;
-                }
-                free(sNode);
-
 
                 break;
             }
@@ -1693,42 +1121,41 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 unsigned char argval;
 
                 //Read short jump parameter
-                fread(&pdata[numArg], 2, 1, inFile);
+                curRead(pCur, &pdata[numArg], 2, 1);
                 memcpy(&wdOffset, &pdata[numArg], 2);
                 swap16(&wdOffset);
                 numArg += 2;
 
                 /* Determine # of Arguments to read */
-                while (!feof(inFile)){
-                    fread(&pdata[numArg], 1, 1, inFile);
+                while (!curEof(pCur)){
+                    curRead(pCur, &pdata[numArg], 1, 1);
                     memcpy(&argval, &pdata[numArg], 1);
                     numArg++;
 
                     if (argval == 0x00){
                         //If not aligned, read again
-                        if ((ftell(inFile) % 2) != 0){
-                            fread(&pdata[numArg], 1, 1, inFile);
+                        if ((curTell(pCur) % 2) != 0){
+                            curRead(pCur, &pdata[numArg], 1, 1);
                             numArg++;
                         }
                         break;
                     }
                 }
 
-                /* Create a new script node */
-                if (createScriptNode(&sNode) < 0){
+                /* Create a new script node at the end of the list */
+                sNode = appendScriptNode(ctx, ctx->nextID++, NODE_EXE_SUB, offset);
+                if (sNode == NULL){
                     printf("Error creating a script node.\n");
                     return -1;
                 }
 
                 /* Fill in Parameters */
-                sNode->id = G_ID++;
-                sNode->nodeType = NODE_EXE_SUB;
                 sNode->subroutine_code = cmd;
                 sNode->num_parameters = numArg / 2;
                 sNode->alignfillVal = 0x00;
 
                 /* Allocate memory for EXE parameters */
-                params = (paramType*)malloc(sNode->num_parameters * sizeof(paramType));
+                params = allocNodeParams(ctx, sNode, sNode->num_parameters);
                 if (params == NULL){
                     printf("Error allocing memory for parameters\n");
                     return -1;
@@ -1742,17 +1169,9 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 }
 
                 sNode->subParams = params;
-                sNode->fileOffset = offset;
 
                 sNode->nextPointerID = (unsigned int)params[0].value;
 
-                /* Add the node */
-                if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-                    printf("Error occurred adding the script node.\n");
-                    return -1;
-                }
-                free(sNode);
-
 
                 break;
             }
@@ -1768,43 +1187,42 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 unsigned char argval;
                 int numArg = 0;
 
-                fread(&pdata[numArg], 2, 1, inFile);
+                curRead(pCur, &pdata[numArg], 2, 1);
                 memcpy(&wdOffset, &pdata[numArg], 2);
                 swap16(&wdOffset);
                 numArg += 2;
 
 
                 /* Determine # of Arguments to read */
-                while (!feof(inFile)){
-                    fread(&pdata[numArg], 1, 1, inFile);
+                while (!curEof(pCur)){
+                    curRead(pCur, &pdata[numArg], 1, 1);
                     memcpy(&argval, &pdata[numArg], 1);
                     numArg++;
 
                     if (argval == 0x00){
                         //If not aligned, read again
-                        if ((ftell(inFile) % 2) != 0){
-                            fread(&pdata[numArg], 1, 1, inFile);
+                        if ((curTell(pCur) % 2) != 0){
+                            curRead(pCur, &pdata[numArg], 1, 1);
                             numArg++;
                         }
                         break;
                     }
                 }
 
-                /* Create a new script node */
-                if (createScriptNode(&sNode) < 0){
+                /* Create a new script node at the end of the list */
+                sNode = appendScriptNode(ctx, ctx->nextID++, NODE_EXE_SUB, offset);
+                if (sNode == NULL){
                     printf("Error creating a script node.\n");
                     return -1;
                 }
 
                 /* Fill in Parameters */
-                sNode->id = G_ID++;
-                sNode->nodeType = NODE_EXE_SUB;
                 sNode->subroutine_code = cmd;
                 sNode->num_parameters = numArg / 2;
                 sNode->alignfillVal = 0x00;
 
                 /* Allocate memory for EXE parameters */
-                params = (paramType*)malloc(sNode->num_parameters * sizeof(paramType));
+                params = allocNodeParams(ctx, sNode, sNode->num_parameters);
                 if (params == NULL){
                     printf("Error allocing memory for parameters\n");
                     return -1;
@@ -1818,17 +1236,9 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 }
 
                 sNode->subParams = params;
-                sNode->fileOffset = offset;
 
                 sNode->nextPointerID = (unsigned int)params[0].value;
 
-                /* Add the node */
-                if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-                    printf("Error occurred adding the script node.\n");
-                    return -1;
-                }
-                free(sNode);
-
                 break;
             }
 
@@ -1847,36 +1257,35 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 short bitOffset, zeroOffset;
                 int numArg = 0;
 
-                fread(&pShort[numArg], 2, 1, inFile);
+                curRead(pCur, &pShort[numArg], 2, 1);
                 memcpy(&wdOffset, &pShort[numArg++], 2);
                 swap16(&wdOffset);
-                fread(&pShort[numArg], 2, 1, inFile);
+                curRead(pCur, &pShort[numArg], 2, 1);
                 memcpy(&bitOffset, &pShort[numArg++], 2);
                 swap16(&bitOffset);
                 zeroOffset = bitOffset;
 
                 //Look for 0x0000 Terminator
                 while (zeroOffset != 0x0000){
-                    fread(&pShort[numArg], 2, 1, inFile);
+                    curRead(pCur, &pShort[numArg], 2, 1);
                     memcpy(&zeroOffset, &pShort[numArg++], 2);
                     swap16(&zeroOffset);
                 }
 
-                /* Create a new script node */
-                if (createScriptNode(&sNode) < 0){
+                /* Create a new script node at the end of the list */
+                sNode = appendScriptNode(ctx, ctx->nextID++, NODE_EXE_SUB, offset);
+                if (sNode == NULL){
                     printf("Error creating a script node.\n");
                     return -1;
                 }
 
                 /* Fill in Parameters */
-                sNode->id = G_ID++;
-                sNode->nodeType = NODE_EXE_SUB;
                 sNode->subroutine_code = cmd;
                 sNode->num_parameters = numArg;
                 sNode->alignfillVal = 0x00;
 
                 /* Allocate memory for EXE parameters */
-                params = (paramType*)malloc(sNode->num_parameters * sizeof(paramType));
+                params = allocNodeParams(ctx, sNode, sNode->num_parameters);
                 if (params == NULL){
                     printf("Error allocing memory for parameters\n");
                     return -1;
@@ -1890,17 +1299,9 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 }
 
                 sNode->subParams = params;
-                sNode->fileOffset = offset;
 
                 sNode->nextPointerID = (unsigned int)params[0].value;
 
-                /* Add the node */
-                if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-                    printf("Error occurred adding the script node.\n");
-                    return -1;
-                }
-                free(sNode);
-
                 break;
             }
 
@@ -1925,14 +1326,14 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 int numArg;
 
                 /* Minimum 3 Arguments to read */
-                fread(&pdata[0], 2, 3, inFile);
+                curRead(pCur, &pdata[0], 2, 3);
 
                 memcpy(&jmploc, &pdata[0], 2);
                 swap16(&jmploc);
 
                 /* See if an additional 5 should be read */
                 if (pdata[2] == (char)0x00){
-                    fread(&pdata[6], 2, 5, inFile);
+                    curRead(pCur, &pdata[6], 2, 5);
                     /* Create a new script node, 8 arg */
                     numArg = 8;
                 }
@@ -1941,21 +1342,20 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                     numArg = 3;
                 }
 
-                /* Create a new script node */
-                if (createScriptNode(&sNode) < 0){
+                /* Create a new script node at the end of the list */
+                sNode = appendScriptNode(ctx, ctx->nextID++, NODE_EXE_SUB, offset);
+                if (sNode == NULL){
                     printf("Error creating a script node.\n");
                     return -1;
                 }
 
                 /* Fill in Parameters */
-                sNode->id = G_ID++;
-                sNode->nodeType = NODE_EXE_SUB;
                 sNode->subroutine_code = cmd;
                 sNode->num_parameters = numArg;
                 sNode->alignfillVal = 0x00;
 
                 /* Allocate memory for EXE parameters */
-                params = (paramType*)malloc(sNode->num_parameters * sizeof(paramType));
+                params = allocNodeParams(ctx, sNode, sNode->num_parameters);
                 if (params == NULL){
                     printf("Error allocing memory for parameters\n");
                     return -1;
@@ -1969,17 +1369,9 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
                 }
 
                 sNode->subParams = params;
-                sNode->fileOffset = offset;
 
                 sNode->nextPointerID = (unsigned int)params[0].value;
 
-                /* Add the node */
-                if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-                    printf("Error occurred adding the script node.\n");
-                    return -1;
-                }
-                free(sNode);
-
                 break;
             }
 
@@ -1992,26 +1384,17 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
             /*************************************************************/
             case 0x0005:
             {
-                /* Create a new script node */
-                if (createScriptNode(&sNode) < 0){
+                /* Create a new script node at the end of the list */
+                sNode = appendScriptNode(ctx, ctx->nextID++, NODE_EXE_SUB, offset);
+                if (sNode == NULL){
                     printf("Error creating a script node.\n");
                     return -1;
                 }
 
                 /* Fill in Parameters */
-                sNode->id = G_ID++;
-                sNode->nodeType = NODE_EXE_SUB;
                 sNode->subroutine_code = cmd;
                 sNode->num_parameters = 0;
                 sNode->alignfillVal = 0x00;
-                sNode->fileOffset = offset;
-
-                /* Add the node */
-                if (addNode(sNode, METHOD_NORMAL, 0) != 0){
-                    printf("Error occurred adding the script node.\n");
-                    return -1;
-                }
-                free(sNode);
 
                 break;
             }
@@ -2039,13 +1422,24 @@ int parseCmdSeq(int offset, FILE** ptr_inFile, int singleRunFlag){
 
 
 
-runParamType* getRunParam(int textMode, char* pdata){
+/*****************************************************************************/
+/* Function: getRunParam                                                     */
+/* Purpose: Splits a block of script text into text and control code run    */
+/*          parameters in a single pass.  Text is converted in the context's */
+/*          scratch text buffer, the input data is not modified.             */
+/* Inputs:  Text decode mode, ptr to text data ending in 0xFFFF.             */
+/* Outputs: The run parameter sequence, NULL on Fail.                        */
+/*****************************************************************************/
+runParamType* getRunParam(lsb_context* ctx, int textMode, char* pdata){
 
-    runParamType* rpHead, *rpNode, *rpCurrent;
-    int x;
-    unsigned char* tmpText = NULL;
-    unsigned int numTextShorts = 0;
-    rpHead = rpNode = rpCurrent = NULL;
+    const unsigned char* pIn = (const unsigned char*)pdata;
+    const unsigned char* pStart;
+    char* pText;
+    unsigned int len;
+    unsigned short code;
+
+    /* Instructions are collected in the context, then copied out */
+    beginRunParams(ctx);
 
     /************************************************************************/
     /* Iterate through the data looking to separate text from control codes */
@@ -2055,144 +1449,54 @@ runParamType* getRunParam(int textMode, char* pdata){
 
     case TEXT_DECODE_TWO_BYTES_PER_CHAR:
     {
-        unsigned short* ptrS = (unsigned short*)pdata;
-        unsigned short* ptrTextStart = NULL;
+        unsigned int numTextShorts = 0;
+        unsigned int x, numBytes;
+        const char* pUtf8;
 
+        pStart = pIn;
         while (1){
 
-            swap16(ptrS);
+            /* Big endian table index */
+            code = (unsigned short)((pIn[0] << 8) | pIn[1]);
+            pIn += 2;
 
-            /* Control Code vs. Text Detection */
-            if (*ptrS == 0xF90A){
-                /* Part of a Text String (Space) */
+            /* Control Codes are >= 0xF000, except for Space */
+            if ((code < 0xF000) || (code == 0xF90A)){
                 if (numTextShorts == 0)
-                    ptrTextStart = ptrS;
+                    pStart = pIn - 2;
                 numTextShorts++;
+                continue;
             }
-            else if (*ptrS >= 0xF000){  /* Control Codes are >= 0xF000 */
-
-                /* Create a text string run parameter element if one was previously started */
-                if (numTextShorts > 0){
-                    char tmp[5];
-
-                    /* Create utf8 Text String*/
-                    tmpText = (unsigned char*)malloc(5 * (numTextShorts + 1));
-                    memset(tmpText, 0, 5 * (numTextShorts + 1));
-                    for (x = 0; x < (int)numTextShorts; x++){
-                        memset(tmp, 0, 5);
-                        if (ptrTextStart[x] == 0xF90A)
-                            strcpy(tmp, " ");
-                        else
-                            getUTF8character(ptrTextStart[x], tmp);
-                        strcat((char *)tmpText, tmp);
-                    }
 
-                    /* Create a runcmds parameter element */
-                    rpNode = (runParamType*)malloc(sizeof(runParamType));
-                    if (rpNode == NULL){
-                        printf("Error allocing space for run parameter struct.\n");
-                        return NULL;
-                    }
-                    memset(rpNode, 0, sizeof(runParamType));
-                    rpNode->pNext = NULL;
-                    rpNode->type = PRINT_LINE;
-                    rpNode->str = tmpText;
-
-                    /* Add the node to the list */
-                    if (rpHead == NULL){
-                        rpHead = rpCurrent = rpNode;
-                    }
-                    else{
-                        rpCurrent->pNext = rpNode;
-                        rpCurrent = rpNode;
+            /* Create a utf8 text string if one was previously started */
+            if (numTextShorts > 0){
+                pText = (char*)reserveTextBuf(ctx, 4 * numTextShorts);
+                if (pText == NULL)
+                    return NULL;
+                len = 0;
+                for (x = 0; x < numTextShorts; x++){
+                    unsigned short index = (unsigned short)((pStart[2 * x] << 8) | pStart[2 * x + 1]);
+                    if (index == 0xF90A){
+                        pText[len++] = ' ';
+                        continue;
                     }
-
-                    numTextShorts = 0;
-                }
-
-                /*********************************/
-                /* Create a Control Code element */
-                /* OR SHOW_PORTRAIT              */
-                /*********************************/
-
-                /* Create a runcmds parameter element */
-                rpNode = (runParamType*)malloc(sizeof(runParamType));
-                if (rpNode == NULL){
-                    printf("Error allocing space for run parameter struct.\n");
+                    pUtf8 = getUTF8string(index);
+                    if (pUtf8 == NULL)
+                        continue;
+                    numBytes = (unsigned int)strlen(pUtf8);
+                    memcpy(&pText[len], pUtf8, numBytes);
+                    len += numBytes;
+                }
+                if (addPrintLine(ctx, pText, len) != 0)
                     return NULL;
-                }
-                memset(rpNode, 0, sizeof(runParamType));
-                rpNode->pNext = NULL;
-                rpNode->str = NULL;
-
-                if ((*ptrS & 0xFF00) == 0xFA00){
-                    rpNode->type = SHOW_PORTRAIT_LEFT;
-                    rpNode->value = (*ptrS & 0x00FF);
-                }
-                else if ((*ptrS & 0xFF00) == 0xFB00){
-                    rpNode->type = SHOW_PORTRAIT_RIGHT;
-                    rpNode->value = (*ptrS & 0x00FF);
-                }
-                else if ((*ptrS & 0xFF00) == 0xF800){
-                    rpNode->type = TIME_DELAY;
-                    rpNode->value = (*ptrS & 0x00FF);
-                }
-                else{
-                    rpNode->type = CTRL_CODE;
-                    rpNode->value = *ptrS;
-                }
-
-                /* Add the node to the list */
-                if (rpHead == NULL){
-                    rpHead = rpCurrent = rpNode;
-                }
-                else{
-                    rpCurrent->pNext = rpNode;
-                    rpCurrent = rpNode;
-                }
-
-                /*****************************/
-                /* END OF TEXT BLOCK LOCATED */
-                /*****************************/
-                if (*ptrS == 0xFFFF){
-
-					/**************************/
-					/* Force 2-Byte Alignment */
-					/**************************/
-
-					/* Create a runcmds parameter element */
-					rpNode = (runParamType*)malloc(sizeof(runParamType));
-					if (rpNode == NULL){
-						printf("Error allocing space for run parameter struct.\n");
-						return NULL;
-					}
-					memset(rpNode, 0, sizeof(runParamType));
-					rpNode->pNext = NULL;
-					rpNode->str = NULL;
-					rpNode->type = ALIGN_2_PARAM;
-					rpNode->value = 0xFF;
-
-					/* Add the node to the list */
-					if (rpHead == NULL){
-						rpHead = rpCurrent = rpNode;
-					}
-					else{
-						rpCurrent->pNext = rpNode;
-						rpCurrent = rpNode;
-					}
-
-
-                    break;
-                }
-            }
-            else{
-                /* Part of a Text String */
-                if (numTextShorts == 0)
-                    ptrTextStart = ptrS;
-                numTextShorts++;
+                numTextShorts = 0;
             }
 
-            ptrS++;  //Incr Short Ptr
+            /* Control Code or SHOW_PORTRAIT, ends at 0xFFFF */
+            if (addCtrlCode(ctx, code) != 0)
+                return NULL;
+            if (code == 0xFFFF)
+                break;
         }
         break;
     }
@@ -2205,111 +1509,47 @@ runParamType* getRunParam(int textMode, char* pdata){
 	/***************************************************************/
 	case TEXT_DECODE_TWO_BYTES_ASCII:
 	{
-		char* tmpData;
 		char prevChar, currentChar;
-		int index = 0;
-		unsigned short* ptrS = (unsigned short*)pdata;
 		prevChar = currentChar = 0;
-		 
+		len = 0;
+
 		/* Condense Text to 1 byte encoding */
 		while (1){
-			swap16(ptrS);
-			if ((*ptrS) == 0xF905){
+			code = (unsigned short)((pIn[0] << 8) | pIn[1]);
+			pIn += 2;
+			if (code == 0xF905){
 				currentChar = ' ';
 			}
-			else if ((*ptrS) == 0xFFFF){
+			else if (code == 0xFFFF){
 				break;
 			}
 			else{
-				currentChar = (char)(*ptrS & 0xFF);
+				currentChar = (char)(code & 0xFF);
 			}
-			pdata[index++] = currentChar;
+
+			pText = (char*)reserveTextBuf(ctx, len + 1);
+			if (pText == NULL)
+				return NULL;
+			pText[len++] = currentChar;
 
 			//For unaligned
 			if ((currentChar == 0xFF) && (prevChar == 0xFF)){
-				index--;
+				len--;
 				break;
 			}
 			prevChar = currentChar;
-
-			ptrS++;
 		}
-		pdata[index++] = 0x00;
-
-		tmpData = (char*)malloc(index + 1);
-		memset(tmpData, 0, index + 1);
-		memcpy(tmpData, pdata, index);
 
-		/* Create a runcmds parameter element */
-		rpNode = (runParamType*)malloc(sizeof(runParamType));
-		if (rpNode == NULL){
-			printf("Error allocing space for run parameter struct.\n");
+		pText = (char*)reserveTextBuf(ctx, len + 1);
+		if (pText == NULL)
 			return NULL;
-		}
-		memset(rpNode, 0, sizeof(runParamType));
-		rpNode->pNext = NULL;
-		rpNode->type = PRINT_LINE;
-		rpNode->str = (unsigned char*)tmpData;
-
-		/* Add the node to the list */
-		if (rpHead == NULL){
-			rpHead = rpCurrent = rpNode;
-		}
-		else{
-			rpCurrent->pNext = rpNode;
-			rpCurrent = rpNode;
-		}
-
-		/*********************/
-		/* FFFF Control Code */
-		/*********************/
-
-		/* Create a runcmds parameter element */
-		rpNode = (runParamType*)malloc(sizeof(runParamType));
-		if (rpNode == NULL){
-			printf("Error allocing space for run parameter struct.\n");
+		pText[len] = 0x00;
+		if (addPrintLine(ctx, pText, len) != 0)
 			return NULL;
-		}
-		memset(rpNode, 0, sizeof(runParamType));
-		rpNode->pNext = NULL;
-		rpNode->str = NULL;
-		rpNode->type = CTRL_CODE;
-		rpNode->value = 0xFFFF;
-
-		/* Add the node to the list */
-		if (rpHead == NULL){
-			rpHead = rpCurrent = rpNode;
-		}
-		else{
-			rpCurrent->pNext = rpNode;
-			rpCurrent = rpNode;
-		}
-
 
-		/**************************/
-		/* Force 2-Byte Alignment */
-		/**************************/
-
-		/* Create a runcmds parameter element */
-		rpNode = (runParamType*)malloc(sizeof(runParamType));
-		if (rpNode == NULL){
-			printf("Error allocing space for run parameter struct.\n");
+		/* FFFF Control Code */
+		if (addCtrlCode(ctx, 0xFFFF) != 0)
 			return NULL;
-		}
-		memset(rpNode, 0, sizeof(runParamType));
-		rpNode->pNext = NULL;
-		rpNode->str = NULL;
-		rpNode->type = ALIGN_2_PARAM;
-		rpNode->value = 0xFF;
-
-		/* Add the node to the list */
-		if (rpHead == NULL){
-			rpHead = rpCurrent = rpNode;
-		}
-		else{
-			rpCurrent->pNext = rpNode;
-			rpCurrent = rpNode;
-		}
 		break;
 	}
 
@@ -2317,336 +1557,89 @@ runParamType* getRunParam(int textMode, char* pdata){
 	case TEXT_DECODE_PSX_ENG:
     case TEXT_DECODE_ONE_BYTE_PER_CHAR:
     {
-        int z;
-        unsigned char byte_data, byte_data2;
-        unsigned short short_data;
-        char* ptrText, *ptrStart;
-
-        /* Buffer */
-        ptrText = (char*)malloc(1024 * 1024);
-        if (ptrText == NULL){
-            printf("Error allocing temp memory\n");
-            return NULL;
-        }
-        z = 0;
-        ptrStart = NULL;
-
         while (1){
-            byte_data = ((unsigned char)*pdata) & 0xFF;
-
-            if (byte_data < 0xF0){
-                /* 1-Byte Text */
-                if(ptrStart == NULL)
-                    ptrStart = pdata;
-                z++;
-                pdata++;
-            }
-            else if (byte_data >= 0xF0){
-                /* 2-byte Code or Space */
-                pdata++;
-                byte_data2 = (((unsigned char)*pdata) & 0xFF);
-                short_data = (byte_data << 8) | byte_data2;
-				pdata++;
-
-                /*************/
-                /* Ctrl Code */
-                /*************/
-
-                /**************************************/
-                /* Write out any prior text           */
-                /* Create a runcmds parameter element */
-                /**************************************/
-                if (z > 0){
-                    unsigned int decmpSize = 0;
-                    rpNode = (runParamType*)malloc(sizeof(runParamType));
-                    if (rpNode == NULL){
-                        printf("Error allocing space for run parameter struct.\n");
-                        free(ptrText);
-                        return NULL;
-                    }
-                    memset(rpNode, 0, sizeof(runParamType));  //-- fix
-                    rpNode->pNext = NULL;
-                    rpNode->type = PRINT_LINE;
-
-
-					if (textMode == TEXT_DECODE_ONE_BYTE_PER_CHAR){
-						memset(ptrText, 0, 1024 * 1024);
-						decompressBPE((unsigned char*)ptrText, (unsigned char*)ptrStart, &decmpSize);
-						rpNode->str = malloc(decmpSize + 1);
-						if (rpNode->str == NULL){
-							printf("Error allocing for string.\n");
-							free(ptrText);
-							return NULL;
-						}
-						memset(rpNode->str, 0, decmpSize + 1);
-						strcpy((char *)rpNode->str, (char *)ptrText);
-					}
-					else {
-						rpNode->str = malloc(z + 1);
-						if (rpNode->str == NULL){
-							printf("Error allocing for string.\n");
-							free(ptrText);
-							return NULL;
-						}
-						memset(rpNode->str, 0, z + 1);
-						strncpy((char *)rpNode->str, (char *)ptrStart, z);
-					}
-
-
-                    /* Add the node to the list */
-                    if (rpHead == NULL){
-                        rpHead = rpCurrent = rpNode;
-                    }
-                    else{
-                        rpCurrent->pNext = rpNode;
-                        rpCurrent = rpNode;
-                    }
-
-                    /* Reset start of text section */
-                    ptrStart = NULL;
-                    z = 0;
-                }
-
-                /*********************************/
-                /* Create a Control Code element */
-                /* OR SHOW_PORTRAIT              */
-                /*********************************/
-
-                /* Create a runcmds parameter element */
-                rpNode = (runParamType*)malloc(sizeof(runParamType));
-                if (rpNode == NULL){
-                    printf("Error allocing space for run parameter struct.\n");
-                    free(ptrText);
-                    return NULL;
-                }
-                memset(rpNode, 0, sizeof(runParamType));
-                rpNode->pNext = NULL;
-                rpNode->str = NULL;
 
-                if ((short_data & 0xFF00) == 0xFA00){
-                    rpNode->type = SHOW_PORTRAIT_LEFT;
-                    rpNode->value = (short_data & 0x00FF);
-                }
-                else if ((short_data & 0xFF00) == 0xFB00){
-                    rpNode->type = SHOW_PORTRAIT_RIGHT;
-                    rpNode->value = (short_data & 0x00FF);
-                }
-                else if ((short_data & 0xFF00) == 0xF800){
-                    rpNode->type = TIME_DELAY;
-                    rpNode->value = (short_data & 0x00FF);
-                }
-                else{
-                    rpNode->type = CTRL_CODE;
-                    rpNode->value = short_data;
-                }
+            /* 1-Byte Text, up to a 2-byte Code or Space */
+            pStart = pIn;
+            while (*pIn < 0xF0)
+                pIn++;
 
-                /* Add the node to the list */
-                if (rpHead == NULL){
-                    rpHead = rpCurrent = rpNode;
+            /* Write out any prior text */
+            if (pIn > pStart){
+                if (textMode == TEXT_DECODE_ONE_BYTE_PER_CHAR){
+                    unsigned int decmpSize = 0;
+                    pText = (char*)reserveTextBuf(ctx, sizeDecompressedBPE(pStart) + 1);
+                    if (pText == NULL)
+                        return NULL;
+                    decompressBPE((unsigned char*)pText, (unsigned char*)pStart, &decmpSize);
+                    if (addPrintLine(ctx, pText, decmpSize) != 0)
+                        return NULL;
                 }
                 else{
-                    rpCurrent->pNext = rpNode;
-                    rpCurrent = rpNode;
-                }
-
-                /*****************************/
-                /* END OF TEXT BLOCK LOCATED */
-                /*****************************/
-                if (short_data == 0xFFFF){
-                    free(ptrText);
-					
-					/**************************/
-					/* Force 2-Byte Alignment */
-					/**************************/
-					
-					/* Create a runcmds parameter element */
-					rpNode = (runParamType*)malloc(sizeof(runParamType));
-					if (rpNode == NULL){
-						printf("Error allocing space for run parameter struct.\n");
-						return NULL;
-					}
-					memset(rpNode, 0, sizeof(runParamType));
-					rpNode->pNext = NULL;
-					rpNode->str = NULL;
-					rpNode->type = ALIGN_2_PARAM;
-					rpNode->value = 0xFF;
-					
-					/* Add the node to the list */
-					if (rpHead == NULL){
-						rpHead = rpCurrent = rpNode;
-					}
-					else{
-						rpCurrent->pNext = rpNode;
-						rpCurrent = rpNode;
-					}
-					
-                    break;
+                    if (addPrintLine(ctx, (const char*)pStart, (unsigned int)(pIn - pStart)) != 0)
+                        return NULL;
                 }
             }
-           // pdata++;
+
+            /* Control Code or SHOW_PORTRAIT, ends at 0xFFFF */
+            code = (unsigned short)((pIn[0] << 8) | pIn[1]);
+            pIn += 2;
+            if (addCtrlCode(ctx, code) != 0)
+                return NULL;
+            if (code == 0xFFFF)
+                break;
         }
         break;
     }
 
     case TEXT_DECODE_UTF8:
     {
-        unsigned char* ptrText = NULL;
-        unsigned char utf8data[5];
-        unsigned short short_data;
         int numBytes, y;
-
-        /* Buffer */
-        ptrText = malloc(1024 * 1024);
-        if (ptrText == NULL){
-            printf("Error allocing temp memory\n");
-        }
-        memset(ptrText, 0, 1024 * 1024);
+        len = 0;
 
         while (1){
-            memset(utf8data, 0, 5);
-            short_data = 0;
 
             /* Grab the first byte of the utf8 character & get # bytes */
-            if ((unsigned char)*pdata >= 0xF0)
+            if (*pIn >= 0xF0)
                 numBytes = 1;
             else
-                numBytes = numBytesInUtf8Char((unsigned char)*pdata);
-            utf8data[0] = (unsigned char)(*pdata);
-
-            /* Read the rest of the utf8 character */
-            for (y = 1; y < numBytes; y++){
-                pdata++;
-                utf8data[y] = (unsigned char)*pdata;
-            }
+                numBytes = numBytesInUtf8Char(*pIn);
 
             /* Check for Control Code */
-            if ((numBytes == 1) && (utf8data[0] >= 0xF0)){
-                pdata++;
-                short_data = (utf8data[0] << 8) | (unsigned char)(*pdata);
-            }
+            if ((numBytes == 1) && (*pIn >= 0xF0)){
+                code = (unsigned short)((pIn[0] << 8) | pIn[1]);
+                pIn += 2;
 
-            if (short_data == 0xF90A){
-                strcat((char *)ptrText, " ");
-                short_data = 0;
-            }
-            else if (short_data != 0x0000){
-
-                /**************************************/
-                /* Write out any prior text           */
-                /* Create a runcmds parameter element */
-                /**************************************/
-                if (strlen((char *)ptrText) > 0){
-                    rpNode = (runParamType*)malloc(sizeof(runParamType));
-                    if (rpNode == NULL){
-                        printf("Error allocing space for run parameter struct.\n");
-                        free(ptrText);
-                        return NULL;
-                    }
-                    memset(rpNode, 0, sizeof(runParamType));
-                    rpNode->pNext = NULL;
-                    rpNode->type = PRINT_LINE;
-                    rpNode->str = malloc(strlen((char *)ptrText) + 1);
-                    if (rpNode->str == NULL){
-                        printf("Error allocing for string.\n");
-                        free(ptrText);
+                if (code == 0xF90A){
+                    pText = (char*)reserveTextBuf(ctx, len + 1);
+                    if (pText == NULL)
                         return NULL;
-                    }
-                    memset(rpNode->str, 0, strlen((char *)ptrText) + 1);
-                    strcpy((char *)rpNode->str, (char *)ptrText);
-
-                    /* Add the node to the list */
-                    if (rpHead == NULL){
-                        rpHead = rpCurrent = rpNode;
-                    }
-                    else{
-                        rpCurrent->pNext = rpNode;
-                        rpCurrent = rpNode;
-                    }
-                }
-
-                /*********************************/
-                /* Create a Control Code element */
-                /* OR SHOW_PORTRAIT              */
-                /*********************************/
-
-                /* Create a runcmds parameter element */
-                rpNode = (runParamType*)malloc(sizeof(runParamType));
-                if (rpNode == NULL){
-                    printf("Error allocing space for run parameter struct.\n");
-                    free(ptrText);
-                    return NULL;
+                    pText[len++] = ' ';
+                    continue;
                 }
-                memset(rpNode, 0, sizeof(runParamType));
-                rpNode->pNext = NULL;
-                rpNode->str = NULL;
 
-                if ((short_data & 0xFF00) == 0xFA00){
-                    rpNode->type = SHOW_PORTRAIT_LEFT;
-                    rpNode->value = (short_data & 0x00FF);
-                }
-                else if ((short_data & 0xFF00) == 0xFB00){
-                    rpNode->type = SHOW_PORTRAIT_RIGHT;
-                    rpNode->value = (short_data & 0x00FF);
-                }
-                else if ((short_data & 0xFF00) == 0xF800){
-                    rpNode->type = TIME_DELAY;
-                    rpNode->value = (short_data & 0x00FF);
-                }
-                else{
-                    rpNode->type = CTRL_CODE;
-                    rpNode->value = short_data;
-                }
-
-                /* Add the node to the list */
-                if (rpHead == NULL){
-                    rpHead = rpCurrent = rpNode;
-                }
-                else{
-                    rpCurrent->pNext = rpNode;
-                    rpCurrent = rpNode;
+                /* Write out any prior text */
+                if (len > 0){
+                    if (addPrintLine(ctx, (char*)ctx->pTextBuf, len) != 0)
+                        return NULL;
+                    len = 0;
                 }
 
-                /*****************************/
-                /* END OF TEXT BLOCK LOCATED */
-                /*****************************/
-                if (short_data == 0xFFFF){
-                    free(ptrText);
-
-					/**************************/
-					/* Force 2-Byte Alignment */
-					/**************************/
-
-					/* Create a runcmds parameter element */
-					rpNode = (runParamType*)malloc(sizeof(runParamType));
-					if (rpNode == NULL){
-						printf("Error allocing space for run parameter struct.\n");
-						return NULL;
-					}
-					memset(rpNode, 0, sizeof(runParamType));
-					rpNode->pNext = NULL;
-					rpNode->str = NULL;
-					rpNode->type = ALIGN_2_PARAM;
-					rpNode->value = 0xFF;
-
-					/* Add the node to the list */
-					if (rpHead == NULL){
-						rpHead = rpCurrent = rpNode;
-					}
-					else{
-						rpCurrent->pNext = rpNode;
-						rpCurrent = rpNode;
-					}
-
+                /* Control Code or SHOW_PORTRAIT, ends at 0xFFFF */
+                if (addCtrlCode(ctx, code) != 0)
+                    return NULL;
+                if (code == 0xFFFF)
                     break;
-                }
-                short_data = 0;
-                ptrText[0] = '\0';
-            }
-            else{
-                /* Text */
-                strcat((char *)ptrText, (char *)utf8data);
+                continue;
             }
-            pdata++;
+
+            /* Text, a NUL byte ends the character early */
+            pText = (char*)reserveTextBuf(ctx, len + numBytes);
+            if (pText == NULL)
+                return NULL;
+            for (y = 0; (y < numBytes) && (pIn[y] != 0x00); y++)
+                pText[len++] = (char)pIn[y];
+            pIn += numBytes;
         }
         break;
     }
@@ -2659,5 +1652,91 @@ runParamType* getRunParam(int textMode, char* pdata){
 
     }
 
-    return rpHead;
+    return finishRunParams(ctx);
+}
+
+
+
+
+/*****************************************************************************/
+/* Function: addPrintLine                                                    */
+/* Purpose: Adds a PRINT_LINE run parameter for len bytes of text.           */
+/* Inputs:  Ptr to the text and its length in bytes.                         */
+/* Outputs: 0 on Pass, -1 on Fail.                                           */
+/*****************************************************************************/
+static int addPrintLine(lsb_context* ctx, const char* pText, unsigned int len){
+
+    runParamType* rpNode;
+
+    /* Create a runcmds parameter element */
+    rpNode = addRunParam(ctx);
+    if (rpNode == NULL){
+        printf("Error allocing space for run parameter struct.\n");
+        return -1;
+    }
+    rpNode->type = PRINT_LINE;
+    if (poolIntern(&ctx->strings, pText, len, &rpNode->str) != 0){
+        printf("Error allocing for string.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+
+
+
+/*****************************************************************************/
+/* Function: addCtrlCode                                                     */
+/* Purpose: Adds a Control Code, SHOW_PORTRAIT or TIME_DELAY run parameter.  */
+/*          The 0xFFFF end of text code is followed by 2-byte alignment.     */
+/* Inputs:  The 2-byte code.                                                 */
+/* Outputs: 0 on Pass, -1 on Fail.                                           */
+/*****************************************************************************/
+static int addCtrlCode(lsb_context* ctx, unsigned short code){
+
+    runParamType* rpNode;
+
+    /* Create a runcmds parameter element */
+    rpNode = addRunParam(ctx);
+    if (rpNode == NULL){
+        printf("Error allocing space for run parameter struct.\n");
+        return -1;
+    }
+
+    if ((code & 0xFF00) == 0xFA00){
+        rpNode->type = SHOW_PORTRAIT_LEFT;
+        rpNode->value = (code & 0x00FF);
+    }
+    else if ((code & 0xFF00) == 0xFB00){
+        rpNode->type = SHOW_PORTRAIT_RIGHT;
+        rpNode->value = (code & 0x00FF);
+    }
+    else if ((code & 0xFF00) == 0xF800){
+        rpNode->type = TIME_DELAY;
+        rpNode->value = (code & 0x00FF);
+    }
+    else{
+        rpNode->type = CTRL_CODE;
+        rpNode->value = code;
+    }
+
+    /*****************************/
+    /* END OF TEXT BLOCK LOCATED */
+    /*****************************/
+    if (code == 0xFFFF){
+
+        /**************************/
+        /* Force 2-Byte Alignment */
+        /**************************/
+        rpNode = addRunParam(ctx);
+        if (rpNode == NULL){
+            printf("Error allocing space for run parameter struct.\n");
+            return -1;
+        }
+        rpNode->type = ALIGN_2_PARAM;
+        rpNode->value = 0xFF;
+    }
+
+    return 0;
 }
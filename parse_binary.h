@@ -3,8 +3,10 @@
 
 #include <stdio.h>
 #include "script_node_types.h"
+#include "lsb_context.h"
 
-int decodeBinaryScript(FILE* inFile, FILE* outFile);
-runParamType* getRunParam(int textMode, char* pdata);
+int decodeBinaryScript(lsb_context* ctx, FILE* inFile, FILE* outFile);
+runParamType* getRunParam(lsb_context* ctx, int textMode, char* pdata);
+unsigned int* readPtrTable(lsb_context* ctx, int bigEndian);
 
 #endif
\ No newline at end of file
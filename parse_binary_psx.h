@@ -8,8 +8,9 @@
 #define PARSE_BINARY_PSX_H
 
 #include <stdio.h>
+#include "lsb_context.h"
 
-int decodeBinaryScript_PSX(FILE* inFile, FILE* outFile);
+int decodeBinaryScript_PSX(lsb_context* ctx, FILE* inFile, FILE* outFile);
 
 
 #endif
\ No newline at end of file
@@ -5,8 +5,9 @@
 #define PARSE_BINARY_RE_ENG_H
 
 #include <stdio.h>
+#include "lsb_context.h"
 
-int decodeBinaryScript_RE_Eng(FILE* inFile, FILE* outFile);
+int decodeBinaryScript_RE_Eng(lsb_context* ctx, FILE* inFile, FILE* outFile);
 
 
 #endif
\ No newline at end of file
@@ -16,18 +16,14 @@
 /* Defines */
 
 
-/* Globals */
-static unsigned char* pInput = NULL;
-static int radix_type = RADIX_HEX;
-
 /* Function Prototypes */
-int encodeScript(FILE* infile, FILE* outfile);
-int decode_goto(int id);
-int decode_fill(int id);
-int decode_pointer(int id);
-int decode_exesub(int id);
-int decode_runcmds(int id);
-int decode_options(int id);
+int encodeScript(lsb_context* ctx, FILE* infile, FILE* outfile);
+int decode_goto(lsb_context* ctx, int id);
+int decode_fill(lsb_context* ctx, int id);
+int decode_pointer(lsb_context* ctx, int id);
+int decode_exesub(lsb_context* ctx, int id);
+int decode_runcmds(lsb_context* ctx, int id);
+int decode_options(lsb_context* ctx, int id);
 
 
 
@@ -39,10 +35,10 @@ int decode_options(int id);
 /* Inputs:  Pointers to input/output files.                                  */
 /* Outputs: 0 on Pass, -1 on Fail.                                           */
 /*****************************************************************************/
-int encodeScript(FILE* infile, FILE* outfile){
+int encodeScript(lsb_context* ctx, FILE* infile, FILE* outfile){
 
-    int rval, output_endian_type;
-    unsigned int fsize, max_size_bytes;
+    int rval, output_endian_type, radix_type;
+    unsigned int fsize, max_size_bytes, ptrEntries, ptrEntrySize;
     unsigned char* pBuffer = NULL;
 
     /* Determine Input File Size */
@@ -56,21 +52,26 @@ int encodeScript(FILE* infile, FILE* outfile){
         return -1;
     }
 
-    /* Read the entire file into memory */
-    pBuffer = (unsigned char*)malloc(fsize);
+    /* Read the entire file into memory, the context owns it as the */
+    /* tokens point into it.  It is freed by releaseContext.        */
+    pBuffer = (unsigned char*)malloc(fsize + 1);
     if (pBuffer == NULL){
         printf("Error allocating to put input file in memory.\n");
         return -1;
     }
+    if (ctx->pScriptBuf != NULL)
+        free(ctx->pScriptBuf);
+    ctx->pScriptBuf = pBuffer;
     if (fread(pBuffer, 1, fsize, infile) != fsize){
         printf("Error, reading file into memory\n");
     }
+    pBuffer[fsize] = '\0';
 
     /****************************************************/
     /* Parse the input file to create the binary output */
     /****************************************************/
-    pInput = (unsigned char*)strtok((char *)pBuffer, "() \t=\r\n");
-    if ((pInput == NULL) || (strcmp((char *)pInput, "start") != 0)) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, (char *)pBuffer, "() \t=\r\n");
+    if ((ctx->pInput == NULL) || (strcmp((char *)ctx->pInput, "start") != 0)) {
         printf("Error, start not found\n");
         return -1;
     }
@@ -80,18 +81,18 @@ int encodeScript(FILE* infile, FILE* outfile){
     /*********/
 
     /* start - endian (big or little) */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((char *)pInput, "endian") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((char *)ctx->pInput, "endian") != 0) {
         printf("Error, start endian not found\n");
         return -1;
     }
 
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((char *)pInput, "big") == 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((char *)ctx->pInput, "big") == 0) {
         output_endian_type = LUNAR_BIG_ENDIAN;
         printf("Setting Big Endian.\n");
     }
-    else if (strcmp((char *)pInput, "little") == 0){
+    else if (strcmp((char *)ctx->pInput, "little") == 0){
         output_endian_type = LUNAR_LITTLE_ENDIAN;
         printf("Setting Little Endian.\n");
     }
@@ -99,20 +100,20 @@ int encodeScript(FILE* infile, FILE* outfile){
         printf("Invalid Endian.\n");
         return -1;
     }
-    setBinOutputMode(output_endian_type);
+    setBinOutputMode(ctx, output_endian_type);
 
     /* start - radix (hex or decimal) */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((char *)pInput, "radix") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((char *)ctx->pInput, "radix") != 0) {
         printf("Error, start radix not found\n");
         return -1;
     }
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((char *)pInput, "hex") == 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((char *)ctx->pInput, "hex") == 0) {
         radix_type = RADIX_HEX;
         printf("Setting Radix to HEX.\n");
     }
-    else if(strcmp((char *)pInput, "dec") == 0) {
+    else if(strcmp((char *)ctx->pInput, "dec") == 0) {
         radix_type = RADIX_DEC;
         printf("Setting Radix to DEC.\n");
     }
@@ -120,72 +121,94 @@ int encodeScript(FILE* infile, FILE* outfile){
         printf("Unknown Radix.\n");
         return -1;
     }
-    setMetaScriptInputMode(radix_type);
+    setMetaScriptInputMode(ctx, radix_type);
 
     /* start - max_size_bytes */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((char *)pInput, "max_size_bytes") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((char *)ctx->pInput, "max_size_bytes") != 0) {
         printf("Error, max_size_bytes not found\n");
         return -1;
     }
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (readLW(pInput, &max_size_bytes) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (readLW(ctx, ctx->pInput, &max_size_bytes) < 0){
         printf("Error invalid max_size_bytes\n");
         return -1;
     }
 
     /* Default to sega saturn limitation if not set */
     if (max_size_bytes == 0)
-        max_size_bytes = 0x10000;
-    setBinMaxSize(max_size_bytes);
+        max_size_bytes = DEFAULT_MAX_BIN_SIZE;
+    setBinMaxSize(ctx, max_size_bytes);
+
+    /* start - optional pointer table layout */
+    ptrEntries = DEFAULT_PTR_ENTRIES;
+    ptrEntrySize = DEFAULT_PTR_ENTRY_SIZE;
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if ((ctx->pInput != NULL) && (strcmp((char *)ctx->pInput, "ptr_table_entries") == 0)) {
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+        if (readLW(ctx, ctx->pInput, &ptrEntries) < 0){
+            printf("Error invalid ptr_table_entries\n");
+            return -1;
+        }
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    }
+    if ((ctx->pInput != NULL) && (strcmp((char *)ctx->pInput, "ptr_entry_size") == 0)) {
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+        if (readLW(ctx, ctx->pInput, &ptrEntrySize) < 0){
+            printf("Error invalid ptr_entry_size\n");
+            return -1;
+        }
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    }
+    if (setPtrTableLayout(ctx, ptrEntries, ptrEntrySize) < 0)
+        return -1;
 
 
     /************************************************************/
     /* Parse the rest of the file until EOF or "end" is located */
     /************************************************************/
     rval = 0;
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    while ((pInput != NULL) && rval == 0){
+    while ((ctx->pInput != NULL) && rval == 0){
         int id;
 
         /* goto */
-        if (strcmp((char *)pInput, "goto") == 0){
-            id = read_ID(pInput);
-            rval = decode_goto(id);
+        if (strcmp((char *)ctx->pInput, "goto") == 0){
+            id = read_ID(ctx, ctx->pInput);
+            rval = decode_goto(ctx, id);
         }
 
         /* fill-space */
-        else if (strcmp((char *)pInput, "fill-space") == 0){
-            id = read_ID(pInput);
-            rval = decode_fill(id);
+        else if (strcmp((char *)ctx->pInput, "fill-space") == 0){
+            id = read_ID(ctx, ctx->pInput);
+            rval = decode_fill(ctx, id);
         }
 
         /* pointer */
-        else if (strcmp((char *)pInput, "pointer") == 0){
-            id = read_ID(pInput);
-            rval = decode_pointer(id);
+        else if (strcmp((char *)ctx->pInput, "pointer") == 0){
+            id = read_ID(ctx, ctx->pInput);
+            rval = decode_pointer(ctx, id);
         }
 
         /* execute-subroutine */
-        else if (strcmp((char *)pInput, "execute-subroutine") == 0){
-            id = read_ID(pInput);
-            rval = decode_exesub(id);
+        else if (strcmp((char *)ctx->pInput, "execute-subroutine") == 0){
+            id = read_ID(ctx, ctx->pInput);
+            rval = decode_exesub(ctx, id);
         }
 
         /* run-commands */
-        else if (strcmp((char *)pInput, "run-commands") == 0){
-            id = read_ID(pInput);
-            rval = decode_runcmds(id);
+        else if (strcmp((char *)ctx->pInput, "run-commands") == 0){
+            id = read_ID(ctx, ctx->pInput);
+            rval = decode_runcmds(ctx, id);
         }
 
         /* options */
-        else if (strcmp((char *)pInput, "options") == 0){
-            id = read_ID(pInput);
-            rval = decode_options(id);
+        else if (strcmp((char *)ctx->pInput, "options") == 0){
+            id = read_ID(ctx, ctx->pInput);
+            rval = decode_options(ctx, id);
         }
 
         /* end */
-        else if (strcmp((char *)pInput, "end") == 0){
+        else if (strcmp((char *)ctx->pInput, "end") == 0){
             printf("Detected END\n");
             break;
         }
@@ -199,7 +222,7 @@ int encodeScript(FILE* infile, FILE* outfile){
             return rval;
 
         /* Read Next Token */
-        pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
     }
 
     return 0;
@@ -209,35 +232,31 @@ int encodeScript(FILE* infile, FILE* outfile){
 /******************************/
 /* goto                       */
 /******************************/
-int decode_goto(int id){
+int decode_goto(lsb_context* ctx, int id){
 
     unsigned int offset;
     scriptNode* newNode = NULL;
 
     /* read location */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((char *)pInput, "location") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((char *)ctx->pInput, "location") != 0) {
         printf("Error, location expected\n");
         return -1;
     }
 
     /* read offset */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (readLW(pInput, &offset) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (readLW(ctx, ctx->pInput, &offset) < 0){
         printf("Error invalid goto offset\n");
         return -1;
     }
 
-    /* Create a script node */
-    createScriptNode(&newNode);
-    newNode->nodeType = NODE_GOTO;
-    newNode->id = id;
+    /* Add a script node to the list */
+    newNode = appendScriptNode(ctx, id, NODE_GOTO, 0);
+    if (newNode == NULL)
+        return -1;
     newNode->byteOffset = offset;
 
-    /* Add the script node to the list */
-    addNode(newNode, METHOD_NORMAL,0);
-    free(newNode);
-
     return 0;
 }
 
@@ -245,7 +264,7 @@ int decode_goto(int id){
 /******************************/
 /* fill                       */
 /******************************/
-int decode_fill(int id){
+int decode_fill(lsb_context* ctx, int id){
 
     scriptNode* newNode;
     unsigned int unitSize = 0;
@@ -253,53 +272,49 @@ int decode_fill(int id){
     unsigned int fillValue = 0;
 
     /* read unit-size */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((char *)pInput, "unit-size") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((char *)ctx->pInput, "unit-size") != 0) {
         printf("Error, unit-size expected\n");
         return -1;
     }
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (readLW(pInput, &unitSize) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (readLW(ctx, ctx->pInput, &unitSize) < 0){
         printf("Error invalid goto offset\n");
         return -1;
     }
 
     /* read fill-value */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((char *)pInput, "fill-value") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((char *)ctx->pInput, "fill-value") != 0) {
         printf("Error, fill-value expected\n");
         return -1;
     }
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (readLW(pInput, &fillValue) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (readLW(ctx, ctx->pInput, &fillValue) < 0){
         printf("Error invalid unit size\n");
         return -1;
     }
 
     /* read unit-count */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((char *)pInput, "unit-count") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((char *)ctx->pInput, "unit-count") != 0) {
         printf("Error, unit-count expected\n");
         return -1;
     }
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (readLW(pInput, &unitCount) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (readLW(ctx, ctx->pInput, &unitCount) < 0){
         printf("Error invalid unit count\n");
         return -1;
     }
 
-    /* Create a script node */
-    createScriptNode(&newNode);
-    newNode->nodeType = NODE_FILL_SPACE;
-    newNode->id = id;
+    /* Add a script node to the list */
+    newNode = appendScriptNode(ctx, id, NODE_FILL_SPACE, 0);
+    if (newNode == NULL)
+        return -1;
     newNode->unit_size = unitSize;
     newNode->fillVal = fillValue;
     newNode->unit_count = unitCount;
 
-    /* Add the script node to the list */
-    addNode(newNode, METHOD_NORMAL,0);
-    free(newNode);
-
     return 0;
 }
 
@@ -307,7 +322,7 @@ int decode_fill(int id){
 /******************************/
 /* pointer                    */
 /******************************/
-int decode_pointer(int id){
+int decode_pointer(lsb_context* ctx, int id){
 
     scriptNode* newNode;
     unsigned int byteOffset;
@@ -317,42 +332,42 @@ int decode_pointer(int id){
     unsigned int value_selected = 0;
 
     /* read byteoffset */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((char *)pInput, "byteoffset") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((char *)ctx->pInput, "byteoffset") != 0) {
         printf("Error, byteoffset expected\n");
         return -1;
     }
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (readLW(pInput, &byteOffset) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (readLW(ctx, ctx->pInput, &byteOffset) < 0){
         printf("Error invalid pointer byte offset\n");
         return -1;
     }
 
     /* read size of pointer */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((char *)pInput, "size") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((char *)ctx->pInput, "size") != 0) {
         printf("Error, size expected\n");
         return -1;
     }
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (readLW(pInput, &dataSize) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (readLW(ctx, ctx->pInput, &dataSize) < 0){
         printf("Error invalid pointer data size\n");
         return -1;
     }
 
     /* read value or id to point to */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((char *)pInput, "value") == 0) {
-        pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-        if (readLW(pInput, &value) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((char *)ctx->pInput, "value") == 0) {
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+        if (readLW(ctx, ctx->pInput, &value) < 0){
             printf("Error invalid value\n");
             return -1;
         }
         value_selected = 1;
     }
-    else if (strcmp((char *)pInput, "id-link") == 0) {
-        pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-        if (readLW(pInput, &id_link) < 0){
+    else if (strcmp((char *)ctx->pInput, "id-link") == 0) {
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+        if (readLW(ctx, ctx->pInput, &id_link) < 0){
             printf("Error invalid id\n");
             return -1;
         }
@@ -364,10 +379,10 @@ int decode_pointer(int id){
     }
 
 
-    /* Create a script node */
-    createScriptNode(&newNode);
-    newNode->nodeType = NODE_POINTER;
-    newNode->id = id;
+    /* Add a script node to the list */
+    newNode = appendScriptNode(ctx, id, NODE_POINTER, 0);
+    if (newNode == NULL)
+        return -1;
     newNode->byteOffset = byteOffset;
     newNode->ptrSize = dataSize;
     newNode->ptrValueFlag = value_selected;
@@ -378,10 +393,6 @@ int decode_pointer(int id){
         newNode->ptrID = id_link;
     }
 
-    /* Add the script node to the list */
-    addNode(newNode, METHOD_NORMAL,0);
-    free(newNode);
-
     return 0;
 }
 
@@ -389,7 +400,7 @@ int decode_pointer(int id){
 /******************************/
 /* execute-subroutine         */
 /******************************/
-int decode_exesub(int id){
+int decode_exesub(lsb_context* ctx, int id){
     
     scriptNode* newNode;
     int x, skip_add;
@@ -400,46 +411,75 @@ int decode_exesub(int id){
 	skip_add = 0;
 
     /* Read subroutine value */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((char *)pInput, "subroutine") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((char *)ctx->pInput, "subroutine") != 0) {
         printf("Error, subroutine expected\n");
         return -1;
     }
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (readSW(pInput, &subrtn_code) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (readSW(ctx, ctx->pInput, &subrtn_code) < 0){
         printf("Error invalid subroutine code\n");
         return -1;
     }
 
     /* read num-parameters */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((char *)pInput, "num-parameters") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((char *)ctx->pInput, "num-parameters") != 0) {
         printf("Error, num-parameters expected\n");
         return -1;
     }
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (readLW(pInput, &numparam) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (readLW(ctx, ctx->pInput, &numparam) < 0){
         printf("Error invalid number of parameters\n");
 
         return -1;
     }
 
+	/* If encoding to ENG Saturn SSS or SSSC, ignore iOS CMDs */
+	/* If encoding to ENG Saturn SSS, also ignore SSSC CMDs   */
+	skip_add = 0;
+	if ((getTableOutputMode(ctx) == ONE_BYTE_ENC) && 
+		((subrtn_code == 0x005E) || (subrtn_code == 0x005F) ||
+		(subrtn_code == 0x0060) || (subrtn_code == 0xFF00) ||
+		(subrtn_code == 0xFF03) || (subrtn_code == 0xFFFF)) )
+	{
+		skip_add = 1;
+	}
+	if (((getTableOutputMode(ctx) == ONE_BYTE_ENC) && getSSSEncode(ctx)) &&
+		(subrtn_code == 0x005D))
+	{
+		skip_add = 2;
+	}
+
+    /* Add a script node to the list, parameters are read into it */
+    newNode = NULL;
+    if (!skip_add){
+        newNode = appendScriptNode(ctx, id, NODE_EXE_SUB, 0);
+        if (newNode == NULL)
+            return -1;
+        newNode->subroutine_code = subrtn_code;
+        newNode->num_parameters = numparam;
+    }
+
     if (numparam > 0){
 
         /* read align-fill-byteval */
-        pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-        if (strcmp((char *)pInput, "align-fill-byteval") != 0) {
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+        if (strcmp((char *)ctx->pInput, "align-fill-byteval") != 0) {
             printf("Error, align-fill-byteval expected\n");
             return -1;
         }
-        pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-        if (readBYTE(pInput, &fillVal) < 0){
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+        if (readBYTE(ctx, ctx->pInput, &fillVal) < 0){
             printf("Error invalid alignment byte fill value\n");
             return -1;
         }
 
         /* Allocate memory for parameters */
-        params = (paramType*)malloc(numparam * sizeof(paramType));
+        if (newNode != NULL)
+            params = allocNodeParams(ctx, newNode, numparam);
+        else
+            params = (paramType*)allocNodeMem(ctx, numparam * sizeof(paramType));
         if (params == NULL){
             printf("Error allocing memory for parameters\n");
             return -1;
@@ -450,24 +490,24 @@ int decode_exesub(int id){
         /**********************/
 
         /* Parameter Type Information */
-        pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-        if (strcmp((char *)pInput, "parameter-types") != 0) {
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+        if (strcmp((char *)ctx->pInput, "parameter-types") != 0) {
             printf("Error, parameter-types expected\n");
             return -1;
         }
         for (x = 0; x < (int)numparam; x++){
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-            if (strcmp((char *)pInput, "1") == 0)
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+            if (strcmp((char *)ctx->pInput, "1") == 0)
                 params[x].type = BYTE_PARAM;
-            else if (strcmp((char *)pInput, "2") == 0)
+            else if (strcmp((char *)ctx->pInput, "2") == 0)
                 params[x].type = SHORT_PARAM;
-            else if (strcmp((char *)pInput, "4") == 0)
+            else if (strcmp((char *)ctx->pInput, "4") == 0)
                 params[x].type = LONG_PARAM;
-            else if (strcmp((char *)pInput, "align-2") == 0)
+            else if (strcmp((char *)ctx->pInput, "align-2") == 0)
                 params[x].type = ALIGN_2_PARAM;
-            else if (strcmp((char *)pInput, "align-4") == 0)
+            else if (strcmp((char *)ctx->pInput, "align-4") == 0)
                 params[x].type = ALIGN_4_PARAM;
-			else if (strcmp((char *)pInput, "subtitle") == 0)
+			else if (strcmp((char *)ctx->pInput, "subtitle") == 0)
 				params[x].type = SUBT_STR;
             else{
                 printf("Error invalid parameter type read\n");
@@ -476,8 +516,8 @@ int decode_exesub(int id){
         }
 
         /* Parameter Values */
-        pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-        if (strcmp((char *)pInput, "parameter-values") != 0) {
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+        if (strcmp((char *)ctx->pInput, "parameter-values") != 0) {
             printf("Error, parameter-values expected\n");
             return -1;
         }
@@ -485,51 +525,27 @@ int decode_exesub(int id){
 			if ((params[x].type == ALIGN_2_PARAM) || (params[x].type == ALIGN_4_PARAM) || (params[x].type == SUBT_STR))
                 continue;
 
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-            if (readLW(pInput, &params[x].value) < 0){
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+            if (readLW(ctx, ctx->pInput, &params[x].value) < 0){
                 printf("Error invalid parameter value\n");
                 return -1;
             }
         }
     }
 
-    /* Create a script node */
-    createScriptNode(&newNode);
-    newNode->nodeType = NODE_EXE_SUB;
-    newNode->id = id;
-    newNode->subroutine_code = subrtn_code;
-    newNode->num_parameters = numparam;
+	if (skip_add == 1){
+		printf("\tSkipping iOS subroutine code 0x%X\n", subrtn_code);
+		return 0;
+	}
+	if (skip_add == 2){
+		printf("\tSkipping SSSC subroutine code 0x%X\n", subrtn_code);
+		return 0;
+	}
+
     if (numparam > 0){
         newNode->alignfillVal = fillVal;
         newNode->subParams = params;
     }
-    else{
-        newNode->subParams = NULL;
-    }
-    newNode->runParams = NULL;
-
-    /* Add the script node to the list */
-	/* If encoding to ENG Saturn SSS or SSSC, ignore iOS CMDs */
-	/* If encoding to ENG Saturn SSS, also ignore SSSC CMDs   */
-	skip_add = 0;
-	if ((getTableOutputMode() == ONE_BYTE_ENC) && 
-		((newNode->subroutine_code == 0x005E) || (newNode->subroutine_code == 0x005F) ||
-		(newNode->subroutine_code == 0x0060) || (newNode->subroutine_code == 0xFF00) ||
-		(newNode->subroutine_code == 0xFF03) || (newNode->subroutine_code == 0xFFFF)) )
-	{
-		skip_add = 1;
-		printf("\tSkipping iOS subroutine code 0x%X\n", newNode->subroutine_code);
-	}
-	if (((getTableOutputMode() == ONE_BYTE_ENC) && getSSSEncode()) &&
-		(newNode->subroutine_code == 0x005D))
-	{
-		skip_add = 1;
-		printf("\tSkipping SSSC subroutine code 0x%X\n", newNode->subroutine_code);
-	}
-
-	if (!skip_add)
-		addNode(newNode, METHOD_NORMAL, 0);
-    free(newNode);
 
     return 0;
 }
@@ -538,58 +554,48 @@ int decode_exesub(int id){
 /******************************/
 /* run-commands               */
 /******************************/
-int decode_runcmds(int id){
+int decode_runcmds(lsb_context* ctx, int id){
 
     scriptNode* newNode = NULL;
     runParamType* rpNode = NULL;
-    runParamType* rpHead = NULL;
-    runParamType* pPrev = NULL;
+    runParamType* rpCmds;
     int len = 0;
 
     /* read series of commands until the end of them is reached */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    while (strcmp((char *)pInput, "commands-end") != 0) {
+    beginRunParams(ctx);
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    while (strcmp((char *)ctx->pInput, "commands-end") != 0) {
 
         /* Create a runcmds parameter */
-        rpNode = (runParamType*)malloc(sizeof(runParamType));
+        rpNode = addRunParam(ctx);
         if(rpNode == NULL){
             printf("Error allocing space for run parameter struct.\n");
             return -1;
         }
-        rpNode->str = NULL;
-        rpNode->pNext = NULL;
-
-        /* Book keeping */
-        if(rpHead == NULL)
-            rpHead = rpNode;
-        if(pPrev != NULL){
-            pPrev->pNext = rpNode;
-        }
 
         /* print-line */
-        if (strcmp((char *)pInput, "print-line") == 0){
+        if (strcmp((char *)ctx->pInput, "print-line") == 0){
             unsigned char* pText;
 
             /* Get Text String (UTF-8) */
-            pInput = (unsigned char*)strtok(NULL, "`"); // Used quotes before, which led to a BUG if there is a quote in the middle of a sentence.
-            if (pInput == NULL){                        // Changed to use ` as a delimiter (because who uses those things)...
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "`"); // Used quotes before, which led to a BUG if there is a quote in the middle of a sentence.
+            if (ctx->pInput == NULL){                        // Changed to use ` as a delimiter (because who uses those things)...
                 printf("Error, bad text input.\n");
                 return -1;
             }
-            pText = pInput;
+            pText = ctx->pInput;
             len = strlen((char *)pText);
 
             rpNode->type = PRINT_LINE;
-            rpNode->str = malloc(len+1);
-            memset(rpNode->str,0,len+1);
-            memcpy(rpNode->str,pText,len);
+            if (poolIntern(&ctx->strings, (char *)pText, len, &rpNode->str) != 0)
+                return -1;
         }
         
         /* show-portrait-left */
-        else if (strcmp((char *)pInput, "show-portrait-left") == 0){
+        else if (strcmp((char *)ctx->pInput, "show-portrait-left") == 0){
             unsigned char portraitCode;
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-            if (readBYTE(pInput, &portraitCode) < 0){
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+            if (readBYTE(ctx, ctx->pInput, &portraitCode) < 0){
                 printf("Error invalid portrait code.\n");
                 return -1;
             }
@@ -600,10 +606,10 @@ int decode_runcmds(int id){
         }
 
         /* show-portrait-right */
-        else if (strcmp((char *)pInput, "show-portrait-right") == 0){
+        else if (strcmp((char *)ctx->pInput, "show-portrait-right") == 0){
             unsigned char portraitCode;
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-            if (readBYTE(pInput, &portraitCode) < 0){
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+            if (readBYTE(ctx, ctx->pInput, &portraitCode) < 0){
                 printf("Error invalid portrait code.\n");
                 return -1;
             }
@@ -614,10 +620,10 @@ int decode_runcmds(int id){
         }
 
         /* time-delay */
-        else if (strcmp((char *)pInput, "time-delay") == 0){
+        else if (strcmp((char *)ctx->pInput, "time-delay") == 0){
             unsigned char timedelay;
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-            if (readBYTE(pInput, &timedelay) < 0){
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+            if (readBYTE(ctx, ctx->pInput, &timedelay) < 0){
                 printf("Error invalid time delay.\n");
                 return -1;
             }
@@ -628,10 +634,10 @@ int decode_runcmds(int id){
         }
 
         /* control-code */
-        else if (strcmp((char *)pInput, "control-code") == 0){
+        else if (strcmp((char *)ctx->pInput, "control-code") == 0){
             unsigned short ctrlCode;
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-            if (readSW(pInput, &ctrlCode) < 0){
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+            if (readSW(ctx, ctx->pInput, &ctrlCode) < 0){
                 printf("Error invalid control code.\n");
                 return -1;
             }
@@ -642,10 +648,10 @@ int decode_runcmds(int id){
         }
 
         /* align-2 */
-        else if (strcmp((char *)pInput, "align-2") == 0){
+        else if (strcmp((char *)ctx->pInput, "align-2") == 0){
             unsigned char fillVal;
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-            if (readBYTE(pInput, &fillVal) < 0){
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+            if (readBYTE(ctx, ctx->pInput, &fillVal) < 0){
                 printf("Error invalid fill value.\n");
                 return -1;
             }
@@ -656,10 +662,10 @@ int decode_runcmds(int id){
         }
         
         /* align-4 */
-        else if (strcmp((char *)pInput, "align-4") == 0){
+        else if (strcmp((char *)ctx->pInput, "align-4") == 0){
             unsigned char fillVal;
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-            if (readBYTE(pInput, &fillVal) < 0){
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+            if (readBYTE(ctx, ctx->pInput, &fillVal) < 0){
                 printf("Error invalid fill value.\n");
                 return -1;
             }
@@ -671,27 +677,24 @@ int decode_runcmds(int id){
 
         /* Unknown */
         else{
-            printf("Error unknown command %s detected in run-commands\n",pInput);
+            printf("Error unknown command %s detected in run-commands\n",ctx->pInput);
             return -1;
         }
 
-        pPrev = rpNode;
-
         /* Read next token */
-        pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
     }
 
-    /* Create a script node */
-    createScriptNode(&newNode);
-    newNode->nodeType = NODE_RUN_CMDS;
-    newNode->id = id;
-    newNode->subroutine_code = 0x0002;
-    newNode->runParams = rpHead;
-    newNode->subParams = NULL;
+    rpCmds = finishRunParams(ctx);
+    if (rpCmds == NULL)
+        return -1;
 
-    /* Add the script node to the list */
-    addNode(newNode, METHOD_NORMAL,0);
-    free(newNode);
+    /* Add a script node to the list */
+    newNode = appendScriptNode(ctx, id, NODE_RUN_CMDS, 0);
+    if (newNode == NULL)
+        return -1;
+    newNode->subroutine_code = 0x0002;
+    newNode->runParams = rpCmds;
 
     return 0;
 }
@@ -702,51 +705,51 @@ int decode_runcmds(int id){
 /*************************/
 /* options               */
 /*************************/
-int decode_options(int id){
+int decode_options(lsb_context* ctx, int id){
 
     int x;
     scriptNode* node = NULL;
     unsigned short jmpParam, param2;
     paramType* params = NULL;
     runParamType* rpNode;
-    runParamType* rpHead = NULL;
-    runParamType* rpHead1 = NULL;
-    runParamType* pPrev = NULL;
+    runParamType* rpOpt[2];
     int len = 0;
 
-    /* Create a script node */
-    createScriptNode(&node);
-
     /***********************************************/
     /* Read in the two fixed subroutine parameters */
     /***********************************************/
 
     /* JMP Offset */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((char *)pInput, "jmpparam") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((char *)ctx->pInput, "jmpparam") != 0) {
         printf("Error, jmpparam expected\n");
         return -1;
     }
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (readSW(pInput, &jmpParam) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (readSW(ctx, ctx->pInput, &jmpParam) < 0){
         printf("Error invalid subroutine code\n");
         return -1;
     }
 
     /* 2nd Parameter */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((char *)pInput, "param2") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((char *)ctx->pInput, "param2") != 0) {
         printf("Error, param2 expected\n");
         return -1;
     }
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (readSW(pInput, &param2) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (readSW(ctx, ctx->pInput, &param2) < 0){
         printf("Error invalid subroutine code\n");
         return -1;
     }
 
+    /* Add a script node to the list */
+    node = appendScriptNode(ctx, id, NODE_OPTIONS, 0);
+    if (node == NULL)
+        return -1;
+
     /* Allocate Subroutine Parameters and copy */
-    params = (paramType*)malloc(2 * sizeof(paramType));
+    params = allocNodeParams(ctx, node, 2);
     if (params == NULL){
         printf("Error allocing memory for parameters\n");
         return -1;
@@ -760,65 +763,53 @@ int decode_options(int id){
     for (x = 0; x < 2; x++){
 
         if (x == 0){
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-            if (strcmp((char *)pInput, "opt1") != 0) {
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+            if (strcmp((char *)ctx->pInput, "opt1") != 0) {
                 printf("Error, opt1 expected\n");
                 return -1;
             }
         }
         else{
-            rpHead1 = rpHead;
-            rpHead = NULL;
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-            if (strcmp((char *)pInput, "opt2") != 0) {
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+            if (strcmp((char *)ctx->pInput, "opt2") != 0) {
                 printf("Error, opt2 expected\n");
                 return -1;
             }
         }
-        pPrev = NULL;
-        pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-        while (strcmp((char *)pInput, "opt-end") != 0) {
+        beginRunParams(ctx);
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+        while (strcmp((char *)ctx->pInput, "opt-end") != 0) {
 
             /* Create a runcmds parameter */
-            rpNode = (runParamType*)malloc(sizeof(runParamType));
+            rpNode = addRunParam(ctx);
             if (rpNode == NULL){
                 printf("Error allocing space for run parameter struct.\n");
                 return -1;
             }
-            rpNode->str = NULL;
-            rpNode->pNext = NULL;
-
-            /* Book keeping */
-            if (rpHead == NULL)
-                rpHead = rpNode;
-            if (pPrev != NULL){
-                pPrev->pNext = rpNode;
-            }
 
             /* print-line */
-            if (strcmp((char *)pInput, "print-line") == 0){
+            if (strcmp((char *)ctx->pInput, "print-line") == 0){
                 unsigned char* pText;
 
                 /* Get Text String (UTF-8) */
-				pInput = (unsigned char*)strtok(NULL, "`"); // Used quotes before, which led to a BUG if there is a quote in the middle of a sentence.
-				if (pInput == NULL){                        // Changed to use ` as a delimiter (because who uses those things)...
+				ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "`"); // Used quotes before, which led to a BUG if there is a quote in the middle of a sentence.
+				if (ctx->pInput == NULL){                        // Changed to use ` as a delimiter (because who uses those things)...
                     printf("Error, bad text input.\n");
                     return -1;
                 }
-                pText = pInput;
+                pText = ctx->pInput;
                 len = strlen((char *)pText);
 
                 rpNode->type = PRINT_LINE;
-                rpNode->str = malloc(len + 1);
-                memset(rpNode->str, 0, len + 1);
-                memcpy(rpNode->str, pText, len);
+                if (poolIntern(&ctx->strings, (char *)pText, len, &rpNode->str) != 0)
+                    return -1;
             }
 
             /* control-code */
-            else if (strcmp((char *)pInput, "control-code") == 0){
+            else if (strcmp((char *)ctx->pInput, "control-code") == 0){
                 unsigned short ctrlCode;
-                pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-                if (readSW(pInput, &ctrlCode) < 0){
+                ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+                if (readSW(ctx, ctx->pInput, &ctrlCode) < 0){
                     printf("Error invalid control code.\n");
                     return -1;
                 }
@@ -829,10 +820,10 @@ int decode_options(int id){
             }
 
             /* align-2 */
-            else if (strcmp((char *)pInput, "align-2") == 0){
+            else if (strcmp((char *)ctx->pInput, "align-2") == 0){
                 unsigned char fillVal;
-                pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-                if (readBYTE(pInput, &fillVal) < 0){
+                ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+                if (readBYTE(ctx, ctx->pInput, &fillVal) < 0){
                     printf("Error invalid fill value.\n");
                     return -1;
                 }
@@ -843,10 +834,10 @@ int decode_options(int id){
             }
 
             /* align-4 */
-            else if (strcmp((char *)pInput, "align-4") == 0){
+            else if (strcmp((char *)ctx->pInput, "align-4") == 0){
                 unsigned char fillVal;
-                pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-                if (readBYTE(pInput, &fillVal) < 0){
+                ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+                if (readBYTE(ctx, ctx->pInput, &fillVal) < 0){
                     printf("Error invalid fill value.\n");
                     return -1;
                 }
@@ -858,30 +849,25 @@ int decode_options(int id){
 
             /* Unknown */
             else{
-                printf("Error unknown command %s detected in run-commands\n", pInput);
+                printf("Error unknown command %s detected in run-commands\n", ctx->pInput);
                 return -1;
             }
 
-            pPrev = rpNode;
-
             /* Read next token */
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
         }
+        rpOpt[x] = finishRunParams(ctx);
+        if (rpOpt[x] == NULL)
+            return -1;
     }
 
-    /* Create a script node */
-    node->nodeType = NODE_OPTIONS;
-    node->id = id;
+    /* Fill in the script node */
     node->subroutine_code = 0x0007;
     node->alignfillVal = 0xFF;
     node->num_parameters = 2;
-    node->runParams = rpHead1;
-    node->runParams2 = rpHead;
+    node->runParams = rpOpt[0];
+    node->runParams2 = rpOpt[1];
     node->subParams = params;
 
-    /* Add the script node to the list */
-    addNode(node, METHOD_NORMAL, 0);
-    free(node);
-
     return 0;
 }
@@ -2,8 +2,9 @@
 #define PARSE_SCRIPT_H
 
 #include <stdio.h>
+#include "lsb_context.h"
 
-int encodeScript(FILE* inFile, FILE* outFile);
+int encodeScript(lsb_context* ctx, FILE* inFile, FILE* outFile);
 
 
 #endif
\ No newline at end of file
@@ -12,20 +12,30 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "psx_decode.h"
 
 /* Defines */
-#define psxBufferSize (10*1024) //Should be Overkill
 
 /* Function Prototypes */
 int loadPSXStringTable(char* inFname);
 int releasePSXStringTable();
 int getPSXComprStr(int compressionIndex, char* target, int* tlen);
-int convertPSXText(char* strIn, char** strOut, int len, int* lenOut);
+int convertPSXText(lsb_context* ctx, char* strIn, char** strOut, int len, int* lenOut);
 
 
-static unsigned char tmpPsxBuf[psxBufferSize];
+/* Location of a string within the table file */
+typedef struct psxTableEntry{
+	unsigned int offset;
+	unsigned int length;
+}psxTableEntry;
+
+/* String table, loaded once and shared read only by all contexts.  */
+/* The file is kept as read, each entry indexes its NULL-terminated  */
+/* string in it.                                                     */
 static int G_NumPSXTableEntries = 0;
-static char** pPSXTableEntries = NULL;
+static unsigned int G_MaxPSXEntryLen = 0;
+static unsigned char* pPSXTableData = NULL;
+static psxTableEntry* pPSXTableEntries = NULL;
 
 
 /******************************************************************************/
@@ -36,54 +46,72 @@ static char** pPSXTableEntries = NULL;
 int loadPSXStringTable(char* inFname){
 
 	FILE* infile;
+	long fsize;
+	unsigned int numBytes, start, x;
 	int entryIndex;
-	int x = 0;
+
 	infile = fopen(inFname, "rb");
 	if (infile == NULL){
 		printf("Error opening %s\n", inFname);
 		return -1;
 	}
 
-	/* Part 1, count # entries */
-	while (1){
-		fread(tmpPsxBuf, 1, 1, infile);
-		if (feof(infile))
-			break;
+	/* Part 1, read the whole file */
+	if ((fseek(infile, 0, SEEK_END) != 0) || ((fsize = ftell(infile)) < 0) ||
+		(fseek(infile, 0, SEEK_SET) != 0)){
+		printf("Error reading %s\n", inFname);
+		fclose(infile);
+		return -1;
+	}
+	numBytes = (unsigned int)fsize;
+	pPSXTableData = (unsigned char*)malloc(numBytes + 1);
+	if (pPSXTableData == NULL){
+		printf("Error allocating memory for table entries.\n");
+		fclose(infile);
+		return -1;
+	}
+	if (fread(pPSXTableData, 1, numBytes, infile) != numBytes){
+		printf("Error reading %s\n", inFname);
+		fclose(infile);
+		releasePSXStringTable();
+		return -1;
+	}
+	fclose(infile);
 
-		if (*tmpPsxBuf == 0x00)
+	/* Part 2, count # entries, bytes after the last NULL are not one */
+	G_NumPSXTableEntries = 0;
+	for (x = 0; x < numBytes; x++){
+		if (pPSXTableData[x] == 0x00)
 			G_NumPSXTableEntries++;
 	}
 
-	/* Part 2, Allocate Space and add entries */
-	fseek(infile, 0, SEEK_SET);
-	entryIndex = 0;
-
-	pPSXTableEntries = (char**)malloc(sizeof(char*)*G_NumPSXTableEntries);
-	if (*pPSXTableEntries == NULL){
+	/* Part 3, index the entries */
+	pPSXTableEntries = (psxTableEntry*)malloc(sizeof(psxTableEntry)*(G_NumPSXTableEntries + 1));
+	if (pPSXTableEntries == NULL){
 		printf("Error allocating memory for table entries.\n");
+		releasePSXStringTable();
 		return -1;
 	}
-
-	while (1){
-		x = 0;
-		fread(&tmpPsxBuf[x], 1, 1, infile);
-		if (feof(infile))
-			break;
-
-		while (tmpPsxBuf[x] != 0x00){
-			x++;
-			fread(&tmpPsxBuf[x], 1, 1, infile);
-		}
-		pPSXTableEntries[entryIndex] = (char*)malloc(x+1);
-		if (pPSXTableEntries[entryIndex] == NULL){
-			printf("Error allocating memory for table entry.\n");
-			return -1;
-		}
-		memset(pPSXTableEntries[entryIndex], 0,x+1);
-		memcpy(pPSXTableEntries[entryIndex], tmpPsxBuf, x);
+	entryIndex = 0;
+	start = 0;
+	G_MaxPSXEntryLen = 0;
+	for (x = 0; x < numBytes; x++){
+		if (pPSXTableData[x] != 0x00)
+			continue;
+		pPSXTableEntries[entryIndex].offset = start;
+		pPSXTableEntries[entryIndex].length = x - start;
+		if (x - start > G_MaxPSXEntryLen)
+			G_MaxPSXEntryLen = x - start;
 		entryIndex++;
+		start = x + 1;
+	}
+
+	/* Decompressed text must have room for any entry */
+	if (G_MaxPSXEntryLen + 16 > psxBufferSize){
+		printf("Error, %s has an entry longer than %d bytes.\n", inFname, psxBufferSize - 16);
+		releasePSXStringTable();
+		return -1;
 	}
-	fclose(infile);
 
 	return 0;
 }
@@ -95,18 +123,16 @@ int loadPSXStringTable(char* inFname){
 /******************************************************************************/
 int releasePSXStringTable(){
 
-	int x;
-	for (x = 0; x < G_NumPSXTableEntries; x++){
-		if (pPSXTableEntries[x] != NULL){
-			free(pPSXTableEntries[x]);
-			pPSXTableEntries[x] = NULL;
-		}
-	}
 	if (pPSXTableEntries != NULL){
 		free(pPSXTableEntries);
 	}
+	if (pPSXTableData != NULL){
+		free(pPSXTableData);
+	}
 	pPSXTableEntries = NULL;
+	pPSXTableData = NULL;
 	G_NumPSXTableEntries = 0;
+	G_MaxPSXEntryLen = 0;
 
 	return 0;
 }
@@ -114,19 +140,23 @@ int releasePSXStringTable(){
 
 /******************************************************************************/
 /* getPSXComprStr - Looks up a compression string by an index value and       */
-/*                  copies the string and length of the string.               */
+/*                  copies the string (without its NULL) and its length.      */
+/*                  target must have room for the longest table entry.        */
 /* Input - Lookup index.                                                      */
 /* Returns 0 on success, -1 on failure.                                       */
 /******************************************************************************/
 int getPSXComprStr(int compressionIndex, char* target, int* tlen){
 
-	if (compressionIndex >= G_NumPSXTableEntries){
+	psxTableEntry* pEntry;
+
+	if ((compressionIndex < 0) || (compressionIndex >= G_NumPSXTableEntries)){
 		printf("Invalid index in getPSXComprStr\n");
 		return -1;
 	}
 	else{
-		strcpy(target, pPSXTableEntries[compressionIndex]);
-		*tlen = strlen(pPSXTableEntries[compressionIndex]);
+		pEntry = &pPSXTableEntries[compressionIndex];
+		memcpy(target, pPSXTableData + pEntry->offset, pEntry->length);
+		*tlen = (int)pEntry->length;
 	}
 	return 0;
 }
@@ -141,7 +171,7 @@ int getPSXComprStr(int compressionIndex, char* target, int* tlen){
 /* Input - Compressed String.                                                 */
 /* Returns 0 on success, -1 on failure.                                       */
 /******************************************************************************/
-int convertPSXText(char* strIn, char** strOut, int len, int* lenOut){
+int convertPSXText(lsb_context* ctx, char* strIn, char** strOut, int len, int* lenOut){
 
 	unsigned char* ptarget, *optr;
 	unsigned char input, inputNext;
@@ -150,13 +180,18 @@ int convertPSXText(char* strIn, char** strOut, int len, int* lenOut){
 	int out_offset = 0;
 	int enableCtrlCodes = 1;
 	*lenOut = 0;
-	ptarget = tmpPsxBuf;
-	memset(ptarget, 0, psxBufferSize);
+	ptarget = ctx->psxBuf;
 
 	/* Decode the message */
 	while (offset < len){
 
 		int tlen = 0;
+
+		/* Room for the longest step, a table entry or 6 bytes of codes */
+		if (out_offset + G_MaxPSXEntryLen + 8 > psxBufferSize){
+			printf("Error, decompressed PSX text exceeds %d bytes.\n", psxBufferSize);
+			return -1;
+		}
 		input = (unsigned char)strIn[offset];
 		inputNext = (unsigned char)strIn[offset+1];
 
@@ -282,9 +317,10 @@ int convertPSXText(char* strIn, char** strOut, int len, int* lenOut){
 		offset++;
 
 		/* End of text */
-		if (ptarget[out_offset - 1] == '$')
+		if ((out_offset > 0) && (ptarget[out_offset - 1] == '$'))
 			break;
 	}
+	ptarget[out_offset] = 0x00;  /* A trailing ctrl code reads one past */
 
 
 	/* Copy out actual decompressed string */
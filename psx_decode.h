@@ -7,11 +7,13 @@
 #ifndef PSX_DECODE_H
 #define PSX_DECODE_H
 
+#include "lsb_context.h"
+
 /* Function Prototypes */
 int loadPSXStringTable(char* inFname);
 int releasePSXStringTable();
 int getPSXComprStr(int compressionIndex, char* target, int* tlen);
-int convertPSXText(char* strIn, char** strOut, int len, int* lenOut);
+int convertPSXText(lsb_context* ctx, char* strIn, char** strOut, int len, int* lenOut);
 
 
 
@@ -0,0 +1,258 @@
+/**********************************************************************/
+/* script_cfg.c - Control flow over the script node list.  Script     */
+/*                execution starts at the nodes linked from the       */
+/*                pointer table, runs through the list and stops at a */
+/*                return or unconditional jump.  Jumps go through the */
+/*                pointer table, so every jump target is one of those */
+/*                starting nodes.  A node reached by no run can never */
+/*                execute and may be left out of the encoded binary.  */
+/**********************************************************************/
+
+
+/************/
+/* Includes */
+/************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "script_cfg.h"
+#include "snode_list.h"
+#include "util.h"
+
+
+
+/***********************/
+/* Function Prototypes */
+/***********************/
+int buildScriptCFG(lsb_context* ctx, unsigned int* pNumUnreachable);
+int pruneUnreachable(lsb_context* ctx);
+int writeCFGDump(lsb_context* ctx, FILE* outFile);
+static int isCodeNode(scriptNode* pNode);
+static int isJumpCode(unsigned int code);
+static int endsRun(unsigned int code);
+
+
+
+
+/*******************************************************************/
+/* buildScriptCFG                                                  */
+/* Sets each node's pointerID to the pointer table entry of the    */
+/* run that reaches it (INVALID_PTR_ID if none does), and each     */
+/* jump's nextPointerID to the pointer table entry it jumps to.    */
+/* A GOTO moves the script elsewhere, the node after it is treated */
+/* as reached if any earlier run fell off the end of its section.  */
+/* pNumUnreachable is set to the # of commands no run reaches.     */
+/* Returns 0 on success, -1 if some pointers hold raw values, so   */
+/* the commands they lead to are unknown.                          */
+/*******************************************************************/
+int buildScriptCFG(lsb_context* ctx, unsigned int* pNumUnreachable){
+
+    scriptNode *pNode, *pTarget;
+    unsigned int runID, liveID;
+    int rval = 0;
+
+    /* Jump arguments are pointer IDs */
+    for (pNode = getHeadPtr(ctx); pNode != NULL; pNode = getNextPtr(ctx, pNode)){
+        pNode->pointerID = INVALID_PTR_ID;
+        pNode->nextPointerID = INVALID_PTR_ID;
+        if (isCodeNode(pNode) && isJumpCode(pNode->subroutine_code) &&
+            (pNode->num_parameters > 0) && (pNode->subParams != NULL))
+            pNode->nextPointerID = pNode->subParams[0].value;
+    }
+
+    /* Runs start at the pointer targets */
+    for (pNode = getHeadPtr(ctx); pNode != NULL; pNode = getNextPtr(ctx, pNode)){
+        if (pNode->nodeType != NODE_POINTER)
+            continue;
+        if (pNode->ptrValueFlag){
+            rval = -1;
+            continue;
+        }
+        pTarget = getListItemByID(ctx, pNode->ptrID);
+        if (pTarget != NULL)
+            pTarget->pointerID = pNode->byteOffset / getPtrEntrySize(ctx);
+    }
+
+    /* Follow each run to its end */
+    *pNumUnreachable = 0;
+    runID = liveID = INVALID_PTR_ID;
+    for (pNode = getHeadPtr(ctx); pNode != NULL; pNode = getNextPtr(ctx, pNode)){
+
+        if (pNode->nodeType == NODE_GOTO){
+            if (runID != INVALID_PTR_ID)
+                liveID = runID;
+            runID = liveID;
+            continue;
+        }
+        if (!isCodeNode(pNode))
+            continue;
+
+        if (pNode->pointerID == INVALID_PTR_ID)
+            pNode->pointerID = runID;
+        if (pNode->pointerID == INVALID_PTR_ID)
+            (*pNumUnreachable)++;
+
+        runID = endsRun(pNode->subroutine_code) ? INVALID_PTR_ID : pNode->pointerID;
+    }
+
+    return rval;
+}
+
+
+
+
+/*******************************************************************/
+/* pruneUnreachable                                                */
+/* Removes the commands no run reaches from the last section of    */
+/* the script, the part after its final GOTO.  Earlier sections    */
+/* end where a GOTO places the next one, so removing commands from */
+/* them would only leave a gap.  GOTO, pointer and fill-space      */
+/* nodes are kept, they only place data.  buildScriptCFG must be   */
+/* called first.  Returns the # of nodes removed.                  */
+/*******************************************************************/
+int pruneUnreachable(lsb_context* ctx){
+
+    scriptNode *pNode, *pNext, *pStart;
+    int numRemoved = 0;
+
+    /* Find the last section */
+    pStart = getHeadPtr(ctx);
+    for (pNode = pStart; pNode != NULL; pNode = getNextPtr(ctx, pNode)){
+        if (pNode->nodeType == NODE_GOTO)
+            pStart = pNode;
+    }
+
+    pNode = pStart;
+    while (pNode != NULL){
+        pNext = getNextPtr(ctx, pNode);
+        if (isCodeNode(pNode) && (pNode->pointerID == INVALID_PTR_ID)){
+            removeListItem(ctx, pNode);
+            numRemoved++;
+        }
+        pNode = pNext;
+    }
+
+    return numRemoved;
+}
+
+
+
+
+/*******************************************************************/
+/* writeCFGDump                                                    */
+/* Writes one tab separated line per command: its ID, type, code,  */
+/* the pointer of the run reaching it, the pointer it jumps to and */
+/* the ID of the node that pointer leads to.  buildScriptCFG must  */
+/* be called first.  Returns 0 on success, -1 on failure.          */
+/*******************************************************************/
+int writeCFGDump(lsb_context* ctx, FILE* outFile){
+
+    static const char* const typeNames[] = {
+        "", "goto", "fill-space", "pointer", "execute-subroutine", "run-commands", "options"
+    };
+    unsigned int numPtrs = getPtrTableEntries(ctx);
+    unsigned int ptrSize = getPtrEntrySize(ctx);
+    unsigned int* pTargets;
+    scriptNode* pNode;
+    unsigned int x;
+
+    /* Pointer table entry -> Node ID */
+    pTargets = (unsigned int*)malloc(numPtrs * sizeof(unsigned int));
+    if (pTargets == NULL){
+        printf("Error allocating pointer target table.\n");
+        return -1;
+    }
+    for (x = 0; x < numPtrs; x++)
+        pTargets[x] = INVALID_PTR_ID;
+    for (pNode = getHeadPtr(ctx); pNode != NULL; pNode = getNextPtr(ctx, pNode)){
+        if ((pNode->nodeType == NODE_POINTER) && !pNode->ptrValueFlag &&
+            (pNode->byteOffset / ptrSize < numPtrs))
+            pTargets[pNode->byteOffset / ptrSize] = pNode->ptrID;
+    }
+
+    fprintf(outFile, "Node ID\tType\tCode\tParent Ptr\tJump Ptr\tJump Node ID\tReachable\r\n");
+    for (pNode = getHeadPtr(ctx); pNode != NULL; pNode = getNextPtr(ctx, pNode)){
+        if (!isCodeNode(pNode))
+            continue;
+
+        fprintf(outFile, "%u\t%s\t0x%04X\t", pNode->id, typeNames[pNode->nodeType], pNode->subroutine_code);
+        if (pNode->pointerID != INVALID_PTR_ID)
+            fprintf(outFile, "%u", pNode->pointerID);
+        fprintf(outFile, "\t");
+        if (pNode->nextPointerID != INVALID_PTR_ID){
+            fprintf(outFile, "%u\t", pNode->nextPointerID);
+            if ((pNode->nextPointerID < numPtrs) && (pTargets[pNode->nextPointerID] != INVALID_PTR_ID))
+                fprintf(outFile, "%u", pTargets[pNode->nextPointerID]);
+        }
+        else
+            fprintf(outFile, "\t");
+        fprintf(outFile, "\t%s\r\n", (pNode->pointerID != INVALID_PTR_ID) ? "yes" : "no");
+    }
+
+    free(pTargets);
+
+    return 0;
+}
+
+
+
+
+/*******************************************************************/
+/* isCodeNode - True for nodes that are executed script commands.  */
+/*******************************************************************/
+static int isCodeNode(scriptNode* pNode){
+    return ((pNode->nodeType == NODE_EXE_SUB) || (pNode->nodeType == NODE_RUN_CMDS) ||
+            (pNode->nodeType == NODE_OPTIONS));
+}
+
+
+
+
+/*******************************************************************/
+/* isJumpCode                                                      */
+/* True for commands whose first argument is a pointer ID, the     */
+/* same commands the decoders record a nextPointerID for.          */
+/*******************************************************************/
+static int isJumpCode(unsigned int code){
+
+    switch (code){
+        case 0x0003:  /* Unconditional JMP */
+        case 0x0004:  /* Unconditional JMP */
+        case 0x0007:  /* SELECT */
+        case 0x000B:  /* Conditional TRUE */
+        case 0x000C:  /* Conditional FALSE */
+        case 0x000D:
+        case 0x0010:
+        case 0x0011:
+        case 0x0016:  /* Conditional JMP */
+        case 0x0026:  /* Return & Jump into new scene */
+        case 0x0042:  /* Unconditional JMP */
+            return 1;
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+
+
+
+/*******************************************************************/
+/* endsRun - True for commands never followed by the next node.    */
+/*******************************************************************/
+static int endsRun(unsigned int code){
+
+    switch (code){
+        case 0x0003:  /* Unconditional JMP */
+        case 0x0004:  /* Unconditional JMP */
+        case 0x0005:  /* Return */
+        case 0x0026:  /* Return & Jump into new scene */
+        case 0x0042:  /* Unconditional JMP */
+            return 1;
+        default:
+            break;
+    }
+
+    return 0;
+}
@@ -0,0 +1,21 @@
+/**********************************************************************/
+/* script_cfg.h - Control flow and reachability of the script nodes.  */
+/**********************************************************************/
+#ifdef _MSC_VER
+#pragma warning(disable:4996)
+#endif
+#ifndef SCRIPT_CFG_H
+#define SCRIPT_CFG_H
+#include <stdio.h>
+#include "lsb_context.h"
+
+
+/***********************/
+/* Function Prototypes */
+/***********************/
+int buildScriptCFG(lsb_context* ctx, unsigned int* pNumUnreachable);
+int pruneUnreachable(lsb_context* ctx);
+int writeCFGDump(lsb_context* ctx, FILE* outFile);
+
+
+#endif
@@ -1,5 +1,8 @@
 #ifndef SCRIPT_NODE_TYPES
 #define SCRIPT_NODE_TYPES
+#ifdef _MSC_VER
+#pragma warning(disable:4201)  /* nameless struct/union in scriptNode */
+#endif
 
 /***********/
 /* Defines */
@@ -22,6 +25,11 @@
 /* Default Fill Byte Value */
 #define DEFAULT_FILL  0x00
 
+/* Binary Layout Defaults (Sega Saturn), overridden by the start header */
+#define DEFAULT_MAX_BIN_SIZE    0x10000  /* Max binary file size in bytes */
+#define DEFAULT_PTR_ENTRIES     1024     /* # of pointer table entries    */
+#define DEFAULT_PTR_ENTRY_SIZE  2        /* Bytes per pointer table entry */
+
 /* Meta Script Node Types */
 #define NODE_GOTO       1
 #define NODE_FILL_SPACE 2
@@ -30,6 +38,9 @@
 #define NODE_RUN_CMDS   5
 #define NODE_OPTIONS    6
 
+/* Handle of no node, ends the list in both directions */
+#define NODE_NONE       0xFFFFFFFF
+
 /* Execute Subroutine / Run Cmds Parameter Types */
 #define BYTE_PARAM    0
 #define SHORT_PARAM   1
@@ -42,6 +53,7 @@
 #define SHOW_PORTRAIT_RIGHT 8
 #define TIME_DELAY    9
 #define SUBT_STR      10
+#define RUN_END       0xFF /* Ends a run-commands / options sequence */
 
 /* Script Dump Defines */
 #define INVALID_PTR_ID 0xFFFFFFFF
@@ -57,55 +69,68 @@ struct paramType{
     unsigned int value;
 };
 
+/* Run-commands / options instruction.  A sequence is a contiguous */
+/* array of these ended by a RUN_END opcode.                        */
 struct runParamType{
-    unsigned int type;
-    unsigned int value;
-    unsigned char* str;
-    runParamType* pNext;
+    unsigned char type;           /* Opcode */
+    union{
+        unsigned int value;
+        unsigned int str;         /* String pool handle (PRINT_LINE) */
+    };
 };
 
 
-/* Script Node Datatype */
+/* Script Node Datatype                                            */
+/* A common header followed by the fields used by the node's type. */
+/* Nodes are only allocated as large as their type requires, with  */
+/* subroutine parameters normally stored inline after the node.    */
+/* Nodes are linked by 32-bit node store handles (see snode_list). */
 struct scriptNode
 {
+    //Linked List Handles (NODE_NONE at either end)
+    unsigned int next;
+    unsigned int prev;
+    unsigned int self;            // This node's own handle
+
     unsigned int id;
     int nodeType;
 
-    //Pointer Values 
-    unsigned short byteOffset; // (Goto shares byteOffset)
-    unsigned int ptrSize;      // 2 or 4 bytes
-    unsigned int ptrValueFlag; // When true, use ptrValue, otherwise ID
-    unsigned int ptrValue;  
-    unsigned int ptrID;
-
-    //fill-space Parameters
-    unsigned int unit_size;
-    unsigned int fillVal;
-    unsigned int unit_count;
-
-    //Execute-Subroutine Parameters
-    unsigned int subroutine_code;
-    unsigned int num_parameters;
-    unsigned char alignfillVal;
-    paramType* subParams;
-
-    //Run-Commands Parameters
-    runParamType* runParams;
-    runParamType* runParams2;
-
     //When reading in binary file, stores original file offset of data
     //When writing out to binary file, location where written to
     unsigned int fileOffset;
+    unsigned int binSize;         // Bytes written for the node (binary output only)
 
     //Book-keeping for script dumps only
     unsigned int pointerID;       // Pointer ID that brought the script to this node. (FFFFFFFF if unreachable)
-    unsigned int nextPointerID;   // Node ID of next non-linear script element (if it exists, FFFFFFFF otherwise)
-
-    //Linked List Pointers
-    scriptNode* pNext;
-    scriptNode* pPrev;
+    unsigned int nextPointerID;   // Pointer ID jumped to by this node (if it exists, FFFFFFFF otherwise)
+
+    union{
+        //Pointer Values 
+        struct{
+            unsigned int byteOffset;   // (Goto shares byteOffset)
+            unsigned int ptrSize;      // 2 or 4 bytes
+            unsigned int ptrValueFlag; // When true, use ptrValue, otherwise ID
+            unsigned int ptrValue;  
+            unsigned int ptrID;
+        };
+
+        //fill-space Parameters
+        struct{
+            unsigned int unit_size;
+            unsigned int fillVal;
+            unsigned int unit_count;
+        };
+
+        //Execute-Subroutine, Run-Commands and Options Parameters
+        struct{
+            unsigned int subroutine_code;
+            unsigned int num_parameters;
+            unsigned char alignfillVal;
+            paramType* subParams;
+            runParamType* runParams;
+            runParamType* runParams2;  // Options only
+        };
+    };
 };
 
-
-
 #endif
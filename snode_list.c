@@ -1,5 +1,10 @@
 /**********************************************************************/
 /* snode_list.c - Functions to for script node linked list.           */
+/*                Nodes are packed into a node store made of large    */
+/*                chunks and are linked in script order by 32-bit     */
+/*                handles rather than pointers.  A handle encodes the */
+/*                chunk and the 8-byte unit within it, so nodes are   */
+/*                found without a search and never move once made.    */
 /**********************************************************************/
 
 
@@ -9,38 +14,76 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include "snode_list.h"
 #include "script_node_types.h"
+#include "mem_arena.h"
 
 
 
 /***********************/
 /* Function Prototypes */
 /***********************/
-int initNodeList();
-int destroyNodeList();
-scriptNode* getHeadPtr();
-int createScriptNode(scriptNode** node);
-int addNode(scriptNode* node, int method, int target_id);
-int removeNode(int id);
-int overwriteNode(int id, scriptNode* node);
-scriptNode* getListItemByID(unsigned int id);
-scriptNode* getListItemByOffset(unsigned int offset);
+int initNodeList(lsb_context* ctx);
+int destroyNodeList(lsb_context* ctx);
+void releaseNodeList(lsb_context* ctx);
+scriptNode* getHeadPtr(lsb_context* ctx);
+scriptNode* getNextPtr(lsb_context* ctx, scriptNode* pNode);
+scriptNode* getPrevPtr(lsb_context* ctx, scriptNode* pNode);
+scriptNode* appendScriptNode(lsb_context* ctx, unsigned int id, int nodeType, unsigned int fileOffset);
+void* allocNodeMem(lsb_context* ctx, unsigned int numBytes);
+paramType* allocNodeParams(lsb_context* ctx, scriptNode* pNode, unsigned int numParams);
+void beginRunParams(lsb_context* ctx);
+runParamType* addRunParam(lsb_context* ctx);
+runParamType* finishRunParams(lsb_context* ctx);
+unsigned int nodeSizeForType(int nodeType);
+static scriptNode* copyNode(lsb_context* ctx, scriptNode* node);
+int addNode(lsb_context* ctx, scriptNode* node, int method, int target_id);
+int removeNode(lsb_context* ctx, int id);
+int removeListItem(lsb_context* ctx, scriptNode* pNode);
+int overwriteNode(lsb_context* ctx, int id, scriptNode* node);
+int moveNode(lsb_context* ctx, int id, int method, int target_id);
+scriptNode* getListItemByID(lsb_context* ctx, unsigned int id);
+scriptNode* getListItemByOffset(lsb_context* ctx, unsigned int offset);
+int initOffsetIndex(lsb_context* ctx, unsigned int numBytes);
+void releaseOffsetIndex(lsb_context* ctx);
+int buildOffsetIntervals(lsb_context* ctx, unsigned int endOffset);
+scriptNode* getListItemContainingOffset(lsb_context* ctx, unsigned int offset, unsigned int* pStart, unsigned int* pEnd);
+int placeOverlapNode(lsb_context* ctx, scriptNode* pOwner, scriptNode* pNode, unsigned int resumeOffset, unsigned int gotoID);
+static scriptNode* nodeAt(lsb_context* ctx, unsigned int handle);
+static scriptNode* storeAlloc(lsb_context* ctx, unsigned int numBytes);
+static void* storeAllocAfter(lsb_context* ctx, scriptNode* pNode, unsigned int nodeBytes, unsigned int numBytes);
+static void linkNode(lsb_context* ctx, scriptNode* pItem, int method, scriptNode* pTarget);
+static void unlinkNode(lsb_context* ctx, scriptNode* pItem);
+static int cmpInterval(const void* a, const void* b);
+static void offsetIndexInsert(lsb_context* ctx, scriptNode* pNode);
+static void offsetIndexRemove(lsb_context* ctx, scriptNode* pNode);
+static int idIndexInsert(lsb_context* ctx, scriptNode* pNode);
+static void idIndexRemove(lsb_context* ctx, scriptNode* pNode);
+static scriptNode* idIndexLookup(lsb_context* ctx, unsigned int id);
+static scriptNode* findNodeByID(lsb_context* ctx, unsigned int id);
+
+
+/* Defines */
+#define ID_INDEX_MIN_SIZE 1024   /* Initial # of slots, power of 2 */
+#define ID_HASH(id,mask)  ((((unsigned int)(id)) * 0x9E3779B1u) & (mask))
+#define NODE_UNIT_MASK    ((1u << NODE_CHUNK_SHIFT) - 1)
+#define NODE_ROUND(n)     (((n) + NODE_UNIT - 1) & ~(NODE_UNIT - 1))
+#define MIN_CHUNK_SLOTS   16     /* Initial size of the chunk table */
 
 
-/* Globals */
-static scriptNode *pHead = NULL;    /* List Ptr  */
-
 
 /*******************************************************************/
 /* initNodeList                                                    */
 /* Creates an empty list to hold the script node information.      */
+/* Node IDs assigned by the binary decoders restart at 1.          */
 /*******************************************************************/
-int initNodeList()
+int initNodeList(lsb_context* ctx)
 {
-    if(pHead != NULL)
-        destroyNodeList();
-    pHead = NULL;
+    if(ctx->head != NODE_NONE)
+        destroyNodeList(ctx);
+    ctx->head = ctx->tail = NODE_NONE;
+    ctx->nextID = 1;
 
     return 0;
 }
@@ -51,8 +94,28 @@ int initNodeList()
 /*******************************************************************/
 /* getHeadPtr - Returns the list's head pointer.                   */
 /*******************************************************************/
-scriptNode* getHeadPtr(){
-    return pHead;
+scriptNode* getHeadPtr(lsb_context* ctx){
+    return nodeAt(ctx, ctx->head);
+}
+
+
+
+
+/*******************************************************************/
+/* getNextPtr - Returns the node after pNode, NULL at the end.     */
+/*******************************************************************/
+scriptNode* getNextPtr(lsb_context* ctx, scriptNode* pNode){
+    return nodeAt(ctx, pNode->next);
+}
+
+
+
+
+/*******************************************************************/
+/* getPrevPtr - Returns the node before pNode, NULL at the start.  */
+/*******************************************************************/
+scriptNode* getPrevPtr(lsb_context* ctx, scriptNode* pNode){
+    return nodeAt(ctx, pNode->prev);
 }
 
 
@@ -60,129 +123,279 @@ scriptNode* getHeadPtr(){
 
 /*******************************************************************/
 /* destroyNodeList                                                 */
-/* Destroys all items in the list.                                 */
+/* Destroys all items in the list.  The first chunk of the node    */
+/* store is kept for reuse by the next script.                     */
 /*******************************************************************/
-int destroyNodeList()
+int destroyNodeList(lsb_context* ctx)
 {
-    runParamType* ptrRun, *ptrRunNext;
-    scriptNode *pCurrent = NULL;
-    scriptNode *pItem = pHead;
-
-
-    while (pItem != NULL){
-        pCurrent = pItem;
-
-        /* Free internal data */
-        if (pCurrent->subParams != NULL)
-            free(pCurrent->subParams);
-        if (pCurrent->runParams != NULL){
-            ptrRun = pCurrent->runParams;
-            while (ptrRun != NULL){
-                ptrRunNext = ptrRun->pNext;
-                free(ptrRun);
-                ptrRun = ptrRunNext;
-            }
-        }
-        if (pCurrent->runParams2 != NULL){
-            ptrRun = pCurrent->runParams2;
-            while (ptrRun != NULL){
-                ptrRunNext = ptrRun->pNext;
-                free(ptrRun);
-                ptrRun = ptrRunNext;
-            }
-        }
+    nodeStore* pStore = &ctx->nodes;
+    unsigned int x;
+
+    /* Nodes live in the store, everything they reference in the arena */
+    for (x = 1; x < pStore->numChunks; x++)
+        free(pStore->pChunks[x]);
+    if (pStore->numChunks > 1)
+        pStore->numChunks = 1;
+    pStore->used = 0;
+    arenaReset(&ctx->nodeArena);
+
+    ctx->head = ctx->tail = NODE_NONE;
+
+    /* Release the ID index */
+    if (ctx->pIdIndex != NULL)
+        free(ctx->pIdIndex);
+    ctx->pIdIndex = NULL;
+    ctx->idIndexSize = ctx->idIndexCount = ctx->idIndexDups = 0;
+    releaseOffsetIndex(ctx);
 
-        pItem = pItem->pNext;
-        free(pCurrent);
-    }
+    return 0;
+}
 
-    pHead = NULL;
 
-    return 0;
+
+
+/*******************************************************************/
+/* releaseNodeList                                                 */
+/* Destroys the list and frees all memory held for it.             */
+/*******************************************************************/
+void releaseNodeList(lsb_context* ctx)
+{
+    nodeStore* pStore = &ctx->nodes;
+
+    destroyNodeList(ctx);
+    if (pStore->numChunks > 0)
+        free(pStore->pChunks[0]);
+    if (pStore->pChunks != NULL)
+        free(pStore->pChunks);
+    pStore->pChunks = NULL;
+    pStore->numChunks = pStore->maxChunks = 0;
+    arenaFree(&ctx->nodeArena);
+
+    return;
 }
 
 
 /*******************************************************************/
-/* createScriptNode                                                */
-/* Creates and initializes a new script node.                      */
-/* Returns 0 on success, -1 on failure.                            */
+/* appendScriptNode                                                */
+/* Creates a zero-initialized script node linked at the end of the */
+/* list.  The caller fills in the type specific fields in place.   */
+/* NULL is returned on failure.                                    */
 /*******************************************************************/
-int createScriptNode(scriptNode** node){
+scriptNode* appendScriptNode(lsb_context* ctx, unsigned int id, int nodeType, unsigned int fileOffset){
 
     scriptNode* pNode;
-    *node = (scriptNode*)malloc(sizeof(scriptNode));
-    pNode = *node;
+
+    pNode = storeAlloc(ctx, nodeSizeForType(nodeType));
     if(pNode == NULL){
         printf("Error creating new script node\n");
-        return -1;
+        return NULL;
     }
-    memset(pNode,0,sizeof(scriptNode));
-    pNode->pNext = pNode->pPrev = NULL;
-    pNode->subParams = NULL;
-    pNode->runParams = NULL;
-    pNode->runParams2 = NULL;
+    pNode->id = id;
+    pNode->nodeType = nodeType;
+    pNode->fileOffset = fileOffset;
     pNode->pointerID = INVALID_PTR_ID;
     pNode->nextPointerID = INVALID_PTR_ID;
-    return 0;
+
+    linkNode(ctx, pNode, METHOD_NORMAL, NULL);
+    offsetIndexInsert(ctx, pNode);
+    if (idIndexInsert(ctx, pNode) != 0)
+        return NULL;
+
+    return pNode;
 }
 
 
 /*******************************************************************/
-/* addNode                                                         */
-/* Inserts an element in the list.                                 */
-/* Returns 0 on success, -1 on failure.                            */
+/* allocNodeMem                                                    */
+/* Allocates zeroed memory owned by the node list: parameter       */
+/* arrays, run parameters and strings referenced by nodes.  The    */
+/* memory is released all at once by destroyNodeList.              */
+/* NULL is returned on failure.                                    */
 /*******************************************************************/
-int addNode(scriptNode* node, int method, int target_id){
+void* allocNodeMem(lsb_context* ctx, unsigned int numBytes){
 
-    scriptNode * newItem, *pCurrent, *pNext, *pPrev;
+    void* pMem = arenaAlloc(&ctx->nodeArena, numBytes);
+    if (pMem != NULL)
+        memset(pMem, 0, numBytes);
+    return pMem;
+}
 
-    /* Create a new item */
-    newItem = (scriptNode*)malloc(sizeof(scriptNode));
-    if(newItem == NULL){
-        printf("Error allocing memory for new item in addNode.\n");
-        return -1;
+
+/*******************************************************************/
+/* allocNodeParams                                                 */
+/* Allocates zeroed subroutine parameters for a node.  When pNode  */
+/* is the most recently created node they are placed inline        */
+/* directly after it in the node store, otherwise they come from   */
+/* the arena.                                                      */
+/* NULL is returned on failure.                                    */
+/*******************************************************************/
+paramType* allocNodeParams(lsb_context* ctx, scriptNode* pNode, unsigned int numParams){
+
+    unsigned int numBytes = numParams * sizeof(paramType);
+    paramType* params;
+
+    params = (paramType*)storeAllocAfter(ctx, pNode, nodeSizeForType(pNode->nodeType), numBytes);
+    if (params == NULL)
+        return (paramType*)allocNodeMem(ctx, numBytes);
+    memset(params, 0, numBytes);
+
+    return params;
+}
+
+
+/*******************************************************************/
+/* beginRunParams                                                  */
+/* Starts building a new run-commands / options sequence.          */
+/*******************************************************************/
+void beginRunParams(lsb_context* ctx){
+
+    ctx->runCount = 0;
+
+    return;
+}
+
+
+/*******************************************************************/
+/* addRunParam                                                     */
+/* Appends a zeroed instruction to the sequence being built.  The  */
+/* pointer is only valid until the next instruction is added.      */
+/* NULL is returned on failure.                                    */
+/*******************************************************************/
+runParamType* addRunParam(lsb_context* ctx){
+
+    runParamType* rpNode;
+
+    if (ctx->runCount == ctx->runMax){
+        unsigned int newMax = (ctx->runMax == 0) ? 64 : (ctx->runMax * 2);
+        runParamType* pNew = (runParamType*)realloc(ctx->pRunBuf, newMax * sizeof(runParamType));
+        if (pNew == NULL)
+            return NULL;
+        ctx->pRunBuf = pNew;
+        ctx->runMax = newMax;
     }
-    memcpy(newItem, node, sizeof(scriptNode));
-    newItem->pNext = NULL;
+    rpNode = &ctx->pRunBuf[ctx->runCount++];
+    memset(rpNode, 0, sizeof(runParamType));
 
-    /* Head is Empty */
-    if(pHead == NULL){
-        pHead = newItem;
-        return 0;
+    return rpNode;
+}
+
+
+/*******************************************************************/
+/* finishRunParams                                                 */
+/* Copies the sequence that was built, ended by RUN_END, into      */
+/* memory owned by the node list.                                  */
+/* NULL is returned on failure.                                    */
+/*******************************************************************/
+runParamType* finishRunParams(lsb_context* ctx){
+
+    runParamType* pRun;
+
+    pRun = (runParamType*)allocNodeMem(ctx, (ctx->runCount + 1) * sizeof(runParamType));
+    if (pRun == NULL){
+        printf("Error allocing space for run parameters.\n");
+        return NULL;
     }
+    if (ctx->runCount > 0)
+        memcpy(pRun, ctx->pRunBuf, ctx->runCount * sizeof(runParamType));
+    pRun[ctx->runCount].type = RUN_END;
+    ctx->runCount = 0;
 
-    /* Head != NULL, Insert at Head ? */
-    if ((method == METHOD_INSERT_BEFORE) && (pHead->id == target_id)){
-        newItem->pNext = pHead;
-        pHead = newItem;
-        return 0;
+    return pRun;
+}
+
+
+/*******************************************************************/
+/* nodeSizeForType                                                 */
+/* Returns the number of bytes a node of the given type occupies:  */
+/* the common header plus the part of the union the type uses.     */
+/*******************************************************************/
+unsigned int nodeSizeForType(int nodeType){
+
+    switch (nodeType){
+        case NODE_GOTO:
+            return offsetof(scriptNode, byteOffset) + sizeof(unsigned int);
+        case NODE_POINTER:
+            return offsetof(scriptNode, ptrID) + sizeof(unsigned int);
+        case NODE_FILL_SPACE:
+            return offsetof(scriptNode, unit_count) + sizeof(unsigned int);
+        case NODE_EXE_SUB:
+        case NODE_RUN_CMDS:
+            return offsetof(scriptNode, runParams2);
+        default:
+            break;
     }
+    return sizeof(scriptNode);
+}
 
-    /* First item is not empty and insertion will not take place at head */
-    pPrev = NULL;
-    pCurrent = pHead;
-    while(pCurrent != NULL){
-        pNext = pCurrent->pNext;
 
-        /* Check to insert */
-        if ((method == METHOD_INSERT_BEFORE) && (pCurrent->id == target_id)){
-            newItem->pNext = pCurrent;
-            if (pPrev != NULL)
-                pPrev->pNext = newItem;
-            return 0;
-        }
-        else if ((method == METHOD_INSERT_AFTER) && (pCurrent->id == target_id)){
-            newItem->pNext = pCurrent->pNext;
-            pCurrent->pNext = newItem;
-            return 0;
-        }
-        else if ((method == METHOD_NORMAL) && (pNext == NULL)){
-            pCurrent->pNext = newItem;
-            return 0;
+/*******************************************************************/
+/* copyNode                                                        */
+/* Creates a list owned copy of a node, sized for its type, with   */
+/* its subroutine parameters copied inline after it.               */
+/* The copy is not linked into the list.                           */
+/* NULL is returned on failure.                                    */
+/*******************************************************************/
+static scriptNode* copyNode(lsb_context* ctx, scriptNode* node){
+
+    scriptNode* newItem;
+    unsigned int nodeSize = nodeSizeForType(node->nodeType);
+    unsigned int numParams = 0;
+    unsigned int handle;
+
+    if (((node->nodeType == NODE_EXE_SUB) || (node->nodeType == NODE_OPTIONS)) &&
+        (node->subParams != NULL))
+        numParams = node->num_parameters;
+
+    newItem = storeAlloc(ctx, nodeSize);
+    if(newItem == NULL){
+        printf("Error allocing memory for new item in addNode.\n");
+        return NULL;
+    }
+    handle = newItem->self;
+    memcpy(newItem, node, nodeSize);
+    newItem->self = handle;
+    newItem->next = newItem->prev = NODE_NONE;
+    if (numParams > 0){
+        newItem->subParams = allocNodeParams(ctx, newItem, numParams);
+        if (newItem->subParams == NULL){
+            printf("Error allocing memory for new item in addNode.\n");
+            return NULL;
         }
+        memcpy(newItem->subParams, node->subParams, numParams * sizeof(paramType));
+    }
+
+    return newItem;
+}
+
 
-        pPrev = pCurrent;
-        pCurrent = pCurrent->pNext;
+/*******************************************************************/
+/* addNode                                                         */
+/* Inserts an element in the list.                                 */
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+int addNode(lsb_context* ctx, scriptNode* node, int method, int target_id){
+
+    scriptNode * newItem, *pCurrent;
+
+    /* Create a new item */
+    newItem = copyNode(ctx, node);
+    if(newItem == NULL)
+        return -1;
+
+    /* Head is Empty, or append at the tail */
+    if((ctx->head == NODE_NONE) || (method == METHOD_NORMAL)){
+        linkNode(ctx, newItem, METHOD_NORMAL, NULL);
+        offsetIndexInsert(ctx, newItem);
+        return idIndexInsert(ctx, newItem);
+    }
+
+    /* Insert relative to the target node */
+    pCurrent = findNodeByID(ctx, target_id);
+    if ((pCurrent != NULL) &&
+        ((method == METHOD_INSERT_BEFORE) || (method == METHOD_INSERT_AFTER))){
+        linkNode(ctx, newItem, method, pCurrent);
+        offsetIndexInsert(ctx, newItem);
+        return idIndexInsert(ctx, newItem);
     }
 
     printf("Error, insertion failed.\n");
@@ -195,55 +408,32 @@ int addNode(scriptNode* node, int method, int target_id){
 /* Removes an element in the list.                                 */
 /* Returns 0 on success, -1 on failure.                            */
 /*******************************************************************/
-int removeNode(int id){
-
-    scriptNode *pCurrent, *pNext, *pPrev;
+int removeNode(lsb_context* ctx, int id){
 
-    pPrev = NULL;
-    pCurrent = pHead;
-    while (pCurrent != NULL){
-        pNext = pCurrent->pNext;
+    scriptNode *pCurrent;
 
-        /* Check to remove */
-        if (pCurrent->id == id){
-            runParamType* ptrRun, *ptrRunNext;
+    pCurrent = findNodeByID(ctx, id);
+    if (pCurrent != NULL)
+        return removeListItem(ctx, pCurrent);
 
-            if (pPrev != NULL)
-                pPrev->pNext = pNext;
-            if (pHead == pCurrent){ //Update Head
-                pHead = pCurrent->pNext;
-            }
+    printf("Error, node removal failed.\n");
+    return -1;
+}
 
-            /* Free internal data */
-            if (pCurrent->subParams != NULL)
-                free(pCurrent->subParams);
-            if (pCurrent->runParams != NULL){
-                ptrRun = pCurrent->runParams;
-                while (ptrRun != NULL){
-                    ptrRunNext = ptrRun->pNext;
-                    free(ptrRun);
-                    ptrRun = ptrRunNext;
-                }
-            }
-            if (pCurrent->runParams2 != NULL){
-                ptrRun = pCurrent->runParams2;
-                while (ptrRun != NULL){
-                    ptrRunNext = ptrRun->pNext;
-                    free(ptrRun);
-                    ptrRun = ptrRunNext;
-                }
-            }
 
-            free(pCurrent);
-            return 0;
-        }
+/*******************************************************************/
+/* removeListItem                                                  */
+/* Removes a node from the list, for when IDs may not be unique.   */
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+int removeListItem(lsb_context* ctx, scriptNode* pNode){
 
-        pPrev = pCurrent;
-        pCurrent = pCurrent->pNext;
-    }
+    idIndexRemove(ctx, pNode);
+    offsetIndexRemove(ctx, pNode);
+    unlinkNode(ctx, pNode);
 
-    printf("Error, node removal failed.\n");
-    return -1;
+    /* Memory is reclaimed with the rest of the node store */
+    return 0;
 }
 
 
@@ -252,25 +442,55 @@ int removeNode(int id){
 /* Overwrites an element in the list.                              */
 /* Returns 0 on success, -1 on failure.                            */
 /*******************************************************************/
-int overwriteNode(int id, scriptNode* node){
+int overwriteNode(lsb_context* ctx, int id, scriptNode* node){
+
+    scriptNode *pCurrent, *newItem;
+
+    pCurrent = findNodeByID(ctx, id);
+    if (pCurrent != NULL){
+
+        /* Node sizes differ by type, so a new copy takes the old */
+        /* node's place in the list.                              */
+        newItem = copyNode(ctx, node);
+        if (newItem == NULL)
+            return -1;
+        idIndexRemove(ctx, pCurrent);
+        offsetIndexRemove(ctx, pCurrent);
+        linkNode(ctx, newItem, METHOD_INSERT_BEFORE, pCurrent);
+        unlinkNode(ctx, pCurrent);
+        offsetIndexInsert(ctx, newItem);
+        return idIndexInsert(ctx, newItem);
+    }
 
-    scriptNode *pCurrent;
+    printf("Error, node overwrite failed.\n");
+    return -1;
+}
 
-    pCurrent = pHead;
-    while (pCurrent != NULL){
 
-        /* Check to overwrite data */
-        if (pCurrent->id == id){
-            node->pNext = pCurrent->pNext;
-            memcpy(pCurrent, node, sizeof(scriptNode));
-            return 0;
-        }
 
-        pCurrent = pCurrent->pNext;
+/*******************************************************************/
+/* moveNode                                                        */
+/* Relinks an element at a new position in the list.               */
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+int moveNode(lsb_context* ctx, int id, int method, int target_id){
+
+    scriptNode *pItem, *pTarget;
+
+    pItem = findNodeByID(ctx, id);
+    pTarget = NULL;
+    if (method != METHOD_NORMAL)
+        pTarget = findNodeByID(ctx, target_id);
+    if ((pItem == NULL) || (pItem == pTarget) ||
+        ((method != METHOD_NORMAL) && (pTarget == NULL))){
+        printf("Error, node move failed.\n");
+        return -1;
     }
 
-    printf("Error, node overwrite failed.\n");
-    return -1;
+    unlinkNode(ctx, pItem);
+    linkNode(ctx, pItem, method, pTarget);
+
+    return 0;
 }
 
 
@@ -281,39 +501,593 @@ int overwriteNode(int id, scriptNode* node){
 /* Returns a pointer to the scriptNode with the given ID.          */
 /* NULL is returned on failure.                                    */
 /*******************************************************************/
-scriptNode* getListItemByID(unsigned int id){
+scriptNode* getListItemByID(lsb_context* ctx, unsigned int id){
+
+    scriptNode *pCurrent = findNodeByID(ctx, id);
+    if (pCurrent != NULL)
+        return pCurrent;
+
+    printf("Error, node not found.\n");
+    return NULL;
+}
+
+
+
+/*******************************************************************/
+/* getListItemByOffset                                             */
+/* Returns a pointer to the first scriptNode with the given file   */
+/* offset.  Uses the offset index when one is active.              */
+/* NULL is returned on failure, reporting is left to the caller.   */
+/*******************************************************************/
+scriptNode* getListItemByOffset(lsb_context* ctx, unsigned int offset){
+
+    scriptNode *pCurrent;
 
-    scriptNode *pCurrent = pHead;
+    if (ctx->pOffsetIndex != NULL){
+        if (offset < ctx->offsetIndexSize)
+            return nodeAt(ctx, ctx->pOffsetIndex[offset]);
+        return NULL;
+    }
+
+    pCurrent = getHeadPtr(ctx);
     while (pCurrent != NULL){
         /* Check for the id */
-        if (pCurrent->id == id){
+        if (pCurrent->fileOffset == offset){
             return pCurrent;
         }
-        pCurrent = pCurrent->pNext;
+        pCurrent = getNextPtr(ctx, pCurrent);
     }
 
-    printf("Error, node not found.\n");
     return NULL;
 }
 
 
 
 /*******************************************************************/
-/* getListItemByOffset                                             */
-/* Returns a pointer to the scriptNode with the given offset.      */
+/* initOffsetIndex                                                 */
+/* Creates an empty fileOffset->node index covering numBytes of    */
+/* input.  Nodes added afterwards are indexed as they are added.   */
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+int initOffsetIndex(lsb_context* ctx, unsigned int numBytes){
+
+    releaseOffsetIndex(ctx);
+
+    ctx->pOffsetIndex = (unsigned int*)malloc((numBytes + 1) * sizeof(unsigned int));
+    if (ctx->pOffsetIndex == NULL){
+        printf("Error allocing memory for the node offset index.\n");
+        return -1;
+    }
+    memset(ctx->pOffsetIndex, 0xFF, (numBytes + 1) * sizeof(unsigned int));
+    ctx->offsetIndexSize = numBytes + 1;
+
+    return 0;
+}
+
+
+
+/*******************************************************************/
+/* releaseOffsetIndex                                              */
+/* Frees the fileOffset->node index.  getListItemByOffset falls    */
+/* back to walking the list afterwards.                            */
+/*******************************************************************/
+void releaseOffsetIndex(lsb_context* ctx){
+
+    if (ctx->pOffsetIndex != NULL)
+        free(ctx->pOffsetIndex);
+    ctx->pOffsetIndex = NULL;
+    ctx->offsetIndexSize = 0;
+
+    if (ctx->pIntervals != NULL)
+        free(ctx->pIntervals);
+    ctx->pIntervals = NULL;
+    ctx->numIntervals = 0;
+
+    return;
+}
+
+
+
+/*******************************************************************/
+/* buildOffsetIntervals                                            */
+/* Records the byte range covered by each decoded command in the   */
+/* list.  A command runs from its file offset up to the start of   */
+/* the next decoded command, the last one runs up to endOffset.    */
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+int buildOffsetIntervals(lsb_context* ctx, unsigned int endOffset){
+
+    scriptNode* pCurrent;
+    unsigned int x, count;
+
+    if (ctx->pIntervals != NULL)
+        free(ctx->pIntervals);
+    ctx->pIntervals = NULL;
+    ctx->numIntervals = 0;
+
+    /* Count the decoded commands */
+    count = 0;
+    for (pCurrent = getHeadPtr(ctx); pCurrent != NULL; pCurrent = getNextPtr(ctx, pCurrent)){
+        if ((pCurrent->nodeType != NODE_POINTER) && (pCurrent->fileOffset < endOffset))
+            count++;
+    }
+    if (count == 0)
+        return 0;
+
+    ctx->pIntervals = (offsetInterval*)malloc(count * sizeof(offsetInterval));
+    if (ctx->pIntervals == NULL){
+        printf("Error allocing memory for the node offset intervals.\n");
+        return -1;
+    }
+    for (pCurrent = getHeadPtr(ctx); pCurrent != NULL; pCurrent = getNextPtr(ctx, pCurrent)){
+        if ((pCurrent->nodeType != NODE_POINTER) && (pCurrent->fileOffset < endOffset)){
+            ctx->pIntervals[ctx->numIntervals].start = pCurrent->fileOffset;
+            ctx->pIntervals[ctx->numIntervals].node = pCurrent->self;
+            ctx->numIntervals++;
+        }
+    }
+
+    /* Decoding is sequential so this is normally already sorted */
+    for (x = 1; x < ctx->numIntervals; x++){
+        if (ctx->pIntervals[x].start < ctx->pIntervals[x - 1].start){
+            qsort(ctx->pIntervals, ctx->numIntervals, sizeof(offsetInterval), cmpInterval);
+            break;
+        }
+    }
+    for (x = 0; x < ctx->numIntervals; x++){
+        if (x + 1 < ctx->numIntervals)
+            ctx->pIntervals[x].end = ctx->pIntervals[x + 1].start;
+        else
+            ctx->pIntervals[x].end = endOffset;
+    }
+
+    return 0;
+}
+
+
+
+/*******************************************************************/
+/* getListItemContainingOffset                                     */
+/* Binary searches the command intervals for the one containing    */
+/* offset.  The interval bounds are returned if pointers are given.*/
+/* NULL is returned if no decoded command covers the offset.       */
+/*******************************************************************/
+scriptNode* getListItemContainingOffset(lsb_context* ctx, unsigned int offset, unsigned int* pStart, unsigned int* pEnd){
+
+    unsigned int lo, hi, mid;
+
+    if (ctx->numIntervals == 0)
+        return NULL;
+
+    /* Find the last interval starting at or before the offset */
+    lo = 0;
+    hi = ctx->numIntervals;
+    while (lo < hi){
+        mid = lo + (hi - lo) / 2;
+        if (ctx->pIntervals[mid].start <= offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+        return NULL;
+    lo--;
+
+    if (offset >= ctx->pIntervals[lo].end)
+        return NULL;
+    if (pStart != NULL)
+        *pStart = ctx->pIntervals[lo].start;
+    if (pEnd != NULL)
+        *pEnd = ctx->pIntervals[lo].end;
+
+    return nodeAt(ctx, ctx->pIntervals[lo].node);
+}
+
+
+
+/*******************************************************************/
+/* placeOverlapNode                                                */
+/* Moves a command decoded from inside another command (pOwner),   */
+/* along with the GOTO that precedes it, to directly after pOwner. */
+/* A GOTO back to resumeOffset (the end of pOwner) is added after  */
+/* it so the commands that follow are still written in place.      */
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+int placeOverlapNode(lsb_context* ctx, scriptNode* pOwner, scriptNode* pNode, unsigned int resumeOffset, unsigned int gotoID){
+
+    scriptNode* pGoto = getPrevPtr(ctx, pNode);
+    scriptNode* sNode;
+
+    if ((pGoto == NULL) || (pGoto->nodeType != NODE_GOTO)){
+        printf("Error, overlapping node is not preceded by a GOTO.\n");
+        return -1;
+    }
+
+    if (moveNode(ctx, pGoto->id, METHOD_INSERT_AFTER, pOwner->id) != 0)
+        return -1;
+    if (moveNode(ctx, pNode->id, METHOD_INSERT_AFTER, pGoto->id) != 0)
+        return -1;
+
+    /* Resume at the end of the overlapped command */
+    sNode = appendScriptNode(ctx, gotoID, NODE_GOTO, 0xFFFFFFFF);
+    if (sNode == NULL){
+        printf("Error creating a script node.\n");
+        return -1;
+    }
+    sNode->byteOffset = resumeOffset;
+
+    return moveNode(ctx, sNode->id, METHOD_INSERT_AFTER, pNode->id);
+}
+
+
+
+/*******************************************************************/
+/* nodeAt - Returns the node for a handle, NULL for NODE_NONE.     */
+/*******************************************************************/
+static scriptNode* nodeAt(lsb_context* ctx, unsigned int handle){
+
+    if (handle == NODE_NONE)
+        return NULL;
+    return (scriptNode*)(ctx->nodes.pChunks[handle >> NODE_CHUNK_SHIFT] +
+        (handle & NODE_UNIT_MASK) * NODE_UNIT);
+}
+
+
+
+/*******************************************************************/
+/* storeAlloc                                                      */
+/* Returns a zeroed, unlinked node of numBytes from the end of the */
+/* node store, with its handle filled in.  A new chunk is started  */
+/* when the current one is full; nodes never move once created.    */
 /* NULL is returned on failure.                                    */
 /*******************************************************************/
-scriptNode* getListItemByOffset(unsigned int offset){
+static scriptNode* storeAlloc(lsb_context* ctx, unsigned int numBytes){
+
+    nodeStore* pStore = &ctx->nodes;
+    scriptNode* pNode;
+
+    numBytes = NODE_ROUND(numBytes);
+    if ((pStore->numChunks == 0) || ((pStore->used + numBytes) > NODE_CHUNK_SIZE)){
+
+        /* Last handle value is reserved for NODE_NONE */
+        if (pStore->numChunks >= (NODE_NONE >> NODE_CHUNK_SHIFT)){
+            printf("Error, node store is full.\n");
+            return NULL;
+        }
+
+        /* Grow the chunk table */
+        if (pStore->numChunks == pStore->maxChunks){
+            unsigned int newMax = (pStore->maxChunks == 0) ? MIN_CHUNK_SLOTS : (pStore->maxChunks * 2);
+            unsigned char** pNew = (unsigned char**)realloc(pStore->pChunks, newMax * sizeof(unsigned char*));
+            if (pNew == NULL){
+                printf("Error allocing memory for the node store.\n");
+                return NULL;
+            }
+            pStore->pChunks = pNew;
+            pStore->maxChunks = newMax;
+        }
+
+        pStore->pChunks[pStore->numChunks] = (unsigned char*)malloc(NODE_CHUNK_SIZE);
+        if (pStore->pChunks[pStore->numChunks] == NULL){
+            printf("Error allocing memory for the node store.\n");
+            return NULL;
+        }
+        pStore->numChunks++;
+        pStore->used = 0;
+    }
+
+    pNode = (scriptNode*)(pStore->pChunks[pStore->numChunks - 1] + pStore->used);
+    memset(pNode, 0, numBytes);
+    pNode->self = ((pStore->numChunks - 1) << NODE_CHUNK_SHIFT) | (pStore->used / NODE_UNIT);
+    pNode->next = pNode->prev = NODE_NONE;
+    pStore->used += numBytes;
+
+    return pNode;
+}
+
+
+
+/*******************************************************************/
+/* storeAllocAfter                                                 */
+/* Returns numBytes directly following pNode, a node of nodeBytes, */
+/* if pNode is the last thing in the node store and its chunk has  */
+/* room.  NULL is returned otherwise.                              */
+/*******************************************************************/
+static void* storeAllocAfter(lsb_context* ctx, scriptNode* pNode, unsigned int nodeBytes, unsigned int numBytes){
+
+    nodeStore* pStore = &ctx->nodes;
+    unsigned char* pEnd;
+
+    if (pStore->numChunks == 0)
+        return NULL;
+
+    numBytes = NODE_ROUND(numBytes);
+    if (numBytes == 0)
+        numBytes = NODE_UNIT;
+    pEnd = pStore->pChunks[pStore->numChunks - 1] + pStore->used;
+    if (((unsigned char*)pNode + NODE_ROUND(nodeBytes) != pEnd) ||
+        ((pStore->used + numBytes) > NODE_CHUNK_SIZE))
+        return NULL;
+    pStore->used += numBytes;
+
+    return pEnd;
+}
+
+
+
+/*******************************************************************/
+/* linkNode                                                        */
+/* Links an unlinked node at the tail (METHOD_NORMAL) or before or */
+/* after pTarget.                                                  */
+/*******************************************************************/
+static void linkNode(lsb_context* ctx, scriptNode* pItem, int method, scriptNode* pTarget){
+
+    scriptNode* pNeighbor;
+
+    if (ctx->head == NODE_NONE){
+        pItem->next = pItem->prev = NODE_NONE;
+        ctx->head = ctx->tail = pItem->self;
+    }
+    else if (method == METHOD_NORMAL){
+        nodeAt(ctx, ctx->tail)->next = pItem->self;
+        pItem->prev = ctx->tail;
+        pItem->next = NODE_NONE;
+        ctx->tail = pItem->self;
+    }
+    else if (method == METHOD_INSERT_BEFORE){
+        pItem->prev = pTarget->prev;
+        pItem->next = pTarget->self;
+        pNeighbor = nodeAt(ctx, pTarget->prev);
+        if (pNeighbor != NULL)
+            pNeighbor->next = pItem->self;
+        else
+            ctx->head = pItem->self;
+        pTarget->prev = pItem->self;
+    }
+    else{
+        pItem->prev = pTarget->self;
+        pItem->next = pTarget->next;
+        pNeighbor = nodeAt(ctx, pTarget->next);
+        if (pNeighbor != NULL)
+            pNeighbor->prev = pItem->self;
+        else
+            ctx->tail = pItem->self;
+        pTarget->next = pItem->self;
+    }
+
+    return;
+}
+
+
+
+/*******************************************************************/
+/* unlinkNode - Takes a node out of the list.                      */
+/*******************************************************************/
+static void unlinkNode(lsb_context* ctx, scriptNode* pItem){
+
+    scriptNode* pNeighbor;
+
+    pNeighbor = nodeAt(ctx, pItem->prev);
+    if (pNeighbor != NULL)
+        pNeighbor->next = pItem->next;
+    else
+        ctx->head = pItem->next;
+    pNeighbor = nodeAt(ctx, pItem->next);
+    if (pNeighbor != NULL)
+        pNeighbor->prev = pItem->prev;
+    else
+        ctx->tail = pItem->prev;
+    pItem->next = pItem->prev = NODE_NONE;
+
+    return;
+}
+
+
+
+/*******************************************************************/
+/* cmpInterval - qsort comparison on interval start offset.        */
+/*******************************************************************/
+static int cmpInterval(const void* a, const void* b){
+
+    const offsetInterval* pA = (const offsetInterval*)a;
+    const offsetInterval* pB = (const offsetInterval*)b;
+
+    if (pA->start < pB->start)
+        return -1;
+    if (pA->start > pB->start)
+        return 1;
+    return 0;
+}
+
+
+
+/*******************************************************************/
+/* offsetIndexInsert                                               */
+/* Indexes a node by its file offset.  The first node added for an */
+/* offset keeps the slot, matching a front-to-back list search.    */
+/*******************************************************************/
+static void offsetIndexInsert(lsb_context* ctx, scriptNode* pNode){
+
+    if ((ctx->pOffsetIndex != NULL) && (pNode->fileOffset < ctx->offsetIndexSize) &&
+        (ctx->pOffsetIndex[pNode->fileOffset] == NODE_NONE))
+        ctx->pOffsetIndex[pNode->fileOffset] = pNode->self;
+
+    return;
+}
+
+
+
+/*******************************************************************/
+/* offsetIndexRemove                                               */
+/* Drops a node from the offset index.                             */
+/*******************************************************************/
+static void offsetIndexRemove(lsb_context* ctx, scriptNode* pNode){
+
+    if ((ctx->pOffsetIndex != NULL) && (pNode->fileOffset < ctx->offsetIndexSize) &&
+        (ctx->pOffsetIndex[pNode->fileOffset] == pNode->self))
+        ctx->pOffsetIndex[pNode->fileOffset] = NODE_NONE;
 
-    scriptNode *pCurrent = pHead;
+    return;
+}
+
+
+
+/*******************************************************************/
+/* findNodeByID                                                    */
+/* Returns the first node in list order with the given ID, or NULL.*/
+/* Uses the ID index; only walks the list if duplicate IDs exist.  */
+/*******************************************************************/
+static scriptNode* findNodeByID(lsb_context* ctx, unsigned int id){
+
+    scriptNode *pCurrent;
+
+    if (ctx->idIndexDups == 0)
+        return idIndexLookup(ctx, id);
+
+    pCurrent = getHeadPtr(ctx);
     while (pCurrent != NULL){
-        /* Check for the id */
-        if (pCurrent->fileOffset == offset){
+        if (pCurrent->id == id)
             return pCurrent;
-        }
-        pCurrent = pCurrent->pNext;
+        pCurrent = getNextPtr(ctx, pCurrent);
     }
+    return NULL;
+}
+
+
+
+/*******************************************************************/
+/* idIndexLookup                                                   */
+/* Returns the indexed node for an ID, NULL if not present.        */
+/*******************************************************************/
+static scriptNode* idIndexLookup(lsb_context* ctx, unsigned int id){
+
+    unsigned int mask, slot;
+    scriptNode* pNode;
+
+    if (ctx->pIdIndex == NULL)
+        return NULL;
 
-    printf("Error, node not found with offset 0x%X.\n",offset);
+    mask = ctx->idIndexSize - 1;
+    slot = ID_HASH(id, mask);
+    while (ctx->pIdIndex[slot] != NODE_NONE){
+        pNode = nodeAt(ctx, ctx->pIdIndex[slot]);
+        if (pNode->id == id)
+            return pNode;
+        slot = (slot + 1) & mask;
+    }
     return NULL;
 }
+
+
+
+/*******************************************************************/
+/* idIndexInsert                                                   */
+/* Adds a node to the ID index, growing the table as needed.       */
+/* A node whose ID is already indexed is counted as a duplicate.   */
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+static int idIndexInsert(lsb_context* ctx, scriptNode* pNode){
+
+    unsigned int mask, slot, x;
+
+    /* Grow at 50% load */
+    if ((ctx->idIndexCount + 1) * 2 > ctx->idIndexSize){
+        unsigned int* pOld = ctx->pIdIndex;
+        unsigned int oldSize = ctx->idIndexSize;
+        unsigned int newSize = (oldSize == 0) ? ID_INDEX_MIN_SIZE : (oldSize * 2);
+
+        ctx->pIdIndex = (unsigned int*)malloc(newSize * sizeof(unsigned int));
+        if (ctx->pIdIndex == NULL){
+            printf("Error allocing memory for the node ID index.\n");
+            ctx->pIdIndex = pOld;
+            return -1;
+        }
+        memset(ctx->pIdIndex, 0xFF, newSize * sizeof(unsigned int));
+        ctx->idIndexSize = newSize;
+        mask = newSize - 1;
+
+        /* Rehash */
+        for (x = 0; x < oldSize; x++){
+            if (pOld[x] == NODE_NONE)
+                continue;
+            slot = ID_HASH(nodeAt(ctx, pOld[x])->id, mask);
+            while (ctx->pIdIndex[slot] != NODE_NONE)
+                slot = (slot + 1) & mask;
+            ctx->pIdIndex[slot] = pOld[x];
+        }
+        if (pOld != NULL)
+            free(pOld);
+    }
+
+    mask = ctx->idIndexSize - 1;
+    slot = ID_HASH(pNode->id, mask);
+    while (ctx->pIdIndex[slot] != NODE_NONE){
+        if (nodeAt(ctx, ctx->pIdIndex[slot])->id == pNode->id){
+            ctx->idIndexDups++;
+            return 0;
+        }
+        slot = (slot + 1) & mask;
+    }
+    ctx->pIdIndex[slot] = pNode->self;
+    ctx->idIndexCount++;
+
+    return 0;
+}
+
+
+
+/*******************************************************************/
+/* idIndexRemove                                                   */
+/* Removes a node from the ID index.  If the node was the indexed  */
+/* entry for a duplicated ID, the next node in the list with that  */
+/* ID takes its place.                                             */
+/*******************************************************************/
+static void idIndexRemove(lsb_context* ctx, scriptNode* pNode){
+
+    unsigned int mask, slot, next, home;
+    scriptNode* pCurrent;
+
+    if (ctx->pIdIndex == NULL)
+        return;
+
+    mask = ctx->idIndexSize - 1;
+    slot = ID_HASH(pNode->id, mask);
+    while ((ctx->pIdIndex[slot] != NODE_NONE) && (nodeAt(ctx, ctx->pIdIndex[slot])->id != pNode->id))
+        slot = (slot + 1) & mask;
+    if (ctx->pIdIndex[slot] == NODE_NONE)
+        return;
+
+    /* Node was a duplicate, the indexed entry stays */
+    if (ctx->pIdIndex[slot] != pNode->self){
+        if (ctx->idIndexDups > 0)
+            ctx->idIndexDups--;
+        return;
+    }
+
+    /* Promote the next node in the list with the same ID */
+    if (ctx->idIndexDups > 0){
+        for (pCurrent = getHeadPtr(ctx); pCurrent != NULL; pCurrent = getNextPtr(ctx, pCurrent)){
+            if ((pCurrent != pNode) && (pCurrent->id == pNode->id)){
+                ctx->pIdIndex[slot] = pCurrent->self;
+                ctx->idIndexDups--;
+                return;
+            }
+        }
+    }
+
+    /* Delete the entry, shifting back any displaced entries */
+    ctx->pIdIndex[slot] = NODE_NONE;
+    ctx->idIndexCount--;
+    next = (slot + 1) & mask;
+    while (ctx->pIdIndex[next] != NODE_NONE){
+        home = ID_HASH(nodeAt(ctx, ctx->pIdIndex[next])->id, mask);
+        if (((next - home) & mask) >= ((next - slot) & mask)){
+            ctx->pIdIndex[slot] = ctx->pIdIndex[next];
+            ctx->pIdIndex[next] = NODE_NONE;
+            slot = next;
+        }
+        next = (next + 1) & mask;
+    }
+
+    return;
+}
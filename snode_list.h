@@ -7,6 +7,7 @@
 #ifndef SNODE_LIST_H
 #define SNODE_LIST_H
 #include "script_node_types.h"
+#include "lsb_context.h"
 
 /* Defines */
 #define METHOD_NORMAL        0 //Add at tail
@@ -16,15 +17,31 @@
 /***********************/
 /* Function Prototypes */
 /***********************/
-int initNodeList();
-int destroyNodeList();
-scriptNode* getHeadPtr();
-int createScriptNode(scriptNode** node);
-int addNode(scriptNode* node, int method, int target_id);
-int removeNode(int id);
-int overwriteNode(int id, scriptNode* node);
-scriptNode* getListItemByID(unsigned int id);
-scriptNode* getListItemByOffset(unsigned int offset);
+int initNodeList(lsb_context* ctx);
+int destroyNodeList(lsb_context* ctx);
+void releaseNodeList(lsb_context* ctx);
+scriptNode* getHeadPtr(lsb_context* ctx);
+scriptNode* getNextPtr(lsb_context* ctx, scriptNode* pNode);
+scriptNode* getPrevPtr(lsb_context* ctx, scriptNode* pNode);
+scriptNode* appendScriptNode(lsb_context* ctx, unsigned int id, int nodeType, unsigned int fileOffset);
+void* allocNodeMem(lsb_context* ctx, unsigned int numBytes);
+paramType* allocNodeParams(lsb_context* ctx, scriptNode* pNode, unsigned int numParams);
+void beginRunParams(lsb_context* ctx);
+runParamType* addRunParam(lsb_context* ctx);
+runParamType* finishRunParams(lsb_context* ctx);
+unsigned int nodeSizeForType(int nodeType);
+int addNode(lsb_context* ctx, scriptNode* node, int method, int target_id);
+int removeNode(lsb_context* ctx, int id);
+int removeListItem(lsb_context* ctx, scriptNode* pNode);
+int overwriteNode(lsb_context* ctx, int id, scriptNode* node);
+int moveNode(lsb_context* ctx, int id, int method, int target_id);
+scriptNode* getListItemByID(lsb_context* ctx, unsigned int id);
+scriptNode* getListItemByOffset(lsb_context* ctx, unsigned int offset);
+int initOffsetIndex(lsb_context* ctx, unsigned int numBytes);
+void releaseOffsetIndex(lsb_context* ctx);
+int buildOffsetIntervals(lsb_context* ctx, unsigned int endOffset);
+scriptNode* getListItemContainingOffset(lsb_context* ctx, unsigned int offset, unsigned int* pStart, unsigned int* pEnd);
+int placeOverlapNode(lsb_context* ctx, scriptNode* pOwner, scriptNode* pNode, unsigned int resumeOffset, unsigned int gotoID);
 
 
 
@@ -0,0 +1,197 @@
+/**********************************************************************/
+/* str_pool.c - Interned string pool for decoded script text.         */
+/*              Each distinct string is stored once and referenced by */
+/*              a 32-bit handle, so two strings are equal exactly     */
+/*              when their handles are.  Strings are never modified   */
+/*              or removed, the pool is released all at once.         */
+/**********************************************************************/
+
+
+/************/
+/* Includes */
+/************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "str_pool.h"
+
+
+
+/***********************/
+/* Function Prototypes */
+/***********************/
+void poolInit(strPool* pPool);
+int poolIntern(strPool* pPool, const char* str, unsigned int len, unsigned int* pHandle);
+const char* poolStr(const strPool* pPool, unsigned int handle);
+void poolFree(strPool* pPool);
+static unsigned int hashStr(const char* str, unsigned int len);
+static int growHash(strPool* pPool);
+
+
+
+/*******************************************************************/
+/* poolInit                                                        */
+/* Sets up an empty pool.  Memory is not allocated until needed.   */
+/*******************************************************************/
+void poolInit(strPool* pPool){
+
+    memset(pPool, 0, sizeof(strPool));
+
+    return;
+}
+
+
+
+/*******************************************************************/
+/* poolIntern                                                      */
+/* Gets the handle of the string made of the first len bytes of    */
+/* str, stopping early at a NUL, adding it to the pool if needed.  */
+/* The empty string is always STR_NONE.                            */
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+int poolIntern(strPool* pPool, const char* str, unsigned int len, unsigned int* pHandle){
+
+    unsigned int mask, slot, handle, hash;
+
+    *pHandle = STR_NONE;
+    len = (unsigned int)(memchr(str, '\0', len) ? strlen(str) : len);
+    if (len == 0)
+        return 0;
+
+    /* Grow at 50% load */
+    if ((pPool->count + 1) * 2 > pPool->hashSize){
+        if (growHash(pPool) != 0)
+            return -1;
+    }
+
+    /* Look for an existing copy */
+    hash = hashStr(str, len);
+    mask = pPool->hashSize - 1;
+    slot = hash & mask;
+    while (pPool->pHash[slot] != STR_NONE){
+        handle = pPool->pHash[slot];
+        if ((memcmp(pPool->pData + handle, str, len) == 0) && (pPool->pData[handle + len] == '\0')){
+            *pHandle = handle;
+            return 0;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    /* Make room, offset 0 holds the empty string */
+    if ((pPool->size + len + 1) > pPool->maxSize){
+        unsigned int newSize = (pPool->maxSize == 0) ? STR_POOL_MIN_DATA : pPool->maxSize;
+        char* pNew;
+
+        while ((pPool->size + len + 1) > newSize){
+            if (newSize > 0x7FFFFFFF){
+                printf("Error, string pool is full.\n");
+                return -1;
+            }
+            newSize *= 2;
+        }
+        pNew = (char*)realloc(pPool->pData, newSize);
+        if (pNew == NULL){
+            printf("Error allocing memory for the string pool.\n");
+            return -1;
+        }
+        pPool->pData = pNew;
+        pPool->maxSize = newSize;
+        if (pPool->size == 0)
+            pPool->pData[pPool->size++] = '\0';
+    }
+
+    handle = pPool->size;
+    memcpy(pPool->pData + handle, str, len);
+    pPool->pData[handle + len] = '\0';
+    pPool->size += len + 1;
+    pPool->pHash[slot] = handle;
+    pPool->count++;
+    *pHandle = handle;
+
+    return 0;
+}
+
+
+
+/*******************************************************************/
+/* poolStr                                                         */
+/* Returns the text for a handle.  The pointer is only valid until */
+/* the next string is added to the pool.                           */
+/*******************************************************************/
+const char* poolStr(const strPool* pPool, unsigned int handle){
+
+    if ((handle == STR_NONE) || (handle >= pPool->size))
+        return "";
+    return pPool->pData + handle;
+}
+
+
+
+/*******************************************************************/
+/* poolFree - Releases all memory held by the pool.                */
+/*******************************************************************/
+void poolFree(strPool* pPool){
+
+    if (pPool->pData != NULL)
+        free(pPool->pData);
+    if (pPool->pHash != NULL)
+        free(pPool->pHash);
+    memset(pPool, 0, sizeof(strPool));
+
+    return;
+}
+
+
+
+/*******************************************************************/
+/* hashStr - FNV-1a hash of len bytes.                             */
+/*******************************************************************/
+static unsigned int hashStr(const char* str, unsigned int len){
+
+    unsigned int hash = 2166136261u;
+    unsigned int x;
+
+    for (x = 0; x < len; x++){
+        hash ^= (unsigned char)str[x];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+
+
+/*******************************************************************/
+/* growHash                                                        */
+/* Doubles the hash table and rehashes the strings in it.          */
+/* Returns 0 on success, -1 on failure.                            */
+/*******************************************************************/
+static int growHash(strPool* pPool){
+
+    unsigned int* pOld = pPool->pHash;
+    unsigned int oldSize = pPool->hashSize;
+    unsigned int newSize = (oldSize == 0) ? STR_POOL_MIN_HASH : (oldSize * 2);
+    unsigned int mask = newSize - 1;
+    unsigned int x, slot, handle;
+
+    pPool->pHash = (unsigned int*)calloc(newSize, sizeof(unsigned int));
+    if (pPool->pHash == NULL){
+        printf("Error allocing memory for the string pool.\n");
+        pPool->pHash = pOld;
+        return -1;
+    }
+    pPool->hashSize = newSize;
+
+    for (x = 0; x < oldSize; x++){
+        handle = pOld[x];
+        if (handle == STR_NONE)
+            continue;
+        slot = hashStr(pPool->pData + handle, (unsigned int)strlen(pPool->pData + handle)) & mask;
+        while (pPool->pHash[slot] != STR_NONE)
+            slot = (slot + 1) & mask;
+        pPool->pHash[slot] = handle;
+    }
+    if (pOld != NULL)
+        free(pOld);
+
+    return 0;
+}
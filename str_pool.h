@@ -0,0 +1,37 @@
+/**********************************************************************/
+/* str_pool.h - Interned, immutable string storage.                   */
+/**********************************************************************/
+#ifdef _MSC_VER
+#pragma warning(disable:4996)
+#endif
+#ifndef STR_POOL_H
+#define STR_POOL_H
+
+/* Defines */
+#define STR_NONE           0          /* Handle of no string, reads as "" */
+#define STR_POOL_MIN_DATA  (64*1024)  /* Initial bytes of string data     */
+#define STR_POOL_MIN_HASH  1024       /* Initial # of hash slots, power of 2 */
+
+/* Pool of unique NUL terminated strings stored back to back.  A   */
+/* string's handle is its byte offset in pData, so handles stay    */
+/* valid when the pool grows but string pointers do not.           */
+typedef struct strPool{
+    char* pData;
+    unsigned int size;             /* Bytes of pData in use */
+    unsigned int maxSize;
+    unsigned int* pHash;           /* Handles, open addressing, 0 = empty */
+    unsigned int hashSize;
+    unsigned int count;            /* # of unique strings */
+}strPool;
+
+
+/***********************/
+/* Function Prototypes */
+/***********************/
+void poolInit(strPool* pPool);
+int poolIntern(strPool* pPool, const char* str, unsigned int len, unsigned int* pHandle);
+const char* poolStr(const strPool* pPool, unsigned int handle);
+void poolFree(strPool* pPool);
+
+
+#endif
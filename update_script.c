@@ -20,19 +20,15 @@
 /* Defines */
 
 
-/* Globals */
-static unsigned char* pInput = NULL;
-
-
 /* Function Prototypes */
-int updateScript(FILE* upFile);
-int readNode(scriptNode* node);
-int copy_goto(int id, scriptNode* node);
-int copy_fill(int id, scriptNode* node);
-int copy_pointer(int id, scriptNode* node);
-int copy_exesub(int id, scriptNode* node);
-int copy_runcmds(int id, scriptNode* node);
-int copy_options(int id, scriptNode* node);
+int updateScript(lsb_context* ctx, FILE* upFile);
+int readNode(lsb_context* ctx, scriptNode* node);
+int copy_goto(lsb_context* ctx, int id, scriptNode* node);
+int copy_fill(lsb_context* ctx, int id, scriptNode* node);
+int copy_pointer(lsb_context* ctx, int id, scriptNode* node);
+int copy_exesub(lsb_context* ctx, int id, scriptNode* node);
+int copy_runcmds(lsb_context* ctx, int id, scriptNode* node);
+int copy_options(lsb_context* ctx, int id, scriptNode* node);
 
 
 
@@ -44,7 +40,7 @@ int copy_options(int id, scriptNode* node);
 /* Inputs:  Pointers to input/update/output files.                           */
 /* Outputs: 0 on Pass, -1 on Fail.                                           */
 /*****************************************************************************/
-int updateScript(FILE* upFile){
+int updateScript(lsb_context* ctx, FILE* upFile){
 
     int rval;
     unsigned int fsize;
@@ -75,8 +71,8 @@ int updateScript(FILE* upFile){
     /****************************************************/
     /* Parse the input file to create the binary output */
     /****************************************************/
-    pInput = (unsigned char*)strtok((char*)pBuffer, "() \t=\r\n");
-    if ((pInput == NULL) || (strcmp((const char *)pInput, "start") != 0)) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, (char*)pBuffer, "() \t=\r\n");
+    if ((ctx->pInput == NULL) || (strcmp((const char *)ctx->pInput, "start") != 0)) {
         printf("Error, start not found\n");
         return -1;
     }
@@ -87,43 +83,43 @@ int updateScript(FILE* upFile){
     /* Parse the rest of the file until EOF or "end" is located */
     /************************************************************/
     rval = 0;
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    while ((pInput != NULL) && rval == 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    while ((ctx->pInput != NULL) && rval == 0){
         int id;
         scriptNode node;
         node.runParams = node.runParams2 = NULL;
         node.subParams = NULL;
-        node.pNext = node.pPrev = NULL;
+        node.next = node.prev = NODE_NONE;
 
         /* insert-before-ID */
-        if (strcmp((const char *)pInput, "insert-before-ID") == 0){
-            id = read_ID(pInput);
-            readNode(&node);
-            rval = addNode(&node, METHOD_INSERT_BEFORE, id);
+        if (strcmp((const char *)ctx->pInput, "insert-before-ID") == 0){
+            id = read_ID(ctx, ctx->pInput);
+            readNode(ctx, &node);
+            rval = addNode(ctx, &node, METHOD_INSERT_BEFORE, id);
         }
 
         /* insert-after-ID */
-        else if (strcmp((const char *)pInput, "insert-after-ID") == 0){
-            id = read_ID(pInput);
-            readNode(&node);
-            rval = addNode(&node, METHOD_INSERT_AFTER, id);
+        else if (strcmp((const char *)ctx->pInput, "insert-after-ID") == 0){
+            id = read_ID(ctx, ctx->pInput);
+            readNode(ctx, &node);
+            rval = addNode(ctx, &node, METHOD_INSERT_AFTER, id);
         }
 
         /* remove-ID */
-        else if (strcmp((const char *)pInput, "remove-ID") == 0){
-            id = read_ID(pInput);
-            rval = removeNode(id);
+        else if (strcmp((const char *)ctx->pInput, "remove-ID") == 0){
+            id = read_ID(ctx, ctx->pInput);
+            rval = removeNode(ctx, id);
         }
 
         /* overwrite-ID */
-        else if (strcmp((const char *)pInput, "overwrite-ID") == 0){
-            id = read_ID(pInput);
-            readNode(&node);
-            rval = overwriteNode(id, &node);
+        else if (strcmp((const char *)ctx->pInput, "overwrite-ID") == 0){
+            id = read_ID(ctx, ctx->pInput);
+            readNode(ctx, &node);
+            rval = overwriteNode(ctx, id, &node);
         }
 
         /* end */
-        else if (strcmp((const char *)pInput, "end") == 0){
+        else if (strcmp((const char *)ctx->pInput, "end") == 0){
             printf("Detected END\n");
             break;
         }
@@ -137,7 +133,7 @@ int updateScript(FILE* upFile){
             return rval;
 
         /* Read Next Token */
-        pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
     }
 
     return 0;
@@ -146,47 +142,47 @@ int updateScript(FILE* upFile){
 
 
 
-int readNode(scriptNode* node){
+int readNode(lsb_context* ctx, scriptNode* node){
 
     int rval = 0;
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if ((pInput != NULL) && rval == 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if ((ctx->pInput != NULL) && rval == 0){
         int id;
 
         /* goto */
-        if (strcmp((const char *)pInput, "goto") == 0){
-            id = read_ID(pInput);
-            rval = copy_goto(id, node);
+        if (strcmp((const char *)ctx->pInput, "goto") == 0){
+            id = read_ID(ctx, ctx->pInput);
+            rval = copy_goto(ctx, id, node);
         }
 
         /* fill-space */
-        else if (strcmp((const char *)pInput, "fill-space") == 0){
-            id = read_ID(pInput);
-            rval = copy_fill(id, node);
+        else if (strcmp((const char *)ctx->pInput, "fill-space") == 0){
+            id = read_ID(ctx, ctx->pInput);
+            rval = copy_fill(ctx, id, node);
         }
 
         /* pointer */
-        else if (strcmp((const char *)pInput, "pointer") == 0){
-            id = read_ID(pInput);
-            rval = copy_pointer(id, node);
+        else if (strcmp((const char *)ctx->pInput, "pointer") == 0){
+            id = read_ID(ctx, ctx->pInput);
+            rval = copy_pointer(ctx, id, node);
         }
 
         /* execute-subroutine */
-        else if (strcmp((const char *)pInput, "execute-subroutine") == 0){
-            id = read_ID(pInput);
-            rval = copy_exesub(id, node);
+        else if (strcmp((const char *)ctx->pInput, "execute-subroutine") == 0){
+            id = read_ID(ctx, ctx->pInput);
+            rval = copy_exesub(ctx, id, node);
         }
 
         /* run-commands */
-        else if (strcmp((const char *)pInput, "run-commands") == 0){
-            id = read_ID(pInput);
-            rval = copy_runcmds(id, node);
+        else if (strcmp((const char *)ctx->pInput, "run-commands") == 0){
+            id = read_ID(ctx, ctx->pInput);
+            rval = copy_runcmds(ctx, id, node);
         }
 
         /* options */
-        else if (strcmp((const char *)pInput, "options") == 0){
-            id = read_ID(pInput);
-            rval = copy_options(id, node);
+        else if (strcmp((const char *)ctx->pInput, "options") == 0){
+            id = read_ID(ctx, ctx->pInput);
+            rval = copy_options(ctx, id, node);
         }
 
         else{
@@ -206,22 +202,22 @@ int readNode(scriptNode* node){
 /******************************/
 /* goto                       */
 /******************************/
-int copy_goto(int id, scriptNode* node){
+int copy_goto(lsb_context* ctx, int id, scriptNode* node){
 
     unsigned int offset;
 
     memset(node, 0, sizeof(scriptNode));
 
     /* read location */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((const char *)pInput, "location") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((const char *)ctx->pInput, "location") != 0) {
         printf("Error, location expected\n");
         return -1;
     }
 
     /* read offset */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (readLW(pInput, &offset) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (readLW(ctx, ctx->pInput, &offset) < 0){
         printf("Error invalid goto offset\n");
         return -1;
     }
@@ -238,7 +234,7 @@ int copy_goto(int id, scriptNode* node){
 /******************************/
 /* fill                       */
 /******************************/
-int copy_fill(int id, scriptNode* node){
+int copy_fill(lsb_context* ctx, int id, scriptNode* node){
 
     unsigned int unitSize = 0;
     unsigned int unitCount = 0;
@@ -247,37 +243,37 @@ int copy_fill(int id, scriptNode* node){
     memset(node, 0, sizeof(scriptNode));
 
     /* read unit-size */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((const char *)pInput, "unit-size") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((const char *)ctx->pInput, "unit-size") != 0) {
         printf("Error, unit-size expected\n");
         return -1;
     }
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (readLW(pInput, &unitSize) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (readLW(ctx, ctx->pInput, &unitSize) < 0){
         printf("Error invalid goto offset\n");
         return -1;
     }
 
     /* read fill-value */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((const char *)pInput, "fill-value") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((const char *)ctx->pInput, "fill-value") != 0) {
         printf("Error, fill-value expected\n");
         return -1;
     }
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (readLW(pInput, &fillValue) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (readLW(ctx, ctx->pInput, &fillValue) < 0){
         printf("Error invalid unit size\n");
         return -1;
     }
 
     /* read unit-count */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((const char *)pInput, "unit-count") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((const char *)ctx->pInput, "unit-count") != 0) {
         printf("Error, unit-count expected\n");
         return -1;
     }
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (readLW(pInput, &unitCount) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (readLW(ctx, ctx->pInput, &unitCount) < 0){
         printf("Error invalid unit count\n");
         return -1;
     }
@@ -296,7 +292,7 @@ int copy_fill(int id, scriptNode* node){
 /******************************/
 /* pointer                    */
 /******************************/
-int copy_pointer(int id, scriptNode* node){
+int copy_pointer(lsb_context* ctx, int id, scriptNode* node){
 
     unsigned int byteOffset;
     unsigned int dataSize;
@@ -307,42 +303,42 @@ int copy_pointer(int id, scriptNode* node){
     memset(node, 0, sizeof(scriptNode));
 
     /* read byteoffset */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((const char *)pInput, "byteoffset") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((const char *)ctx->pInput, "byteoffset") != 0) {
         printf("Error, byteoffset expected\n");
         return -1;
     }
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (readLW(pInput, &byteOffset) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (readLW(ctx, ctx->pInput, &byteOffset) < 0){
         printf("Error invalid pointer byte offset\n");
         return -1;
     }
 
     /* read size of pointer */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((const char *)pInput, "size") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((const char *)ctx->pInput, "size") != 0) {
         printf("Error, size expected\n");
         return -1;
     }
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (readLW(pInput, &dataSize) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (readLW(ctx, ctx->pInput, &dataSize) < 0){
         printf("Error invalid pointer data size\n");
         return -1;
     }
 
     /* read value or id to point to */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((const char *)pInput, "value") == 0) {
-        pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-        if (readLW(pInput, &value) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((const char *)ctx->pInput, "value") == 0) {
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+        if (readLW(ctx, ctx->pInput, &value) < 0){
             printf("Error invalid value\n");
             return -1;
         }
         value_selected = 1;
     }
-    else if (strcmp((const char *)pInput, "id-link") == 0) {
-        pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-        if (readLW(pInput, &id_link) < 0){
+    else if (strcmp((const char *)ctx->pInput, "id-link") == 0) {
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+        if (readLW(ctx, ctx->pInput, &id_link) < 0){
             printf("Error invalid id\n");
             return -1;
         }
@@ -372,7 +368,7 @@ int copy_pointer(int id, scriptNode* node){
 /******************************/
 /* execute-subroutine         */
 /******************************/
-int copy_exesub(int id, scriptNode* node){
+int copy_exesub(lsb_context* ctx, int id, scriptNode* node){
 
     int x;
     unsigned short subrtn_code;
@@ -383,25 +379,25 @@ int copy_exesub(int id, scriptNode* node){
     memset(node, 0, sizeof(scriptNode));
 
     /* Read subroutine value */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((const char *)pInput, "subroutine") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((const char *)ctx->pInput, "subroutine") != 0) {
         printf("Error, subroutine expected\n");
         return -1;
     }
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (readSW(pInput, &subrtn_code) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (readSW(ctx, ctx->pInput, &subrtn_code) < 0){
         printf("Error invalid subroutine code\n");
         return -1;
     }
 
     /* read num-parameters */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((const char *)pInput, "num-parameters") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((const char *)ctx->pInput, "num-parameters") != 0) {
         printf("Error, num-parameters expected\n");
         return -1;
     }
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (readLW(pInput, &numparam) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (readLW(ctx, ctx->pInput, &numparam) < 0){
         printf("Error invalid number of parameters\n");
         return -1;
     }
@@ -409,19 +405,19 @@ int copy_exesub(int id, scriptNode* node){
     if (numparam > 0){
 
         /* read align-fill-byteval */
-        pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-        if (strcmp((const char *)pInput, "align-fill-byteval") != 0) {
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+        if (strcmp((const char *)ctx->pInput, "align-fill-byteval") != 0) {
             printf("Error, align-fill-byteval expected\n");
             return -1;
         }
-        pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-        if (readBYTE(pInput, &fillVal) < 0){
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+        if (readBYTE(ctx, ctx->pInput, &fillVal) < 0){
             printf("Error invalid alignment byte fill value\n");
             return -1;
         }
 
         /* Allocate memory for parameters */
-        params = (paramType*)malloc(numparam * sizeof(paramType));
+        params = (paramType*)allocNodeMem(ctx, numparam * sizeof(paramType));
         if (params == NULL){
             printf("Error allocing memory for parameters\n");
             return -1;
@@ -432,24 +428,24 @@ int copy_exesub(int id, scriptNode* node){
         /**********************/
 
         /* Parameter Type Information */
-        pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-        if (strcmp((const char *)pInput, "parameter-types") != 0) {
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+        if (strcmp((const char *)ctx->pInput, "parameter-types") != 0) {
             printf("Error, parameter-types expected\n");
             return -1;
         }
         for (x = 0; x < (int)numparam; x++){
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-            if (strcmp((const char *)pInput, "1") == 0)
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+            if (strcmp((const char *)ctx->pInput, "1") == 0)
                 params[x].type = BYTE_PARAM;
-            else if (strcmp((const char *)pInput, "2") == 0)
+            else if (strcmp((const char *)ctx->pInput, "2") == 0)
                 params[x].type = SHORT_PARAM;
-            else if (strcmp((const char *)pInput, "4") == 0)
+            else if (strcmp((const char *)ctx->pInput, "4") == 0)
                 params[x].type = LONG_PARAM;
-            else if (strcmp((const char *)pInput, "align-2") == 0)
+            else if (strcmp((const char *)ctx->pInput, "align-2") == 0)
                 params[x].type = ALIGN_2_PARAM;
-            else if (strcmp((const char *)pInput, "align-4") == 0)
+            else if (strcmp((const char *)ctx->pInput, "align-4") == 0)
                 params[x].type = ALIGN_4_PARAM;
-			else if (strcmp((const char *)pInput, "subtitle") == 0)
+			else if (strcmp((const char *)ctx->pInput, "subtitle") == 0)
 				params[x].type = SUBT_STR;
             else{
                 printf("Error invalid parameter type read\n");
@@ -458,8 +454,8 @@ int copy_exesub(int id, scriptNode* node){
         }
 
         /* Parameter Values */
-        pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-        if (strcmp((const char *)pInput, "parameter-values") != 0) {
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+        if (strcmp((const char *)ctx->pInput, "parameter-values") != 0) {
             printf("Error, parameter-values expected\n");
             return -1;
         }
@@ -468,8 +464,8 @@ int copy_exesub(int id, scriptNode* node){
 				|| (params[x].type == SUBT_STR))
                 continue;
 
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-            if (readLW(pInput, &params[x].value) < 0){
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+            if (readLW(ctx, ctx->pInput, &params[x].value) < 0){
                 printf("Error invalid parameter value\n");
                 return -1;
             }
@@ -494,59 +490,49 @@ int copy_exesub(int id, scriptNode* node){
 /******************************/
 /* run-commands               */
 /******************************/
-int copy_runcmds(int id, scriptNode* node){
+int copy_runcmds(lsb_context* ctx, int id, scriptNode* node){
 
     runParamType* rpNode;
-    runParamType* rpHead = NULL;
-    runParamType* pPrev = NULL;
+    runParamType* rpCmds;
     int len = 0;
 
     memset(node, 0, sizeof(scriptNode));
 
     /* read series of commands until the end of them is reached */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    while (strcmp((const char *)pInput, "commands-end") != 0) {
+    beginRunParams(ctx);
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    while (strcmp((const char *)ctx->pInput, "commands-end") != 0) {
 
         /* Create a runcmds parameter */
-        rpNode = (runParamType*)malloc(sizeof(runParamType));
+        rpNode = addRunParam(ctx);
         if (rpNode == NULL){
             printf("Error allocing space for run parameter struct.\n");
             return -1;
         }
-        rpNode->str = NULL;
-        rpNode->pNext = NULL;
-
-        /* Book keeping */
-        if (rpHead == NULL)
-            rpHead = rpNode;
-        if (pPrev != NULL){
-            pPrev->pNext = rpNode;
-        }
 
         /* print-line */
-        if (strcmp((const char *)pInput, "print-line") == 0){
+        if (strcmp((const char *)ctx->pInput, "print-line") == 0){
             unsigned char* pText;
 
             /* Get Text String (UTF-8) */
-            pInput = (unsigned char*)strtok(NULL, "\"");
-            if (pInput == NULL){
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "\"");
+            if (ctx->pInput == NULL){
                 printf("Error, bad text input.\n");
                 return -1;
             }
-            pText = pInput;
+            pText = ctx->pInput;
             len = strlen((char *)pText);
 
             rpNode->type = PRINT_LINE;
-            rpNode->str = malloc(len + 1);
-            memset(rpNode->str, 0, len + 1);
-            memcpy(rpNode->str, pText, len);
+            if (poolIntern(&ctx->strings, (char *)pText, len, &rpNode->str) != 0)
+                return -1;
         }
 
         /* show-portrait-left */
-        else if (strcmp((const char *)pInput, "show-portrait-left") == 0){
+        else if (strcmp((const char *)ctx->pInput, "show-portrait-left") == 0){
             unsigned char portraitCode;
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-            if (readBYTE(pInput, &portraitCode) < 0){
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+            if (readBYTE(ctx, ctx->pInput, &portraitCode) < 0){
                 printf("Error invalid portrait code.\n");
                 return -1;
             }
@@ -557,10 +543,10 @@ int copy_runcmds(int id, scriptNode* node){
         }
 
         /* show-portrait-right */
-        else if (strcmp((const char *)pInput, "show-portrait-right") == 0){
+        else if (strcmp((const char *)ctx->pInput, "show-portrait-right") == 0){
             unsigned char portraitCode;
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-            if (readBYTE(pInput, &portraitCode) < 0){
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+            if (readBYTE(ctx, ctx->pInput, &portraitCode) < 0){
                 printf("Error invalid portrait code.\n");
                 return -1;
             }
@@ -571,10 +557,10 @@ int copy_runcmds(int id, scriptNode* node){
         }
 
         /* time-delay */
-        else if (strcmp((const char *)pInput, "time-delay") == 0){
+        else if (strcmp((const char *)ctx->pInput, "time-delay") == 0){
             unsigned char timedelay;
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-            if (readBYTE(pInput, &timedelay) < 0){
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+            if (readBYTE(ctx, ctx->pInput, &timedelay) < 0){
                 printf("Error invalid time delay.\n");
                 return -1;
             }
@@ -585,10 +571,10 @@ int copy_runcmds(int id, scriptNode* node){
         }
 
         /* control-code */
-        else if (strcmp((const char *)pInput, "control-code") == 0){
+        else if (strcmp((const char *)ctx->pInput, "control-code") == 0){
             unsigned short ctrlCode;
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-            if (readSW(pInput, &ctrlCode) < 0){
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+            if (readSW(ctx, ctx->pInput, &ctrlCode) < 0){
                 printf("Error invalid control code.\n");
                 return -1;
             }
@@ -599,10 +585,10 @@ int copy_runcmds(int id, scriptNode* node){
         }
 
         /* align-2 */
-        else if (strcmp((const char *)pInput, "align-2") == 0){
+        else if (strcmp((const char *)ctx->pInput, "align-2") == 0){
             unsigned char fillVal;
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-            if (readBYTE(pInput, &fillVal) < 0){
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+            if (readBYTE(ctx, ctx->pInput, &fillVal) < 0){
                 printf("Error invalid fill value.\n");
                 return -1;
             }
@@ -613,10 +599,10 @@ int copy_runcmds(int id, scriptNode* node){
         }
 
         /* align-4 */
-        else if (strcmp((const char *)pInput, "align-4") == 0){
+        else if (strcmp((const char *)ctx->pInput, "align-4") == 0){
             unsigned char fillVal;
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-            if (readBYTE(pInput, &fillVal) < 0){
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+            if (readBYTE(ctx, ctx->pInput, &fillVal) < 0){
                 printf("Error invalid fill value.\n");
                 return -1;
             }
@@ -628,21 +614,23 @@ int copy_runcmds(int id, scriptNode* node){
 
         /* Unknown */
         else{
-            printf("Error unknown command %s detected in run-commands\n", pInput);
+            printf("Error unknown command %s detected in run-commands\n", ctx->pInput);
             return -1;
         }
 
-        pPrev = rpNode;
-
         /* Read next token */
-        pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
     }
 
+    rpCmds = finishRunParams(ctx);
+    if (rpCmds == NULL)
+        return -1;
+
     /* Create a script node */
     node->nodeType = NODE_RUN_CMDS;
     node->id = id;
     node->subroutine_code = 0x0002;
-    node->runParams = rpHead;
+    node->runParams = rpCmds;
     node->subParams = NULL;
 
     return 0;
@@ -654,15 +642,13 @@ int copy_runcmds(int id, scriptNode* node){
 /*************************/
 /* options               */
 /*************************/
-int copy_options(int id, scriptNode* node){
+int copy_options(lsb_context* ctx, int id, scriptNode* node){
 
     int x;
     unsigned short jmpParam, param2;
     paramType* params = NULL;
     runParamType* rpNode;
-    runParamType* rpHead = NULL;
-    runParamType* rpHead1 = NULL;
-    runParamType* pPrev = NULL;
+    runParamType* rpOpt[2];
     int len = 0;
 
     memset(node, 0, sizeof(scriptNode));
@@ -672,31 +658,31 @@ int copy_options(int id, scriptNode* node){
     /***********************************************/
 
     /* JMP Offset */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((const char *)pInput, "jmpparam") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((const char *)ctx->pInput, "jmpparam") != 0) {
         printf("Error, jmpparam expected\n");
         return -1;
     }
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (readSW(pInput, &jmpParam) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (readSW(ctx, ctx->pInput, &jmpParam) < 0){
         printf("Error invalid subroutine code\n");
         return -1;
     }
 
     /* 2nd Parameter */
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (strcmp((const char *)pInput, "param2") != 0) {
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (strcmp((const char *)ctx->pInput, "param2") != 0) {
         printf("Error, param2 expected\n");
         return -1;
     }
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-    if (readSW(pInput, &param2) < 0){
+    ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+    if (readSW(ctx, ctx->pInput, &param2) < 0){
         printf("Error invalid subroutine code\n");
         return -1;
     }
 
     /* Allocate Subroutine Parameters and copy */
-    params = (paramType*)malloc(2 * sizeof(paramType));
+    params = (paramType*)allocNodeMem(ctx, 2 * sizeof(paramType));
     if (params == NULL){
         printf("Error allocing memory for parameters\n");
         return -1;
@@ -710,65 +696,53 @@ int copy_options(int id, scriptNode* node){
     for (x = 0; x < 2; x++){
 
         if (x == 0){
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-            if (strcmp((const char *)pInput, "opt1") != 0) {
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+            if (strcmp((const char *)ctx->pInput, "opt1") != 0) {
                 printf("Error, opt1 expected\n");
                 return -1;
             }
         }
         else{
-            rpHead1 = rpHead;
-            rpHead = NULL;
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-            if (strcmp((const char *)pInput, "opt2") != 0) {
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+            if (strcmp((const char *)ctx->pInput, "opt2") != 0) {
                 printf("Error, opt2 expected\n");
                 return -1;
             }
         }
-        pPrev = NULL;
-        pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-        while (strcmp((const char *)pInput, "opt-end") != 0) {
+        beginRunParams(ctx);
+        ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+        while (strcmp((const char *)ctx->pInput, "opt-end") != 0) {
 
             /* Create a runcmds parameter */
-            rpNode = (runParamType*)malloc(sizeof(runParamType));
+            rpNode = addRunParam(ctx);
             if (rpNode == NULL){
                 printf("Error allocing space for run parameter struct.\n");
                 return -1;
             }
-            rpNode->str = NULL;
-            rpNode->pNext = NULL;
-
-            /* Book keeping */
-            if (rpHead == NULL)
-                rpHead = rpNode;
-            if (pPrev != NULL){
-                pPrev->pNext = rpNode;
-            }
 
             /* print-line */
-            if (strcmp((const char *)pInput, "print-line") == 0){
+            if (strcmp((const char *)ctx->pInput, "print-line") == 0){
                 unsigned char* pText;
 
                 /* Get Text String (UTF-8) */
-                pInput = (unsigned char*)strtok(NULL, "\"");
-                if (pInput == NULL){
+                ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "\"");
+                if (ctx->pInput == NULL){
                     printf("Error, bad text input.\n");
                     return -1;
                 }
-                pText = pInput;
+                pText = ctx->pInput;
                 len = strlen((const char *)pText);
 
                 rpNode->type = PRINT_LINE;
-                rpNode->str = malloc(len + 1);
-                memset(rpNode->str, 0, len + 1);
-                memcpy(rpNode->str, pText, len);
+                if (poolIntern(&ctx->strings, (char *)pText, len, &rpNode->str) != 0)
+                    return -1;
             }
 
             /* control-code */
-            else if (strcmp((const char *)pInput, "control-code") == 0){
+            else if (strcmp((const char *)ctx->pInput, "control-code") == 0){
                 unsigned short ctrlCode;
-                pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-                if (readSW(pInput, &ctrlCode) < 0){
+                ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+                if (readSW(ctx, ctx->pInput, &ctrlCode) < 0){
                     printf("Error invalid control code.\n");
                     return -1;
                 }
@@ -779,10 +753,10 @@ int copy_options(int id, scriptNode* node){
             }
 
             /* align-2 */
-            else if (strcmp((const char *)pInput, "align-2") == 0){
+            else if (strcmp((const char *)ctx->pInput, "align-2") == 0){
                 unsigned char fillVal;
-                pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-                if (readBYTE(pInput, &fillVal) < 0){
+                ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+                if (readBYTE(ctx, ctx->pInput, &fillVal) < 0){
                     printf("Error invalid fill value.\n");
                     return -1;
                 }
@@ -793,10 +767,10 @@ int copy_options(int id, scriptNode* node){
             }
 
             /* align-4 */
-            else if (strcmp((const char *)pInput, "align-4") == 0){
+            else if (strcmp((const char *)ctx->pInput, "align-4") == 0){
                 unsigned char fillVal;
-                pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
-                if (readBYTE(pInput, &fillVal) < 0){
+                ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
+                if (readBYTE(ctx, ctx->pInput, &fillVal) < 0){
                     printf("Error invalid fill value.\n");
                     return -1;
                 }
@@ -808,15 +782,16 @@ int copy_options(int id, scriptNode* node){
 
             /* Unknown */
             else{
-                printf("Error unknown command %s detected in run-commands\n", pInput);
+                printf("Error unknown command %s detected in run-commands\n", ctx->pInput);
                 return -1;
             }
 
-            pPrev = rpNode;
-
             /* Read next token */
-            pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
+            ctx->pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
         }
+        rpOpt[x] = finishRunParams(ctx);
+        if (rpOpt[x] == NULL)
+            return -1;
     }
 
     /* Create a script node */
@@ -825,8 +800,8 @@ int copy_options(int id, scriptNode* node){
     node->subroutine_code = 0x0007;
     node->alignfillVal = 0xFF;
     node->num_parameters = 2;
-    node->runParams = rpHead1;
-    node->runParams2 = rpHead;
+    node->runParams = rpOpt[0];
+    node->runParams2 = rpOpt[1];
     node->subParams = params;
 
     return 0;
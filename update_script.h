@@ -3,8 +3,9 @@
 
 #include <stdio.h>
 #include "script_node_types.h"
+#include "lsb_context.h"
 
-int updateScript(FILE* upFile);
+int updateScript(lsb_context* ctx, FILE* upFile);
 
 
 #endif
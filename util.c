@@ -17,68 +17,77 @@
 /***********/
 /* Defines */
 /***********/
-#define MAX_STORED_CHARACTERS 4096
+#define GLYPH_TABLE_MIN      256     /* Initial font table allocation */
+#define GLYPH_HASH_EMPTY     0       /* Packed value of an unused slot */
+#define GLYPH_HASH(p)        (((p) * 0x9E3779B1u) >> 8)
 
 
 /***********************/
 /* Function Prototypes */
 /***********************/
-void setSSSEncode();
-int getSSSEncode();
+void setSSSEncode(lsb_context* ctx);
+int getSSSEncode(lsb_context* ctx);
 void swap16(void* pWd);
 void swap32(void* pWd);
 int numBytesInUtf8Char(unsigned char val);
-int loadUTF8Table(char* fname);
+int loadUTF8Table(char* fname, int sssMode);
 int getUTF8character(int index, char* utf8Value);
+const char* getUTF8string(int index);
 int getUTF8code_Byte(char* utf8Value, unsigned char* utf8Code);
 int getUTF8code_Short(char* utf8Value, unsigned short* utf8Code);
-
-void setBinOutputMode(int mode);
-int getBinOutputMode();
-void setBinMaxSize(unsigned int maxSize);
-unsigned int getBinMaxSize();
-void setMetaScriptInputMode(int mode);
-int getMetaScriptInputMode();
-void setTableOutputMode(int mode);
-int getTableOutputMode();
+void releaseUTF8Table();
+unsigned int packUTF8(const char* utf8Value);
+static int findGlyphCode(const char* utf8Value);
+static int buildGlyphHash();
+
+void setBinOutputMode(lsb_context* ctx, int mode);
+int getBinOutputMode(lsb_context* ctx);
+void setBinMaxSize(lsb_context* ctx, unsigned int maxSize);
+unsigned int getBinMaxSize(lsb_context* ctx);
+int setPtrTableLayout(lsb_context* ctx, unsigned int numEntries, unsigned int entrySize);
+unsigned int getPtrTableEntries(lsb_context* ctx);
+unsigned int getPtrEntrySize(lsb_context* ctx);
+void setMetaScriptInputMode(lsb_context* ctx, int mode);
+int getMetaScriptInputMode(lsb_context* ctx);
+void setTableOutputMode(lsb_context* ctx, int mode);
+int getTableOutputMode(lsb_context* ctx);
 
 /**************************/
 /* Meta Script Read Fctns */
 /**************************/
-int read_ID(unsigned char* pInput);
-int readLW(unsigned char* pInput, unsigned int* data);
-int readSW(unsigned char* pInput, unsigned short* datas);
-int readBYTE(unsigned char* pInput, unsigned char* datab);
+char* nextToken(lsb_context* ctx, char* str, const char* delims);
+int read_ID(lsb_context* ctx, unsigned char* pInput);
+int readLW(lsb_context* ctx, unsigned char* pInput, unsigned int* data);
+int readSW(lsb_context* ctx, unsigned char* pInput, unsigned short* datas);
+int readBYTE(lsb_context* ctx, unsigned char* pInput, unsigned char* datab);
 
 /* Decode Related Functions */
-int getTextDecodeMethod();
-void setTextDecodeMethod(int method);
-int checkSSSItemHack();
-
-/* Global Array of UTF8 Data */
-static char utf8Array[MAX_STORED_CHARACTERS][5];
-static int enable_SSS_mode = 0;
-static int numEntries = 0;
-
-/* I/O Globals*/
-static int textDecodeMode = TEXT_DECODE_TWO_BYTES_PER_CHAR;  //Binary Input File Encoding for Text
-static int outputMode = LUNAR_BIG_ENDIAN;  //Script Text File Value Encoding
-static int inputMode = RADIX_HEX;    //Script Text File Value Representation
-static int tableMode = TWO_BYTE_ENC; //Table File Encoding Method
-static unsigned int maxBinFsize = 0; //MAX allowed size of a binary script file
-int G_IOS_ENG = 0; //Flag to signify IOS ENG Input
-static int G_SSS_ITEM_HACK_ENABLED = 0;
+int getTextDecodeMethod(lsb_context* ctx);
+void setTextDecodeMethod(lsb_context* ctx, int method);
+int checkSSSItemHack(lsb_context* ctx);
+
+/* Font table, filled by loadUTF8Table and read only afterwards.   */
+/* utf8Array holds the NUL terminated character for each code, the */
+/* glyph hash maps a packed character back to its lowest code.     */
+typedef struct glyphSlot{
+    unsigned int packed;
+    unsigned int code;
+}glyphSlot;
+static char (*utf8Array)[5] = NULL;
+static unsigned int numGlyphs = 0;
+static glyphSlot* glyphHash = NULL;
+static unsigned int glyphHashMask = 0;
 
 /***********************************************************************/
 /* setSSSEncode                                                        */
 /* Dynamically modifies the inputting of the SSSC table to resemble an */
 /* SSS table (adds the '.' character back in.                          */
 /***********************************************************************/
-void setSSSEncode(){
-    enable_SSS_mode = 1;
+void setSSSEncode(lsb_context* ctx){
+    ctx->sssEncode = 1;
 }
-int getSSSEncode(){
-	return enable_SSS_mode;
+int getSSSEncode(lsb_context* ctx){
+	return ctx->sssEncode;
 }
 
 
@@ -145,15 +154,21 @@ int numBytesInUtf8Char(unsigned char val){
 /* Lines should end in line feed, tabs and spaces may be used for  */
 /* separation.                                                     */
 /* (No real safety checks if the input file is formatted wrong)    */
+/* sssMode selects the SSS variant of the table (see setSSSEncode) */
 /*******************************************************************/
-int loadUTF8Table(char* fname){
+int loadUTF8Table(char* fname, int sssMode){
 
     static char linebuf[300];
     int index, numBytes, x;
+    unsigned int allocSize, newSize;
+    char (*pNewArray)[5];
     FILE* infile = NULL;
     char* ptr_line = NULL;
     memset(linebuf, 0, 300);
 
+    releaseUTF8Table();
+    allocSize = 0;
+
     /* Open the input file */
     infile = fopen(fname,"r");
     if(infile == NULL){
@@ -181,17 +196,35 @@ int loadUTF8Table(char* fname){
             ptr_line++;
 
         /* Hack for SSS */
-        if ((enable_SSS_mode) && (index >= 769)){
+        if ((sssMode) && (index >= 769)){
             index++;
         }
 
         /* Index Bounds Check */
-        if(index >= MAX_STORED_CHARACTERS){
-            printf("Error, static array cannot support an index location of %d!\n",index);
-            printf("Static array fixed to locations 0-%d\n",MAX_STORED_CHARACTERS-1);
+        if ((index < 0) || (index > 0xFFFF)){
+            printf("Error, font table index location of %d is out of range!\n",index);
+            fclose(infile);
             return -1;
         }
 
+        /* Grow the table to hold the index */
+        if ((unsigned int)index >= allocSize){
+            newSize = (allocSize == 0) ? GLYPH_TABLE_MIN : allocSize;
+            while (newSize <= (unsigned int)index)
+                newSize *= 2;
+            pNewArray = (char (*)[5])realloc(utf8Array, newSize * 5);
+            if (pNewArray == NULL){
+                printf("Error allocating font table.\n");
+                fclose(infile);
+                return -1;
+            }
+            memset(&pNewArray[allocSize][0], 0, (newSize - allocSize) * 5);
+            utf8Array = pNewArray;
+            allocSize = newSize;
+        }
+        if ((unsigned int)index >= numGlyphs)
+            numGlyphs = index + 1;
+
         /* Init the array for the index */
         memset(&(utf8Array[index][0]),0,5);
 
@@ -219,18 +252,38 @@ int loadUTF8Table(char* fname){
             ptr_line++;
             utf8Array[index][x] = *ptr_line;
         }
-        numEntries++;
     }
 
     fclose(infile);
 
     /* Hack for SSS -- Fill in '.' at offset 769 */
-    if (enable_SSS_mode){
+    if (sssMode){
+        if (numGlyphs <= 769){
+            printf("Error, SSS font table must hold more than 769 characters.\n");
+            return -1;
+        }
         memset(&(utf8Array[769][0]), 0, 5);
         utf8Array[769][0] = '.';
     }
 
-    return 0;
+    return buildGlyphHash();
+}
+
+
+
+
+/*******************************************************************/
+/* releaseUTF8Table - Frees the font table and its glyph hash.     */
+/*******************************************************************/
+void releaseUTF8Table(){
+
+    free(utf8Array);
+    free(glyphHash);
+    utf8Array = NULL;
+    glyphHash = NULL;
+    numGlyphs = glyphHashMask = 0;
+
+    return;
 }
 
 
@@ -244,9 +297,8 @@ int loadUTF8Table(char* fname){
 /*******************************************************************/
 int getUTF8character(int index, char* utf8Value){
 
-    if(index >= MAX_STORED_CHARACTERS){
-        printf("Error, static array index location of %d does not exist!\n",index);
-        printf("Static array fixed to locations 0-%d\n",MAX_STORED_CHARACTERS-1);
+    if ((index < 0) || ((unsigned int)index >= numGlyphs)){
+        printf("Error, font table index location of %d does not exist!\n",index);
         return -1;
     }
     memcpy(utf8Value,&utf8Array[index][0],5);
@@ -254,27 +306,35 @@ int getUTF8character(int index, char* utf8Value){
 }
 
 
+/*******************************************************************/
+/* getUTF8string                                                   */
+/* Returns the NUL terminated UTF-8 Data for a given index         */
+/* location without copying it, or NULL if the index is invalid.   */
+/*******************************************************************/
+const char* getUTF8string(int index){
+
+    if ((index < 0) || ((unsigned int)index >= numGlyphs)){
+        printf("Error, font table index location of %d does not exist!\n",index);
+        return NULL;
+    }
+    return &utf8Array[index][0];
+}
+
+
 /*******************************************************************/
 /* getUTF8code_Byte                                                */
-/* Copies in the UTF-8 Code for a given UTF-8 character            */
+/* Copies in the UTF-8 Code for a given UTF-8 character.  Fails if */
+/* the character is not in the table or its code needs two bytes.  */
 /*******************************************************************/
 int getUTF8code_Byte(char* utf8Value, unsigned char* utf8Code){
 
-    int x,y,numBytes;
-    numBytes = numBytesInUtf8Char((unsigned char)*utf8Value);
+    int code = findGlyphCode(utf8Value);
 
-    for (x = 0; x < numEntries; x++){
-        for (y = 0; y < numBytes; y++){
-            if (utf8Array[x][y] != utf8Value[y])
-                break;
-            if (y == (numBytes - 1)){
-                *utf8Code = (unsigned char)x;
-                return 0;
-            }
-        }
-    }
+    if ((code < 0) || (code > 0xFF))
+        return -1;
+    *utf8Code = (unsigned char)code;
 
-    return -1;
+    return 0;
 }
 
 
@@ -284,83 +344,189 @@ int getUTF8code_Byte(char* utf8Value, unsigned char* utf8Code){
 /*******************************************************************/
 int getUTF8code_Short(char* utf8Value, unsigned short* utf8Code){
 
-    int x, y, numBytes;
+    int code = findGlyphCode(utf8Value);
+
+    if (code < 0)
+        return -1;
+    *utf8Code = (unsigned short)code;
+
+    return 0;
+}
+
+
+
+
+/*******************************************************************/
+/* packUTF8                                                        */
+/* Packs the bytes of one UTF-8 character into an unsigned int,    */
+/* first byte highest.  Distinct characters pack to distinct       */
+/* values, NUL packs to 0.                                         */
+/*******************************************************************/
+unsigned int packUTF8(const char* utf8Value){
+
+    unsigned int packed = 0;
+    int x, numBytes;
+
     numBytes = numBytesInUtf8Char((unsigned char)*utf8Value);
+    for (x = 0; x < numBytes; x++)
+        packed = (packed << 8) | (unsigned char)utf8Value[x];
+
+    return packed;
+}
 
-    for (x = 0; x < numEntries; x++){
-        for (y = 0; y < numBytes; y++){
-            if (utf8Array[x][y] != utf8Value[y])
+
+
+
+/*******************************************************************/
+/* findGlyphCode                                                   */
+/* Returns the lowest code of a UTF-8 character in the font table, */
+/* or -1 if it is not there.  One hash probe in the common case.   */
+/*******************************************************************/
+static int findGlyphCode(const char* utf8Value){
+
+    unsigned int packed, slot;
+
+    packed = packUTF8(utf8Value);
+    if ((glyphHash == NULL) || (packed == GLYPH_HASH_EMPTY))
+        return -1;
+
+    slot = GLYPH_HASH(packed);
+    while (1){
+        slot &= glyphHashMask;
+        if (glyphHash[slot].packed == packed)
+            return (int)glyphHash[slot].code;
+        if (glyphHash[slot].packed == GLYPH_HASH_EMPTY)
+            return -1;
+        slot++;
+    }
+}
+
+
+
+
+/*******************************************************************/
+/* buildGlyphHash                                                  */
+/* Builds the packed character -> code hash from utf8Array.  Codes */
+/* are added lowest first and duplicates skipped, so a character   */
+/* listed twice encodes to its first code as with a table scan.    */
+/* The hash is kept at most half full.  Returns 0 on success.      */
+/*******************************************************************/
+static int buildGlyphHash(){
+
+    unsigned int x, packed, slot, hashSize;
+
+    hashSize = GLYPH_TABLE_MIN;
+    while (hashSize < 2 * numGlyphs)
+        hashSize *= 2;
+    glyphHash = (glyphSlot*)calloc(hashSize, sizeof(glyphSlot));
+    if (glyphHash == NULL){
+        printf("Error allocating font table hash.\n");
+        return -1;
+    }
+    glyphHashMask = hashSize - 1;
+
+    for (x = 0; x < numGlyphs; x++){
+        packed = packUTF8(&utf8Array[x][0]);
+        if (packed == GLYPH_HASH_EMPTY)
+            continue;
+        slot = GLYPH_HASH(packed);
+        while (1){
+            slot &= glyphHashMask;
+            if (glyphHash[slot].packed == packed)
+                break;
+            if (glyphHash[slot].packed == GLYPH_HASH_EMPTY){
+                glyphHash[slot].packed = packed;
+                glyphHash[slot].code = x;
                 break;
-            if (y == (numBytes - 1)){
-                *utf8Code = (unsigned short)x;
-                return 0;
             }
+            slot++;
         }
     }
 
-    return -1;
+    return 0;
 }
 
 
 
 
-void setBinOutputMode(int mode){
+void setBinOutputMode(lsb_context* ctx, int mode){
     if (mode == LUNAR_BIG_ENDIAN)
-        outputMode = LUNAR_BIG_ENDIAN;
+        ctx->outputMode = LUNAR_BIG_ENDIAN;
     else if (mode == LUNAR_LITTLE_ENDIAN)
-        outputMode = LUNAR_LITTLE_ENDIAN;
+        ctx->outputMode = LUNAR_LITTLE_ENDIAN;
     else{
         printf("Invalid Output Mode, defaulting to Big Endian.\n");
-        outputMode = LUNAR_BIG_ENDIAN;
+        ctx->outputMode = LUNAR_BIG_ENDIAN;
     }
     return;
 }
 
-int getBinOutputMode(){
-    return outputMode;
+int getBinOutputMode(lsb_context* ctx){
+    return ctx->outputMode;
 }
 
 
-void setBinMaxSize(unsigned int maxSize){
-    maxBinFsize = maxSize;
+void setBinMaxSize(lsb_context* ctx, unsigned int maxSize){
+    ctx->maxBinFsize = maxSize;
     return;
 }
 
-unsigned int getBinMaxSize(){
-    return maxBinFsize;
+unsigned int getBinMaxSize(lsb_context* ctx){
+    return ctx->maxBinFsize;
+}
+
+/* Pointer table at the start of a binary script, entries hold the */
+/* target byte offset divided by the entry size.  Returns -1 if    */
+/* the layout is invalid.                                          */
+int setPtrTableLayout(lsb_context* ctx, unsigned int numEntries, unsigned int entrySize){
+    if ((numEntries == 0) || ((entrySize != 2) && (entrySize != 4))){
+        printf("Invalid pointer table layout, %u entries of %u bytes.\n", numEntries, entrySize);
+        return -1;
+    }
+    ctx->ptrTableEntries = numEntries;
+    ctx->ptrEntrySize = entrySize;
+    return 0;
+}
+
+unsigned int getPtrTableEntries(lsb_context* ctx){
+    return ctx->ptrTableEntries;
 }
 
-void setMetaScriptInputMode(int mode){
+unsigned int getPtrEntrySize(lsb_context* ctx){
+    return ctx->ptrEntrySize;
+}
+
+void setMetaScriptInputMode(lsb_context* ctx, int mode){
     if (mode == RADIX_DEC)
-        inputMode = RADIX_DEC;
+        ctx->inputMode = RADIX_DEC;
     else if (mode == RADIX_HEX)
-        inputMode = RADIX_HEX;
+        ctx->inputMode = RADIX_HEX;
     else{
         printf("Invalid Input Mode, defaulting to HEX.\n");
-        outputMode = RADIX_HEX;
+        ctx->outputMode = RADIX_HEX;
     }
     return;
 }
 
-int getMetaScriptInputMode(){
-    return inputMode;
+int getMetaScriptInputMode(lsb_context* ctx){
+    return ctx->inputMode;
 }
 
 
-void setTableOutputMode(int mode){
+void setTableOutputMode(lsb_context* ctx, int mode){
     if (mode == ONE_BYTE_ENC)
-        tableMode = ONE_BYTE_ENC;
+        ctx->tableMode = ONE_BYTE_ENC;
     else if (mode == TWO_BYTE_ENC)
-        tableMode = TWO_BYTE_ENC;
+        ctx->tableMode = TWO_BYTE_ENC;
     else{
         printf("Invalid Table Output Mode, defaulting to TWO_BYTE_ENC.\n");
-        tableMode = TWO_BYTE_ENC;
+        ctx->tableMode = TWO_BYTE_ENC;
     }
     return;
 }
 
-int getTableOutputMode(){
-    return tableMode;
+int getTableOutputMode(lsb_context* ctx){
+    return ctx->tableMode;
 }
 
 
@@ -369,18 +535,54 @@ int getTableOutputMode(){
 /* Meta Script Read Fctns */
 /**************************/
 
-int read_ID(unsigned char* pInput){
+/*******************************************************************/
+/* nextToken                                                       */
+/* Reentrant strtok.  Splits str on any of the delimiters, saving  */
+/* the resume point in the context.  Pass NULL for str to continue */
+/* with the string from the previous call.                         */
+/* NULL is returned when no tokens remain.                         */
+/*******************************************************************/
+char* nextToken(lsb_context* ctx, char* str, const char* delims){
+
+    char* pToken;
+
+    if (str == NULL)
+        str = ctx->pTokNext;
+    if (str == NULL)
+        return NULL;
+
+    /* Skip leading delimiters */
+    str += strspn(str, delims);
+    if (*str == '\0'){
+        ctx->pTokNext = NULL;
+        return NULL;
+    }
+
+    /* Terminate the token */
+    pToken = str;
+    str += strcspn(str, delims);
+    if (*str != '\0'){
+        *str = '\0';
+        ctx->pTokNext = str + 1;
+    }
+    else
+        ctx->pTokNext = NULL;
+
+    return pToken;
+}
+
+int read_ID(lsb_context* ctx, unsigned char* pInput){
 
     unsigned int id;
 
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
+    pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
     if (strcmp((char *)pInput, "id") != 0) {
         printf("Error, id not found\n");
         return -1;
     }
-    pInput = (unsigned char*)strtok(NULL, "()\t = \r\n");
+    pInput = (unsigned char*)nextToken(ctx, NULL, "()\t = \r\n");
 
-    if (inputMode == RADIX_HEX){
+    if (ctx->inputMode == RADIX_HEX){
         if (sscanf((char *)pInput, "%X", &id) != 1){
             printf("Error reading ID\n");
             return -1;
@@ -396,8 +598,8 @@ int read_ID(unsigned char* pInput){
     return (int)id;
 }
 
-int readLW(unsigned char* pInput, unsigned int* data){
-    if (inputMode == RADIX_HEX){
+int readLW(lsb_context* ctx, unsigned char* pInput, unsigned int* data){
+    if (ctx->inputMode == RADIX_HEX){
         if (sscanf((char *)pInput, "%X", data) != 1){
             printf("Error reading long\n");
             return -1;
@@ -413,11 +615,11 @@ int readLW(unsigned char* pInput, unsigned int* data){
     return 0;
 }
 
-int readSW(unsigned char* pInput, unsigned short* datas){
+int readSW(lsb_context* ctx, unsigned char* pInput, unsigned short* datas){
 
     unsigned int local;
 
-    if (inputMode == RADIX_HEX){
+    if (ctx->inputMode == RADIX_HEX){
         if (sscanf((char *)pInput, "%X", &local) != 1){
             printf("Error reading short\n");
             return -1;
@@ -434,11 +636,11 @@ int readSW(unsigned char* pInput, unsigned short* datas){
     return 0;
 }
 
-int readBYTE(unsigned char* pInput, unsigned char* datab){
+int readBYTE(lsb_context* ctx, unsigned char* pInput, unsigned char* datab){
 
     unsigned int local;
 
-    if (inputMode == RADIX_HEX){
+    if (ctx->inputMode == RADIX_HEX){
         if (sscanf((char *)pInput, "%X", &local) != 1){
             printf("Error reading byte\n");
             return -1;
@@ -462,8 +664,8 @@ int readBYTE(unsigned char* pInput, unsigned char* datab){
 /* Returns the current method of text decoding */
 /* Either 1-byte encoding, or 2-byte           */
 /***********************************************/
-int getTextDecodeMethod(){
-    return textDecodeMode;
+int getTextDecodeMethod(lsb_context* ctx){
+    return ctx->textDecodeMode;
 }
 
 
@@ -473,21 +675,21 @@ int getTextDecodeMethod(){
 /* Sets the current method of text decoding */
 /* Either 1-byte encoding, or 2-byte        */
 /********************************************/
-void setTextDecodeMethod(int method){
-	G_SSS_ITEM_HACK_ENABLED = 0;
+void setTextDecodeMethod(lsb_context* ctx, int method){
+	ctx->sssItemHack = 0;
     if (method == 3){
         method = 2;
-        G_IOS_ENG = 1;
+        ctx->iosEng = 1;
     }
 	if (method == 5){
-		G_SSS_ITEM_HACK_ENABLED = 1;
+		ctx->sssItemHack = 1;
 		method = 4;
 	}
 	if (method == 6){
 		method = 4;
 	}
 	
-    textDecodeMode = method;
+    ctx->textDecodeMode = method;
     return;
 }
 
@@ -497,6 +699,6 @@ void setTextDecodeMethod(int method){
 /* not the PSX decoder should auto-correct for item numbering */
 /* changes between PSX SSSC and SSS                           */
 /**************************************************************/
-int checkSSSItemHack(){
-	return G_SSS_ITEM_HACK_ENABLED;
+int checkSSSItemHack(lsb_context* ctx){
+	return ctx->sssItemHack;
 }
@@ -1,6 +1,8 @@
 #ifndef UTIL_H
 #define UTIL_H
 
+#include "lsb_context.h"
+
 /* Defines */
 #define TEXT_DECODE_TWO_BYTES_PER_CHAR 0
 #define TEXT_DECODE_ONE_BYTE_PER_CHAR  1
@@ -10,35 +12,42 @@
 #define TEXT_DECODE_TWO_BYTES_ASCII    5
 
 /* Function Prototypes */
-void setSSSEncode();
-int getSSSEncode();
+void setSSSEncode(lsb_context* ctx);
+int getSSSEncode(lsb_context* ctx);
 void swap16(void* pWd);
 void swap32(void* pWd);
 int numBytesInUtf8Char(unsigned char val);
-int loadUTF8Table(char* fname);
+int loadUTF8Table(char* fname, int sssMode);
 int getUTF8character(int index, char* utf8Value);
+const char* getUTF8string(int index);
 int getUTF8code_Byte(char* utf8Value, unsigned char* utf8Code);
 int getUTF8code_Short(char* utf8Value, unsigned short* utf8Code);
-void setBinOutputMode(int mode);
-int getBinOutputMode();
-void setBinMaxSize(unsigned int maxSize);
-unsigned int getBinMaxSize();
-void setMetaScriptInputMode(int mode);
-int getMetaScriptInputMode();
-void setTableOutputMode(int mode);
-int getTableOutputMode();
+void releaseUTF8Table();
+unsigned int packUTF8(const char* utf8Value);
+void setBinOutputMode(lsb_context* ctx, int mode);
+int getBinOutputMode(lsb_context* ctx);
+void setBinMaxSize(lsb_context* ctx, unsigned int maxSize);
+unsigned int getBinMaxSize(lsb_context* ctx);
+int setPtrTableLayout(lsb_context* ctx, unsigned int numEntries, unsigned int entrySize);
+unsigned int getPtrTableEntries(lsb_context* ctx);
+unsigned int getPtrEntrySize(lsb_context* ctx);
+void setMetaScriptInputMode(lsb_context* ctx, int mode);
+int getMetaScriptInputMode(lsb_context* ctx);
+void setTableOutputMode(lsb_context* ctx, int mode);
+int getTableOutputMode(lsb_context* ctx);
 
 /**************************/
 /* Meta Script Read Fctns */
 /**************************/
-int read_ID(unsigned char* pInput);
-int readLW(unsigned char* pInput, unsigned int* data);
-int readSW(unsigned char* pInput, unsigned short* datas);
-int readBYTE(unsigned char* pInput, unsigned char* datab);
+char* nextToken(lsb_context* ctx, char* str, const char* delims);
+int read_ID(lsb_context* ctx, unsigned char* pInput);
+int readLW(lsb_context* ctx, unsigned char* pInput, unsigned int* data);
+int readSW(lsb_context* ctx, unsigned char* pInput, unsigned short* datas);
+int readBYTE(lsb_context* ctx, unsigned char* pInput, unsigned char* datab);
 
 /* Decode Related Functions */
-int getTextDecodeMethod();
-void setTextDecodeMethod(int method);
-int checkSSSItemHack();
+int getTextDecodeMethod(lsb_context* ctx);
+void setTextDecodeMethod(lsb_context* ctx, int method);
+int checkSSSItemHack(lsb_context* ctx);
 
 #endif
@@ -14,31 +14,68 @@
 #include "bpe_compression.h"
 
 /* Defines */
+#define OBUF_MIN_SIZE  (64*1024)   /* Output buffer grows from this size */
 
 
-/* Globals */
-static unsigned char* pOutput = NULL;
-static unsigned int offset = 0x00;
-static unsigned char* obuf = NULL;
+/* Function Prototypes */
+int writeBinScript(lsb_context* ctx, FILE* outFile);
+int writeSizeReport(lsb_context* ctx, FILE* outFile);
+int writeScript(lsb_context* ctx, FILE* outFile);
+int dumpScript(lsb_context* ctx, FILE* outFile, FILE* txtOutFile);
 
-/* Binary Output Unique Globals */
-static unsigned int max_size_bytes;
-static unsigned int output_endian_type;
-static unsigned int G_table_mode;
-static unsigned int max_boutput_size_bytes = 0;
+/* Write Fctns */
+static int reserveOutput(lsb_context* ctx, unsigned int endOffset);
+static int writeLW(lsb_context* ctx, unsigned int data);
+static int writeSW(lsb_context* ctx, unsigned short data);
+static int writeBYTE(lsb_context* ctx, unsigned char data);
+static unsigned int getUsedBytes(lsb_context* ctx);
+static char* formatVal(lsb_context* ctx, unsigned int value);
+static unsigned char* copyText(lsb_context* ctx, unsigned int str);
+static int sizeSubParams(scriptNode* pNode, unsigned int* pOffset);
+static int sizeRunParams(lsb_context* ctx, runParamType* rpNode, int compress, unsigned int* pOffset);
+static int cacheText(lsb_context* ctx, unsigned int str, int compress);
+static int appendNodeText(lsb_context* ctx, const unsigned char* pData, unsigned int numBytes);
+static int appendNodeTextSW(lsb_context* ctx, unsigned short data);
+static int writeNodeText(lsb_context* ctx);
+char* ctrlCodeLkup(lsb_context* ctx, unsigned short ctrlCode);
 
 
-/* Function Prototypes */
-int writeBinScript(FILE* outFile);
-int writeScript(FILE* outFile);
-int dumpScript(FILE* outFile, FILE* txtOutFile);
 
-/* Write Fctns */
-static int writeLW(unsigned int data);
-static int writeSW(unsigned short data);
-static int writeBYTE(unsigned char data);
-static char* formatVal(unsigned int value);
-char* ctrlCodeLkup(unsigned short ctrlCode);
+
+/*****************************************************************************/
+/* Function: reserveOutput                                                   */
+/* Purpose: Grows the output buffer to hold endOffset bytes, doubling up to  */
+/*          the max file size.  New space holds the default fill value.      */
+/* Returns 0 on success, -1 on error.                                        */
+/*****************************************************************************/
+static int reserveOutput(lsb_context* ctx, unsigned int endOffset){
+
+    unsigned char* pNew;
+    unsigned int newSize;
+
+    if (endOffset <= ctx->obufSize)
+        return 0;
+
+    newSize = (ctx->obufSize > 0) ? ctx->obufSize : OBUF_MIN_SIZE;
+    while ((newSize < endOffset) && (newSize < ctx->maxBinFsize))
+        newSize = (newSize > ctx->maxBinFsize / 2) ? ctx->maxBinFsize : newSize * 2;
+    if (newSize < endOffset){
+        printf("Error, write would exceed MAX filesize.\n");
+        return -1;
+    }
+
+    pNew = (unsigned char*)realloc(ctx->obuf, newSize);
+    if (pNew == NULL){
+        printf("Error allocating memory for output buffer.\n");
+        return -1;
+    }
+    memset(pNew + ctx->obufSize, DEFAULT_FILL, newSize - ctx->obufSize);
+    ctx->obuf = pNew;
+    ctx->obufSize = newSize;
+    ctx->pOutput = ctx->obuf + ctx->offset;
+
+    return 0;
+}
 
 
 
@@ -48,22 +85,25 @@ char* ctrlCodeLkup(unsigned short ctrlCode);
 /* Purpose: Writes a long to a simulated file in memory.  Updates file ptr.  */
 /* Returns 0 on success, -1 on error.                                        */
 /*****************************************************************************/
-static int writeLW(unsigned int data){
+static int writeLW(lsb_context* ctx, unsigned int data){
 
-    unsigned int* pData = (unsigned int*)pOutput;
+    unsigned int* pData;
 
     /* Verify write can take place */
-    if( (offset + 4) > (max_size_bytes-1)){
+    if( (ctx->offset + 4) > ctx->maxBinFsize){
         printf("Error, LW Write would exceed MAX filesize.\n");
         return -1;
     }
+    if (reserveOutput(ctx, ctx->offset + 4) != 0)
+        return -1;
+    pData = (unsigned int*)ctx->pOutput;
 
-    if (output_endian_type == LUNAR_LITTLE_ENDIAN){
+    if (ctx->output_endian_type == LUNAR_LITTLE_ENDIAN){
         *pData = data;
     }
     else{
         unsigned char* pSrc = (unsigned char*)&data;
-        unsigned char* pDst = (unsigned char*)pOutput;
+        unsigned char* pDst = (unsigned char*)ctx->pOutput;
 
         pDst[0] = pSrc[3];
         pDst[1] = pSrc[2];
@@ -72,12 +112,8 @@ static int writeLW(unsigned int data){
     }
 
     /* Advance Output Pointer */
-    pOutput += 4;
-    offset += 4;
-
-    /* Update size of data to write to the binary output file */
-    if(offset > max_boutput_size_bytes)
-        max_boutput_size_bytes = offset;
+    ctx->pOutput += 4;
+    ctx->offset += 4;
 
     return 0;
 }
@@ -90,34 +126,33 @@ static int writeLW(unsigned int data){
 /* Purpose: Writes a short to a simulated file in memory.  Updates file ptr. */
 /* Returns 0 on success, -1 on error.                                        */
 /*****************************************************************************/
-static int writeSW(unsigned short data){
+static int writeSW(lsb_context* ctx, unsigned short data){
 
-    unsigned short* pData = (unsigned short*)pOutput;
+    unsigned short* pData;
 
     /* Verify write can take place */
-    if( (offset + 2) > (max_size_bytes-1)){
+    if( (ctx->offset + 2) > ctx->maxBinFsize){
         printf("Error, SW Write would exceed MAX filesize.\n");
         return -1;
     }
+    if (reserveOutput(ctx, ctx->offset + 2) != 0)
+        return -1;
+    pData = (unsigned short*)ctx->pOutput;
 
-    if (output_endian_type == LUNAR_LITTLE_ENDIAN){
+    if (ctx->output_endian_type == LUNAR_LITTLE_ENDIAN){
         *pData = data;
     }
     else{
         unsigned char* pSrc = (unsigned char*)&data;
-        unsigned char* pDst = (unsigned char*)pOutput;
+        unsigned char* pDst = (unsigned char*)ctx->pOutput;
 
         pDst[0] = pSrc[1];
         pDst[1] = pSrc[0];
     }
 
     /* Advance Output Pointer */
-    pOutput += 2;
-    offset += 2;
-
-    /* Update size of data to write to the binary output file */
-    if (offset > max_boutput_size_bytes)
-        max_boutput_size_bytes = offset;
+    ctx->pOutput += 2;
+    ctx->offset += 2;
 
     return 0;
 }
@@ -130,28 +165,47 @@ static int writeSW(unsigned short data){
 /* Purpose: Writes a byte to a simulated file in memory.  Updates file ptr.  */
 /* Returns 0 on success, -1 on error.                                        */
 /*****************************************************************************/
-static int writeBYTE(unsigned char data){
+static int writeBYTE(lsb_context* ctx, unsigned char data){
 
     /* Verify write can take place */
-    if( (offset + 1) > (max_size_bytes-1)){
+    if( (ctx->offset + 1) > ctx->maxBinFsize){
         printf("Error, Byte Write would exceed MAX filesize.\n");
         return -1;
     }
+    if (reserveOutput(ctx, ctx->offset + 1) != 0)
+        return -1;
 
-    *pOutput = data;
+    *ctx->pOutput = data;
 
     /* Advance Output Pointer */
-    pOutput++;
-    offset++;
-
-    /* Update size of data to write to the binary output file */
-    if (offset > max_boutput_size_bytes)
-        max_boutput_size_bytes = offset;
+    ctx->pOutput++;
+    ctx->offset++;
 
     return 0;
 }
 
 
+/*****************************************************************************/
+/* Function: getUsedBytes                                                    */
+/* Purpose: Returns the end of the furthest node written by writeBinScript,  */
+/*          the length of the binary output.                                 */
+/*****************************************************************************/
+static unsigned int getUsedBytes(lsb_context* ctx){
+
+    scriptNode* pNode;
+    unsigned int usedBytes = 0;
+
+    for (pNode = getHeadPtr(ctx); pNode != NULL; pNode = getNextPtr(ctx, pNode)){
+        if ((pNode->binSize > 0) && (pNode->fileOffset + pNode->binSize > usedBytes))
+            usedBytes = pNode->fileOffset + pNode->binSize;
+    }
+
+    return usedBytes;
+}
+
+
+
+
 /*****************************************************************************/
 /* Function: writeBinScript                                                  */
 /* Purpose: Reads from a linked list data structure in memory to create the  */
@@ -159,35 +213,34 @@ static int writeBYTE(unsigned char data){
 /* Inputs:  Pointers to input/update/output files.                           */
 /* Outputs: 0 on Pass, -1 on Fail.                                           */
 /*****************************************************************************/
-int writeBinScript(FILE* outFile){
+int writeBinScript(lsb_context* ctx, FILE* outFile){
 
     int x;
     scriptNode* pNode = NULL;
 	int subtitle_hack = 0;
-    max_boutput_size_bytes = 0;
-
-    /* Get Max Filesize for Binary Output */
-    max_size_bytes = getBinMaxSize();
 
     /* Get Binary File Output Mode */
-    output_endian_type = getBinOutputMode();
+    ctx->output_endian_type = getBinOutputMode(ctx);
 
     /* Check text table encoding for later output */
-    G_table_mode = getTableOutputMode();
-
-    /* Allocate memory for output */
-    /* File will be kept in memory until completed */
-    obuf = (unsigned char*)malloc(max_size_bytes);
-    if (obuf == NULL){
-        printf("Error allocating memory for output buffer.\n");
+    ctx->table_mode = getTableOutputMode(ctx);
+
+    /* Output is kept in memory until completed, the buffer */
+    /* grows with the highest offset written (reserveOutput) */
+    if (ctx->obuf != NULL)
+        free(ctx->obuf);
+    ctx->obuf = NULL;
+    ctx->obufSize = 0;
+    ctx->offset = 0x00;
+    if (reserveOutput(ctx, 1) != 0)
         return -1;
-    }
-    memset(obuf, DEFAULT_FILL, max_size_bytes);
-    pOutput = obuf;
-    offset = 0x00;
+
+    /* Sizes are recorded as nodes are written */
+    for (pNode = getHeadPtr(ctx); pNode != NULL; pNode = getNextPtr(ctx, pNode))
+        pNode->binSize = 0;
 
     /* Get a Pointer to the Head of the linked list */
-    pNode = getHeadPtr();
+    pNode = getHeadPtr(ctx);
 
     /******************************************************************/
     /* Loop until the binary output corresponding to all list entries */
@@ -203,9 +256,9 @@ int writeBinScript(FILE* outFile){
             case NODE_GOTO:
             {
                 /* Update output pointer */
-                offset = (unsigned int)pNode->byteOffset;
-                pOutput = obuf + offset;
-                pNode->fileOffset = offset;  //Book keeping
+                ctx->offset = (unsigned int)pNode->byteOffset;
+                ctx->pOutput = ctx->obuf + ctx->offset;
+                pNode->fileOffset = ctx->offset;  //Book keeping
             }
             break;
 
@@ -217,15 +270,15 @@ int writeBinScript(FILE* outFile){
             {
                 unsigned int numBytes;
                 numBytes = pNode->unit_count*pNode->unit_size;
+                pNode->fileOffset = ctx->offset;  //Book keeping
+                pNode->binSize = numBytes;
 
                 /* Check that operation can be completed */
-                if ((numBytes + offset) > max_size_bytes){
+                if ((numBytes + ctx->offset) > ctx->maxBinFsize){
                     printf("Error, fill extending beyond max file size.\n");
                     return -1;
                 }
 
-                pNode->fileOffset = offset;  //Book keeping
-
                 /* Copy the fill data */
                 switch (pNode->unit_size){
                     case 1:
@@ -234,7 +287,7 @@ int writeBinScript(FILE* outFile){
                         pNode->fillVal &= 0xFF;
                         fill_byte = (unsigned char)pNode->fillVal;
                         for (x = 0; x < (int)pNode->unit_count; x++){
-                            writeBYTE(fill_byte);
+                            writeBYTE(ctx, fill_byte);
                         }
                         break;
                     }
@@ -244,14 +297,14 @@ int writeBinScript(FILE* outFile){
                         pNode->fillVal &= 0xFFFF;
                         fill_short = (unsigned short)pNode->fillVal;
                         for (x = 0; x < (int)pNode->unit_count; x++){
-                            writeSW(fill_short);
+                            writeSW(ctx, fill_short);
                         }
                         break;
                     }
                     case 4:
                     {
                         for (x = 0; x < (int)pNode->unit_count; x++){
-                            writeLW(pNode->fillVal);
+                            writeLW(ctx, pNode->fillVal);
                         }
                         break;
                     }
@@ -269,12 +322,13 @@ int writeBinScript(FILE* outFile){
             case NODE_POINTER:
             {
                 /* Move file pointer to where the write is to take place */
-                offset = pNode->byteOffset;
-                pOutput = obuf + offset;
-                pNode->fileOffset = offset;  //Book keeping
+                ctx->offset = pNode->byteOffset;
+                ctx->pOutput = ctx->obuf + ctx->offset;
+                pNode->fileOffset = ctx->offset;  //Book keeping
+                pNode->binSize = pNode->ptrSize;
 
                 /* Check that operation can be completed */
-                if ((pNode->ptrSize + offset) > max_size_bytes){
+                if ((pNode->ptrSize + ctx->offset) > ctx->maxBinFsize){
                     printf("Error, pointer extending beyond max file size.\n");
                     return -1;
                 }
@@ -285,12 +339,12 @@ int writeBinScript(FILE* outFile){
                     switch (pNode->ptrSize){
                         case 2:  /* Short Ptr */
                         {
-                            writeSW((unsigned short)(pNode->ptrValue & 0xFFFF));
+                            writeSW(ctx, (unsigned short)(pNode->ptrValue & 0xFFFF));
                             break;
                         }
                         case 4: /* Long Ptr */
                         {
-                            writeLW(pNode->ptrValue);
+                            writeLW(ctx, pNode->ptrValue);
                             break;
                         }
                         default:
@@ -303,8 +357,8 @@ int writeBinScript(FILE* outFile){
                 else{
                     /* ID is selected, hold off on pointer writing for later */
                     /* For now just */
-                    pOutput += pNode->ptrSize;
-                    offset += pNode->ptrSize;
+                    ctx->pOutput += pNode->ptrSize;
+                    ctx->offset += pNode->ptrSize;
                     break;
                 }
             }
@@ -317,65 +371,42 @@ int writeBinScript(FILE* outFile){
             /*****************************************************/
             case NODE_EXE_SUB:
             {
-                int numBytes = 0;
+                unsigned int endOffset;
 
                 /* Check that operation can be completed */
-                numBytes += 2; /* At least need to output subroutine code */
-                for (x = 0; x < (int)pNode->num_parameters; x++){
-                    switch (pNode->subParams[x].type){
-                        case BYTE_PARAM:
-                            numBytes++;
-                            break;
-                        case SHORT_PARAM:
-                            numBytes+=2;
-                            break;
-                        case LONG_PARAM:
-                            numBytes+=4;
-                            break;
-                        case ALIGN_2_PARAM:
-                            numBytes++; /* overestimate for simplicity */
-                            break;
-                        case ALIGN_4_PARAM:
-                            numBytes+=3; /* overestimate for simplicity */
-                            break;
-						case SUBT_STR:
-							numBytes += 1024; /* overestimate for simplicity */
-							break;
-                        default:
-                            printf("Error, bad subroutine parameter detected.\n");
-                            return -1;
-                    }
-                }
-                if ((numBytes + offset) > max_size_bytes){
+                endOffset = ctx->offset + 2; /* Subroutine code */
+                if (sizeSubParams(pNode, &endOffset) != 0)
+                    return -1;
+                pNode->fileOffset = ctx->offset;  //Book keeping
+                pNode->binSize = endOffset - ctx->offset;
+                if (endOffset > ctx->maxBinFsize){
                     printf("Error, subroutine would extend beyond max file size.\n");
                     return -1;
                 }
 
-                pNode->fileOffset = offset;  //Book keeping
-
                 /* Write Subroutine Code */
-                writeSW(pNode->subroutine_code);
+                writeSW(ctx, pNode->subroutine_code);
     
                 /* Write Parameters */
                 for (x = 0; x < (int)pNode->num_parameters; x++){
                     switch (pNode->subParams[x].type){
                         case BYTE_PARAM:
-                            writeBYTE(pNode->subParams[x].value & 0xFF);
+                            writeBYTE(ctx, pNode->subParams[x].value & 0xFF);
                             break;
                         case SHORT_PARAM:
-                            writeSW(pNode->subParams[x].value & 0xFFFF);
+                            writeSW(ctx, pNode->subParams[x].value & 0xFFFF);
                             break;
                         case LONG_PARAM:
-                            writeLW(pNode->subParams[x].value);
+                            writeLW(ctx, pNode->subParams[x].value);
                             break;
                         case ALIGN_2_PARAM:
-                            if ((offset & 0x1) != 0x0){
-                                writeBYTE(pNode->alignfillVal);
+                            if ((ctx->offset & 0x1) != 0x0){
+                                writeBYTE(ctx, pNode->alignfillVal);
                             }
                             break;
                         case ALIGN_4_PARAM:
-                            while ((offset & 0x3) != 0x0){
-                                writeBYTE(pNode->alignfillVal);
+                            while ((ctx->offset & 0x3) != 0x0){
+                                writeBYTE(ctx, pNode->alignfillVal);
                             }
                             break;
 						case SUBT_STR:
@@ -395,82 +426,32 @@ int writeBinScript(FILE* outFile){
             /****************/
             case NODE_RUN_CMDS:
             {
-                runParamType* rpNode = pNode->runParams;
-                int numBytes = 0;
-
-                /* Check that operation can be completed */
-                numBytes += 2; /* At least need to output subroutine code */
-                while (rpNode != NULL) {
-
-                    switch (rpNode->type){
-
-                    case ALIGN_2_PARAM:
-                        numBytes++; /* overestimate for simplicity */
-                        break;
-                    case ALIGN_4_PARAM:
-                        numBytes+=3; /* overestimate for simplicity */
-                        break;
-                    case SHOW_PORTRAIT_LEFT:
-                    case SHOW_PORTRAIT_RIGHT:
-                    case TIME_DELAY:
-                        numBytes+=2;
-                        break;
-                    case PRINT_LINE:
-                    {
-                        int numBytes2, numBytes3;
-                        unsigned char* pText = rpNode->str;
-                        numBytes2 = numBytes3 = 0;
-                        while (*pText != '\0'){
-
-                            /* Read in a utf8 character */
-                            numBytes3 = numBytesInUtf8Char((unsigned char)*pText);
-
-                            /* Look up associated code */
-                            if ((numBytes3 == 1) && (*pText == ' ')){
-                                numBytes2 += 2; /* Space */
-                            }
-                            else{
-                                if (G_table_mode == ONE_BYTE_ENC){
-                                    //Fix estimation later or ignore assuming there will be enough space
-                                    //numBytes2++;
-                                }
-                                else if (G_table_mode == TWO_BYTE_ENC){
-                                    numBytes2 += 2;
-                                }
-                                else{   //Straight UTF-8 Encoding
-                                    numBytes2 += numBytes3;
-                                }
-                            }
-                            pText += numBytes3;
-                        }
-                        numBytes += numBytes2;
-                    }
-                    break;
-                    case CTRL_CODE:
-                        numBytes+=2;
-                        break;
-                    default:
-                        printf("Error, bad run cmd parameter detected.\n");
-                        return -1;
-                    }
-
-                    rpNode = rpNode->pNext;
-                }
-                if ((numBytes + offset) > max_size_bytes){
+                runParamType* rpNode;
+                unsigned int endOffset;
+
+                /* Check that operation can be completed, text is */
+                /* encoded here and cached until it is written    */
+                endOffset = ctx->offset;
+                if (!subtitle_hack)
+                    endOffset += 2; /* Subroutine code */
+                ctx->nodeTextLen = ctx->nodeTextPos = 0;
+                if (sizeRunParams(ctx, pNode->runParams, 1, &endOffset) != 0)
+                    return -1;
+                pNode->fileOffset = ctx->offset;  //Book keeping
+                pNode->binSize = endOffset - ctx->offset;
+                if (endOffset > ctx->maxBinFsize){
                     printf("Error, subroutine 0002 would extend beyond max file size.\n");
                     return -1;
                 }
 
-                pNode->fileOffset = offset;  //Book keeping
-
                 /* This is all part of subroutine code 0x0002 */
 				if (!subtitle_hack)
-					writeSW(0x0002);
+					writeSW(ctx, 0x0002);
 				else
 					subtitle_hack = 0;
 
                 rpNode = pNode->runParams;
-                while (rpNode != NULL) {
+                while ((rpNode != NULL) && (rpNode->type != RUN_END)) {
 
                     switch (rpNode->type){
 
@@ -478,8 +459,8 @@ int writeBinScript(FILE* outFile){
                         /* align-2 */
                         /***********/
                         case ALIGN_2_PARAM:
-                            if ((offset & 0x1) != 0x0){
-                                writeBYTE((unsigned char)rpNode->value);
+                            if ((ctx->offset & 0x1) != 0x0){
+                                writeBYTE(ctx, (unsigned char)rpNode->value);
                             }
                             break;
 
@@ -488,8 +469,8 @@ int writeBinScript(FILE* outFile){
                         /* align-4 */
                         /***********/
                         case ALIGN_4_PARAM:
-                            while ((offset & 0x3) != 0x0){
-                                writeBYTE((unsigned char)rpNode->value);
+                            while ((ctx->offset & 0x3) != 0x0){
+                                writeBYTE(ctx, (unsigned char)rpNode->value);
                             }
                             break;
 
@@ -501,7 +482,7 @@ int writeBinScript(FILE* outFile){
                         {
                             unsigned short portraitCode;
                             portraitCode = 0xFA00 | ((unsigned short)rpNode->value);
-                            writeSW(portraitCode);
+                            writeSW(ctx, portraitCode);
                         }
                         break;
                     
@@ -512,7 +493,7 @@ int writeBinScript(FILE* outFile){
                         {
                             unsigned short portraitCode;
                             portraitCode = 0xFB00 | ((unsigned short)rpNode->value);
-                            writeSW(portraitCode);
+                            writeSW(ctx, portraitCode);
                         }
                         break;
 
@@ -523,7 +504,7 @@ int writeBinScript(FILE* outFile){
                         {
                             unsigned short timedelay;
                             timedelay = 0xF800 | ((unsigned short)rpNode->value);
-                            writeSW(timedelay);
+                            writeSW(ctx, timedelay);
                         }
                             break;
 
@@ -531,81 +512,16 @@ int writeBinScript(FILE* outFile){
                         /* print-line */
                         /**************/
                         case PRINT_LINE:
-                        {
-                            unsigned char* pText = rpNode->str;
-
-                            /* BPE EDIT HERE */
-                            if (G_table_mode == ONE_BYTE_ENC){
-                                int x;
-                                unsigned int comprSizeBytes;
-                                utf8Text_to_8bit_binary((char*)pText, &comprSizeBytes);
-                                compressBPE(pText, &comprSizeBytes);
-                                for(x = 0; x < (int)comprSizeBytes; x++){
-                                    /* Write the code to the output file */
-//                                    if (*pText == ' '){
-//                                        writeSW(0xF905); /* Space */
-//                                    }
-//                                    else
-                                        writeBYTE(pText[x]);
-                                }
-                                break;
-                            }
-
-                            while (*pText != '\0'){
-                                int numBytes;
-                                unsigned char code;
-                                unsigned short scode;
-                                char tmp[5];
-
-                                /* Read in a utf8 character */
-                                numBytes = numBytesInUtf8Char((unsigned char)*pText);
-                                memset(tmp, 0, 5);
-                                memcpy(tmp, pText, numBytes);
-
-                                /* Look up associated code */
-                                if ((numBytes == 1) && (*pText == ' ')){
-                                    writeSW(0xF905); /* Space */
-                                }
-                                else{
-                                    if (G_table_mode == ONE_BYTE_ENC){
-                                        if (getUTF8code_Byte(tmp, &code) < 0){
-                                            printf("Error looking up 1-byte code corresponding with UTF-8 character\n");
-                                            return -1;
-                                        }
-
-                                        /* Write the code to the output file */
-                                        writeBYTE(code);
-                                    }
-
-                                    else if (G_table_mode == TWO_BYTE_ENC){
-                                        if (getUTF8code_Short(tmp, &scode) < 0){
-                                            printf("Error looking up 2-byte code corresponding with UTF-8 character\n");
-                                            return -1;
-                                        }
-
-                                        /* Write the code to the output file */
-                                        writeSW(scode);
-                                    }
-
-                                    else{   //Straight UTF-8 Encoding
-                                        int z;
-
-                                        /* Write the data to the output file */
-                                        for (z = 0; z < numBytes; z++){
-                                            writeBYTE(tmp[z]);
-                                        }
-                                    }
-                                }
-                                pText += numBytes;
-                            }
-                        }
-                        break;
+                            /* Encoded when the node was sized */
+                            if (writeNodeText(ctx) != 0)
+                                return -1;
+                            break;
 
                         /****************/
                         /* control-code */
                         /****************/
                         case CTRL_CODE:
-                            writeSW((unsigned short)rpNode->value);
+                            writeSW(ctx, (unsigned short)rpNode->value);
                             break;
 
 
@@ -614,7 +530,7 @@ int writeBinScript(FILE* outFile){
                             return -1;
                     }
 
-                    rpNode = rpNode->pNext;
+                    rpNode++;
                 }
             }
             break;
@@ -626,79 +542,26 @@ int writeBinScript(FILE* outFile){
             case NODE_OPTIONS:
             {
                 runParamType* rpNode = NULL;
-                int numBytes = 0;
-
-                /* Check that operation can be completed */
-                numBytes += 6; /* At least need to output subroutine code & 2 param */
-                
-                for (x = 0; x < 2; x++){
-                    if (x == 0)
-                        rpNode = pNode->runParams;
-                    else
-                        rpNode = pNode->runParams2;
-                    while (rpNode != NULL) {
-
-                        switch (rpNode->type){
-
-                        case ALIGN_2_PARAM:
-                            numBytes++; /* overestimate for simplicity */
-                            break;
-                        case ALIGN_4_PARAM:
-                            numBytes += 3; /* overestimate for simplicity */
-                            break;
-                        case PRINT_LINE:
-                        {
-                            int numBytes2, numBytes3;
-                            unsigned char* pText = rpNode->str;
-                            numBytes2 = numBytes3 = 0;
-                            while (*pText != '\0'){
-
-                                /* Read in a utf8 character */
-                                numBytes3 = numBytesInUtf8Char((unsigned char)*pText);
-
-                                /* Look up associated code */
-                                if ((numBytes3 == 1) && (*pText == ' ')){
-                                    numBytes2 += 2; /* Space */
-                                }
-                                else{
-                                    if (G_table_mode == ONE_BYTE_ENC){
-                                        //Fix estimation later or ignore assuming there will be enough space
-                                        //numBytes2++;
-                                    }
-                                    else if (G_table_mode == TWO_BYTE_ENC){
-                                        numBytes2 += 2;
-                                    }
-                                    else{   //Straight UTF-8 Encoding
-                                        numBytes2 += numBytes3;
-                                    }
-                                }
-                                pText += numBytes3;
-                            }
-                            numBytes += numBytes2;
-                        }
-                            break;
-                        case CTRL_CODE:
-                            numBytes += 2;
-                            break;
-                        default:
-                            printf("Error, bad run cmd parameter detected.\n");
-                            return -1;
-                        }
-
-                        rpNode = rpNode->pNext;
-                    }
-                }
-                if ((numBytes + offset) > max_size_bytes){
+                unsigned int endOffset;
+
+                /* Check that operation can be completed, text is */
+                /* encoded here and cached until it is written    */
+                endOffset = ctx->offset + 6; /* Subroutine code & 2 params */
+                ctx->nodeTextLen = ctx->nodeTextPos = 0;
+                if ((sizeRunParams(ctx, pNode->runParams, 0, &endOffset) != 0) ||
+                    (sizeRunParams(ctx, pNode->runParams2, 0, &endOffset) != 0))
+                    return -1;
+                pNode->fileOffset = ctx->offset;  //Book keeping
+                pNode->binSize = endOffset - ctx->offset;
+                if (endOffset > ctx->maxBinFsize){
                     printf("Error, subroutine 0007 would extend beyond max file size.\n");
                     return -1;
                 }
 
-                pNode->fileOffset = offset;  //Book keeping
-
                 /* This is all part of subroutine code 0x0007 */
-                writeSW(0x0007);
-                writeSW(pNode->subParams[0].value);
-                writeSW(pNode->subParams[1].value);
+                writeSW(ctx, 0x0007);
+                writeSW(ctx, pNode->subParams[0].value);
+                writeSW(ctx, pNode->subParams[1].value);
 
                 /*****************************/
                 /* Loop Through Both Options */
@@ -709,7 +572,7 @@ int writeBinScript(FILE* outFile){
                     else
                         rpNode = pNode->runParams2;
 
-                    while (rpNode != NULL) {
+                    while ((rpNode != NULL) && (rpNode->type != RUN_END)) {
 
                         switch (rpNode->type){
 
@@ -717,8 +580,8 @@ int writeBinScript(FILE* outFile){
                             /* align-2 */
                             /***********/
                             case ALIGN_2_PARAM:
-                                if ((offset & 0x1) != 0x0){
-                                    writeBYTE((unsigned char)rpNode->value);
+                                if ((ctx->offset & 0x1) != 0x0){
+                                    writeBYTE(ctx, (unsigned char)rpNode->value);
                                 }
                             break;
 
@@ -727,8 +590,8 @@ int writeBinScript(FILE* outFile){
                             /* align-4 */
                             /***********/
                             case ALIGN_4_PARAM:
-                                while ((offset & 0x3) != 0x0){
-                                    writeBYTE((unsigned char)rpNode->value);
+                                while ((ctx->offset & 0x3) != 0x0){
+                                    writeBYTE(ctx, (unsigned char)rpNode->value);
                                 }
                             break;
 
@@ -737,96 +600,16 @@ int writeBinScript(FILE* outFile){
                             /* print-line */
                             /**************/
                             case PRINT_LINE:
-                            {
-                                unsigned char* pText = rpNode->str;
-
-                                /* BPE EDIT HERE */
-                                if (G_table_mode == ONE_BYTE_ENC){
-                                    int x;
-                                    unsigned int comprSizeBytes;
-                                    utf8Text_to_8bit_binary((char*)pText, &comprSizeBytes);
-
-									/*************************************************/
-									/* Dont bother compression Options, not worth it */
-									/*************************************************/
-#if 0
-                                    compressBPE(pText, &comprSizeBytes);
-                                    for(x = 0; x < (int)comprSizeBytes; x++){
-                                        /* Write the code to the output file */
-                                        if (*pText == ' '){
-                                            writeSW(0xF905); /* Space */
-                                        }
-                                        else
-                                            writeBYTE(pText[x]);
-                                    }
-#else
-									for(x = 0; x < (int)comprSizeBytes; x++){
-                                        /* Write the code to the output file */
-                                        if (pText[x] == ' '){
-                                            writeSW(0xF905);
-                                        }
-                                        else
-                                            writeSW((unsigned short)(pText[x]));
-                                    }
-#endif									
-                                    break;
-                                }
-
-                                while (*pText != '\0'){
-                                    int numBytes;
-                                    unsigned char code;
-                                    unsigned short scode;
-                                    char tmp[5];
-
-                                    /* Read in a utf8 character */
-                                    numBytes = numBytesInUtf8Char((unsigned char)*pText);
-                                    memset(tmp, 0, 5);
-                                    memcpy(tmp, pText, numBytes);
-
-                                    /* Look up associated code */
-                                    if ((numBytes == 1) && (*pText == ' ')){
-                                        writeSW(0xF905); /* Space */
-                                    }
-                                    else{
-                                        if (G_table_mode == ONE_BYTE_ENC){
-                                            if (getUTF8code_Byte(tmp, &code) < 0){
-                                                printf("Error looking up 1-byte code corresponding with UTF-8 character\n");
-                                                return -1;
-                                            }
-
-                                            /* Write the code to the output file */
-                                            writeBYTE(code);
-                                        }
-
-                                        else if (G_table_mode == TWO_BYTE_ENC){
-                                            if (getUTF8code_Short(tmp, &scode) < 0){
-                                                printf("Error looking up 2-byte code corresponding with UTF-8 character\n");
-                                                return -1;
-                                            }
-
-                                            /* Write the code to the output file */
-                                            writeSW(scode);
-                                        }
-
-                                        else{   //Straight UTF-8 Encoding
-                                            int z;
-
-                                            /* Write the data to the output file */
-                                            for (z = 0; z < numBytes; z++){
-                                                writeBYTE(tmp[z]);
-                                            }
-                                        }
-                                    }
-                                    pText += numBytes;
-                                }
-                            }
-                            break;
+                                /* Encoded when the node was sized */
+                                if (writeNodeText(ctx) != 0)
+                                    return -1;
+                                break;
 
                             /****************/
                             /* control-code */
                             /****************/
                             case CTRL_CODE:
-                                writeSW((unsigned short)rpNode->value);
+                                writeSW(ctx, (unsigned short)rpNode->value);
                                 break;
 
 
@@ -835,7 +618,7 @@ int writeBinScript(FILE* outFile){
                                 return -1;
                         }
 
-                        rpNode = rpNode->pNext;
+                        rpNode++;
                     }
                 }
             }	
@@ -850,7 +633,7 @@ int writeBinScript(FILE* outFile){
             }
             break;
         }
-        pNode = pNode->pNext;
+        pNode = getNextPtr(ctx, pNode);
     }
 
 
@@ -859,7 +642,7 @@ int writeBinScript(FILE* outFile){
     /**************************************************************/
 
     /* Get a Pointer to the Head of the linked list */
-    pNode = getHeadPtr();
+    pNode = getHeadPtr(ctx);
     while (pNode != NULL){
 
         scriptNode *ptrTarget;
@@ -868,34 +651,44 @@ int writeBinScript(FILE* outFile){
         if ((pNode->nodeType == NODE_POINTER) && (pNode->ptrValueFlag == 0)){
 
             /* Move file pointer to where the write is to take place */
-            offset = pNode->byteOffset;
-            pOutput = obuf + offset;
+            ctx->offset = pNode->byteOffset;
+            ctx->pOutput = ctx->obuf + ctx->offset;
 
             /* Check that operation can be completed */
-            if ((pNode->ptrSize + offset) > max_size_bytes){
+            if ((pNode->ptrSize + ctx->offset) > ctx->maxBinFsize){
                 printf("Error, pointer extending beyond max file size.\n");
                 return -1;
             }
 
             /* Retrieve the starting offset of the node in question */
-            ptrTarget = getListItemByID(pNode->ptrID);
+            ptrTarget = getListItemByID(ctx, pNode->ptrID);
             if (ptrTarget == NULL){
                 printf("Error locating pointer target.\n");
                 return -1;
             }
             ptrOffset = ptrTarget->fileOffset;
+            if ((pNode->ptrSize != 0) && (ptrOffset % pNode->ptrSize != 0)){
+                printf("Error, node %u at 0x%X is not aligned for a %u byte pointer.\n",
+                    ptrTarget->id, ptrOffset, pNode->ptrSize);
+                return -1;
+            }
 
             switch (pNode->ptrSize){
                 case 2:  /* Short Ptr */
                 {
                     ptrOffset /= 2;
-                    writeSW((unsigned short)(ptrOffset & 0xFFFF));
+                    if (ptrOffset > 0xFFFF){
+                        printf("Error, node %u at 0x%X is beyond the reach of a 2 byte pointer.\n",
+                            ptrTarget->id, ptrTarget->fileOffset);
+                        return -1;
+                    }
+                    writeSW(ctx, (unsigned short)ptrOffset);
                     break;
                 }
                 case 4: /* Long Ptr */
                 {
                     ptrOffset /= 4;
-                    writeLW(ptrOffset);
+                    writeLW(ctx, ptrOffset);
                     break;
                 }
                 default:
@@ -906,15 +699,109 @@ int writeBinScript(FILE* outFile){
             }
         }
 
-        pNode = pNode->pNext;
+        pNode = getNextPtr(ctx, pNode);
     }
 
     /**************************************/
     /* Output the binary data to the file */
     /**************************************/
-    fwrite(obuf, 1, max_boutput_size_bytes, outFile);
-    if (obuf != NULL)
-        free(obuf);
+    fwrite(ctx->obuf, 1, getUsedBytes(ctx), outFile);
+    if (ctx->obuf != NULL)
+        free(ctx->obuf);
+    ctx->obuf = ctx->pOutput = NULL;
+    ctx->obufSize = 0;
+
+    return 0;
+}
+
+
+
+
+/*****************************************************************************/
+/* Function: writeSizeReport                                                 */
+/* Purpose: Lists where the space of the last binary written went, as tab    */
+/*          separated tables of the bytes taken by each node, by each        */
+/*          pointer ID (the run reaching a command) and by each subroutine   */
+/*          code, followed by the bytes left under max_size_bytes.  Nodes    */
+/*          keep the sizes recorded by writeBinScript, so if it failed the   */
+/*          report shows the node that did not fit.  buildScriptCFG must be  */
+/*          called first for the pointer IDs.                                */
+/* Inputs:  Pointer to output file.                                          */
+/* Outputs: 0 on Pass, -1 on Fail.                                           */
+/*****************************************************************************/
+int writeSizeReport(lsb_context* ctx, FILE* outFile){
+
+    static const char* const typeNames[] = {
+        "", "goto", "fill-space", "pointer", "execute-subroutine", "run-commands", "options"
+    };
+    unsigned int numPtrs = getPtrTableEntries(ctx);
+    unsigned int *pPtrBytes, *pPtrNodes, *pCodeBytes, *pCodeNodes;
+    unsigned int ptrBytes, fillBytes, x;
+    scriptNode* pNode;
+
+    /* Totals per pointer ID (last one is unreached) and code */
+    pPtrBytes = (unsigned int*)calloc(2 * (numPtrs + 1) + 2 * 0x10000, sizeof(unsigned int));
+    if (pPtrBytes == NULL){
+        printf("Error allocating size report tables.\n");
+        return -1;
+    }
+    pPtrNodes = pPtrBytes + numPtrs + 1;
+    pCodeBytes = pPtrNodes + numPtrs + 1;
+    pCodeNodes = pCodeBytes + 0x10000;
+
+    fprintf(outFile, "Node ID\tType\tCode\tOffset\tBytes\tParent Ptr\r\n");
+    ptrBytes = fillBytes = 0;
+    for (pNode = getHeadPtr(ctx); pNode != NULL; pNode = getNextPtr(ctx, pNode)){
+        if (pNode->nodeType == NODE_GOTO)
+            continue;
+
+        fprintf(outFile, "%u\t%s\t", pNode->id, typeNames[pNode->nodeType]);
+        if (pNode->nodeType == NODE_POINTER){
+            ptrBytes += pNode->binSize;
+            fprintf(outFile, "\t0x%X\t%u\t\r\n", pNode->fileOffset, pNode->binSize);
+            continue;
+        }
+        if (pNode->nodeType == NODE_FILL_SPACE){
+            fillBytes += pNode->binSize;
+            fprintf(outFile, "\t0x%X\t%u\t\r\n", pNode->fileOffset, pNode->binSize);
+            continue;
+        }
+
+        x = pNode->subroutine_code & 0xFFFF;
+        pCodeBytes[x] += pNode->binSize;
+        pCodeNodes[x]++;
+        x = (pNode->pointerID < numPtrs) ? pNode->pointerID : numPtrs;
+        pPtrBytes[x] += pNode->binSize;
+        pPtrNodes[x]++;
+        fprintf(outFile, "0x%04X\t0x%X\t%u\t", pNode->subroutine_code, pNode->fileOffset, pNode->binSize);
+        if (pNode->pointerID != INVALID_PTR_ID)
+            fprintf(outFile, "%u", pNode->pointerID);
+        fprintf(outFile, "\r\n");
+    }
+
+    fprintf(outFile, "\r\nPointer ID\tCommands\tBytes\r\n");
+    for (x = 0; x <= numPtrs; x++){
+        if (pPtrNodes[x] == 0)
+            continue;
+        if (x < numPtrs)
+            fprintf(outFile, "%u\t%u\t%u\r\n", x, pPtrNodes[x], pPtrBytes[x]);
+        else
+            fprintf(outFile, "none\t%u\t%u\r\n", pPtrNodes[x], pPtrBytes[x]);
+    }
+
+    fprintf(outFile, "\r\nCode\tCommands\tBytes\r\n");
+    for (x = 0; x < 0x10000; x++){
+        if (pCodeNodes[x] > 0)
+            fprintf(outFile, "0x%04X\t%u\t%u\r\n", x, pCodeNodes[x], pCodeBytes[x]);
+    }
+
+    fprintf(outFile, "\r\nPointer table bytes\t%u\r\n", ptrBytes);
+    fprintf(outFile, "Fill bytes\t%u\r\n", fillBytes);
+    fprintf(outFile, "Used bytes\t%u\r\n", getUsedBytes(ctx));
+    fprintf(outFile, "Max size bytes\t%u\r\n", getBinMaxSize(ctx));
+    fprintf(outFile, "Remaining bytes\t%ld\r\n", (long)getBinMaxSize(ctx) - (long)getUsedBytes(ctx));
+
+    free(pPtrBytes);
 
     return 0;
 }
@@ -925,12 +812,12 @@ int writeBinScript(FILE* outFile){
 /******************************************************/
 /* formatVal - formats the given number as Hex or Dec */
 /******************************************************/
-static char* formatVal(unsigned int value){
+static char* formatVal(lsb_context* ctx, unsigned int value){
     
-    static char scratch[64];
-    int mode = getMetaScriptInputMode();
+    char* scratch = ctx->fmtBuf;
+    int mode = getMetaScriptInputMode(ctx);
 
-    memset(scratch, 0, 64);
+    memset(scratch, 0, FORMAT_BUF_SIZE);
     if (mode == RADIX_HEX){
         sprintf(scratch, "%X",value);
     }
@@ -944,6 +831,280 @@ static char* formatVal(unsigned int value){
 
 
 
+/*****************************************************************/
+/* copyText - Returns a writable copy of a pooled string.  Pooled */
+/*            text is shared between nodes and must not be       */
+/*            converted in place.  NULL is returned on failure.   */
+/*****************************************************************/
+static unsigned char* copyText(lsb_context* ctx, unsigned int str){
+
+    const char* pText = poolStr(&ctx->strings, str);
+    unsigned int len = (unsigned int)strlen(pText) + 1;
+
+    if (reserveTextBuf(ctx, len) == NULL)
+        return NULL;
+    memcpy(ctx->pTextBuf, pText, len);
+
+    return ctx->pTextBuf;
+}
+
+
+
+
+/*******************************************************************/
+/* sizeSubParams - Advances *pOffset past the parameters of an     */
+/*                 execute-subroutine written there.  A subtitle   */
+/*                 string adds nothing, its text is written by the */
+/*                 run-commands that follows.  Returns 0 or -1.    */
+/*******************************************************************/
+static int sizeSubParams(scriptNode* pNode, unsigned int* pOffset){
+
+    unsigned int x;
+
+    for (x = 0; x < pNode->num_parameters; x++){
+        switch (pNode->subParams[x].type){
+            case BYTE_PARAM:
+                *pOffset += 1;
+                break;
+            case SHORT_PARAM:
+                *pOffset += 2;
+                break;
+            case LONG_PARAM:
+                *pOffset += 4;
+                break;
+            case ALIGN_2_PARAM:
+                *pOffset += *pOffset & 0x1;
+                break;
+            case ALIGN_4_PARAM:
+                *pOffset = (*pOffset + 3) & ~0x3u;
+                break;
+            case SUBT_STR:
+                break;
+            default:
+                printf("Error, bad subroutine parameter detected.\n");
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+
+
+/*******************************************************************/
+/* sizeRunParams - Advances *pOffset past a run-commands / options */
+/*                 sequence written there, encoding its text into  */
+/*                 the node text cache (see cacheText).  Returns   */
+/*                 0 on success, -1 on failure.                    */
+/*******************************************************************/
+static int sizeRunParams(lsb_context* ctx, runParamType* rpNode, int compress, unsigned int* pOffset){
+
+    int numBytes;
+
+    while ((rpNode != NULL) && (rpNode->type != RUN_END)){
+
+        switch (rpNode->type){
+            case ALIGN_2_PARAM:
+                *pOffset += *pOffset & 0x1;
+                break;
+            case ALIGN_4_PARAM:
+                *pOffset = (*pOffset + 3) & ~0x3u;
+                break;
+            case SHOW_PORTRAIT_LEFT:
+            case SHOW_PORTRAIT_RIGHT:
+            case TIME_DELAY:
+            case CTRL_CODE:
+                *pOffset += 2;
+                break;
+            case PRINT_LINE:
+                numBytes = cacheText(ctx, rpNode->str, compress);
+                if (numBytes < 0)
+                    return -1;
+                *pOffset += numBytes;
+                break;
+            default:
+                printf("Error, bad run cmd parameter detected.\n");
+                return -1;
+        }
+
+        rpNode++;
+    }
+
+    return 0;
+}
+
+
+
+
+/*******************************************************************/
+/* cacheText                                                       */
+/* Encodes a print-line the way it is written to the binary and    */
+/* appends it, preceded by its length, to the node text cache.     */
+/* BPE text is compressed when compress is set (run-commands), and */
+/* otherwise written a code per short (options).  Encoding once    */
+/* lets a node be sized exactly before any of it is written.       */
+/* Returns the # of bytes the text takes, -1 on failure.           */
+/*******************************************************************/
+static int cacheText(lsb_context* ctx, unsigned int str, int compress){
+
+    unsigned char* pText;
+    unsigned int start, numBytes, x;
+    unsigned short scode;
+    char tmp[5];
+
+    /* Room for the length, filled in once the text is encoded */
+    start = ctx->nodeTextLen;
+    if (appendNodeText(ctx, NULL, sizeof(unsigned int)) != 0)
+        return -1;
+
+    /* BPE EDIT HERE */
+    if (ctx->table_mode == ONE_BYTE_ENC){
+        pText = copyText(ctx, str);
+        if (pText == NULL)
+            return -1;
+        utf8Text_to_8bit_binary((char*)pText, &numBytes);
+        if (compress){
+            if (ctx->bpeOptimal){
+                int saved = compressBPEOptimal(pText, &numBytes);
+                if (saved < 0)
+                    return -1;
+                ctx->bpeBytesSaved += saved;
+            }
+            else if (compressBPE(pText, &numBytes) != 0)
+                return -1;
+            if (appendNodeText(ctx, pText, numBytes) != 0)
+                return -1;
+        }
+        else{
+            /* Options are not worth compressing */
+            for (x = 0; x < numBytes; x++){
+                scode = (pText[x] == ' ') ? 0xF905 : (unsigned short)pText[x];
+                if (appendNodeTextSW(ctx, scode) != 0)
+                    return -1;
+            }
+        }
+    }
+    else{
+        pText = (unsigned char*)poolStr(&ctx->strings, str);
+        while (*pText != '\0'){
+
+            /* Read in a utf8 character */
+            numBytes = numBytesInUtf8Char((unsigned char)*pText);
+            memset(tmp, 0, 5);
+            memcpy(tmp, pText, numBytes);
+
+            /* Look up associated code */
+            if ((numBytes == 1) && (*pText == ' ')){
+                if (appendNodeTextSW(ctx, 0xF905) != 0) /* Space */
+                    return -1;
+            }
+            else if (ctx->table_mode == TWO_BYTE_ENC){
+                if (getUTF8code_Short(tmp, &scode) < 0){
+                    printf("Error looking up 2-byte code corresponding with UTF-8 character\n");
+                    return -1;
+                }
+                if (appendNodeTextSW(ctx, scode) != 0)
+                    return -1;
+            }
+            else{   //Straight UTF-8 Encoding
+                if (appendNodeText(ctx, (unsigned char*)tmp, numBytes) != 0)
+                    return -1;
+            }
+            pText += numBytes;
+        }
+    }
+
+    numBytes = ctx->nodeTextLen - start - sizeof(unsigned int);
+    memcpy(ctx->pNodeText + start, &numBytes, sizeof(unsigned int));
+
+    return (int)numBytes;
+}
+
+
+
+
+/*******************************************************************/
+/* appendNodeText - Appends numBytes to the node text cache, just  */
+/*                  reserving them if pData is NULL.  Returns 0 or */
+/*                  -1 if the cache cannot grow.                   */
+/*******************************************************************/
+static int appendNodeText(lsb_context* ctx, const unsigned char* pData, unsigned int numBytes){
+
+    unsigned char* pNew;
+    unsigned int newSize;
+
+    if (ctx->nodeTextLen + numBytes > ctx->nodeTextSize){
+        newSize = (ctx->nodeTextSize > 0) ? (ctx->nodeTextSize * 2) : 256;
+        if (newSize < ctx->nodeTextLen + numBytes)
+            newSize = ctx->nodeTextLen + numBytes;
+        pNew = (unsigned char*)realloc(ctx->pNodeText, newSize);
+        if (pNew == NULL){
+            printf("Error allocating memory for encoded text.\n");
+            return -1;
+        }
+        ctx->pNodeText = pNew;
+        ctx->nodeTextSize = newSize;
+    }
+    if (pData != NULL)
+        memcpy(ctx->pNodeText + ctx->nodeTextLen, pData, numBytes);
+    ctx->nodeTextLen += numBytes;
+
+    return 0;
+}
+
+
+
+
+/*******************************************************************/
+/* appendNodeTextSW - Appends a short in the output byte order.    */
+/*******************************************************************/
+static int appendNodeTextSW(lsb_context* ctx, unsigned short data){
+
+    unsigned char bytes[2];
+
+    if (ctx->output_endian_type == LUNAR_LITTLE_ENDIAN){
+        bytes[0] = (unsigned char)(data & 0xFF);
+        bytes[1] = (unsigned char)(data >> 8);
+    }
+    else{
+        bytes[0] = (unsigned char)(data >> 8);
+        bytes[1] = (unsigned char)(data & 0xFF);
+    }
+
+    return appendNodeText(ctx, bytes, 2);
+}
+
+
+
+
+/*******************************************************************/
+/* writeNodeText - Writes the next print-line from the node text   */
+/*                 cache.  Returns 0 on success, -1 on failure.    */
+/*******************************************************************/
+static int writeNodeText(lsb_context* ctx){
+
+    unsigned int numBytes, x;
+
+    if (ctx->nodeTextPos + sizeof(unsigned int) > ctx->nodeTextLen){
+        printf("Error, print-line text was not encoded.\n");
+        return -1;
+    }
+    memcpy(&numBytes, ctx->pNodeText + ctx->nodeTextPos, sizeof(unsigned int));
+    ctx->nodeTextPos += sizeof(unsigned int);
+
+    for (x = 0; x < numBytes; x++){
+        if (writeBYTE(ctx, ctx->pNodeText[ctx->nodeTextPos + x]) != 0)
+            return -1;
+    }
+    ctx->nodeTextPos += numBytes;
+
+    return 0;
+}
+
+
+
+
 /*****************************************************************************/
 /* Function: writeScript                                                     */
 /* Purpose: Reads from a linked list data structure in memory to create a    */
@@ -951,26 +1112,28 @@ static char* formatVal(unsigned int value){
 /* Inputs:  Pointer to output file.                                          */
 /* Outputs: 0 on Pass, -1 on Fail.                                           */
 /*****************************************************************************/
-int writeScript(FILE* outFile){
+int writeScript(lsb_context* ctx, FILE* outFile){
     
     int x;
     scriptNode* pNode = NULL;
 
     /* Output Header */
     fprintf(outFile, "(start\r\n");
-    if( getBinOutputMode() == LUNAR_BIG_ENDIAN)
+    if( getBinOutputMode(ctx) == LUNAR_BIG_ENDIAN)
         fprintf(outFile, "    (endian=big)\r\n");
     else
         fprintf(outFile, "    (endian=little)\r\n");
-    if (getMetaScriptInputMode() == RADIX_HEX)
+    if (getMetaScriptInputMode(ctx) == RADIX_HEX)
         fprintf(outFile, "    (radix=hex)\r\n");
     else
         fprintf(outFile, "    (radix=dec)\r\n");
-    fprintf(outFile, "    (max_size_bytes=%s)\r\n", formatVal(getBinMaxSize()));
+    fprintf(outFile, "    (max_size_bytes=%s)\r\n", formatVal(ctx, getBinMaxSize(ctx)));
+    fprintf(outFile, "    (ptr_table_entries=%s)\r\n", formatVal(ctx, getPtrTableEntries(ctx)));
+    fprintf(outFile, "    (ptr_entry_size=%s)\r\n", formatVal(ctx, getPtrEntrySize(ctx)));
     fprintf(outFile, ")\r\n");
 
     /* Get a Pointer to the Head of the linked list */
-    pNode = getHeadPtr();
+    pNode = getHeadPtr(ctx);
 
     /******************************************************************/
     /* Loop until the binary output corresponding to all list entries */
@@ -986,8 +1149,8 @@ int writeScript(FILE* outFile){
             /********/
             case NODE_GOTO:
             {
-                fprintf(outFile, "(goto id=%s\r\n", formatVal(pNode->id));
-                fprintf(outFile, "    (location %s)\r\n", formatVal(pNode->byteOffset));
+                fprintf(outFile, "(goto id=%s\r\n", formatVal(ctx, pNode->id));
+                fprintf(outFile, "    (location %s)\r\n", formatVal(ctx, pNode->byteOffset));
                 fprintf(outFile, ")\r\n");
             }
             break;
@@ -998,10 +1161,10 @@ int writeScript(FILE* outFile){
             /********/
             case NODE_FILL_SPACE:
             {
-                fprintf(outFile, "(fill-space id=%s\r\n", formatVal(pNode->id));
-                fprintf(outFile, "    (unit-size %s)\r\n", formatVal(pNode->unit_size));
-                fprintf(outFile, "    (fill-value %s)\r\n", formatVal(pNode->fillVal));
-                fprintf(outFile, "    (unit-count %s)\r\n", formatVal(pNode->unit_count));
+                fprintf(outFile, "(fill-space id=%s\r\n", formatVal(ctx, pNode->id));
+                fprintf(outFile, "    (unit-size %s)\r\n", formatVal(ctx, pNode->unit_size));
+                fprintf(outFile, "    (fill-value %s)\r\n", formatVal(ctx, pNode->fillVal));
+                fprintf(outFile, "    (unit-count %s)\r\n", formatVal(ctx, pNode->unit_count));
                 fprintf(outFile, ")\r\n");
             }
             break;
@@ -1012,13 +1175,13 @@ int writeScript(FILE* outFile){
             /***********/
             case NODE_POINTER:
             {
-                fprintf(outFile, "(pointer id=%s\r\n", formatVal(pNode->id));
-                fprintf(outFile, "    (byteoffset %s)\r\n", formatVal(pNode->byteOffset));
-                fprintf(outFile, "    (size %s)\r\n", formatVal(pNode->ptrSize));
+                fprintf(outFile, "(pointer id=%s\r\n", formatVal(ctx, pNode->id));
+                fprintf(outFile, "    (byteoffset %s)\r\n", formatVal(ctx, pNode->byteOffset));
+                fprintf(outFile, "    (size %s)\r\n", formatVal(ctx, pNode->ptrSize));
                 if (pNode->ptrValueFlag)
-                    fprintf(outFile, "    (value %s)\r\n", formatVal(pNode->ptrValue));
+                    fprintf(outFile, "    (value %s)\r\n", formatVal(ctx, pNode->ptrValue));
                 else
-                    fprintf(outFile, "    (id-link %s)\r\n", formatVal(pNode->ptrID));
+                    fprintf(outFile, "    (id-link %s)\r\n", formatVal(ctx, pNode->ptrID));
                 fprintf(outFile, ")\r\n");
             }
             break;
@@ -1029,11 +1192,11 @@ int writeScript(FILE* outFile){
             /*****************************************************/
             case NODE_EXE_SUB:
             {
-                fprintf(outFile, "(execute-subroutine id=%s\r\n", formatVal(pNode->id));
-                fprintf(outFile, "    (subroutine %s)\r\n", formatVal(pNode->subroutine_code));
-                fprintf(outFile, "    (num-parameters %s)\r\n", formatVal(pNode->num_parameters));
+                fprintf(outFile, "(execute-subroutine id=%s\r\n", formatVal(ctx, pNode->id));
+                fprintf(outFile, "    (subroutine %s)\r\n", formatVal(ctx, pNode->subroutine_code));
+                fprintf(outFile, "    (num-parameters %s)\r\n", formatVal(ctx, pNode->num_parameters));
                 if (pNode->num_parameters > 0){
-                    fprintf(outFile, "    (align-fill-byteval %s)\r\n", formatVal(pNode->alignfillVal));
+                    fprintf(outFile, "    (align-fill-byteval %s)\r\n", formatVal(ctx, pNode->alignfillVal));
                     fprintf(outFile, "    (parameter-types ");
                     for (x = 0; x < (int)pNode->num_parameters; x++){
                         switch (pNode->subParams[x].type){
@@ -1070,7 +1233,7 @@ int writeScript(FILE* outFile){
 						if (pNode->subParams[x].type == SUBT_STR)
 							subtitle_hack = 1;
 						else
-							fprintf(outFile, "%s ", formatVal(pNode->subParams[x].value));
+							fprintf(outFile, "%s ", formatVal(ctx, pNode->subParams[x].value));
                     }
                     fprintf(outFile, ")\r\n");
                 }
@@ -1088,41 +1251,41 @@ int writeScript(FILE* outFile){
                 runParamType* rpNode = pNode->runParams;
 
 				if (subtitle_hack)
-	                fprintf(outFile, "(run-commands id=%s\r\n", formatVal(pNode->id + 9000));
+	                fprintf(outFile, "(run-commands id=%s\r\n", formatVal(ctx, pNode->id + 9000));
 				else
-					fprintf(outFile, "(run-commands id=%s\r\n", formatVal(pNode->id));
+					fprintf(outFile, "(run-commands id=%s\r\n", formatVal(ctx, pNode->id));
 
-                while (rpNode != NULL) {
+                while ((rpNode != NULL) && (rpNode->type != RUN_END)) {
 
                     switch (rpNode->type){
 
                         case ALIGN_2_PARAM:
-                            fprintf(outFile, "    (align-2 %s)\r\n", formatVal(rpNode->value));
+                            fprintf(outFile, "    (align-2 %s)\r\n", formatVal(ctx, rpNode->value));
                             break;
                         case ALIGN_4_PARAM:
-                            fprintf(outFile, "    (align-4 %s)\r\n", formatVal(rpNode->value));
+                            fprintf(outFile, "    (align-4 %s)\r\n", formatVal(ctx, rpNode->value));
                             break;
                         case SHOW_PORTRAIT_LEFT:
-                            fprintf(outFile, "    (show-portrait-left %s)\r\n", formatVal(rpNode->value & 0xFF));
+                            fprintf(outFile, "    (show-portrait-left %s)\r\n", formatVal(ctx, rpNode->value & 0xFF));
                             break;
                         case SHOW_PORTRAIT_RIGHT:
-                            fprintf(outFile, "    (show-portrait-right %s)\r\n", formatVal(rpNode->value & 0xFF));
+                            fprintf(outFile, "    (show-portrait-right %s)\r\n", formatVal(ctx, rpNode->value & 0xFF));
                             break;
                         case TIME_DELAY:
-                            fprintf(outFile, "    (time-delay %s)\r\n", formatVal(rpNode->value & 0xFF));
+                            fprintf(outFile, "    (time-delay %s)\r\n", formatVal(ctx, rpNode->value & 0xFF));
                             break;
                         case PRINT_LINE:
-                            fprintf(outFile, "    (print-line `%s`)\r\n", rpNode->str);
+                            fprintf(outFile, "    (print-line `%s`)\r\n", poolStr(&ctx->strings, rpNode->str));
                             break;
                         case CTRL_CODE:
-                            fprintf(outFile, "    (control-code %s)\r\n", formatVal(rpNode->value));
+                            fprintf(outFile, "    (control-code %s)\r\n", formatVal(ctx, rpNode->value));
                             break;
                         default:
                             printf("Error, bad run cmd parameter detected.\n");
                             return -1;
                     }
 
-                    rpNode = rpNode->pNext;
+                    rpNode++;
                 }
                 fprintf(outFile, "    (commands-end)\r\n");
                 fprintf(outFile, ")\r\n");
@@ -1137,11 +1300,11 @@ int writeScript(FILE* outFile){
             {
                 runParamType* rpNode = NULL;
 
-                fprintf(outFile, "(options id=%s\r\n", formatVal(pNode->id));
+                fprintf(outFile, "(options id=%s\r\n", formatVal(ctx, pNode->id));
 
                 /* Print the 2 required parameters */
-                fprintf(outFile, "    (jmpparam %s)\r\n", formatVal(pNode->subParams[0].value));
-                fprintf(outFile, "    (param2 %s)\r\n", formatVal(pNode->subParams[1].value));
+                fprintf(outFile, "    (jmpparam %s)\r\n", formatVal(ctx, pNode->subParams[0].value));
+                fprintf(outFile, "    (param2 %s)\r\n", formatVal(ctx, pNode->subParams[1].value));
 
                 /* Fixed at 2 options */
                 for (x = 0; x < 2; x++){
@@ -1153,28 +1316,28 @@ int writeScript(FILE* outFile){
                         rpNode = pNode->runParams2;
                         fprintf(outFile, "    (opt2)\r\n");
                     }
-                    while (rpNode != NULL) {
+                    while ((rpNode != NULL) && (rpNode->type != RUN_END)) {
 
                         switch (rpNode->type){
 
                         case ALIGN_2_PARAM:
-                            fprintf(outFile, "    (align-2 %s)\r\n", formatVal(rpNode->value));
+                            fprintf(outFile, "    (align-2 %s)\r\n", formatVal(ctx, rpNode->value));
                             break;
                         case ALIGN_4_PARAM:
-                            fprintf(outFile, "    (align-4 %s)\r\n", formatVal(rpNode->value));
+                            fprintf(outFile, "    (align-4 %s)\r\n", formatVal(ctx, rpNode->value));
                             break;
                         case PRINT_LINE:
-                            fprintf(outFile, "    (print-line `%s`)\r\n", rpNode->str);
+                            fprintf(outFile, "    (print-line `%s`)\r\n", poolStr(&ctx->strings, rpNode->str));
                             break;
                         case CTRL_CODE:
-                            fprintf(outFile, "    (control-code %s)\r\n", formatVal(rpNode->value));
+                            fprintf(outFile, "    (control-code %s)\r\n", formatVal(ctx, rpNode->value));
                             break;
                         default:
                             printf("Error, bad run cmd parameter detected.\n");
                             return -1;
                         }
 
-                        rpNode = rpNode->pNext;
+                        rpNode++;
                     }
                     fprintf(outFile, "    (opt-end)\r\n");
                 }
@@ -1190,7 +1353,7 @@ int writeScript(FILE* outFile){
             }
             break;
         }
-        pNode = pNode->pNext;
+        pNode = getNextPtr(ctx, pNode);
     }
 
     /* End Footer */
@@ -1210,7 +1373,7 @@ int writeScript(FILE* outFile){
 /* Inputs:  Pointer to output file.                                          */
 /* Outputs: 0 on Pass, -1 on Fail.                                           */
 /*****************************************************************************/
-int dumpScript(FILE* outFile, FILE* txtOutFile){
+int dumpScript(lsb_context* ctx, FILE* outFile, FILE* txtOutFile){
 
     int x;
     scriptNode* pNode = NULL;
@@ -1219,7 +1382,7 @@ int dumpScript(FILE* outFile, FILE* txtOutFile){
     fprintf(outFile, "Parent Ptr\tNode ID\tType\tJP Text\tCtrl Codes\r\n");
 
     /* Get a Pointer to the Head of the linked list */
-    pNode = getHeadPtr();
+    pNode = getHeadPtr(ctx);
 
     /******************************************************************/
     /* Loop until the binary output corresponding to all list entries */
@@ -2150,7 +2313,7 @@ int dumpScript(FILE* outFile, FILE* txtOutFile){
 
 
                     default:
-                        ; /* Do Nothing */
+                        fprintf(outFile, "\r\n"); /* Row with just the IDs */
                 }
             }
             break;
@@ -2172,7 +2335,7 @@ int dumpScript(FILE* outFile, FILE* txtOutFile){
 
                 fprintf(outFile, "\tTALK %u", pNode->id);
 
-                while (rpNode != NULL) {
+                while ((rpNode != NULL) && (rpNode->type != RUN_END)) {
 
                     switch (rpNode->type){
 
@@ -2198,7 +2361,7 @@ int dumpScript(FILE* outFile, FILE* txtOutFile){
                             fprintf(outFile, "\r\n\t\t");
                         }
 
-                        fprintf(outFile, "\t%s\t", rpNode->str);
+                        fprintf(outFile, "\t%s\t", poolStr(&ctx->strings, rpNode->str));
                         ctrlMode = 1;
 
                         //Text Dump
@@ -2206,7 +2369,7 @@ int dumpScript(FILE* outFile, FILE* txtOutFile){
                             textDetected = 1;
                             fprintf(txtOutFile, "`");
                         }
-                        fprintf(txtOutFile, "%s", rpNode->str);
+                        fprintf(txtOutFile, "%s", poolStr(&ctx->strings, rpNode->str));
                         break;
                     case TIME_DELAY:
                     case CTRL_CODE:
@@ -2215,7 +2378,7 @@ int dumpScript(FILE* outFile, FILE* txtOutFile){
                             fprintf(outFile, "\t\t");
                         }
                         else{
-                            fprintf(outFile, "(control-code %s%s) ", formatVal(rpNode->value), ctrlCodeLkup((unsigned short)rpNode->value));
+                            fprintf(outFile, "(control-code %s%s) ", formatVal(ctx, rpNode->value), ctrlCodeLkup(ctx, (unsigned short)rpNode->value));
                         }
 
                         //Text Dump
@@ -2235,7 +2398,7 @@ int dumpScript(FILE* outFile, FILE* txtOutFile){
                         printf("Error, bad run cmd parameter detected.\n");
                         return -1;
                     }
-                    rpNode = rpNode->pNext;
+                    rpNode++;
                 }
                 fprintf(outFile, "\r\n");
             }
@@ -2267,7 +2430,7 @@ int dumpScript(FILE* outFile, FILE* txtOutFile){
                         fprintf(outFile, "\r\n\t\tOpt2 : %d",pNode->subParams[0].value);
                     }
                     ctrlMode = 0;
-                    while (rpNode != NULL) {
+                    while ((rpNode != NULL) && (rpNode->type != RUN_END)) {
 
                         switch (rpNode->type){
 
@@ -2282,7 +2445,7 @@ int dumpScript(FILE* outFile, FILE* txtOutFile){
                                 fprintf(outFile, "\r\n\t\t");
                             }
 
-                            fprintf(outFile, "\t%s\t", rpNode->str);
+                            fprintf(outFile, "\t%s\t", poolStr(&ctx->strings, rpNode->str));
                             ctrlMode = 1;
                             break;
                         case CTRL_CODE:
@@ -2292,7 +2455,7 @@ int dumpScript(FILE* outFile, FILE* txtOutFile){
                                 fprintf(outFile, "\t\t");
                             }
                             else{
-                                fprintf(outFile, "(control-code %s%s) ", formatVal(rpNode->value), ctrlCodeLkup((unsigned short)rpNode->value));
+                                fprintf(outFile, "(control-code %s%s) ", formatVal(ctx, rpNode->value), ctrlCodeLkup(ctx, (unsigned short)rpNode->value));
                             }
 
                             break;
@@ -2301,7 +2464,7 @@ int dumpScript(FILE* outFile, FILE* txtOutFile){
                             return -1;
                         }
 
-                        rpNode = rpNode->pNext;
+                        rpNode++;
                     }
                 }
                 fprintf(outFile, "\r\n");
@@ -2317,7 +2480,7 @@ int dumpScript(FILE* outFile, FILE* txtOutFile){
         }
             break;
         }
-        pNode = pNode->pNext;
+        pNode = getNextPtr(ctx, pNode);
     }
 
     return 0;
@@ -2331,9 +2494,9 @@ FF02 <Newline>\n
 FF03 \n<NewTextBox>\n
 FF04 \n<EndText>\n
 */
-char* ctrlCodeLkup(unsigned short ctrlCode){
+char* ctrlCodeLkup(lsb_context* ctx, unsigned short ctrlCode){
 
-    static char ttxt[300];
+    char* ttxt = ctx->ctrlTxt;
 
     switch (ctrlCode){
         case 0xFF00:
@@ -2383,7 +2546,7 @@ char* ctrlCodeLkup(unsigned short ctrlCode){
 /* Inputs:  Pointer to output file.                                          */
 /* Outputs: 0 on Pass, -1 on Fail.                                           */
 /*****************************************************************************/
-int dumpScript(FILE* outFile){
+int dumpScript(lsb_context* ctx, FILE* outFile){
 
     int x;
     scriptNode* pNode = NULL;
@@ -2392,7 +2555,7 @@ int dumpScript(FILE* outFile){
     fprintf(outFile, "Node ID\tType\tJP Text\r\n");
 
     /* Get a Pointer to the Head of the linked list */
-    pNode = getHeadPtr();
+    pNode = getHeadPtr(ctx);
 
     /******************************************************************/
     /* Loop until the binary output corresponding to all list entries */
@@ -2454,7 +2617,7 @@ int dumpScript(FILE* outFile){
 
             fprintf(outFile, "\tDialog", pNode->id);
 
-            while (rpNode != NULL) {
+            while ((rpNode != NULL) && (rpNode->type != RUN_END)) {
 
                 switch (rpNode->type){
 
@@ -2471,9 +2634,9 @@ int dumpScript(FILE* outFile){
                         fprintf(outFile, "\t");
                     }
                     if (rpNode->type == SHOW_PORTRAIT_LEFT)
-                        fprintf(outFile, "\t (portrait-left %s)\r\n", formatVal(rpNode->value));
+                        fprintf(outFile, "\t (portrait-left %s)\r\n", formatVal(ctx, rpNode->value));
                     else
-                        fprintf(outFile, "\t (portrait-right %s)\r\n", formatVal(rpNode->value));
+                        fprintf(outFile, "\t (portrait-right %s)\r\n", formatVal(ctx, rpNode->value));
                     break;
                 case TIME_DELAY:
                     if (count == 0){
@@ -2482,7 +2645,7 @@ int dumpScript(FILE* outFile){
                     else{
                         fprintf(outFile, "\t");
                     }
-                    fprintf(outFile, "\t (delay-time %s)\r\n", formatVal(rpNode->value));
+                    fprintf(outFile, "\t (delay-time %s)\r\n", formatVal(ctx, rpNode->value));
                     break;
                 case PRINT_LINE:
                     if (count == 0){
@@ -2491,7 +2654,7 @@ int dumpScript(FILE* outFile){
                     else{
                         fprintf(outFile, "\t");
                     }
-                    fprintf(outFile, "\t%s\r\n", rpNode->str);
+                    fprintf(outFile, "\t%s\r\n", poolStr(&ctx->strings, rpNode->str));
                     break;
                 case CTRL_CODE:
                     if (count == 0){
@@ -2501,14 +2664,14 @@ int dumpScript(FILE* outFile){
                         fprintf(outFile, "\t");
                     }
 
-                    fprintf(outFile, "\t (control-code %s%s)\r\n", formatVal(rpNode->value), ctrlCodeLkup((unsigned short)rpNode->value));
+                    fprintf(outFile, "\t (control-code %s%s)\r\n", formatVal(ctx, rpNode->value), ctrlCodeLkup(ctx, (unsigned short)rpNode->value));
                     break;
                 default:
                     printf("Error, bad run cmd parameter detected.\n");
                     return -1;
                 }
 
-                rpNode = rpNode->pNext;
+                rpNode++;
             }
         }
             break;
@@ -2536,7 +2699,7 @@ int dumpScript(FILE* outFile){
                     fprintf(outFile, "\tOpt2");
                 }
                 count = 0;
-                while (rpNode != NULL) {
+                while ((rpNode != NULL) && (rpNode->type != RUN_END)) {
 
                     switch (rpNode->type){
 
@@ -2552,7 +2715,7 @@ int dumpScript(FILE* outFile){
                             fprintf(outFile, "\t");
                         }
 
-                        fprintf(outFile, "\t%s\r\n", rpNode->str);
+                        fprintf(outFile, "\t%s\r\n", poolStr(&ctx->strings, rpNode->str));
                         break;
                     case CTRL_CODE:
                         if (count == 0){
@@ -2562,14 +2725,14 @@ int dumpScript(FILE* outFile){
                             fprintf(outFile, "\t");
                         }
 
-                        fprintf(outFile, "\t (control-code %s%s)\r\n", formatVal(rpNode->value), ctrlCodeLkup((unsigned short)rpNode->value));
+                        fprintf(outFile, "\t (control-code %s%s)\r\n", formatVal(ctx, rpNode->value), ctrlCodeLkup(ctx, (unsigned short)rpNode->value));
                         break;
                     default:
                         printf("Error, bad run cmd parameter detected.\n");
                         return -1;
                     }
 
-                    rpNode = rpNode->pNext;
+                    rpNode++;
                 }
             }
         }
@@ -2583,7 +2746,7 @@ int dumpScript(FILE* outFile){
         }
             break;
         }
-        pNode = pNode->pNext;
+        pNode = getNextPtr(ctx, pNode);
     }
 
     return 0;
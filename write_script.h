@@ -2,9 +2,11 @@
 #define WRITE_SCRIPT_H
 
 #include <stdio.h>
+#include "lsb_context.h"
 
-int writeBinScript(FILE* outFile);
-int writeScript(FILE* outFile);
-int dumpScript(FILE* outFile, FILE* txtOutFile);
+int writeBinScript(lsb_context* ctx, FILE* outFile);
+int writeSizeReport(lsb_context* ctx, FILE* outFile);
+int writeScript(lsb_context* ctx, FILE* outFile);
+int dumpScript(lsb_context* ctx, FILE* outFile, FILE* txtOutFile);
 
 #endif